@@ -0,0 +1,27 @@
+include ($$_PRO_FILE_PWD_/../DP_Locations.pri)
+include(../DP_Dependencies.pri)
+include(../DP_Application.pri)
+
+TARGET = DP_BatchFilter
+
+QT += core
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x070000
+DEFINES += APP_NAME=BATCHFILTER
+
+HEADERS += \
+    class_batchfilter.h \
+    class_boundedqueue.h
+
+SOURCES += \
+    class_batchfilter.cpp \
+    main.cpp
+
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_LFLAGS += -fopenmp
+LIBS += -fopenmp
@@ -0,0 +1,584 @@
+#include "class_batchfilter.h"
+#include "class_boundedqueue.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <class_trackingfilemanager.h>
+#include <class_salarasettings.h>
+
+#include <algorithms.h>
+#include <helpers.h>
+#include <class_cpf.h>
+#include <class_crd.h>
+#include <crdutils.h>
+#include <rtfilter.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <thread>
+
+// Conversion from metres (one way) to picoseconds (two way), as used in the Filter Tester.
+constexpr double kMetreToPs2w = 3335.640951982;
+
+const QMap<QString, BatchFilterConfig::Stage> BatchFilterConfig::kStageNames =
+{
+    {"window", BatchFilterConfig::Stage::WINDOW},
+    {"prefilter", BatchFilterConfig::Stage::PREFILTER},
+    {"postfilter", BatchFilterConfig::Stage::POSTFILTER},
+    {"threshold", BatchFilterConfig::Stage::THRESHOLD},
+    {"stats", BatchFilterConfig::Stage::STATS}
+};
+
+BatchFilterConfig::BatchFilterConfig() :
+    chain({Stage::WINDOW, Stage::PREFILTER, Stage::THRESHOLD, Stage::STATS}),
+    win_upper(40.), win_lower(-40.),
+    pre_bs(0.33), pre_depth(0.17), pre_min_ph(5), pre_divisions(5),
+    post_bs(200.), post_depth(0.1),
+    thresh_rf(2.5), thresh_iter(20),
+    stats_rf(2.5), crd_bs(30),
+    threads(std::max(1u, std::thread::hardware_concurrency())), queue_size(64),
+    rt_replay(false), rt_rate(10000.), rt_window(1.)
+{}
+
+BatchFilter::BatchFilter(const BatchFilterConfig &config, QTextStream &metrics) :
+    config(config),
+    metrics_stream(metrics)
+{}
+
+std::size_t BatchFilter::run(const QStringList &files)
+{
+    BoundedQueue<QString> queue(this->config.queue_size);
+    std::atomic<std::size_t> processed_ok(0);
+    std::vector<std::thread> workers;
+
+    // Workers. Each one takes the next file from the queue until it is closed and drained.
+    for (unsigned i = 0; i < this->config.threads; i++)
+    {
+        workers.emplace_back([this, &queue, &processed_ok]
+        {
+            QString file_path;
+            while (queue.pop(file_path))
+            {
+                QJsonObject metrics;
+                auto start = std::chrono::steady_clock::now();
+                SalaraInformation errors = this->processFile(file_path, metrics);
+                auto end = std::chrono::steady_clock::now();
+
+                metrics.insert("file", file_path);
+                metrics.insert("total_ms", std::chrono::duration<double, std::milli>(end - start).count());
+                if (errors.hasError())
+                {
+                    QJsonArray errors_array;
+                    for (const auto& error : errors.getErrors())
+                        errors_array.append(error.second);
+                    metrics.insert("status", "error");
+                    metrics.insert("errors", errors_array);
+                }
+                else
+                {
+                    metrics.insert("status", "ok");
+                    processed_ok++;
+                }
+
+                this->emitMetrics(metrics);
+            }
+        });
+    }
+
+    // Producer. Blocks while the queue is full.
+    for (const auto& file : files)
+        queue.push(file);
+
+    queue.close();
+
+    for (auto&& worker : workers)
+        worker.join();
+
+    return processed_ok;
+}
+
+QStringList BatchFilter::collectFiles(const QString &dir)
+{
+    QStringList filters{"*.dptr"};
+    for (const auto& ext : dpslr::CRD::ExtensionsString)
+        filters.append(QString("*.") + ext);
+
+    QStringList files;
+    for (const auto& info : QDir(dir).entryInfoList(filters, QDir::Files, QDir::Name))
+        files.append(info.absoluteFilePath());
+
+    return files;
+}
+
+SalaraInformation BatchFilter::processFile(const QString &file_path, QJsonObject &metrics) const
+{
+    QString suffix = QFileInfo(file_path).suffix().toLower();
+
+    if ("dptr" == suffix)
+        return this->processTracking(file_path, metrics);
+
+    // Only full rate CRD files can be filtered.
+    if ("frd" == suffix || "fr2" == suffix || "crd" == suffix)
+        return this->processCRD(file_path, metrics);
+
+    return SalaraInformation({ErrorEnum::FILE_NOT_SUPPORTED, "File type not supported: " + file_path});
+}
+
+SalaraInformation BatchFilter::processTracking(const QString &file_path, QJsonObject &metrics) const
+{
+    QFileInfo info(file_path);
+    Tracking track;
+
+    // Read the tracking. Any error is fatal, because writing a tracking with missing calibrations would drop them.
+    SalaraInformation errors = TrackingFileManager::readTracking(info.fileName(), info.absolutePath(),
+                                                                 this->config.calib_dir, track);
+    if (errors.hasError())
+        return errors;
+
+    // Get the residuals of the valid ranges. The time is corrected at day change.
+    std::vector<std::size_t> range_idxs;
+    std::vector<double> times, resids;
+    long double prev_start = -1.L;
+    long double offset = 0.L;
+
+    for (std::size_t i = 0; i < track.ranges.size(); i++)
+    {
+        const auto& shot = track.ranges[i];
+        if (shot.start_time < prev_start)
+            offset += 86400.L;
+        prev_start = shot.start_time;
+
+        if (Tracking::RangeData::FilterFlag::UNKNOWN == shot.flag)
+            continue;
+
+        range_idxs.push_back(i);
+        times.push_back(static_cast<double>(shot.start_time + offset));
+        resids.push_back(shot.tof_2w - shot.pre_2w - shot.trop_corr_2w -
+                         static_cast<long long>(track.cal_val_overall));
+    }
+
+    metrics.insert("type", "dptr");
+    metrics.insert("ptn", static_cast<qint64>(times.size()));
+
+    if (times.empty())
+        return SalaraInformation({ErrorEnum::NO_DATA, "No ranges to filter in: " + file_path});
+
+    // Apply the filter chain.
+    dpslr::algorithms::ResidualsStats stats;
+    bool stats_ok = false;
+    auto result = this->applyChain(times, resids, track.obj_bs, stats, stats_ok);
+
+    // Update the flags.
+    for (const auto& idx : range_idxs)
+        track.ranges[idx].flag = Tracking::RangeData::FilterFlag::NOISE;
+    for (const auto& idx : result.first)
+        track.ranges[range_idxs[idx]].flag = Tracking::RangeData::FilterFlag::DATA;
+
+    // Update the statistics.
+    if (stats_ok)
+    {
+        track.rf = this->config.stats_rf;
+        track.stats_rfrms = stats.total_bin_stats.stats_rfrms;
+        track.stats_1rms = stats.total_bin_stats.stats_01rms;
+        track.tror_rfrms = track.nshots > 0 ? (stats.total_bin_stats.stats_rfrms.aptn * 100.) / track.nshots : 0.;
+        track.tror_1rms = track.nshots > 0 ? (stats.total_bin_stats.stats_01rms.aptn * 100.) / track.nshots : 0.;
+    }
+
+    track.filter_mode = Tracking::FilterMode::AUTO;
+
+    // Store the metrics.
+    QJsonArray passes;
+    for (const auto& pass : result.second)
+    {
+        passes.append(QJsonObject{{"stage", BatchFilterConfig::kStageNames.key(pass.stage)},
+                                  {"in", static_cast<qint64>(pass.in)},
+                                  {"out", static_cast<qint64>(pass.out)},
+                                  {"arate", pass.in > 0 ? pass.out * 100. / pass.in : 0.},
+                                  {"ms", pass.ms}});
+    }
+    metrics.insert("passes", passes);
+    metrics.insert("accepted", static_cast<qint64>(result.first.size()));
+    metrics.insert("arate", result.first.size() * 100. / times.size());
+    if (stats_ok)
+        metrics.insert("rms_rfrms", static_cast<double>(stats.total_bin_stats.stats_rfrms.rms));
+
+    // Real time filter replay.
+    if (this->config.rt_replay)
+    {
+        errors = this->replayTracking(track, range_idxs, times, result.first, metrics);
+        if (errors.hasError())
+            return errors;
+    }
+
+    // Write the filtered tracking.
+    return TrackingFileManager::writeTracking(track, this->config.output_dir);
+}
+
+SalaraInformation BatchFilter::processCRD(const QString &file_path, QJsonObject &metrics) const
+{
+    dpslr::CRD crd(file_path.toStdString(), dpslr::CRD::OpenOptionEnum::ALL_DATA);
+
+    metrics.insert("type", "crd");
+
+    if (crd.empty() || crd.getData().fullRateRecords().empty() || !crd.getHeader().targetHeader() ||
+            !crd.getHeader().sessionHeader())
+        return SalaraInformation({ErrorEnum::NO_DATA, "No full rate data to filter in: " + file_path});
+
+    // Find the CPF used to generate the residuals.
+    QString cpf_path = this->findCPF(crd.getHeader().targetHeader()->norad,
+                                     crd.getHeader().sessionHeader()->start_time);
+    if (cpf_path.isEmpty())
+        return SalaraInformation({ErrorEnum::CPF_NOT_FOUND, "CPF not found for: " + file_path});
+
+    dpslr::CPF cpf(cpf_path.toStdString(), dpslr::CPF::OpenOptionEnum::ALL_DATA);
+
+    // Station location.
+    dpslr::geo::frames::GeodeticPoint<long double> geodetic;
+    dpslr::geo::frames::GeocentricPoint<long double> geocentric;
+    SalaraInformation errors = this->stationLocation(geodetic, geocentric);
+    if (errors.hasError())
+        return errors;
+
+    // Residuals.
+    dpslr::common::ResidualsData<> rdata;
+    auto res_error = dpslr::algorithms::calculateFullRateResiduals(cpf, crd, geodetic, geocentric,
+                                                                   this->config.crd_bs, rdata);
+    if (dpslr::algorithms::FullRateResCalcErr::NOT_ERROR != res_error)
+        return SalaraInformation({ErrorEnum::RESIDUALS_FAILED, "Residuals calculation failed for: " + file_path});
+
+    std::vector<double> times, resids;
+    long double prev_start = -1.L;
+    long double offset = 0.L;
+    for (const auto& res : rdata)
+    {
+        if (res.first < prev_start)
+            offset += 86400.L;
+        prev_start = res.first;
+        times.push_back(static_cast<double>(res.first + offset));
+        resids.push_back(static_cast<double>(res.second));
+    }
+
+    metrics.insert("ptn", static_cast<qint64>(times.size()));
+
+    // Apply the filter chain.
+    dpslr::algorithms::ResidualsStats stats;
+    bool stats_ok = false;
+    auto result = this->applyChain(times, resids, this->config.crd_bs, stats, stats_ok);
+
+    // Update the flags.
+    auto& fr_records = crd.getData().fullRateRecords();
+    for (auto&& record : fr_records)
+        record.filter_flag = dpslr::CRDData::FilterFlagEnum::NOISE_EXCLUDED_RETURN;
+    for (const auto& idx : result.first)
+        fr_records[idx].filter_flag = dpslr::CRDData::FilterFlagEnum::DATA;
+
+    // Update the statistics record.
+    if (stats_ok)
+    {
+        dpslr::CRDData::StatisticsRecord stat_record;
+        stat_record.system_cfg_id = fr_records.front().system_cfg_id;
+        stat_record.rms = static_cast<double>(stats.total_bin_stats.stats_rfrms.rms);
+        stat_record.skew = static_cast<double>(stats.total_bin_stats.stats_rfrms.skew);
+        stat_record.kurtosis = static_cast<double>(stats.total_bin_stats.stats_rfrms.kurt);
+        stat_record.peak = static_cast<double>(stats.total_bin_stats.stats_rfrms.peak -
+                                               stats.total_bin_stats.stats_rfrms.mean);
+        stat_record.quality = dpslr::CRDData::DataQualityEnum::UNDEFINED_QUALITY;
+        crd.getData().setStatisticsRecord(stat_record);
+    }
+
+    // Store the metrics.
+    QJsonArray passes;
+    for (const auto& pass : result.second)
+    {
+        passes.append(QJsonObject{{"stage", BatchFilterConfig::kStageNames.key(pass.stage)},
+                                  {"in", static_cast<qint64>(pass.in)},
+                                  {"out", static_cast<qint64>(pass.out)},
+                                  {"arate", pass.in > 0 ? pass.out * 100. / pass.in : 0.},
+                                  {"ms", pass.ms}});
+    }
+    metrics.insert("passes", passes);
+    metrics.insert("accepted", static_cast<qint64>(result.first.size()));
+    metrics.insert("arate", times.empty() ? 0. : result.first.size() * 100. / times.size());
+    metrics.insert("cpf", QFileInfo(cpf_path).fileName());
+
+    // Write the filtered CRD.
+    QString dest = this->config.output_dir + '/' + QFileInfo(file_path).fileName();
+    if (dpslr::CRD::WriteFileErrorEnum::NOT_ERROR !=
+            crd.writeCRDFile(dest.toStdString(), dpslr::CRDData::DataGenerationOptionEnum::FULL_RATE, true))
+        return SalaraInformation({ErrorEnum::WRITE_FAILED, "The filtered CRD could not be written: " + dest});
+
+    // Normal points of the filtered data, with the ILRS bin size of the object.
+    const double np_bs = dpslr::crdutils::normalPointBinSize(cpf);
+    auto np_error = dpslr::crdutils::generateNormalPoints(np_bs, geodetic, geocentric, cpf, crd,
+                                                          this->config.stats_rf);
+    metrics.insert("np_bs", np_bs);
+    metrics.insert("np", static_cast<qint64>(crd.getData().normalPointRecords().size()));
+    if (dpslr::crdutils::NPGenErr::NOT_ERROR != np_error &&
+            dpslr::crdutils::NPGenErr::SOME_BINS_CALC_FAILED != np_error)
+        return SalaraInformation({ErrorEnum::NP_FAILED, "The normal points could not be generated for: " + file_path});
+
+    // Write the normal points file, with the normal point data type in the session header.
+    auto session = *crd.getHeader().sessionHeader();
+    session.data_type = dpslr::CRDHeader::DataTypeEnum::NORMAL_POINT;
+    crd.getHeader().setSessionHeader(session);
+    const bool v2 = crd.getHeader().formatHeader()->crd_version >= 2;
+    QString np_dest = this->config.output_dir + '/' + QFileInfo(file_path).completeBaseName() +
+            (v2 ? ".np2" : ".npt");
+    if (dpslr::CRD::WriteFileErrorEnum::NOT_ERROR !=
+            crd.writeCRDFile(np_dest.toStdString(), dpslr::CRDData::DataGenerationOptionEnum::NORMAL_POINT, true))
+        return SalaraInformation({ErrorEnum::WRITE_FAILED, "The normal points could not be written: " + np_dest});
+
+    return {};
+}
+
+BatchFilter::FilterResult BatchFilter::applyChain(const std::vector<double> &times, const std::vector<double> &resids,
+                                                  unsigned bs, dpslr::algorithms::ResidualsStats &stats,
+                                                  bool &stats_ok) const
+{
+    // All the points are selected at the beginning.
+    std::vector<std::size_t> selected(times.size());
+    std::iota(selected.begin(), selected.end(), 0);
+    std::vector<PassMetrics> passes;
+    stats_ok = false;
+
+    for (const auto& stage : this->config.chain)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // Data accepted by the previous stage.
+        std::vector<double> stage_times = dpslr::helpers::extract(times, selected);
+        std::vector<double> stage_resids = dpslr::helpers::extract(resids, selected);
+        std::vector<std::size_t> accepted;
+
+        switch (stage)
+        {
+        case BatchFilterConfig::Stage::WINDOW:
+            accepted = dpslr::algorithms::windowPrefilter(stage_resids, this->config.win_upper * 1000.,
+                                                          this->config.win_lower * 1000.);
+            break;
+
+        case BatchFilterConfig::Stage::PREFILTER:
+            accepted = dpslr::algorithms::histPrefilterSLR(stage_times, stage_resids, this->config.pre_bs,
+                                                           this->config.pre_depth * kMetreToPs2w,
+                                                           this->config.pre_min_ph, this->config.pre_divisions);
+            break;
+
+        case BatchFilterConfig::Stage::POSTFILTER:
+            accepted = dpslr::algorithms::histPostfilterSLR(stage_times, stage_resids, this->config.post_bs,
+                                                            this->config.post_depth * kMetreToPs2w);
+            break;
+
+        case BatchFilterConfig::Stage::THRESHOLD:
+            accepted = dpslr::algorithms::threshPostfilterSLR(stage_times, stage_resids, bs, this->config.thresh_rf,
+                                                              9, this->config.thresh_iter);
+            break;
+
+        case BatchFilterConfig::Stage::STATS:
+        {
+            // Same process as the statistics calculation of the Filter Tool. The RF*RMS mask is the accepted data.
+            std::vector<long double> ld_times(stage_times.begin(), stage_times.end());
+            std::vector<long double> ld_resids(stage_resids.begin(), stage_resids.end());
+            auto rdata = dpslr::algorithms::binPolynomialDetrend(static_cast<int>(bs), ld_times, ld_resids);
+            auto error = dpslr::algorithms::calculateResidualsStats(bs, rdata, stats, this->config.stats_rf);
+            stats_ok = dpslr::algorithms::ResiStatsCalcErr::STATS_CALC_FAILED != error && !rdata.empty();
+            if (stats_ok)
+            {
+                const auto& mask = stats.total_bin_stats.amask_rfrms;
+                for (std::size_t i = 0; i < mask.size(); i++)
+                    if (mask[i])
+                        accepted.push_back(i);
+            }
+            break;
+        }
+        }
+
+        // Map the accepted indexes to the original data.
+        std::vector<std::size_t> next_selected;
+        next_selected.reserve(accepted.size());
+        for (const auto& idx : accepted)
+            next_selected.push_back(selected[idx]);
+
+        auto end = std::chrono::steady_clock::now();
+        passes.push_back({stage, selected.size(), next_selected.size(),
+                          std::chrono::duration<double, std::milli>(end - start).count()});
+
+        selected = std::move(next_selected);
+    }
+
+    return {selected, passes};
+}
+
+SalaraInformation BatchFilter::replayTracking(const Tracking &track, const std::vector<std::size_t> &range_idxs,
+                                              const std::vector<double> &times,
+                                              const std::vector<std::size_t> &accepted, QJsonObject &metrics) const
+{
+    // CPF used by the tracking, or the most recent one.
+    QString cpf_path = QDir(this->config.cpf_dir).filePath(track.ephemeris_file);
+    if (track.ephemeris_file.isEmpty() || !QFileInfo::exists(cpf_path))
+        cpf_path = this->findCPF(track.obj_norad.toStdString(), dpslr::common::HRTimePoint(
+                                     std::chrono::milliseconds(track.date_start.toMSecsSinceEpoch())));
+    if (cpf_path.isEmpty())
+        return SalaraInformation({ErrorEnum::CPF_NOT_FOUND, "CPF not found for the replay of: " + track.obj_name});
+
+    dpslr::CPF cpf(cpf_path.toStdString(), dpslr::CPF::OpenOptionEnum::ALL_DATA);
+
+    dpslr::geo::frames::GeodeticPoint<long double> geodetic;
+    dpslr::geo::frames::GeocentricPoint<long double> geocentric;
+    SalaraInformation errors = this->stationLocation(geodetic, geocentric);
+    if (errors.hasError())
+        return errors;
+
+    // Same window and parameters as the offline chain.
+    dpslr::rtfilter::StreamingFilterConfig rt_config;
+    rt_config.win_upper = this->config.win_upper * 1000.;
+    rt_config.win_lower = this->config.win_lower * 1000.;
+    rt_config.depth = this->config.pre_depth * kMetreToPs2w;
+    rt_config.min_photons = this->config.pre_min_ph;
+    rt_config.rf = this->config.thresh_rf;
+    rt_config.window = this->config.rt_window;
+    rt_config.calibration = track.cal_val_overall;
+    rt_config.latency_budget = static_cast<std::uint64_t>(1e9 / this->config.rt_rate);
+
+    // The pass starts at the day of the tracking start, or the next one if the first shot is after midnight.
+    const QDateTime date_start = track.date_start.toUTC();
+    int mjd = static_cast<int>(date_start.date().toJulianDay() - 2400001);
+    const double sod = date_start.time().msecsSinceStartOfDay() / 1000.;
+    const long double first_time = track.ranges[range_idxs.front()].start_time;
+    if (first_time < sod - 43200.)
+        mjd++;
+
+    dpslr::rtfilter::StreamingFilter filter(cpf, geodetic, geocentric, rt_config);
+    if (dpslr::rtfilter::RTFilterError::NOT_ERROR !=
+            filter.startPass(mjd, first_time - 1.L, times.back() - times.front() + 2.))
+        return SalaraInformation({ErrorEnum::RT_REPLAY_FAILED, "The real time filter could not start the pass of: " +
+                                  track.obj_name});
+
+    // The producer pushes the ranges at the replay rate, as the event timer. The consumer is this thread.
+    std::vector<char> pushed(range_idxs.size(), false);
+    std::vector<dpslr::rtfilter::ShotResult> results;
+    results.reserve(range_idxs.size());
+    std::atomic<bool> producer_done(false);
+
+    std::thread producer([this, &track, &range_idxs, &filter, &pushed, &producer_done]
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < range_idxs.size(); i++)
+        {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(
+                                              static_cast<long long>(i * 1e9 / this->config.rt_rate)));
+            // The streaming predictions are geometric, so the troposphere correction is removed from the flight
+            // times, as in the offline residuals.
+            const auto& shot = track.ranges[range_idxs[i]];
+            pushed[i] = filter.push(shot.start_time, shot.tof_2w - shot.trop_corr_2w);
+        }
+        producer_done = true;
+    });
+
+    std::array<dpslr::rtfilter::ShotResult, 256> buffer;
+    while (!producer_done || filter.pending() > 0)
+    {
+        std::size_t processed = filter.process(buffer.data(), buffer.size());
+        results.insert(results.end(), buffer.begin(), buffer.begin() + static_cast<long>(processed));
+        if (0 == processed)
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    // Agreement with the offline chain. The dropped shots are not compared.
+    std::vector<char> offline(range_idxs.size(), false);
+    for (const auto& idx : accepted)
+        offline[idx] = true;
+
+    std::size_t compared = 0, agree = 0, rt_accepted = 0, offline_accepted = 0, both = 0;
+    std::vector<std::uint64_t> latencies;
+    latencies.reserve(results.size());
+    for (std::size_t i = 0; i < pushed.size() && compared < results.size(); i++)
+    {
+        if (!pushed[i])
+            continue;
+        const auto& result = results[compared++];
+        latencies.push_back(result.latency);
+        agree += result.signal == static_cast<bool>(offline[i]);
+        rt_accepted += result.signal;
+        offline_accepted += offline[i];
+        both += result.signal && offline[i];
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p)
+    {
+        return latencies.empty() ? 0. : latencies[static_cast<std::size_t>(
+                    std::min(latencies.size() - 1., std::floor(p * latencies.size())))] / 1000.;
+    };
+
+    QJsonObject rt;
+    rt.insert("rate", this->config.rt_rate);
+    rt.insert("shots", static_cast<qint64>(compared));
+    rt.insert("dropped", static_cast<qint64>(filter.dropped()));
+    rt.insert("overruns", static_cast<qint64>(filter.overruns()));
+    rt.insert("p50_us", percentile(0.5));
+    rt.insert("p99_us", percentile(0.99));
+    rt.insert("max_us", latencies.empty() ? 0. : latencies.back() / 1000.);
+    rt.insert("accepted", static_cast<qint64>(rt_accepted));
+    rt.insert("agreement", compared > 0 ? agree * 100. / compared : 0.);
+    rt.insert("recall", offline_accepted > 0 ? both * 100. / offline_accepted : 0.);
+    rt.insert("precision", rt_accepted > 0 ? both * 100. / rt_accepted : 0.);
+    metrics.insert("rt_replay", rt);
+
+    return {};
+}
+
+SalaraInformation BatchFilter::stationLocation(dpslr::geo::frames::GeodeticPoint<long double> &geodetic,
+                                               dpslr::geo::frames::GeocentricPoint<long double> &geocentric) const
+{
+    QList<double> coords = SalaraSettings::instance().getStationDataValue(
+                "StationData/StationCoordinates").value<QList<double>>();
+    QList<double> xyz = SalaraSettings::instance().getStationDataValue("StationData/StationXYZ").value<QList<double>>();
+    if (coords.size() != 3 || xyz.size() != 3)
+        return SalaraInformation({SalaraSettings::ErrorEnum::INVALID_COORDINATES, "Station coordinates invalid."});
+
+    geodetic = dpslr::geo::frames::GeodeticPoint<long double>(coords[0], coords[1], coords[2]);
+    geocentric = dpslr::geo::frames::GeocentricPoint<long double>(xyz[0], xyz[1], xyz[2]);
+    return {};
+}
+
+QString BatchFilter::findCPF(const std::string &norad, const dpslr::common::HRTimePoint &start) const
+{
+    // Select the most recent CPF of the object that covers the start of the session.
+    QString selected;
+    dpslr::common::HRTimePoint selected_production;
+
+    for (const auto& info : QDir(this->config.cpf_dir).entryInfoList(QDir::Files, QDir::Name))
+    {
+        dpslr::CPF cpf(info.absoluteFilePath().toStdString(), dpslr::CPF::OpenOptionEnum::ONLY_HEADER);
+        const auto& header = cpf.getHeader();
+        if (!header.basicInfo1Header() || !header.basicInfo2Header())
+            continue;
+
+        if (norad != header.basicInfo2Header()->norad ||
+                start < header.basicInfo2Header()->start_time || start > header.basicInfo2Header()->end_time)
+            continue;
+
+        if (selected.isEmpty() || header.basicInfo1Header()->cpf_production_date > selected_production)
+        {
+            selected = info.absoluteFilePath();
+            selected_production = header.basicInfo1Header()->cpf_production_date;
+        }
+    }
+
+    return selected;
+}
+
+void BatchFilter::emitMetrics(const QJsonObject &metrics)
+{
+    QMutexLocker locker(&this->metrics_mutex);
+    this->metrics_stream << QJsonDocument(metrics).toJson(QJsonDocument::Compact) << '\n';
+    this->metrics_stream.flush();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QMutex>
+#include <QTextStream>
+#include <QMap>
+
+#include <class_salarainformation.h>
+#include <class_tracking.h>
+
+#include <algorithms.h>
+
+#include <vector>
+
+struct BatchFilterConfig
+{
+    enum class Stage
+    {
+        WINDOW,
+        PREFILTER,
+        POSTFILTER,
+        THRESHOLD,
+        STATS
+    };
+
+    static const QMap<QString, Stage> kStageNames;
+
+    // Filter chain. The stages are applied in order over the points accepted by the previous stage.
+    std::vector<Stage> chain;
+
+    // Window prefilter (ns).
+    double win_upper;
+    double win_lower;
+
+    // Histogram prefilter. Bin size (s), depth (m), minimum photons per histogram bin and divisions.
+    double pre_bs;
+    double pre_depth;
+    unsigned pre_min_ph;
+    unsigned pre_divisions;
+
+    // Histogram postfilter. Bin size (s) and depth (m).
+    double post_bs;
+    double post_depth;
+
+    // Threshold filter (Filter Tool autofilter). Rejection factor and maximum iterations.
+    double thresh_rf;
+    unsigned thresh_iter;
+
+    // Statistics. Rejection factor. The bin size is the object bin size of each tracking.
+    double stats_rf;
+
+    // Bin size (s) used for the residuals of CRD files, which do not store the object bin size.
+    unsigned crd_bs;
+
+    // Paths.
+    QString output_dir;
+    QString calib_dir;
+    QString cpf_dir;
+
+    // Parallelism.
+    unsigned threads;
+    unsigned queue_size;
+
+    // Real time filter replay of the trackings. Shots per second and sliding window (s).
+    bool rt_replay;
+    double rt_rate;
+    double rt_window;
+
+    BatchFilterConfig();
+};
+
+class BatchFilter
+{
+public:
+
+    enum ErrorEnum
+    {
+        FILE_NOT_SUPPORTED = 100,
+        NO_DATA,
+        CPF_NOT_FOUND,
+        RESIDUALS_FAILED,
+        STATS_FAILED,
+        WRITE_FAILED,
+        RT_REPLAY_FAILED,
+        NP_FAILED
+    };
+
+    BatchFilter(const BatchFilterConfig& config, QTextStream& metrics);
+
+    // Process all the files with a pool of workers fed through a bounded queue. Returns the number of files
+    // processed without errors.
+    std::size_t run(const QStringList& files);
+
+    static QStringList collectFiles(const QString& dir);
+
+private:
+
+    struct PassMetrics
+    {
+        BatchFilterConfig::Stage stage;
+        std::size_t in;
+        std::size_t out;
+        double ms;
+    };
+
+    using FilterResult = std::pair<std::vector<std::size_t>, std::vector<PassMetrics>>;
+
+    SalaraInformation processFile(const QString& file_path, QJsonObject& metrics) const;
+    SalaraInformation processTracking(const QString& file_path, QJsonObject& metrics) const;
+    SalaraInformation processCRD(const QString& file_path, QJsonObject& metrics) const;
+
+    // Applies the configured chain. Returns the indexes of the accepted points and the metrics of each pass.
+    FilterResult applyChain(const std::vector<double>& times, const std::vector<double>& resids,
+                            unsigned bs, dpslr::algorithms::ResidualsStats& stats, bool& stats_ok) const;
+
+    // Feeds the ranges to the real time filter at the configured rate, and compares the result with the offline one.
+    SalaraInformation replayTracking(const Tracking& track, const std::vector<std::size_t>& range_idxs,
+                                     const std::vector<double>& times, const std::vector<std::size_t>& accepted,
+                                     QJsonObject& metrics) const;
+
+    SalaraInformation stationLocation(dpslr::geo::frames::GeodeticPoint<long double>& geodetic,
+                                      dpslr::geo::frames::GeocentricPoint<long double>& geocentric) const;
+
+    QString findCPF(const std::string& norad, const dpslr::common::HRTimePoint& start) const;
+
+    void emitMetrics(const QJsonObject& metrics);
+
+    BatchFilterConfig config;
+    QTextStream& metrics_stream;
+    QMutex metrics_mutex;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Simple blocking FIFO with a maximum capacity. The producer blocks while the queue is full, so the number of
+// pending jobs (and the memory used by them) is bounded.
+template <typename T>
+class BoundedQueue
+{
+public:
+
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false){}
+
+    // Blocks while the queue is full. Returns false if the queue was closed.
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->not_full.wait(lock, [this]{return this->closed || this->items.size() < this->capacity;});
+        if (this->closed)
+            return false;
+        this->items.push_back(std::move(item));
+        lock.unlock();
+        this->not_empty.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty. Returns false when the queue is closed and there are no more items.
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->not_empty.wait(lock, [this]{return this->closed || !this->items.empty();});
+        if (this->items.empty())
+            return false;
+        item = std::move(this->items.front());
+        this->items.pop_front();
+        lock.unlock();
+        this->not_full.notify_one();
+        return true;
+    }
+
+    // No more items will be pushed. Consumers will drain the remaining items.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->closed = true;
+        }
+        this->not_empty.notify_all();
+        this->not_full.notify_all();
+    }
+
+private:
+    std::deque<T> items;
+    std::size_t capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
@@ -0,0 +1,165 @@
+#include "class_batchfilter.h"
+#include "class_salarasettings.h"
+#include "class_trackingfilemanager.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream err(stderr);
+
+    SalaraInformation errors = SalaraSettings::instance().initConsoleApp("DP_BatchFilter");
+    if (errors.hasError())
+    {
+        for (const auto& error : errors.getErrors())
+            err << "Initialization error: " << error.second << Qt::endl;
+        return -1;
+    }
+
+    BatchFilterConfig config;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless batch filtering of tracking (dptr) and full rate CRD files. "
+                                     "One JSON line with the filter metrics is written for each file.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"input", "Directory with the files to filter.", "dir"},
+        {"from", "Query the archive from this UTC datetime (ISO 8601).", "datetime"},
+        {"to", "Query the archive until this UTC datetime (ISO 8601).", "datetime"},
+        {"norad", "Query only trackings of this NORAD.", "norad"},
+        {"cfg", "Query only trackings of this system configuration.", "cfg"},
+        {"archive", "Historical trackings directory for the query. Default is the configured one.", "dir"},
+        {"output", "Destination directory of the filtered files and the CRD normal points.", "dir"},
+        {"calib-dir", "Calibrations directory. Default is the configured one.", "dir"},
+        {"cpf-dir", "CPF directory, required for CRD files.", "dir"},
+        {"chain", "Comma separated filter chain. Stages: window, prefilter, postfilter, threshold, stats.",
+         "stages", "window,prefilter,threshold,stats"},
+        {"win-upper", "Window upper limit (ns).", "ns", QString::number(config.win_upper)},
+        {"win-lower", "Window lower limit (ns).", "ns", QString::number(config.win_lower)},
+        {"pre-bs", "Histogram prefilter bin size (s).", "s", QString::number(config.pre_bs)},
+        {"pre-depth", "Histogram prefilter depth (m).", "m", QString::number(config.pre_depth)},
+        {"pre-min-ph", "Histogram prefilter minimum photons.", "n", QString::number(config.pre_min_ph)},
+        {"pre-divisions", "Histogram prefilter divisions.", "n", QString::number(config.pre_divisions)},
+        {"post-bs", "Histogram postfilter bin size (s).", "s", QString::number(config.post_bs)},
+        {"post-depth", "Histogram postfilter depth (m).", "m", QString::number(config.post_depth)},
+        {"thresh-rf", "Threshold filter rejection factor.", "rf", QString::number(config.thresh_rf)},
+        {"thresh-iter", "Threshold filter maximum iterations.", "n", QString::number(config.thresh_iter)},
+        {"stats-rf", "Statistics rejection factor.", "rf", QString::number(config.stats_rf)},
+        {"crd-bs", "Bin size used for the residuals of CRD files (s).", "s", QString::number(config.crd_bs)},
+        {"threads", "Number of worker threads.", "n", QString::number(config.threads)},
+        {"queue", "Maximum number of pending files.", "n", QString::number(config.queue_size)},
+        {"rt-replay", "Replay the trackings through the real time filter, reporting its latency and the agreement "
+                      "with the offline chain. Use one thread for representative latencies. Requires --cpf-dir."},
+        {"rt-rate", "Real time replay rate (shots/s).", "hz", QString::number(config.rt_rate)},
+        {"rt-window", "Real time filter sliding window (s).", "s", QString::number(config.rt_window)},
+        {"metrics", "File for the JSON metrics. Default is the standard output.", "file"}
+    });
+    parser.process(a);
+
+    // Filter chain.
+    config.chain.clear();
+    for (const auto& name : parser.value("chain").split(',', Qt::SkipEmptyParts))
+    {
+        if (!BatchFilterConfig::kStageNames.contains(name.trimmed().toLower()))
+        {
+            err << "Unknown filter stage: " << name << Qt::endl;
+            return -1;
+        }
+        config.chain.push_back(BatchFilterConfig::kStageNames.value(name.trimmed().toLower()));
+    }
+
+    // Parameters.
+    config.win_upper = parser.value("win-upper").toDouble();
+    config.win_lower = parser.value("win-lower").toDouble();
+    config.pre_bs = parser.value("pre-bs").toDouble();
+    config.pre_depth = parser.value("pre-depth").toDouble();
+    config.pre_min_ph = parser.value("pre-min-ph").toUInt();
+    config.pre_divisions = parser.value("pre-divisions").toUInt();
+    config.post_bs = parser.value("post-bs").toDouble();
+    config.post_depth = parser.value("post-depth").toDouble();
+    config.thresh_rf = parser.value("thresh-rf").toDouble();
+    config.thresh_iter = parser.value("thresh-iter").toUInt();
+    config.stats_rf = parser.value("stats-rf").toDouble();
+    config.crd_bs = parser.value("crd-bs").toUInt();
+    config.threads = std::max(1u, parser.value("threads").toUInt());
+    config.queue_size = std::max(1u, parser.value("queue").toUInt());
+    config.rt_replay = parser.isSet("rt-replay");
+    config.rt_rate = parser.value("rt-rate").toDouble();
+    config.rt_window = parser.value("rt-window").toDouble();
+    config.calib_dir = parser.value("calib-dir");
+    config.cpf_dir = parser.value("cpf-dir");
+    config.output_dir = parser.value("output");
+
+    if (config.rt_replay && (config.rt_rate <= 0. || config.rt_window <= 0.))
+    {
+        err << "The real time replay rate and window must be positive." << Qt::endl;
+        return -1;
+    }
+
+    // The output directory is mandatory, so the original files are never overwritten.
+    if (config.output_dir.isEmpty() || !QDir().mkpath(config.output_dir))
+    {
+        err << "A valid output directory is required." << Qt::endl;
+        return -1;
+    }
+
+    // Input files. From a directory or from an archive query.
+    QStringList files;
+    if (parser.isSet("input"))
+    {
+        files = BatchFilter::collectFiles(parser.value("input"));
+    }
+    else if (parser.isSet("from") && parser.isSet("to"))
+    {
+        QDateTime start = QDateTime::fromString(parser.value("from"), Qt::ISODate);
+        QDateTime end = QDateTime::fromString(parser.value("to"), Qt::ISODate);
+        start.setTimeSpec(Qt::UTC);
+        end.setTimeSpec(Qt::UTC);
+        if (!start.isValid() || !end.isValid() || start > end)
+        {
+            err << "Invalid query interval." << Qt::endl;
+            return -1;
+        }
+
+        QString archive = parser.isSet("archive") ? parser.value("archive") :
+            SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalObservations");
+        for (const auto& name : TrackingFileManager::findTrackings(start, end, parser.value("norad"),
+                                                                    parser.value("cfg"), archive))
+        {
+            files.append(archive + '/' + TrackingFileManager::startDate(name).toString("yyyyMMdd") + '/' + name);
+        }
+    }
+    else
+    {
+        err << "An input directory or a query interval (--from, --to) is required." << Qt::endl;
+        parser.showHelp(-1);
+    }
+
+    // Metrics output.
+    QFile metrics_file;
+    if (parser.isSet("metrics"))
+    {
+        metrics_file.setFileName(parser.value("metrics"));
+        if (!metrics_file.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            err << "The metrics file could not be opened: " << metrics_file.fileName() << Qt::endl;
+            return -1;
+        }
+    }
+    else
+    {
+        metrics_file.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream metrics(&metrics_file);
+
+    BatchFilter batch(config, metrics);
+    std::size_t processed_ok = batch.run(files);
+
+    err << "Processed " << processed_ok << " of " << files.size() << " files." << Qt::endl;
+
+    return processed_ok == static_cast<std::size_t>(files.size()) ? 0 : 1;
+}
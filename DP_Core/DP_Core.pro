@@ -35,6 +35,7 @@ SOURCES += \
     sources/class_spaceobjectdisplaywidget.cpp \
     sources/class_spaceobjectfilemanager.cpp\
     sources/class_spaceobjectsmodelloader.cpp \
+    sources/class_spaceobjectsjournal.cpp \
     sources/class_treemodel.cpp\
     sources/class_prediction.cpp \
     sources/class_predictionmodel.cpp \
@@ -44,14 +45,18 @@ SOURCES += \
     sources/class_globalutils.cpp \
     sources/class_timeprogressdialog.cpp \
     sources/class_passworddialog.cpp \
+    sources/class_passscheduler.cpp \
     sources/global_styles.cpp \
     sources/interface_plugin.cpp \
+    sources/interface_cpfdownloadengine.cpp \
     sources/class_calibration.cpp \
     sources/class_calibrationfilemanager.cpp \
+    sources/class_calibrationindex.cpp \
     sources/class_tracking.cpp \
     sources/class_trackingfilemanager.cpp \
     sources/class_meteodata.cpp \
     sources/class_statsfilemanager.cpp \
+    sources/class_jsonstreamreader.cpp \
 
 
 
@@ -70,6 +75,7 @@ HEADERS += \
     includes/class_spaceobjectfilemanager.h \
     includes/class_spaceobjectmodel.h\
     includes/class_spaceobjectsmodelloader.h \
+    includes/class_spaceobjectsjournal.h \
     includes/class_treemodel.h\
     includes/global_texts.h\
     includes/interface_cpfdownloadengine.h \
@@ -84,6 +90,7 @@ HEADERS += \
     includes/class_globalutils.h\
     includes/class_timeprogressdialog.h \
     includes/class_passworddialog.h \
+    includes/class_passscheduler.h \
     includes/global_styles.h \
     includes/interface_spaceobjectsearchengine.h \
     includes/interface_tle_propagator.h \
@@ -91,10 +98,12 @@ HEADERS += \
     includes/spcore_global.h \
     includes/class_calibration.h \
     includes/class_calibrationfilemanager.h \
+    includes/class_calibrationindex.h \
     includes/class_tracking.h \
     includes/class_trackingfilemanager.h \
     includes/class_meteodata.h \
     includes/class_statsfilemanager.h \
+    includes/class_jsonstreamreader.h \
 
 
 
@@ -4,6 +4,9 @@
 #include "class_salarainformation.h"
 #include "spcore_global.h"
 
+#include <atomic>
+#include <functional>
+
 class QFile;
 
 class SP_CORE_EXPORT CalibrationFileManager
@@ -13,14 +16,22 @@ public:
     {
         CALIBFILE_NOT_OPEN,
         CALIBFILE_INVALID,
-        CALIB_NOT_FOUND
+        CALIB_NOT_FOUND,
+        LOAD_CANCELLED
     };
 
+    // Called with the number of files processed and the total number of files. It is called from the loader
+    // threads, so it must be thread safe.
+    using ProgressCallback = std::function<void(std::size_t, std::size_t)>;
+
     static const QMap<ErrorEnum, QString> ErrorListStringMap;
 
     static SalaraInformation readCalibration(const QString& cal_name, const QString &dir_path, Calibration& calib);
     static SalaraInformation readCalibration(const QString& cal_name, Calibration& calib);
-    static SalaraInformation readCalibrationDir(const QString& dir, std::vector<Calibration>& calibs);
+    // Files are parsed in parallel. The calibrations are appended to calibs sorted by file name.
+    static SalaraInformation readCalibrationDir(const QString& dir, std::vector<Calibration>& calibs,
+                                                const std::atomic_bool* cancel = nullptr,
+                                                const ProgressCallback& progress = {});
     static SalaraInformation readLastCalib(Calibration &calib);
     static SalaraInformation writeCalibration(const Calibration& calib, const QString& dest_dir,
                                               const QString& dest_file = "" );
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "class_calibration.h"
+#include "class_salarainformation.h"
+#include "spcore_global.h"
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+#include <map>
+#include <vector>
+
+// Index of the historical calibrations. It is stored in the historical calibrations directory and is updated each
+// time a calibration is written there, so the calibrations can be found by time and configuration without listing
+// the archive. If the index file does not exist, it is rebuilt from the archive the first time it is used.
+// The index file is shared by all the processes. It is reloaded when it changes on disk and the updates are merged
+// with the file under a lock file. The queries only read the index: the calibrations written by tools that do not
+// update it are picked up from the newest date folder when a query finds nothing, and rebuild() indexes the rest.
+class SP_CORE_EXPORT CalibrationIndex
+{
+public:
+
+    enum ErrorEnum
+    {
+        INDEX_NOT_OPEN,
+        HISTORICAL_PATH_INVALID,
+        INDEX_LOCKED
+    };
+
+    static const QMap<ErrorEnum, QString> ErrorListStringMap;
+
+    struct SP_CORE_EXPORT Entry
+    {
+        QDateTime date_start;
+        QString cfg_id;
+        QString station_name;
+        unsigned int station_id;
+        Calibration::Type type;
+        double cal_val_rfrms;
+        double cal_val_1rms;
+        double tror_rfrms;
+        QString file_path;          ///< Relative to the historical calibrations directory.
+
+        explicit Entry();
+        Entry(const Calibration& calib, const QString& file_path);
+
+        QJsonObject toJson() const;
+        static Entry fromJson(const QJsonObject& obj);
+    };
+
+    static CalibrationIndex& instance();
+
+    // Index maintenance.
+    SalaraInformation rebuild();
+    SalaraInformation update(const Calibration& calib, const QString& file_path);
+
+    // Queries. If cfg_id is empty, all the configurations are considered. They are lookups in the entries ordered by
+    // date, O(log n) for each configuration.
+    bool last(Entry& entry, const QString& cfg_id = "");
+    std::vector<Entry> between(const QDateTime& start, const QDateTime& end, const QString& cfg_id = "");
+
+    QString absolutePath(const Entry& entry) const;
+
+private:
+
+    // Entries ordered by configuration and start date.
+    using OrderedEntries = std::map<QDateTime, Entry>;
+
+    CalibrationIndex() = default;
+    CalibrationIndex(const CalibrationIndex&) = delete;
+    CalibrationIndex& operator=(const CalibrationIndex&) = delete;
+
+    // Loads the index if the historical path changed or the file changed on disk since it was loaded or saved.
+    SalaraInformation ensureLoaded();
+    SalaraInformation load();
+    SalaraInformation rebuildPrivate();
+    SalaraInformation save();
+
+    // Adds the calibrations of the newest date folder that are not indexed. Returns true if any was added.
+    bool scanNewestDir();
+
+    void addEntry(Entry&& entry);
+    QString indexFilePath() const;
+
+    QString historical_path;
+    std::map<QString, OrderedEntries> entries;
+    QSet<QString> indexed_files;
+    // Modification time and size of the index file when it was loaded or saved.
+    QDateTime index_modified;
+    qint64 index_size = -1;
+    mutable QMutex mutex;
+};
@@ -44,7 +44,8 @@ public:
         CPF_NOT_FOUND=1,
         CPF_LOAD_FAILED=2,
         CPF_INVALID=3,
-        CPF_OLD
+        CPF_OLD,
+        CPF_GAP
     };
 
     enum SelectionOption
@@ -54,6 +55,7 @@ public:
         MOST_CURRENT_REDUCE,
         MAXIMIZE_DAYS_REDUCE,
         MOST_CURRENT_FIXED,
+        STITCHED,           // All the releases merged with loadStitchedCPF. Only for loadSingleCPFRecursive.
         SELECTION_END
     };
 
@@ -104,6 +106,16 @@ public:
                                                     double &r_days, const QString& provider="",
                                                     unsigned int days_before = 6);
 
+    // Loads all the CPF releases of the object that overlap the interval, from the end date folder to the folders of
+    // the days before, and merges them into one CPF with dpslr::cpfutils::CPFStitcher (newest release first). If the
+    // releases leave gaps, the continuous part that covers most of the interval is returned, and the gaps inside the
+    // interval are reported with CPF_GAP.
+    static SalaraInformation loadStitchedCPF(const QString& path_data, const SpaceObject &object,
+                                             const QDateTime &start, const QDateTime &end,
+                                             ProviderOption provider_option, PriorityTLE tle_prior,
+                                             std::shared_ptr<CPF> &cpf, const QString& provider="",
+                                             unsigned int days_before = 6);
+
     static QStringList getCPFFilesForObject(const QString& path_data, const SpaceObject& object);
 
     static QStringList getCPFFilePathsForTracking(const QString &path_data, const QDateTime &start_time,
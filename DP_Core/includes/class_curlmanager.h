@@ -3,12 +3,17 @@
 #include "spcore_global.h"
 
 #include <QObject>
+#include <QDateTime>
 #include <QFutureWatcher>
+#include <QHash>
 
 #include <atomic>
+#include <list>
+#include <memory>
 #include <mutex>
 
 typedef void CURL;
+typedef void CURLM;
 
 class SP_CORE_EXPORT CurlManager : public QObject
 {
@@ -146,6 +151,15 @@ public:
                                           inside a callback */
         CODE_END
     };
+    Q_ENUM(ResultCodes)
+
+    // Options of the queued downloads.
+    struct TransferOptions
+    {
+        bool conditional = true;    ///< Skip the download if the remote file was not modified (ETag or date).
+        bool resume = true;         ///< Resume the interrupted downloads with a byte range request.
+        int max_retries = 3;        ///< Retries of the transient errors, with exponential backoff.
+    };
 
     bool isWorking() const;
     ResultCodes getLastResultCode() const;
@@ -162,14 +176,34 @@ public:
     bool downloadToString(const QString &url_path, int port, QString &result_string);
     bool uploadFile(const QString &filepath, const QString &url_path, int port);
 
+    // Gets the ETag (HTTP) and the modification date (HTTP Last-Modified or FTP MDTM) of a remote file without
+    // downloading it. It uses its own handle, so it can be called from several threads while other transfers run.
+    // The values not sent by the server are left empty.
+    ResultCodes remoteFileInfo(const QString& url_path, int port, QByteArray& etag, QDateTime& modified);
+
     bool listFoldersBlocking(const QString &url, int port, QStringList &buffer);
     bool downloadFileBlocking(const QString &url_path, int port, const QString &dest_file_path);
     bool downloadToStringBlocking(const QString &url_path, int port, QString &result_string);
     bool uploadFileBlocking(const QString &filepath, const QString &url_path, int port);
 
+    // Queued downloads. They are run concurrently in a worker thread with a curl multi handle, independently of the
+    // single transfer functions above. The connections are kept open and reused by the transfers to the same host.
+    // Each download is written to a ".part" file that replaces the destination file only if the download succeeds.
+    // Returns the transfer id, that is reported by transferFinished.
+    int queueDownload(const QString& url_path, int port, const QString& dest_file_path,
+                      const TransferOptions& options = TransferOptions());
+    void setMaxConcurrentTransfers(int max_transfers);
+    void setMaxHostConnections(int max_connections);
+    int pendingTransfers() const;
+    void cancelTransfers();
+    void waitForTransfers();
+
 signals:
     void currentProgressStateChanged(int remaining, int total);
     void jobFinished();
+    // Modified is false if the download was skipped because the remote file was not modified.
+    void transferFinished(int id, CurlManager::ResultCodes code, bool modified);
+    void allTransfersFinished();
 
 private:
     friend class CurlManagerFactory;
@@ -186,6 +220,15 @@ private:
     static size_t writeFileCallback(void *ptr, size_t size, size_t nmemb, FILE *stream);
     static size_t writeStringCallback(char *contents, size_t size, size_t nmemb, QString *buffer);
 
+    struct Transfer;
+    static size_t writeTransferCallback(char *contents, size_t size, size_t nmemb, Transfer *transfer);
+    static size_t headerTransferCallback(char *buffer, size_t size, size_t nitems, Transfer *transfer);
+
+    void applyOptions(CURL* handle) const;
+    bool startTransfer(Transfer& transfer);
+    void finishTransfer(std::unique_ptr<Transfer> transfer, ResultCodes code);
+    void runTransfers();
+
     QFutureWatcher<ResultCodes> future_watcher;
     CURL *curl;
     ResultCodes last_result;
@@ -194,5 +237,28 @@ private:
     mutable std::mutex mutex;
     std::atomic_bool working;
 
+    // Settings, also applied to the easy handles of the queued downloads.
+    bool ssl_verification;
+    bool verbose;
+    int timeout;
+    QString proxy;
+    bool proxy_tunnel;
+    bool follow_redirection;
+    QString cacert_path;
+
+    // Queued downloads. The multi handle is only used by the worker thread, so the connections stay open between
+    // runs. The queue and the ETags are shared with the caller threads.
+    CURLM *multi;
+    QFuture<void> transfers_future;
+    std::list<std::unique_ptr<Transfer>> queued_transfers;
+    QHash<QString, QByteArray> etags;
+    mutable std::mutex transfers_mutex;
+    std::atomic_bool cancel_transfers;
+    bool transfers_running;
+    int active_transfers;
+    int max_transfers;
+    int max_host_connections;
+    int next_transfer_id;
+
 };
 
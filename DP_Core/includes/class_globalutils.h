@@ -7,6 +7,8 @@
 #include <QSettings>
 #include <QDateTime>
 #include <QMap>
+#include <QJsonObject>
+#include <QVector>
 #include <QPushButton>
 #include <QWidget>
 
@@ -35,7 +37,8 @@ public:
     static void initApp(const QString& app_name, const QString& app_error,
                         const QString& app_config, const QString& icon);
 
-    // Plugins related functions.
+    // Plugins related functions. The plugins are classified with their metadata, which is cached in a manifest in
+    // the plugins dir, so only the plugins of the selected categories are loaded.
     static SalaraInformation loadPlugins(const QDir &dir, PluginCategories cats,
                                          PluginsMultiMap& plugins, bool recursive = false);
 
@@ -67,4 +70,9 @@ public:
     static QDateTime timePointToQDateTime(const dpslr::common::HRTimePoint& tp, Qt::TimeSpec ts = Qt::UTC);
     static double datetimeToJ2000Datetime(const QDateTime& time);
 
+private:
+
+    // Plugins discovery helpers.
+    static void collectPluginFiles(const QDir& dir, bool recursive, QStringList& files);
+    static QVector<QJsonObject> readPluginsMetaData(const QDir& dir, const QStringList& files);
 };
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "spcore_global.h"
+
+#include <QString>
+#include <QLatin1String>
+
+#include <string_view>
+#include <vector>
+
+// Pull parser that reads a JSON document token by token from a byte buffer, without building a DOM and without
+// converting the data to QString. Strings and numbers are returned as views over the buffer, so the buffer must be
+// valid while the reader is in use. The value conversions follow the QJsonValue ones: a value of a different type
+// returns the default value, and ok (if given) is set to false. Malformed numbers make the document invalid, and the
+// numbers are always read with the C locale.
+class SP_CORE_EXPORT JsonStreamReader
+{
+public:
+
+    enum class Token
+    {
+        NONE,
+        BEGIN_OBJECT,
+        END_OBJECT,
+        BEGIN_ARRAY,
+        END_ARRAY,
+        KEY,
+        STRING,
+        NUMBER,
+        BOOL,
+        NULL_VALUE,
+        END_DOCUMENT,
+        INVALID
+    };
+
+    JsonStreamReader(const char* data, std::size_t size);
+
+    // Advances to the next token and returns it. Once the reader is INVALID or END_DOCUMENT it stays there.
+    Token next();
+
+    // Advances inside an object. Returns true if the new token is a key, false at the end of the object or on error.
+    bool nextKey();
+
+    // Advances inside an array. Returns true if the new token is the beginning of an element.
+    bool nextElement();
+
+    // Skips the current value. If it is the beginning of an object or array, the reader advances to its end.
+    // Returns the raw JSON text of the value.
+    std::string_view skipValue();
+
+    inline Token token() const {return this->current_token;}
+    inline bool hasError() const {return Token::INVALID == this->current_token;}
+
+    // True if the current token is the beginning of an object or array.
+    inline bool isContainer() const
+    {
+        return Token::BEGIN_OBJECT == this->current_token || Token::BEGIN_ARRAY == this->current_token;
+    }
+
+    // Raw text of the current key, string (without quotes and escapes undecoded), number or bool.
+    inline std::string_view text() const {return this->current_text;}
+
+    // Checks the last key read. The key is kept while its value is read.
+    inline bool isKey(const QString& key) const
+    {
+        return QLatin1String(this->current_key.data(), static_cast<int>(this->current_key.size())) == key;
+    }
+
+    // Value conversions.
+    double toDouble(double default_value = 0., bool* ok = nullptr) const;
+    long long toInteger(long long default_value = 0, bool* ok = nullptr) const;
+    bool toBool(bool default_value = false, bool* ok = nullptr) const;
+    QString toString(const QString& default_value = QString(), bool* ok = nullptr) const;
+
+    // Also accepts numbers stored as strings, used to keep the long double precision of the times.
+    long double toLongDouble(long double default_value = 0.L, bool* ok = nullptr) const;
+
+private:
+
+    struct Level
+    {
+        bool object;
+        bool has_items;
+    };
+
+    Token parseValue();
+    bool parseString();
+    void skipWhitespaces();
+    Token setInvalid();
+
+    const char* pos;
+    const char* end;
+    const char* token_begin;
+    std::string_view current_text;
+    std::string_view current_key;
+    Token current_token;
+    std::vector<Level> levels;
+    bool value_after_key;
+    bool has_escapes;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+#include "class_cpffilemanager.h"
+#include "class_salarainformation.h"
+#include "class_spaceobject.h"
+#include "spcore_global.h"
+
+#include <cpfutils.h>
+#include <geo.h>
+
+// A pass of the schedule. Overlaps has the indexes (in the schedule) of the passes that overlap with this one.
+struct SP_CORE_EXPORT ScheduledPass
+{
+    std::shared_ptr<SpaceObject> space_object;
+    QString cpf_name;
+    QDateTime start;
+    QDateTime culmination;
+    QDateTime end;
+    double max_elevation;
+    dpslr::cpfutils::Pass pass;
+    QList<int> overlaps;
+};
+
+// Calculates the passes of a tracking list over a time window, as a time sorted schedule.
+//
+// The passes of each object are cached by the identity of its CPF (a hash of its positions) and the window, so when a
+// new CPF release is loaded, or stitched, only the objects whose CPF changed are calculated again. The objects are
+// calculated in parallel, each one with its own PassCalculator.
+class SP_CORE_EXPORT PassScheduler
+{
+public:
+
+    enum ErrorEnum
+    {
+        CPF_NOT_VALID,
+        WINDOW_OUTSIDE_OF_CPF,
+        PASSES_FAILED
+    };
+
+    static const QMap<ErrorEnum, QString> ErrorListStringMap;
+
+    PassScheduler(const dpslr::geo::frames::GeodeticPoint<long double>& stat_geodetic,
+                  const dpslr::geo::frames::GeocentricPoint<long double>& stat_geocentric,
+                  unsigned int min_elev = 0, long double interval = 1.L);
+
+    // Search mode of the pass calculators. The cache is cleared if the mode changes.
+    void setSearchMode(dpslr::cpfutils::PassCalculator::SearchMode mode, bool dense_steps = true);
+
+    // Calculates the schedule for the CPFs selected with CPFFileManager. The window is clipped to the CPFs data.
+    SalaraInformation computeSchedule(const QList<CPFSelected>& cpf_list, const QDateTime& start,
+                                      const QDateTime& end, QList<ScheduledPass>& schedule);
+
+    // Objects (preferred names) calculated again by the last call to computeSchedule.
+    const QStringList& recomputedObjects() const;
+
+    void clearCache();
+
+private:
+
+    struct CacheEntry
+    {
+        QString cpf_identity;
+        QDateTime start;
+        QDateTime end;
+        std::vector<dpslr::cpfutils::Pass> passes;
+    };
+
+    dpslr::geo::frames::GeodeticPoint<long double> stat_geodetic;
+    dpslr::geo::frames::GeocentricPoint<long double> stat_geocentric;
+    unsigned int min_elev;
+    long double interval;
+    dpslr::cpfutils::PassCalculator::SearchMode search_mode;
+    bool dense_steps;
+    QHash<QString, CacheEntry> cache;
+    QStringList recomputed;
+};
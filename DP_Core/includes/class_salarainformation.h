@@ -1,20 +1,25 @@
 #pragma once
 
 #include <QObject>
-#include <QMessageBox>
+#include <QList>
+#include <QPair>
+#include <QString>
 
 #include "spcore_global.h"
 
+class QWidget;
+
 class SP_CORE_EXPORT SalaraInformation
 {
 
 public:
 
+    // Same values as QMessageBox::Icon, so the header does not depend on the widgets module (console tools).
     enum MessageTypeEnum
     {
-        CRITICAL = QMessageBox::Critical,
-        WARNING = QMessageBox::Warning,
-        INFO = QMessageBox::Information
+        CRITICAL = 3,
+        WARNING = 2,
+        INFO = 1
     };
 
     typedef QPair<int, QString> ErrorPair;
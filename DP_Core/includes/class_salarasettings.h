@@ -4,7 +4,6 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QDebug>
-#include <QMessageBox>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QList>
@@ -30,6 +29,10 @@ public:
         INVALID_XYZ
     };
 
+    // Loads the global configuration and the station data for console applications, reporting the errors instead of
+    // showing dialogs.
+    SalaraInformation initConsoleApp(const QString& app_name);
+
     // Seters.
     SalaraInformation setGlobalConfig(const QString& path);
     SalaraInformation setApplicationConfig(const QString& path);
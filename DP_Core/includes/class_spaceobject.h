@@ -8,9 +8,11 @@
 #include <QJsonValue>
 #include <QVariant>
 #include <QStringList>
+#include <QList>
 #include <QPair>
 
 #include <map>
+#include <memory>
 
 class SP_CORE_EXPORT SpaceObjectSet
 {
@@ -197,5 +199,8 @@ protected:
     bool initialized;
 };
 
+using SpaceObjectsList = QList<std::shared_ptr<SpaceObject>>;
+using SpaceObjectsMap = QMap<QString, std::shared_ptr<SpaceObject>>;
+
 Q_DECLARE_METATYPE(SpaceObject*)
 Q_DECLARE_METATYPE(SpaceObjectSet*)
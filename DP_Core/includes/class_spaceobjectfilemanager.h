@@ -7,7 +7,10 @@
 #include <QJsonValue>
 #include <QDateTime>
 #include <QMap>
+#include <QVector>
 
+#include <atomic>
+#include <functional>
 #include <memory>
 
 #include "class_spaceobject.h"
@@ -27,9 +30,15 @@ public:
         DATAFILE_INVALID,
         SCHEMEFILE_INVALID,
         INTEGRITY_ERROR,
-        SCHEME_NOT_VALID
+        SCHEME_NOT_VALID,
+        CSVFILE_NOT_OPEN,
+        EXPORT_CANCELLED,
+        CSVFILE_NOT_WRITTEN
     };
 
+    // Called with the number of rows written and the total number of rows.
+    using ProgressCallback = std::function<void(std::size_t, std::size_t)>;
+
     static const QMap<ErrorEnum, QString> ErrorListStringMap;
 
     // Static class. Delete constructor.
@@ -59,6 +68,13 @@ public:
     saveSpaceObjectsData(const QString& path_data, const QString& version_name, const QDateTime& version_date,
                           const QString& comment, const QJsonArray& list, const QJsonArray &extraparameters);
 
+    // Writes the given rows of the model (source rows, in order) to a CSV file. The values are read directly from
+    // the model columns and written in chunks. The file is only replaced if the whole export succeeds.
+    static SalaraInformation exportSpaceObjectsCSV(const QString& path_csv, const SpaceObjectModel& model,
+                                                   const QVector<int>& rows,
+                                                   const std::atomic_bool* cancel = nullptr,
+                                                   const ProgressCallback& progress = {});
+
     static SalaraInformation saveSets(const QString& path_sets, const QDateTime& version_date, const QList<SpaceObjectSet*>& sets);
 
     static SalaraInformation saveCurrentSet(const QString &current_set, const QString &path_sets);
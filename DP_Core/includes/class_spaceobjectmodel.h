@@ -9,9 +9,6 @@
 #include "class_spaceobject.h"
 #include "spcore_global.h"
 
-using SpaceObjectsList = QList<std::shared_ptr<SpaceObject>>;
-using SpaceObjectsMap = QMap<QString, std::shared_ptr<SpaceObject>>;
-
 class SP_CORE_EXPORT SpaceObjectModel : public JsonTableModel
 {
     Q_OBJECT
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "class_salarainformation.h"
+#include "spcore_global.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QMetaObject>
+#include <QString>
+
+#include <functional>
+
+class SpaceObjectModel;
+
+// Backups of the space objects data. Each backup is a snapshot of the whole data (with the same format as the data
+// file) and a journal where each change made after the snapshot is appended as a JSON line. When the journal reaches
+// the maximum number of records, it is compacted into a new snapshot. Only the newest backups are kept.
+//
+// The journal file is synced after each record, so a crash can only lose the record being written. A truncated
+// last line is ignored when the backup is restored.
+//
+// The journal can be attached to the model, so every change of the data is journaled, whatever made it.
+class SP_CORE_EXPORT SpaceObjectsJournal
+{
+public:
+
+    enum ErrorEnum
+    {
+        SNAPSHOT_NOT_SAVED,
+        JOURNAL_NOT_OPEN,
+        JOURNAL_NOT_WRITTEN,
+        BACKUP_NOT_FOUND,
+        SNAPSHOT_INVALID
+    };
+
+    enum class Operation
+    {
+        EDIT,
+        INSERT,
+        REMOVE
+    };
+
+    // Called with the errors of the changes journaled from the attached model.
+    using ErrorCallback = std::function<void(const SalaraInformation&)>;
+
+    static const QMap<ErrorEnum, QString> ErrorListStringMap;
+
+    SpaceObjectsJournal();
+    ~SpaceObjectsJournal();
+
+    void setBackupDirectory(const QString& dir, int max_backups, int max_records);
+
+    // Closes the current backup. The next change starts a new one.
+    void close();
+
+    // Starts a new backup with a snapshot of the data and an empty journal.
+    SalaraInformation startBackup(const QJsonArray& data, const QJsonArray& extraparameters);
+
+    // Appends a change to the journal. Data is the whole data after the change. It is only used if a new backup must
+    // be started (there is no backup yet or the journal is full).
+    SalaraInformation record(Operation operation, int row, const QJsonObject& object,
+                             const QJsonArray& data, const QJsonArray& extraparameters);
+
+    // Journals every change of the model (edited, inserted and removed rows) until it is detached. The edits of rows
+    // not submitted yet are not journaled. A reset of the model closes the backup, so the next change starts a new one.
+    void attachModel(const SpaceObjectModel* model, const ErrorCallback& error_callback = {});
+    void detachModel();
+
+    // The changes of the attached model between these calls are not journaled one by one. If there are any, a new
+    // backup is started with a snapshot of the data at the end.
+    void beginBulkChange();
+    SalaraInformation endBulkChange();
+
+    // Starts a new backup with a snapshot of the attached model.
+    SalaraInformation snapshotModel();
+
+    // Rebuilds the data as it was at the given time, from the newest snapshot before it and its journal.
+    static SalaraInformation restore(const QString& dir, const QDateTime& datetime, QJsonArray& data);
+
+private:
+
+    SpaceObjectsJournal(const SpaceObjectsJournal&) = delete;
+    SpaceObjectsJournal& operator=(const SpaceObjectsJournal&) = delete;
+
+    void pruneBackups() const;
+    void recordModelRows(Operation operation, int first, int last);
+    QJsonArray modelExtraParameters() const;
+
+    QString backup_dir;
+    int max_backups;
+    int max_records;
+    int records;
+    QFile journal_file;
+
+    const SpaceObjectModel* model;
+    QList<QMetaObject::Connection> model_connections;
+    ErrorCallback error_callback;
+    int bulk_depth;
+    bool bulk_changed;
+};
@@ -4,6 +4,9 @@
 #include "class_salarainformation.h"
 #include "spcore_global.h"
 
+#include <atomic>
+#include <functional>
+
 class SP_CORE_EXPORT TrackingFileManager
 {
 public:
@@ -12,17 +15,24 @@ public:
         TRACKFILE_NOT_OPEN,
         TRACKFILE_INVALID,
         TRACKFILE_NOT_EXISTS,
-        TRACKFILE_NOT_REMOVABLE
+        TRACKFILE_NOT_REMOVABLE,
+        LOAD_CANCELLED
     };
 
+    // Called with the number of files processed and the total number of files. It is called from the loader
+    // threads, so it must be thread safe.
+    using ProgressCallback = std::function<void(std::size_t, std::size_t)>;
+
     static const QMap<ErrorEnum, QString> ErrorListStringMap;
 
     static SalaraInformation readTracking(const QString& track_name, const QString &track_dirpath,
                                           const QString &calib_dirpath, Tracking& track);
     static SalaraInformation readTracking(const QString& track_name, const QString &track_dirpath, Tracking& track);
     static SalaraInformation readTracking(const QString& track_name, Tracking& track);
+    // Files are parsed in parallel. The trackings are appended to tracks sorted by file name.
     static SalaraInformation readTrackingDir(const QString& dir, const QString& calib_path,
-                                             std::vector<Tracking>& tracks);
+                                             std::vector<Tracking>& tracks, const std::atomic_bool* cancel = nullptr,
+                                             const ProgressCallback& progress = {});
     static SalaraInformation readTrackingDir(const QString& dir, std::vector<Tracking>& tracks);
     static SalaraInformation writeTracking(const Tracking& track, const QString& dest_dir = "",
                                            const QString& filename = "");
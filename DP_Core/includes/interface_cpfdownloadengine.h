@@ -2,6 +2,9 @@
 
 #include "interface_plugin.h"
 #include "class_salarainformation.h"
+#include "class_spaceobject.h"
+
+#include <QDateTime>
 
 class SP_CORE_EXPORT CPFDownloadEngine : public SPPlugin
 {
@@ -14,7 +17,8 @@ public:
         LISTING_FAILED,
         DOWNLOAD_FAILED,
         ENGINE_BUSY,
-        PERMISSIONS_ERROR
+        PERMISSIONS_ERROR,
+        WRITE_FAILED
     };
 
     enum ClassificationEnum
@@ -32,9 +36,23 @@ public:
         {CPFDownloadEngine::ErrorEnum::ENGINE_BUSY,
          "Engine is busy. Impossible to accept this request."},
         {CPFDownloadEngine::ErrorEnum::PERMISSIONS_ERROR,
-         "Denied permits. Impossible to create a temporary directory."}
+         "Denied permits. Impossible to create a temporary directory."},
+        {CPFDownloadEngine::ErrorEnum::WRITE_FAILED,
+         "Write failed. Impossible to move the downloaded file to the destination directory."}
+    };
+
+    // Metadata of a remote file, used to detect new content published with the same name.
+    struct RemoteFileInfo
+    {
+        QString etag;
+        QDateTime last_modified;
+
+        inline bool isEmpty() const {return this->etag.isEmpty() && !this->last_modified.isValid();}
     };
 
+    // Number of concurrent downloads of syncCPFs by default.
+    static constexpr int kDefaultConcurrentDownloads = 4;
+
     CPFDownloadEngine(ClassificationEnum clas) :
         SPPlugin(PluginCategory::CPF_DOWNLOAD_ENGINE), classification(clas){}
     virtual ~CPFDownloadEngine() = default;
@@ -42,6 +60,24 @@ public:
     virtual SalaraInformation listCPFs(QStringList& files) = 0;
     virtual SalaraInformation getCPF(const QString &file_name, const QString& dest_path) = 0;
 
+    // Gets the metadata of a remote file: the ETag or Last-Modified headers with HTTP, the modification date with FTP
+    // (CurlManager::remoteFileInfo gets both). The default implementation returns empty metadata, so syncCPFs can
+    // only check the local copies of the engine files.
+    virtual SalaraInformation remoteFileInfo(const QString& file_name, RemoteFileInfo& info);
+
+    // Downloads the CPFs of the objects (all the CPFs if objects is empty) released since the given date that are
+    // not in the destination directory yet or changed in the server. The checksums and the remote metadata of the
+    // fetched files are kept in a cache file in the destination directory, so only the new releases and the files
+    // republished with the same name are downloaded. Each file is downloaded to a temporary directory and then
+    // atomically replaces the destination file, so the readers never see a partial or missing CPF.
+    // The default implementation is built on listCPFs, remoteFileInfo and getCPF.
+    virtual SalaraInformation syncCPFs(const SpaceObjectsList& objects, const QDateTime& since,
+                                       const QString& dest_dir, QStringList& downloaded);
+
+    // Number of files checked and downloaded at the same time by syncCPFs. The engines whose getCPF and
+    // remoteFileInfo are not reentrant must return 1.
+    virtual int maxConcurrentDownloads() const {return kDefaultConcurrentDownloads;}
+
     inline ClassificationEnum getEngineClassification() const {return this->classification;}
 
 signals:
@@ -1,4 +1,5 @@
 #include "includes/class_calibrationfilemanager.h"
+#include "includes/class_calibrationindex.h"
 #include "includes/class_statsfilemanager.h"
 #include "includes/class_salarasettings.h"
 
@@ -7,7 +8,11 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QDir>
+#include <QFileInfo>
 
+#include <omp.h>
+
+#include "includes/class_jsonstreamreader.h"
 
 const QString kDateStartKey = QStringLiteral("date");
 const QString kCfgIdKey = QStringLiteral("cfg_id");
@@ -42,6 +47,8 @@ const QMap<CalibrationFileManager::ErrorEnum, QString> CalibrationFileManager::E
      "The calibration json file %1 is not valid."},
     {CalibrationFileManager::ErrorEnum::CALIBFILE_NOT_OPEN,
      "The calibration json file %1 could not be opened."},
+    {CalibrationFileManager::ErrorEnum::LOAD_CANCELLED,
+     "The loading of the calibrations directory %1 was cancelled."},
 };
 
 // TODO: long double?
@@ -140,63 +147,83 @@ SalaraInformation CalibrationFileManager::writeCalibration(const Calibration& ca
     calib_file.write(calib_jsondocument.toJson(QJsonDocument::Indented));
     calib_file.close();
 
+    // Update the index if the calibration was written in the historical calibrations directory.
+    QString hist_calpath =
+            SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalCalibrations");
+    if (!hist_calpath.isEmpty())
+    {
+        QString relative_path = QDir(hist_calpath).relativeFilePath(QFileInfo(file_path).absoluteFilePath());
+        if (!relative_path.startsWith(".."))
+            return CalibrationIndex::instance().update(calib, relative_path);
+    }
+
     // Return the errors
     return {};
 }
 
-SalaraInformation CalibrationFileManager::readCalibrationDir(const QString &dir, std::vector<Calibration> &calibs)
+SalaraInformation CalibrationFileManager::readCalibrationDir(const QString &dir, std::vector<Calibration> &calibs,
+                                                            const std::atomic_bool *cancel,
+                                                            const ProgressCallback &progress)
 {
-    Calibration c;
+    const QStringList files = QDir(dir).entryList({"*.dpcr"}, QDir::Files, QDir::Name);
+    const int nfiles = files.size();
+
+    // Each file is parsed into its own slot, so the output order does not depend on the threads scheduling.
+    std::vector<Calibration> loaded(nfiles);
+    std::vector<SalaraInformation> loaded_errors(nfiles);
+    std::vector<char> processed(nfiles, 0);
+    std::size_t processed_count = 0;
+
+    #pragma omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)
+    for (int i = 0; i < nfiles; i++)
+    {
+        if (cancel && *cancel)
+            continue;
+
+        loaded_errors[i] = CalibrationFileManager::readCalibration(files[i], dir, loaded[i]);
+        processed[i] = 1;
+
+        #pragma omp critical
+        {
+            processed_count++;
+            if (progress)
+                progress(processed_count, static_cast<std::size_t>(nfiles));
+        }
+    }
+
+    // Move the valid calibrations to the output.
     SalaraInformation result;
-    for (auto&& file : QDir(dir).entryList({"*.dpcr"}, QDir::Files))
+    calibs.reserve(calibs.size() + static_cast<std::size_t>(nfiles));
+    for (int i = 0; i < nfiles; i++)
     {
-        auto errors = CalibrationFileManager::readCalibration(file, dir, c);
-        result.append(errors);
-        if (!errors.hasError())
-            calibs.push_back(c);
+        result.append(loaded_errors[i]);
+        if (processed[i] && !loaded_errors[i].hasError())
+            calibs.push_back(std::move(loaded[i]));
     }
+
+    if (processed_count < static_cast<std::size_t>(nfiles))
+        result.append({{CalibrationFileManager::ErrorEnum::LOAD_CANCELLED,
+                        CalibrationFileManager::ErrorListStringMap[ErrorEnum::LOAD_CANCELLED].arg(dir)}});
+
     return result;
 }
 
 SalaraInformation CalibrationFileManager::readLastCalib(Calibration &calib)
 {
-    QString hist_calpath =
-            SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalCalibrations");
-    QStringList dirs = QDir(hist_calpath).entryList(QDir::Dirs, QDir::Name);
-
-    QDateTime last_calib_dt(QDateTime::fromMSecsSinceEpoch(0, Qt::UTC));
-    QString last_calib_name;
+    CalibrationIndex& index = CalibrationIndex::instance();
+    CalibrationIndex::Entry entry;
     SalaraInformation errors;
-    auto dir_it = dirs.crbegin();
-
-    if (!dirs.empty())
-    {
-        do
-        {
-            for (const auto& filename : QDir(hist_calpath + '/' + *dir_it).entryList(QDir::Files))
-            {
-                QDateTime calib_dt(CalibrationFileManager::startDateTime(filename));
-                if (calib_dt > last_calib_dt)
-                {
-                    last_calib_name = filename;
-                    last_calib_dt = calib_dt;
-                }
-            }
 
-            dir_it++;
-
-        } while (last_calib_name.isEmpty() && dir_it != dirs.crend());
-    }
-
-    if (last_calib_name.isEmpty())
+    // The index could be outdated if the files were modified externally. In that case it is rebuilt once.
+    if (index.last(entry))
     {
-        errors = {{ErrorEnum::CALIB_NOT_FOUND, "Last calibration file not found"}};
+        errors = CalibrationFileManager::readCalibrationFromFile(index.absolutePath(entry), calib);
+        if (errors.containsError(ErrorEnum::CALIBFILE_NOT_OPEN) && !index.rebuild().hasError() && index.last(entry))
+            errors = CalibrationFileManager::readCalibrationFromFile(index.absolutePath(entry), calib);
     }
     else
     {
-        dir_it--;
-        errors = CalibrationFileManager::readCalibrationFromFile(
-                    hist_calpath + '/' + *dir_it + '/' + last_calib_name, calib);
+        errors = {{ErrorEnum::CALIB_NOT_FOUND, "Last calibration file not found"}};
     }
 
     return errors;
@@ -210,21 +237,31 @@ QString CalibrationFileManager::calibrationFilename(const Calibration &calib)
 }
 
 QString CalibrationFileManager::findCalibration(const QString &calib_name)
-{   
+{
+    // The calibrations are named after the station, configuration and start minute (UTC), so the calibration is
+    // looked up in the index between the start of that minute and the next one.
     QString result;
-    QDate date_start = CalibrationFileManager::startDate(calib_name);
-
-    if (date_start.isValid())
+    QDateTime datetime = CalibrationFileManager::startDateTime(calib_name);
+    if (!datetime.isValid())
+        return result;
+    datetime.setTimeSpec(Qt::UTC);
+
+    CalibrationIndex& index = CalibrationIndex::instance();
+    const QString file_name = calib_name.endsWith(".dpcr") ? calib_name : calib_name + ".dpcr";
+    const auto entries = index.between(datetime, datetime.addSecs(60).addMSecs(-1), calib_name.section('_', 1, 1));
+    for (const auto& entry : entries)
     {
-        QString hist_calpath =
-                SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalCalibrations");
-
-        result = hist_calpath + "/" + date_start.toString("yyyyMMdd") + '/' + calib_name;
-
-        if (!QFile::exists(result))
-            result = QString();
+        if (QFileInfo(entry.file_path).fileName() == file_name && QFile::exists(index.absolutePath(entry)))
+            return index.absolutePath(entry);
     }
 
+    // Calibrations not indexed yet are looked for in the date folder.
+    QString hist_calpath =
+            SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalCalibrations");
+    result = hist_calpath + "/" + datetime.date().toString("yyyyMMdd") + '/' + calib_name;
+    if (!QFile::exists(result))
+        result = QString();
+
     return result;
 }
 
@@ -268,90 +305,156 @@ SalaraInformation CalibrationFileManager::readCalibrationFromFile(const QString
 {
     QFile calib_file(filepath);
     // Check if file could be opened.
-    if(!calib_file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if(!calib_file.open(QIODevice::ReadOnly))
         return SalaraInformation({CalibrationFileManager::ErrorEnum::CALIBFILE_NOT_OPEN,
                                   ErrorListStringMap[ErrorEnum::CALIBFILE_NOT_OPEN].arg(filepath)});
 
-    // Read all.
-    QString calib_string = calib_file.readAll().simplified();
-    calib_file.close();
-    // Loads the json document.
-    QJsonDocument json = QJsonDocument::fromJson(calib_string.toUtf8());
+    // Map the file. If it is not possible, read all.
+    QByteArray calib_buffer;
+    const char* calib_data = reinterpret_cast<const char*>(calib_file.map(0, calib_file.size()));
+    if (!calib_data)
+    {
+        calib_buffer = calib_file.readAll();
+        calib_data = calib_buffer.constData();
+    }
 
-    // Check if scheme is valid
+    // The document is decoded while it is parsed, without building the json DOM.
+    JsonStreamReader reader(calib_data, static_cast<std::size_t>(calib_file.size()));
     SalaraInformation::ErrorList error_list;
+    Calibration result;
 
-    // Check if data file is valid
-    if (json.isNull())
+    // Small nested values are decoded with the json DOM.
+    auto subObject = [&reader]
     {
-        error_list.append({ErrorEnum::CALIBFILE_INVALID, ErrorListStringMap[ErrorEnum::CALIBFILE_INVALID].arg(filepath)});
-    }
-    else
+        std::string_view raw = reader.skipValue();
+        return QJsonDocument::fromJson(QByteArray::fromRawData(raw.data(), static_cast<int>(raw.size()))).object();
+    };
+
+    // Appends the times of an ET array. The times are stored as strings to keep the precision. Invalid times are
+    // discarded.
+    auto readTimes = [&reader](std::vector<long double>& times)
     {
-        // Ensure object is cleared
-        calib = Calibration();
-
-        calib.date_start = QDateTime::fromString(json[kDateStartKey].toString(), Qt::ISODateWithMs);
-        calib.cfg_id = json[kCfgIdKey].toString();
-        calib.station_name = json[kStationNameKey].toString();
-        calib.station_id = json[kStationIdKey].toInt();
-        calib.type = static_cast<Calibration::Type>(json[kCalTypeKey].toInt());
-        calib.target_dist_2w = json[kTgtDistKey].toDouble();
-        calib.target_tof_2w = {json[kTgtToFKey].toDouble(), decltype(calib.target_tof_2w)::Unit::LIGHT_PS};
-        calib.rf = json[kRFKey].toDouble();
-        calib.nshots = json[kNShotsKey].toInt();
-        calib.rnshots = json[kRNShotsKey].toInt();
-        calib.unshots = json[kUNShotsKey].toInt();
-        calib.tror_rfrms = json[kTRORRFRMSKey].toDouble();
-        calib.tror_1rms = json[kTROR1RMSKey].toDouble();
-        calib.cal_val_rfrms = json[kCalValRFRMSKey].toDouble();
-        calib.cal_val_1rms = json[kCalVal1RMSKey].toDouble();
-
-        calib.meteo = MeteoData::fromJson(json[kMeteoKey].toObject());
-
-        calib.stats_rfrms = StatsFileManager::fromJson(json[kStatsRFRMSKey].toObject());
-        calib.stats_1rms = StatsFileManager::fromJson(json[kStats1RMSKey].toObject());
-
-        QJsonArray array = json[kRangesKey].toArray();
-        for (const auto& elem : std::as_const(array))
+        if (JsonStreamReader::Token::BEGIN_ARRAY != reader.token())
+            return;
+        while (reader.nextElement())
         {
-            QJsonObject obj = elem.toObject();
-            Calibration::RangeData echo;
-            // TODO: check values of enum
-            echo.flag = static_cast<Calibration::RangeData::FilterFlag>(obj[kFlagKey].toInt());
-            echo.start_time = obj[kStartKey].toDouble();
-            echo.tof_2w = obj[kToFKey].toDouble();
-            calib.ranges.push_back(echo);
+            bool ok;
+            long double value = reader.toLongDouble(0.L, &ok);
+            if (ok)
+                times.push_back(value);
+            else if (reader.isContainer())
+                reader.skipValue();
         }
+    };
 
-        // TODO: include fail for failed converssions?
-        QJsonObject et_object = json[kEtKey].toObject();
-        if (!et_object.empty())
+    if (JsonStreamReader::Token::BEGIN_OBJECT == reader.next())
+    {
+        while (reader.nextKey() && !reader.hasError())
         {
-            array = et_object[kTAKey].toArray();
-            for (const auto& elem : std::as_const(array))
+            reader.next();
+
+            if (reader.isKey(kDateStartKey))
+                result.date_start = QDateTime::fromString(reader.toString(), Qt::ISODateWithMs);
+            else if (reader.isKey(kCfgIdKey))
+                result.cfg_id = reader.toString();
+            else if (reader.isKey(kStationNameKey))
+                result.station_name = reader.toString();
+            else if (reader.isKey(kStationIdKey))
+                result.station_id = static_cast<unsigned int>(reader.toInteger());
+            else if (reader.isKey(kCalTypeKey))
+                result.type = static_cast<Calibration::Type>(reader.toInteger());
+            else if (reader.isKey(kTgtDistKey))
+                result.target_dist_2w = reader.toDouble();
+            else if (reader.isKey(kTgtToFKey))
+                result.target_tof_2w = {reader.toDouble(), decltype(result.target_tof_2w)::Unit::LIGHT_PS};
+            else if (reader.isKey(kRFKey))
+                result.rf = reader.toDouble();
+            else if (reader.isKey(kNShotsKey))
+                result.nshots = static_cast<std::size_t>(reader.toInteger());
+            else if (reader.isKey(kRNShotsKey))
+                result.rnshots = static_cast<std::size_t>(reader.toInteger());
+            else if (reader.isKey(kUNShotsKey))
+                result.unshots = static_cast<std::size_t>(reader.toInteger());
+            else if (reader.isKey(kTRORRFRMSKey))
+                result.tror_rfrms = reader.toDouble();
+            else if (reader.isKey(kTROR1RMSKey))
+                result.tror_1rms = reader.toDouble();
+            else if (reader.isKey(kCalValRFRMSKey))
+                result.cal_val_rfrms = reader.toDouble();
+            else if (reader.isKey(kCalVal1RMSKey))
+                result.cal_val_1rms = reader.toDouble();
+
+            else if (reader.isKey(kMeteoKey))
+                result.meteo = MeteoData::fromJson(subObject());
+
+            else if (reader.isKey(kStatsRFRMSKey))
+                result.stats_rfrms = StatsFileManager::fromJson(subObject());
+            else if (reader.isKey(kStats1RMSKey))
+                result.stats_1rms = StatsFileManager::fromJson(subObject());
+
+            // Ranges. The number of shots is stored before the ranges, so it is used to reserve the memory.
+            else if (reader.isKey(kRangesKey) && JsonStreamReader::Token::BEGIN_ARRAY == reader.token())
             {
-                try
+                result.ranges.reserve(result.nshots);
+                while (reader.nextElement())
                 {
-                    calib.tA.push_back(std::stold(elem.toString().toStdString()));
+                    Calibration::RangeData echo;
+                    if (JsonStreamReader::Token::BEGIN_OBJECT != reader.token())
+                    {
+                        reader.skipValue();
+                        continue;
+                    }
+                    while (reader.nextKey())
+                    {
+                        reader.next();
+                        // TODO: check values of enum
+                        if (reader.isKey(kFlagKey))
+                            echo.flag = static_cast<Calibration::RangeData::FilterFlag>(reader.toInteger());
+                        else if (reader.isKey(kStartKey))
+                            echo.start_time = reader.toDouble();
+                        else if (reader.isKey(kToFKey))
+                            echo.tof_2w = reader.toDouble();
+
+                        // Unknown keys or values with unexpected types.
+                        if (reader.isContainer())
+                            reader.skipValue();
+                    }
+                    result.ranges.push_back(echo);
                 }
-                catch(...){}
             }
 
-            array = et_object[kTBKey].toArray();
-            for (const auto& elem : std::as_const(array))
+            // TODO: include fail for failed converssions?
+            else if (reader.isKey(kEtKey) && JsonStreamReader::Token::BEGIN_OBJECT == reader.token())
             {
-                try
+                while (reader.nextKey())
                 {
-                    calib.tB.push_back(std::stold(elem.toString().toStdString()));
+                    reader.next();
+                    if (reader.isKey(kTAKey))
+                        readTimes(result.tA);
+                    else if (reader.isKey(kTBKey))
+                        readTimes(result.tB);
+                    else if (reader.isKey(kETPrecisionKey))
+                        result.et_precision = static_cast<unsigned int>(reader.toInteger());
+
+                    if (reader.isContainer())
+                        reader.skipValue();
                 }
-                catch(...){}
             }
 
-            calib.et_precision = et_object[kETPrecisionKey].toInt();
+            // Other keys or values with unexpected types.
+            if (reader.isContainer())
+                reader.skipValue();
         }
     }
 
+    // Check if data file is valid
+    if (reader.hasError() || JsonStreamReader::Token::END_DOCUMENT != reader.next())
+        error_list.append({ErrorEnum::CALIBFILE_INVALID, ErrorListStringMap[ErrorEnum::CALIBFILE_INVALID].arg(filepath)});
+    else
+        calib = std::move(result);
+
+    calib_file.close();
+
     // Return the errors
     return SalaraInformation(error_list);
 }
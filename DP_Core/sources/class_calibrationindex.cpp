@@ -0,0 +1,338 @@
+#include "includes/class_calibrationindex.h"
+#include "includes/class_calibrationfilemanager.h"
+#include "includes/class_salarasettings.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLockFile>
+#include <QSaveFile>
+
+#include <algorithm>
+
+const QString kIndexFilename = QStringLiteral("SP_CalibrationsIndex.json");
+const QString kLockSuffix = QStringLiteral(".lock");
+const int kLockTimeoutMs = 5000;
+const QString kDateStartKey = QStringLiteral("date");
+const QString kCfgIdKey = QStringLiteral("cfg_id");
+const QString kStationNameKey = QStringLiteral("station_name");
+const QString kStationIdKey = QStringLiteral("station_id");
+const QString kCalTypeKey = QStringLiteral("cal_type");
+const QString kCalValRFRMSKey = QStringLiteral("cal_val_rfrms");
+const QString kCalVal1RMSKey = QStringLiteral("cal_val_1rms");
+const QString kTRORRFRMSKey = QStringLiteral("tror_rfrms");
+const QString kFileKey = QStringLiteral("file");
+
+const QMap<CalibrationIndex::ErrorEnum, QString> CalibrationIndex::ErrorListStringMap =
+{
+    {CalibrationIndex::ErrorEnum::INDEX_NOT_OPEN,
+     "The calibrations index file %1 could not be opened."},
+    {CalibrationIndex::ErrorEnum::HISTORICAL_PATH_INVALID,
+     "The historical calibrations path %1 is not valid."},
+    {CalibrationIndex::ErrorEnum::INDEX_LOCKED,
+     "The calibrations index file %1 is locked by another process."},
+};
+
+CalibrationIndex::Entry::Entry() :
+    station_id(0),
+    type(Calibration::Type::UNDEFINED),
+    cal_val_rfrms(0.),
+    cal_val_1rms(0.),
+    tror_rfrms(0.)
+{}
+
+CalibrationIndex::Entry::Entry(const Calibration &calib, const QString &file_path) :
+    date_start(calib.date_start),
+    cfg_id(calib.cfg_id),
+    station_name(calib.station_name),
+    station_id(calib.station_id),
+    type(calib.type),
+    cal_val_rfrms(calib.cal_val_rfrms),
+    cal_val_1rms(calib.cal_val_1rms),
+    tror_rfrms(calib.tror_rfrms),
+    file_path(file_path)
+{}
+
+QJsonObject CalibrationIndex::Entry::toJson() const
+{
+    QJsonObject obj;
+    obj.insert(kDateStartKey, this->date_start.toString(Qt::ISODateWithMs));
+    obj.insert(kCfgIdKey, this->cfg_id);
+    obj.insert(kStationNameKey, this->station_name);
+    obj.insert(kStationIdKey, static_cast<int>(this->station_id));
+    obj.insert(kCalTypeKey, static_cast<int>(this->type));
+    obj.insert(kCalValRFRMSKey, this->cal_val_rfrms);
+    obj.insert(kCalVal1RMSKey, this->cal_val_1rms);
+    obj.insert(kTRORRFRMSKey, this->tror_rfrms);
+    obj.insert(kFileKey, this->file_path);
+    return obj;
+}
+
+CalibrationIndex::Entry CalibrationIndex::Entry::fromJson(const QJsonObject &obj)
+{
+    Entry entry;
+    entry.date_start = QDateTime::fromString(obj[kDateStartKey].toString(), Qt::ISODateWithMs);
+    entry.cfg_id = obj[kCfgIdKey].toString();
+    entry.station_name = obj[kStationNameKey].toString();
+    entry.station_id = obj[kStationIdKey].toInt();
+    entry.type = static_cast<Calibration::Type>(obj[kCalTypeKey].toInt());
+    entry.cal_val_rfrms = obj[kCalValRFRMSKey].toDouble();
+    entry.cal_val_1rms = obj[kCalVal1RMSKey].toDouble();
+    entry.tror_rfrms = obj[kTRORRFRMSKey].toDouble();
+    entry.file_path = obj[kFileKey].toString();
+    return entry;
+}
+
+CalibrationIndex &CalibrationIndex::instance()
+{
+    static CalibrationIndex calibration_index;
+    return calibration_index;
+}
+
+SalaraInformation CalibrationIndex::rebuild()
+{
+    QMutexLocker locker(&this->mutex);
+    this->historical_path =
+            SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalCalibrations");
+    return this->rebuildPrivate();
+}
+
+SalaraInformation CalibrationIndex::update(const Calibration &calib, const QString &file_path)
+{
+    QMutexLocker locker(&this->mutex);
+    SalaraInformation errors = this->ensureLoaded();
+    if (errors.hasError())
+        return errors;
+
+    // Other processes could have updated the index since it was loaded, so it is reloaded under the lock file and
+    // the new entry is merged with its contents.
+    QLockFile lock_file(this->indexFilePath() + kLockSuffix);
+    if (!lock_file.tryLock(kLockTimeoutMs))
+        return SalaraInformation({ErrorEnum::INDEX_LOCKED,
+                                  ErrorListStringMap[ErrorEnum::INDEX_LOCKED].arg(this->indexFilePath())});
+
+    errors = this->ensureLoaded();
+    if (errors.hasError())
+        return errors;
+
+    // A calibration rewritten with the same configuration and date replaces the previous entry.
+    this->addEntry(Entry(calib, file_path));
+    return this->save();
+}
+
+bool CalibrationIndex::last(Entry &entry, const QString &cfg_id)
+{
+    QMutexLocker locker(&this->mutex);
+    if (this->ensureLoaded().hasError())
+        return false;
+
+    // The last entry of each configuration is the last of its ordered entries. The newest date folder is only
+    // checked if nothing is indexed, so the archive is not listed for each query.
+    auto select = [this, &entry, &cfg_id]
+    {
+        const Entry* selected = nullptr;
+        for (const auto& cfg_pair : this->entries)
+        {
+            if ((cfg_id.isEmpty() || cfg_id == cfg_pair.first) && !cfg_pair.second.empty() &&
+                (!selected || cfg_pair.second.crbegin()->first > selected->date_start))
+                selected = &cfg_pair.second.crbegin()->second;
+        }
+        if (selected)
+            entry = *selected;
+        return selected != nullptr;
+    };
+
+    return select() || (this->scanNewestDir() && select());
+}
+
+std::vector<CalibrationIndex::Entry> CalibrationIndex::between(const QDateTime &start, const QDateTime &end,
+                                                               const QString &cfg_id)
+{
+    QMutexLocker locker(&this->mutex);
+    std::vector<Entry> result;
+    if (this->ensureLoaded().hasError())
+        return result;
+
+    auto collect = [this, &start, &end, &cfg_id, &result]
+    {
+        for (const auto& cfg_pair : this->entries)
+        {
+            if (!cfg_id.isEmpty() && cfg_id != cfg_pair.first)
+                continue;
+            for (auto it = cfg_pair.second.lower_bound(start); it != cfg_pair.second.cend() && it->first <= end; it++)
+                result.push_back(it->second);
+        }
+    };
+
+    collect();
+    if (result.empty() && this->scanNewestDir())
+        collect();
+
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b){return a.date_start < b.date_start;});
+    return result;
+}
+
+QString CalibrationIndex::absolutePath(const Entry &entry) const
+{
+    QMutexLocker locker(&this->mutex);
+    return this->historical_path + '/' + entry.file_path;
+}
+
+SalaraInformation CalibrationIndex::ensureLoaded()
+{
+    // Forget the loaded index if the historical path changed (or it was never loaded).
+    QString hist_calpath =
+            SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalCalibrations");
+    if (hist_calpath != this->historical_path || this->historical_path.isEmpty())
+    {
+        this->historical_path = hist_calpath;
+        this->index_modified = QDateTime();
+        this->index_size = -1;
+    }
+
+    QFileInfo index_info(this->indexFilePath());
+    if (!index_info.exists())
+        return this->rebuildPrivate();
+
+    // Reload if the file was changed by other process since it was loaded or saved.
+    if (index_info.lastModified() == this->index_modified && index_info.size() == this->index_size)
+        return {};
+
+    return this->load();
+}
+
+SalaraInformation CalibrationIndex::load()
+{
+    this->entries.clear();
+    this->indexed_files.clear();
+
+    // The file information is taken before reading. If the file changes meanwhile, it will be reloaded again.
+    QFileInfo index_info(this->indexFilePath());
+    QFile index_file(this->indexFilePath());
+    if (!index_file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return SalaraInformation({ErrorEnum::INDEX_NOT_OPEN,
+                                  ErrorListStringMap[ErrorEnum::INDEX_NOT_OPEN].arg(index_file.fileName())});
+
+    QJsonDocument json = QJsonDocument::fromJson(index_file.readAll());
+    index_file.close();
+
+    // An invalid index is rebuilt from the archive.
+    if (!json.isArray())
+        return this->rebuildPrivate();
+
+    for (const auto& elem : json.array())
+        this->addEntry(Entry::fromJson(elem.toObject()));
+
+    this->index_modified = index_info.lastModified();
+    this->index_size = index_info.size();
+
+    return {};
+}
+
+SalaraInformation CalibrationIndex::rebuildPrivate()
+{
+    this->entries.clear();
+    this->indexed_files.clear();
+    this->index_modified = QDateTime();
+    this->index_size = -1;
+
+    QDir hist_dir(this->historical_path);
+    if (this->historical_path.isEmpty() || !hist_dir.exists())
+        return SalaraInformation({ErrorEnum::HISTORICAL_PATH_INVALID,
+                                  ErrorListStringMap[ErrorEnum::HISTORICAL_PATH_INVALID].arg(this->historical_path)});
+
+    // Directory crawl. Only done when the index does not exist or is not valid. The whole archive is read, so the
+    // result does not need to be merged with the file.
+    for (const auto& date_dir : hist_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+    {
+        for (const auto& filename : QDir(hist_dir.filePath(date_dir)).entryList({"*.dpcr"}, QDir::Files))
+        {
+            Calibration calib;
+            if (!CalibrationFileManager::readCalibration(filename, hist_dir.filePath(date_dir), calib).hasError())
+                this->addEntry(Entry(calib, date_dir + '/' + filename));
+        }
+    }
+
+    return this->save();
+}
+
+bool CalibrationIndex::scanNewestDir()
+{
+    QDir hist_dir(this->historical_path);
+    if (this->historical_path.isEmpty() || !hist_dir.exists())
+        return false;
+
+    // The date folders are named yyyyMMdd, so the newest one is the last by name.
+    const QStringList date_dirs = hist_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    if (date_dirs.isEmpty())
+        return false;
+
+    const QString& date_dir = date_dirs.last();
+    std::vector<Entry> found;
+    for (const auto& filename : QDir(hist_dir.filePath(date_dir)).entryList({"*.dpcr"}, QDir::Files))
+    {
+        Calibration calib;
+        QString file_path = date_dir + '/' + filename;
+        if (!this->indexed_files.contains(file_path) &&
+            !CalibrationFileManager::readCalibration(filename, hist_dir.filePath(date_dir), calib).hasError())
+            found.push_back(Entry(calib, file_path));
+    }
+
+    if (found.empty())
+        return false;
+
+    // Merge the calibrations found with the index file. If it can not be saved, they are kept in memory.
+    QLockFile lock_file(this->indexFilePath() + kLockSuffix);
+    bool locked = lock_file.tryLock(kLockTimeoutMs);
+    if (locked)
+        this->ensureLoaded();
+
+    for (auto& entry : found)
+        this->addEntry(std::move(entry));
+
+    if (locked)
+        this->save();
+
+    return true;
+}
+
+void CalibrationIndex::addEntry(Entry &&entry)
+{
+    this->indexed_files.insert(entry.file_path);
+    QString cfg_id = entry.cfg_id;
+    QDateTime date_start = entry.date_start;
+    this->entries[cfg_id][date_start] = std::move(entry);
+}
+
+QString CalibrationIndex::indexFilePath() const
+{
+    return this->historical_path + '/' + kIndexFilename;
+}
+
+SalaraInformation CalibrationIndex::save()
+{
+    QJsonArray array;
+    for (const auto& cfg_pair : this->entries)
+        for (const auto& entry_pair : cfg_pair.second)
+            array.append(entry_pair.second.toJson());
+
+    // The index is written to a temporary file and renamed over the previous one, so the readers never see a
+    // partially written index.
+    QSaveFile index_file(this->indexFilePath());
+    if (!index_file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return SalaraInformation({ErrorEnum::INDEX_NOT_OPEN,
+                                  ErrorListStringMap[ErrorEnum::INDEX_NOT_OPEN].arg(index_file.fileName())});
+
+    index_file.write(QJsonDocument(array).toJson(QJsonDocument::Indented));
+    if (!index_file.commit())
+        return SalaraInformation({ErrorEnum::INDEX_NOT_OPEN,
+                                  ErrorListStringMap[ErrorEnum::INDEX_NOT_OPEN].arg(index_file.fileName())});
+
+    QFileInfo index_info(this->indexFilePath());
+    this->index_modified = index_info.lastModified();
+    this->index_size = index_info.size();
+
+    return {};
+}
@@ -2,9 +2,12 @@
 #include "includes/class_cpffilemanager.h"
 #include "includes/class_globalutils.h"
 
+#include <cpfutils.h>
+
 #include <QDebug>
 #include <QtMath>
 
+#include <algorithm>
 #include <set>
 #include <omp.h>
 #include <memory>
@@ -14,7 +17,8 @@ const QMap<CPFFileManager::SelectionOption, QString> CPFFileManager::kMapSelecti
     {CPFFileManager::SelectionOption::MAXIMIZE_DAYS, "Maximize days"},
     {CPFFileManager::SelectionOption::MOST_CURRENT_REDUCE, "Most current and reduce"},
     {CPFFileManager::SelectionOption::MAXIMIZE_DAYS_REDUCE, "Maximize days and reduce"},
-    {CPFFileManager::SelectionOption::MOST_CURRENT_FIXED, "Most current and fixed"}
+    {CPFFileManager::SelectionOption::MOST_CURRENT_FIXED, "Most current and fixed"},
+    {CPFFileManager::SelectionOption::STITCHED, "Stitched"}
 };
 
 const QMap<CPFFileManager::ProviderOption, QString> CPFFileManager::kMapProviderString
@@ -119,6 +123,25 @@ SalaraInformation CPFFileManager::loadSingleCPFRecursive(const QString &path_dat
     QDate date = end.date();
     std::shared_ptr<CPF> best_tle;
 
+    // The stitched CPF merges the releases of all the folders searched.
+    if (selection_option == SelectionOption::STITCHED)
+    {
+        result = CPFFileManager::loadStitchedCPF(path_data, object, start, end, provider_option, tle_prior, cpf,
+                                                 provider, days_before);
+        if (!cpf && force_provider == ForceProviderOption::NO_FORCE && provider_option != ProviderOption::ALL)
+            result = CPFFileManager::loadStitchedCPF(path_data, object, start, end, ProviderOption::ALL, tle_prior,
+                                                     cpf, "", days_before);
+        if (cpf)
+        {
+            QDateTime p_end = GlobalUtils::timePointToQDateTime(cpf->getHeader().basicInfo2Header()->end_time);
+            QDateTime p_start = GlobalUtils::timePointToQDateTime(cpf->getHeader().basicInfo2Header()->start_time);
+            t_days = p_start.secsTo(p_end)/86400.0;
+            r_days = start.secsTo(p_end)/86400.0;
+            c_days = r_days;
+        }
+        return result;
+    }
+
     do
     {
         result.append(CPFFileManager::loadSingleCPF(path_data + '/' + date.toString("yyyyMMdd"), object, start, end,
@@ -152,6 +175,125 @@ SalaraInformation CPFFileManager::loadSingleCPFRecursive(const QString &path_dat
 
 }
 
+SalaraInformation CPFFileManager::loadStitchedCPF(const QString &path_data, const SpaceObject &object,
+                                                  const QDateTime &start, const QDateTime &end,
+                                                  CPFFileManager::ProviderOption provider_option,
+                                                  CPFFileManager::PriorityTLE tle_prior, std::shared_ptr<CPF> &cpf,
+                                                  const QString &provider, unsigned int days_before)
+{
+    SalaraInformation::ErrorList error_list;
+    dpslr::cpfutils::CPFStitcher stitcher;
+    dpslr::cpfutils::CPFStitcher tle_stitcher;
+    cpf.reset();
+
+    // Select the cpf extension using the provider option.
+    QString filter = "*.*";
+    if(provider_option == CPFFileManager::ProviderOption::PREFERRED)
+    {
+        QString preferred = object.getCPFProvider();
+        if(preferred != SpaceObject::kAllCPFProvider && preferred != SpaceObject::kNoTLEProvider)
+            filter = "*."+preferred;
+    }
+    else if (provider_option == CPFFileManager::ProviderOption::CUSTOM)
+        filter = "*."+provider;
+
+    QDate date = end.date();
+    for (unsigned int i = 0; i < days_before; i++, date = date.addDays(-1))
+    {
+        QString path = path_data + '/' + date.toString("yyyyMMdd");
+        QDir dir_cpfs(path);
+        dir_cpfs.setNameFilters(QStringList()<<filter);
+
+        for (const auto& filename : dir_cpfs.entryList(QDir::Files))
+        {
+            // Open only the header for the checks.
+            CPF cpf_header((path+'/'+filename).toStdString(), CPF::OpenOptionEnum::ONLY_HEADER);
+            if(cpf_header.empty() || !cpf_header.getHeader().basicInfo1Header() ||
+                    !cpf_header.getHeader().basicInfo2Header())
+            {
+                error_list.append({ErrorEnum::CPF_LOAD_FAILED, filename + " load failed."});
+                continue;
+            }
+
+            const auto& h2 = *cpf_header.getHeader().basicInfo2Header();
+            if(h2.norad != object.getNorad().toStdString())
+                continue;
+
+            // Check if is valid CPF.
+            if(h2.target_class == CPFHeader::TargetClassEnum::PASSIVE_LRR_LUNAR ||
+               h2.target_class == CPFHeader::TargetClassEnum::SYNC_TRANSPONDER  ||
+               h2.target_class == CPFHeader::TargetClassEnum::ASYNC_TRANSPONDER ||
+               !h2.tiv_compatible || h2.end_time <= h2.start_time)
+            {
+                error_list.append({ErrorEnum::CPF_INVALID, filename + " is invalid."});
+                continue;
+            }
+
+            // Only the releases that overlap the interval.
+            if(GlobalUtils::timePointToQDateTime(h2.end_time) < start ||
+                    GlobalUtils::timePointToQDateTime(h2.start_time) > end)
+                continue;
+
+            // TLE releases are only used if there are no other releases, if they are the lowest priority.
+            CPF cpf_release((path+'/'+filename).toStdString(), CPF::OpenOptionEnum::ALL_DATA);
+            QString source = QString::fromStdString(cpf_header.getHeader().basicInfo1Header()->cpf_source).toLower();
+            auto& target = (tle_prior == PriorityTLE::LOWEST_PRIORITY && source == "tle") ? tle_stitcher : stitcher;
+            if(target.addRelease(cpf_release) != dpslr::cpfutils::CPFStitcher::NOT_ERROR)
+                error_list.append({ErrorEnum::CPF_INVALID, filename + " is invalid."});
+        }
+    }
+
+    auto& selected = stitcher.releases() > 0 ? stitcher : tle_stitcher;
+    if(selected.releases() == 0)
+    {
+        error_list.append({ErrorEnum::CPF_NOT_FOUND,
+                           "CPF not found for space object with norad +'"+object.getNorad()+"'."});
+        return SalaraInformation(error_list);
+    }
+
+    std::vector<CPF> segments;
+    if(selected.stitch(segments) != dpslr::cpfutils::CPFStitcher::NOT_ERROR || segments.empty())
+    {
+        error_list.append({ErrorEnum::CPF_LOAD_FAILED,
+                           "CPF stitch failed for space object with norad '"+object.getNorad()+"'."});
+        return SalaraInformation(error_list);
+    }
+
+    // The stitched CPF is never interpolated across the gaps, so the gaps inside the interval are reported.
+    auto gapTime = [](int mjd, long double sod)
+    {
+        return QDateTime(QDate::fromJulianDay(mjd + 2400001), QTime(0, 0), Qt::UTC)
+                .addMSecs(static_cast<qint64>(sod * 1000.L));
+    };
+    for (const auto& gap : selected.gaps())
+    {
+        QDateTime gap_start = gapTime(gap.mjd_start, gap.sod_start);
+        QDateTime gap_end = gapTime(gap.mjd_end, gap.sod_end);
+        if(gap_end > start && gap_start < end)
+            error_list.append({ErrorEnum::CPF_GAP, "Stitched CPF for space object with norad '"+object.getNorad()+
+                               "' has a gap from "+gap_start.toString(Qt::ISODate)+" to "+
+                               gap_end.toString(Qt::ISODate)+"."});
+    }
+
+    // Select the continuous part that covers most of the interval.
+    std::size_t best = 0;
+    qint64 best_overlap = -1;
+    for (std::size_t i = 0; i < segments.size(); i++)
+    {
+        const auto& h2 = *segments[i].getHeader().basicInfo2Header();
+        QDateTime p_start = std::max(start, GlobalUtils::timePointToQDateTime(h2.start_time));
+        QDateTime p_end = std::min(end, GlobalUtils::timePointToQDateTime(h2.end_time));
+        if(p_start.secsTo(p_end) > best_overlap)
+        {
+            best_overlap = p_start.secsTo(p_end);
+            best = i;
+        }
+    }
+    cpf = std::make_shared<CPF>(std::move(segments[best]));
+
+    return SalaraInformation(error_list);
+}
+
 QStringList CPFFileManager::getCPFFilesForObject(const QString& path_data, const SpaceObject &object)
 {
 
@@ -352,9 +494,11 @@ SalaraInformation CPFFileManager::privateLoadCPF(const QString& path_data, const
     });
 
     // For this option we select the most current CPF.
+    // The stitched option needs the folders of several days, so for a single folder it is the most current CPF.
     if(selection_option == CPFFileManager::SelectionOption::MOST_CURRENT         ||
        selection_option == CPFFileManager::SelectionOption::MOST_CURRENT_REDUCE  ||
-       selection_option == CPFFileManager::SelectionOption::MOST_CURRENT_FIXED)
+       selection_option == CPFFileManager::SelectionOption::MOST_CURRENT_FIXED   ||
+       selection_option == CPFFileManager::SelectionOption::STITCHED)
     {
 
         auto it = list_cpf.cbegin();
@@ -4,15 +4,57 @@
 
 #include <curl/curl.h>
 
+#include <QFileInfo>
 #include <QtConcurrent/QtConcurrentRun>
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 // TODO: allow and/or manage redirections?
 
-CurlManager::CurlManager(QObject *parent) : QObject(parent), working(false)
+const QString kPartSuffix = QStringLiteral(".part");
+constexpr int kPollTimeoutMs = 1000;
+constexpr int kBackoffBaseMs = 1000;
+constexpr int kMaxBackoffShift = 6;
+
+struct CurlManager::Transfer
+{
+    int id;
+    QString url_path;
+    int port;
+    QString dest_file_path;
+    TransferOptions options;
+    int attempts = 0;
+    std::chrono::steady_clock::time_point not_before;
+    CURL* easy = nullptr;
+    FILE* file = nullptr;
+    curl_slist* headers = nullptr;
+    curl_off_t resume_from = 0;
+    QByteArray etag;
+
+    QString partPath() const {return this->dest_file_path + kPartSuffix;}
+};
+
+CurlManager::CurlManager(QObject *parent) :
+    QObject(parent),
+    working(false),
+    ssl_verification(true),
+    verbose(false),
+    timeout(0),
+    proxy_tunnel(true),
+    follow_redirection(false),
+    cancel_transfers(false),
+    transfers_running(false),
+    active_transfers(0),
+    max_transfers(4),
+    max_host_connections(2),
+    next_transfer_id(0)
 {
+    qRegisterMetaType<CurlManager::ResultCodes>("CurlManager::ResultCodes");
+
     this->curl = curl_easy_init();
+    this->multi = curl_multi_init();
     QObject::connect(&this->future_watcher, &QFutureWatcher<CurlManager::ResultCodes>::finished, this, [this]
     {
         last_result = this->future_watcher.result();
@@ -20,25 +62,67 @@ CurlManager::CurlManager(QObject *parent) : QObject(parent), working(false)
         emit this->jobFinished();
     });
 
-    QString cacert_path = SalaraSettings::instance().getGlobalConfigString(
+    this->cacert_path = SalaraSettings::instance().getGlobalConfigString(
                 "SalaraProjectConfigPaths/SP_ConfigFiles") + "/cacert.pem";
 
     curl_easy_setopt(curl, CURLOPT_USE_SSL, CURLUSESSL_TRY);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
     curl_easy_setopt(curl, CURLOPT_VERBOSE, 0);
-    curl_easy_setopt(curl, CURLOPT_CAINFO, cacert_path.toLatin1().data());
+    curl_easy_setopt(curl, CURLOPT_CAINFO, this->cacert_path.toLatin1().data());
 }
 
 void CurlManager::setSSLVerification(bool enable)
 {
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    this->ssl_verification = enable;
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, enable ? 1L : 0L);
 }
 
 void CurlManager::setVerbose(bool enable)
 {
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    this->verbose = enable;
     curl_easy_setopt(curl, CURLOPT_VERBOSE, enable ? 1L : 0L);
 }
 
+CurlManager::ResultCodes CurlManager::remoteFileInfo(const QString &url_path, int port, QByteArray &etag,
+                                                     QDateTime &modified)
+{
+    etag.clear();
+    modified = QDateTime();
+
+    CURL* handle = curl_easy_init();
+    if (!handle)
+        return CODE_FAILED_INIT;
+
+    // The headers are parsed as in the queued downloads, which keep the ETag in the transfer.
+    Transfer transfer;
+    {
+        std::lock_guard<std::mutex> lock(this->transfers_mutex);
+        this->applyOptions(handle);
+    }
+    curl_easy_setopt(handle, CURLOPT_PORT, static_cast<long>(port));
+    curl_easy_setopt(handle, CURLOPT_URL, url_path.toLatin1().data());
+    curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(handle, CURLOPT_FILETIME, 1L);
+    curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, headerTransferCallback);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, &transfer);
+
+    const auto code = static_cast<ResultCodes>(curl_easy_perform(handle));
+    curl_off_t filetime = -1;
+    if (CODE_OK == code)
+    {
+        curl_easy_getinfo(handle, CURLINFO_FILETIME_T, &filetime);
+        etag = transfer.etag;
+        if (filetime >= 0)
+            modified = QDateTime::fromSecsSinceEpoch(filetime, Qt::UTC);
+    }
+    curl_easy_cleanup(handle);
+
+    return code;
+}
+
 bool CurlManager::listFoldersBlocking(const QString &url, int port, QStringList &buffer)
 {
     std::lock_guard<std::mutex> lock(this->mutex);
@@ -284,7 +368,12 @@ bool CurlManager::uploadFile(const QString &filepath, const QString &url_path, i
 
 CurlManager::~CurlManager()
 {
+    // Stop the queued downloads before the handles are released.
+    this->cancelTransfers();
+    this->waitForTransfers();
+
     // Finish libCUrl
+    curl_multi_cleanup(multi);
     curl_easy_cleanup(curl);
 }
 
@@ -310,21 +399,325 @@ QString CurlManager::getLastResultString() const
 
 void CurlManager::setTimeout(int time_sec)
 {
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    this->timeout = time_sec;
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, time_sec);
 }
 
 void CurlManager::setProxy(const QString &url, int port, bool tunnel)
 {
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
     QString url_with_port = url + ':' + QString::number(port);
+    this->proxy = url_with_port;
+    this->proxy_tunnel = tunnel;
     curl_easy_setopt(curl, CURLOPT_PROXY, url_with_port.toLatin1().data());
     curl_easy_setopt(curl, CURLOPT_HTTPPROXYTUNNEL, tunnel ? 1L : 0);
 }
 
 void CurlManager::setFollowRedirection(bool follow)
 {
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    this->follow_redirection = follow;
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, follow ? 1L : 0L);
 }
 
+int CurlManager::queueDownload(const QString &url_path, int port, const QString &dest_file_path,
+                               const TransferOptions &options)
+{
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+
+    auto transfer = std::make_unique<Transfer>();
+    transfer->id = this->next_transfer_id++;
+    transfer->url_path = url_path;
+    transfer->port = port;
+    transfer->dest_file_path = dest_file_path;
+    transfer->options = options;
+    this->queued_transfers.push_back(std::move(transfer));
+
+    // The worker is started when there is nothing running. Otherwise, it is woken up to start the new transfer.
+    if (!this->transfers_running)
+    {
+        this->transfers_running = true;
+        this->cancel_transfers = false;
+        this->transfers_future = QtConcurrent::run([this]{this->runTransfers();});
+    }
+    else
+        curl_multi_wakeup(this->multi);
+
+    return this->next_transfer_id - 1;
+}
+
+void CurlManager::setMaxConcurrentTransfers(int max_transfers)
+{
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    this->max_transfers = std::max(1, max_transfers);
+}
+
+void CurlManager::setMaxHostConnections(int max_connections)
+{
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    this->max_host_connections = std::max(1, max_connections);
+}
+
+int CurlManager::pendingTransfers() const
+{
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    return static_cast<int>(this->queued_transfers.size()) + this->active_transfers;
+}
+
+void CurlManager::cancelTransfers()
+{
+    std::lock_guard<std::mutex> lock(this->transfers_mutex);
+    if (this->transfers_running)
+    {
+        this->cancel_transfers = true;
+        curl_multi_wakeup(this->multi);
+    }
+}
+
+void CurlManager::waitForTransfers()
+{
+    QFuture<void> future;
+    {
+        std::lock_guard<std::mutex> lock(this->transfers_mutex);
+        future = this->transfers_future;
+    }
+    future.waitForFinished();
+}
+
+void CurlManager::applyOptions(CURL *handle) const
+{
+    curl_easy_setopt(handle, CURLOPT_USE_SSL, CURLUSESSL_TRY);
+    curl_easy_setopt(handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+    curl_easy_setopt(handle, CURLOPT_CAINFO, this->cacert_path.toLatin1().data());
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, this->ssl_verification ? 1L : 0L);
+    curl_easy_setopt(handle, CURLOPT_VERBOSE, this->verbose ? 1L : 0L);
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, static_cast<long>(this->timeout));
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, this->follow_redirection ? 1L : 0L);
+    if (!this->proxy.isEmpty())
+    {
+        curl_easy_setopt(handle, CURLOPT_PROXY, this->proxy.toLatin1().data());
+        curl_easy_setopt(handle, CURLOPT_HTTPPROXYTUNNEL, this->proxy_tunnel ? 1L : 0L);
+    }
+}
+
+bool CurlManager::startTransfer(Transfer &transfer)
+{
+    QFileInfo dest_info(transfer.dest_file_path);
+    QFileInfo part_info(transfer.partPath());
+
+    // A partial file left by a previous attempt is resumed from its end.
+    transfer.resume_from = transfer.options.resume && part_info.exists() ? part_info.size() : 0;
+    transfer.file = fopen(transfer.partPath().toLatin1().data(), transfer.resume_from > 0 ? "ab" : "wb");
+    if (!transfer.file)
+        return false;
+
+    transfer.easy = curl_easy_init();
+    transfer.etag.clear();
+
+    QByteArray etag;
+    {
+        std::lock_guard<std::mutex> lock(this->transfers_mutex);
+        this->applyOptions(transfer.easy);
+        etag = this->etags.value(transfer.url_path);
+    }
+
+    curl_easy_setopt(transfer.easy, CURLOPT_PRIVATE, &transfer);
+    curl_easy_setopt(transfer.easy, CURLOPT_PORT, static_cast<long>(transfer.port));
+    curl_easy_setopt(transfer.easy, CURLOPT_URL, transfer.url_path.toLatin1().data());
+    curl_easy_setopt(transfer.easy, CURLOPT_WRITEFUNCTION, writeTransferCallback);
+    curl_easy_setopt(transfer.easy, CURLOPT_WRITEDATA, &transfer);
+    curl_easy_setopt(transfer.easy, CURLOPT_HEADERFUNCTION, headerTransferCallback);
+    curl_easy_setopt(transfer.easy, CURLOPT_HEADERDATA, &transfer);
+    curl_easy_setopt(transfer.easy, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(transfer.easy, CURLOPT_FILETIME, 1L);
+
+    if (transfer.resume_from > 0)
+    {
+        curl_easy_setopt(transfer.easy, CURLOPT_RESUME_FROM_LARGE, transfer.resume_from);
+    }
+    else if (transfer.options.conditional && dest_info.exists())
+    {
+        // The ETag is only used by HTTP. The modification date of the file (the remote one, set when it was
+        // downloaded) also works with FTP.
+        if (!etag.isEmpty())
+        {
+            transfer.headers = curl_slist_append(nullptr, ("If-None-Match: " + etag).constData());
+            curl_easy_setopt(transfer.easy, CURLOPT_HTTPHEADER, transfer.headers);
+        }
+        curl_easy_setopt(transfer.easy, CURLOPT_TIMECONDITION, static_cast<long>(CURL_TIMECOND_IFMODSINCE));
+        curl_easy_setopt(transfer.easy, CURLOPT_TIMEVALUE_LARGE,
+                         static_cast<curl_off_t>(dest_info.lastModified().toSecsSinceEpoch()));
+    }
+
+    return CURLM_OK == curl_multi_add_handle(this->multi, transfer.easy);
+}
+
+void CurlManager::finishTransfer(std::unique_ptr<Transfer> transfer, ResultCodes code)
+{
+    long response_code = 0;
+    long condition_unmet = 0;
+    curl_off_t filetime = -1;
+
+    if (transfer->easy)
+    {
+        curl_multi_remove_handle(this->multi, transfer->easy);
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &response_code);
+        curl_easy_getinfo(transfer->easy, CURLINFO_CONDITION_UNMET, &condition_unmet);
+        curl_easy_getinfo(transfer->easy, CURLINFO_FILETIME_T, &filetime);
+        curl_easy_cleanup(transfer->easy);
+        transfer->easy = nullptr;
+    }
+    curl_slist_free_all(transfer->headers);
+    transfer->headers = nullptr;
+    if (transfer->file)
+    {
+        fclose(transfer->file);
+        transfer->file = nullptr;
+    }
+
+    bool modified = false;
+
+    if (CODE_OK == code && (304 == response_code || condition_unmet))
+    {
+        // Not modified. The destination file is kept.
+        QFile::remove(transfer->partPath());
+    }
+    else if (CODE_OK == code)
+    {
+        QFile::remove(transfer->dest_file_path);
+        if (QFile::rename(transfer->partPath(), transfer->dest_file_path))
+        {
+            modified = true;
+
+            // The remote date is kept for the conditional requests.
+            QFile dest_file(transfer->dest_file_path);
+            if (filetime >= 0 && dest_file.open(QIODevice::ReadWrite))
+                dest_file.setFileTime(QDateTime::fromSecsSinceEpoch(filetime), QFileDevice::FileModificationTime);
+
+            std::lock_guard<std::mutex> lock(this->transfers_mutex);
+            if (transfer->etag.isEmpty())
+                this->etags.remove(transfer->url_path);
+            else
+                this->etags.insert(transfer->url_path, transfer->etag);
+        }
+        else
+            code = CODE_WRITE_ERROR;
+    }
+    else
+    {
+        // The partial file can't be resumed, so the next attempt starts from the beginning.
+        const bool bad_resume = CODE_BAD_DOWNLOAD_RESUME == code || CODE_FTP_COULDNT_USE_REST == code ||
+                CODE_RANGE_ERROR == code || (CODE_HTTP_RETURNED_ERROR == code && 416 == response_code);
+        if (bad_resume || !transfer->options.resume)
+            QFile::remove(transfer->partPath());
+
+        const bool transient = bad_resume || CODE_COULDNT_CONNECT == code || CODE_OPERATION_TIMEDOUT == code ||
+                CODE_PARTIAL_FILE == code || CODE_GOT_NOTHING == code || CODE_SEND_ERROR == code ||
+                CODE_RECV_ERROR == code || CODE_SSL_CONNECT_ERROR == code || CODE_AGAIN == code ||
+                CODE_HTTP2 == code || CODE_HTTP2_STREAM == code ||
+                (CODE_HTTP_RETURNED_ERROR == code && (response_code >= 500 || 429 == response_code));
+
+        if (transient && !this->cancel_transfers && transfer->attempts < transfer->options.max_retries)
+        {
+            // Exponential backoff: 1, 2, 4... seconds.
+            int backoff_ms = kBackoffBaseMs << std::min(transfer->attempts, kMaxBackoffShift);
+            transfer->attempts++;
+            transfer->not_before = std::chrono::steady_clock::now() + std::chrono::milliseconds(backoff_ms);
+
+            std::lock_guard<std::mutex> lock(this->transfers_mutex);
+            this->queued_transfers.push_back(std::move(transfer));
+            return;
+        }
+    }
+
+    emit this->transferFinished(transfer->id, code, modified);
+}
+
+void CurlManager::runTransfers()
+{
+    std::list<std::unique_ptr<Transfer>> active;
+
+    while (true)
+    {
+        std::list<std::unique_ptr<Transfer>> ready;
+        {
+            std::lock_guard<std::mutex> lock(this->transfers_mutex);
+
+            if (active.empty() && this->queued_transfers.empty())
+            {
+                this->active_transfers = 0;
+                this->transfers_running = false;
+                break;
+            }
+
+            curl_multi_setopt(this->multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                              static_cast<long>(this->max_host_connections));
+
+            // Cancelled transfers are finished without starting them. The others are started when their backoff time
+            // has elapsed, up to the maximum number of concurrent transfers.
+            const auto now = std::chrono::steady_clock::now();
+            for (auto it = this->queued_transfers.begin(); it != this->queued_transfers.end();)
+            {
+                if (this->cancel_transfers || ((*it)->not_before <= now &&
+                                               static_cast<int>(active.size() + ready.size()) < this->max_transfers))
+                {
+                    ready.push_back(std::move(*it));
+                    it = this->queued_transfers.erase(it);
+                }
+                else
+                    it++;
+            }
+            this->active_transfers = static_cast<int>(active.size() + ready.size());
+        }
+
+        if (this->cancel_transfers)
+        {
+            ready.splice(ready.end(), active);
+            for (auto& transfer : ready)
+                this->finishTransfer(std::move(transfer), CODE_ABORTED_BY_CALLBACK);
+            continue;
+        }
+
+        for (auto& transfer : ready)
+        {
+            if (this->startTransfer(*transfer))
+                active.push_back(std::move(transfer));
+            else
+                this->finishTransfer(std::move(transfer), CODE_WRITE_ERROR);
+        }
+
+        int running = 0;
+        curl_multi_perform(this->multi, &running);
+
+        CURLMsg* message;
+        int queued_messages;
+        while ((message = curl_multi_info_read(this->multi, &queued_messages)))
+        {
+            if (CURLMSG_DONE != message->msg)
+                continue;
+
+            auto code = static_cast<CurlManager::ResultCodes>(message->data.result);
+            auto it = std::find_if(active.begin(), active.end(), [message](const auto& transfer)
+            {
+                return transfer->easy == message->easy_handle;
+            });
+            if (it == active.end())
+                continue;
+
+            std::unique_ptr<Transfer> transfer = std::move(*it);
+            active.erase(it);
+            this->finishTransfer(std::move(transfer), code);
+        }
+
+        // Waits for network activity. It is woken up when a transfer is queued or cancelled, and the timeout starts
+        // the transfers whose backoff time has elapsed.
+        curl_multi_poll(this->multi, nullptr, 0, kPollTimeoutMs, nullptr);
+    }
+
+    emit this->allTransfersFinished();
+}
+
 size_t CurlManager::writeDirectoryCallback(char *contents, size_t size, size_t nmemb, QStringList *buffer)
 {
     char* auxchar = new char[nmemb+1];
@@ -357,6 +750,34 @@ size_t CurlManager::writeFileCallback(void *ptr, size_t size, size_t nmemb, FILE
     return written;
 }
 
+size_t CurlManager::writeTransferCallback(char *contents, size_t size, size_t nmemb, Transfer *transfer)
+{
+    // The server can ignore the range request and send the whole file. In that case, the partial file is discarded.
+    if (transfer->resume_from > 0)
+    {
+        long response_code = 0;
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &response_code);
+        if (200 == response_code)
+        {
+            fclose(transfer->file);
+            transfer->file = fopen(transfer->partPath().toLatin1().data(), "wb");
+            if (!transfer->file)
+                return 0;
+        }
+        transfer->resume_from = 0;
+    }
+
+    return fwrite(contents, 1, size * nmemb, transfer->file);
+}
+
+size_t CurlManager::headerTransferCallback(char *buffer, size_t size, size_t nitems, Transfer *transfer)
+{
+    const QByteArray header = QByteArray(buffer, static_cast<int>(size * nitems)).trimmed();
+    if (header.size() > 5 && header.left(5).toLower() == "etag:")
+        transfer->etag = header.mid(5).trimmed();
+    return size * nitems;
+}
+
 size_t CurlManager::writeStringCallback(char *contents, size_t size, size_t nmemb, QString *buffer)
 {
     char* auxchar = new char[size * nmemb + 1];
@@ -4,22 +4,43 @@
 #include "includes/class_salarainformation.h"
 #include "includes/interface_cpfdownloadengine.h"
 #include "includes/interface_externaltool.h"
+#include "includes/interface_spaceobjectsearchengine.h"
+#include "includes/interface_tledownloadengine.h"
+#include "includes/interface_tle_propagator.h"
 
 #include <QCoreApplication>
 #include <QApplication>
 #include <QFontDatabase>
 #include <QFile>
+#include <QFileInfo>
 #include <QLockFile>
 #include <QStyleFactory>
 #include <QIcon>
 #include <QtMath>
 #include <QPluginLoader>
 #include <QMenu>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSet>
 
 #include <chrono>
 
+#include <omp.h>
+
 #include <utils.h>
 
+const QString kPluginsManifestFilename = QStringLiteral("SP_PluginsManifest.json");
+
+// Category of the plugin interfaces, from the IID of the metadata.
+const QHash<QString, PluginCategory> kPluginIIDCategories =
+{
+    {SpaceObjectSearchEngine_iid, PluginCategory::SPACE_OBJECT_SEARCH_ENGINE},
+    {CPFDownloadEngine_iid, PluginCategory::CPF_DOWNLOAD_ENGINE},
+    {TLEDownloadEngine_iid, PluginCategory::TLE_DOWNLOAD_ENGINE},
+    {ExternalTool_iid, PluginCategory::EXTERNAL_TOOL},
+    {TLEPropagator_iid, PluginCategory::TLE_PROPAGATOR}
+};
+
 QMap<Qt::DayOfWeek, QString> const GlobalUtils::name_of_day{{Qt::Monday, "Monday"},
                                                  {Qt::Tuesday, "Tuesday"},
                                                  {Qt::Wednesday, "Wednesday"},
@@ -156,23 +177,48 @@ void GlobalUtils::initApp(const QString& app_name, const QString& app_error,
     }
 }
 
-
 SalaraInformation GlobalUtils::loadPlugins(const QDir& dir, PluginCategories cats,
                                            PluginsMultiMap& plugins, bool recursive)
 {
     // Operation result.
     SalaraInformation result;
 
-    // Recursive call for load all the plugins in each subdir.
-    if(recursive)
-        for(auto&& internal_dir : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
-            result.append(loadPlugins(QDir(dir.path()+'/'+internal_dir), cats, plugins, true));
+    // Plugin files. The files of the subdirs go first.
+    QStringList files;
+    collectPluginFiles(dir, recursive, files);
 
-    // Load each plugin in the folder (if it has the correct category).
-    for(auto&& file : dir.entryList(QDir::Files))
+    // Plugin metadata. It is read from the manifest if the file has not changed, or from the file otherwise. Reading
+    // the metadata does not load the library.
+    QVector<QJsonObject> metadata = readPluginsMetaData(dir, files);
+
+    // Name and version of the plugins already loaded.
+    QSet<QString> loaded_keys;
+    for (const auto& plugin : plugins)
+        loaded_keys.insert(plugin->getPluginName() + '\n' + plugin->getPluginVersion());
+
+    for (int i = 0; i < files.size(); i++)
     {
+        const QString& path = files[i];
+        const QString file = QFileInfo(path).fileName();
+        const QJsonObject plugin_meta = metadata[i]["MetaData"].toObject();
+
+        // Plugins of known interfaces are discarded by category and name without loading them. The other files are
+        // loaded to check them, as always.
+        auto iid_category = kPluginIIDCategories.constFind(metadata[i]["IID"].toString());
+        if (iid_category != kPluginIIDCategories.cend())
+        {
+            if (!cats.testFlag(iid_category.value()))
+                continue;
+
+            if (loaded_keys.contains(plugin_meta["Name"].toString() + '\n' + plugin_meta["Version"].toString()))
+            {
+                result.append(SalaraInformation({0, file + " -> " + TEXT_ERROR_PLUGIN_ALREADY_LOADED}));
+                continue;
+            }
+        }
+
         // Variables and loader.
-        QPluginLoader plugin_loader(dir.path()+'/'+file);
+        QPluginLoader plugin_loader(path);
         SPPlugin* sp_plugin;
 
         // If load fails, return the error.
@@ -216,12 +262,8 @@ SalaraInformation GlobalUtils::loadPlugins(const QDir& dir, PluginCategories cat
         }
 
         // Check if the plugin is already loaded.
-        auto it = std::find_if(plugins.begin(), plugins.end(), [sp_plugin](const auto& plugin)
-        {
-            return (sp_plugin->getPluginName() == plugin->getPluginName() &&
-                    sp_plugin->getPluginVersion() == plugin->getPluginVersion());
-        });
-        if(it != plugins.end())
+        const QString plugin_key = sp_plugin->getPluginName() + '\n' + sp_plugin->getPluginVersion();
+        if(loaded_keys.contains(plugin_key))
         {
             result.append(SalaraInformation({0, file + " -> " + TEXT_ERROR_PLUGIN_ALREADY_LOADED}));
             plugin_loader.unload();
@@ -239,12 +281,81 @@ SalaraInformation GlobalUtils::loadPlugins(const QDir& dir, PluginCategories cat
         // If all is ok, set the plugin enabled and add to a action if neccesary.
         sp_plugin->setEnabled(true);
         plugins.insert(sp_plugin->getPluginCategory(), sp_plugin);
+        loaded_keys.insert(plugin_key);
     }
 
     // All ok, return empty errors.
     return result;
 }
 
+void GlobalUtils::collectPluginFiles(const QDir &dir, bool recursive, QStringList &files)
+{
+    if(recursive)
+        for(auto&& internal_dir : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+            collectPluginFiles(QDir(dir.path()+'/'+internal_dir), true, files);
+
+    for(auto&& file : dir.entryList(QDir::Files))
+        if(file != kPluginsManifestFilename)
+            files.append(dir.path()+'/'+file);
+}
+
+QVector<QJsonObject> GlobalUtils::readPluginsMetaData(const QDir &dir, const QStringList &files)
+{
+    QVector<QJsonObject> metadata(files.size());
+    QVector<int> pending;
+
+    // Manifest of the plugins dir. Each entry is identified by the relative path, size and modification time.
+    QFile manifest_file(dir.filePath(kPluginsManifestFilename));
+    QJsonObject manifest;
+    if (manifest_file.open(QIODevice::ReadOnly))
+    {
+        manifest = QJsonDocument::fromJson(manifest_file.readAll()).object();
+        manifest_file.close();
+    }
+
+    QJsonObject new_manifest;
+    QVector<QFileInfo> infos;
+    infos.reserve(files.size());
+    for (int i = 0; i < files.size(); i++)
+    {
+        infos.push_back(QFileInfo(files[i]));
+        const QJsonObject entry = manifest[dir.relativeFilePath(files[i])].toObject();
+        if (entry["Size"].toDouble(-1) == static_cast<double>(infos[i].size()) &&
+                entry["Modified"].toDouble(-1) == static_cast<double>(infos[i].lastModified().toMSecsSinceEpoch()))
+            metadata[i] = entry["MetaData"].toObject();
+        else
+            pending.push_back(i);
+    }
+
+    // The metadata of the new or changed files is read in parallel.
+    #pragma omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)
+    for (int j = 0; j < pending.size(); j++)
+        metadata[pending[j]] = QPluginLoader(files[pending[j]]).metaData();
+
+    // Update the manifest. It is only written if something changed, and it is not an error if the plugins dir is
+    // not writable.
+    if (!pending.isEmpty() || manifest.size() != files.size())
+    {
+        for (int i = 0; i < files.size(); i++)
+        {
+            QJsonObject entry;
+            entry.insert("Size", static_cast<double>(infos[i].size()));
+            entry.insert("Modified", static_cast<double>(infos[i].lastModified().toMSecsSinceEpoch()));
+            entry.insert("MetaData", metadata[i]);
+            new_manifest.insert(dir.relativeFilePath(files[i]), entry);
+        }
+
+        QSaveFile new_manifest_file(dir.filePath(kPluginsManifestFilename));
+        if (new_manifest_file.open(QIODevice::WriteOnly))
+        {
+            new_manifest_file.write(QJsonDocument(new_manifest).toJson(QJsonDocument::Compact));
+            new_manifest_file.commit();
+        }
+    }
+
+    return metadata;
+}
+
 void GlobalUtils::createPath(const QString& path)
 {
     if(!path.isEmpty() && !QDir(path).exists())
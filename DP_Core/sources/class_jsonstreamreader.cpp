@@ -0,0 +1,382 @@
+#include "includes/class_jsonstreamreader.h"
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <locale>
+#include <sstream>
+
+namespace
+{
+
+// Checks the JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool isNumber(std::string_view text)
+{
+    auto it = text.begin();
+    auto digits = [&it, &text]
+    {
+        auto first = it;
+        while (it != text.end() && *it >= '0' && *it <= '9')
+            it++;
+        return it != first;
+    };
+
+    if (it != text.end() && '-' == *it)
+        it++;
+    if (it != text.end() && '0' == *it)
+        it++;
+    else if (!digits())
+        return false;
+    if (it != text.end() && '.' == *it)
+    {
+        it++;
+        if (!digits())
+            return false;
+    }
+    if (it != text.end() && ('e' == *it || 'E' == *it))
+    {
+        it++;
+        if (it != text.end() && ('+' == *it || '-' == *it))
+            it++;
+        if (!digits())
+            return false;
+    }
+    return it == text.end();
+}
+
+// Floating point from_chars is not available in all the supported compilers. In that case, the number is parsed with
+// a stream in the C locale, since strtold depends on the global locale (Qt sets it from the environment, so with a
+// comma decimal separator "1.5" would be read as 1).
+template <typename T>
+bool parseFloat(std::string_view text, T& value)
+{
+    if (!isNumber(text))
+        return false;
+#if defined(__cpp_lib_to_chars)
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return std::errc() == result.ec && result.ptr == text.data() + text.size();
+#else
+    thread_local std::istringstream stream = []
+    {
+        std::istringstream classic_stream;
+        classic_stream.imbue(std::locale::classic());
+        return classic_stream;
+    }();
+    stream.clear();
+    stream.str(std::string(text));
+    stream >> value;
+    return !stream.fail() && std::istringstream::traits_type::eof() == stream.peek();
+#endif
+}
+
+template <typename T>
+T setOk(bool* ok, bool valid, T value)
+{
+    if (ok)
+        *ok = valid;
+    return value;
+}
+
+}
+
+JsonStreamReader::JsonStreamReader(const char *data, std::size_t size) :
+    pos(data),
+    end(data + size),
+    token_begin(data),
+    current_token(Token::NONE),
+    value_after_key(false),
+    has_escapes(false)
+{
+    this->levels.reserve(8);
+}
+
+JsonStreamReader::Token JsonStreamReader::next()
+{
+    if (Token::INVALID == this->current_token || Token::END_DOCUMENT == this->current_token)
+        return this->current_token;
+
+    this->skipWhitespaces();
+    this->current_text = {};
+
+    // Root value or end of document.
+    if (this->levels.empty())
+    {
+        if (Token::NONE == this->current_token)
+            return this->parseValue();
+
+        this->current_token = this->pos == this->end ? Token::END_DOCUMENT : Token::INVALID;
+        return this->current_token;
+    }
+
+    if (this->pos == this->end)
+        return this->setInvalid();
+
+    // Value of a key. The colon was already consumed.
+    if (this->value_after_key)
+    {
+        this->value_after_key = false;
+        return this->parseValue();
+    }
+
+    Level& level = this->levels.back();
+    const bool is_object = level.object;
+
+    // End of the current object or array.
+    if (*this->pos == (is_object ? '}' : ']'))
+    {
+        this->token_begin = this->pos++;
+        this->levels.pop_back();
+        this->current_token = is_object ? Token::END_OBJECT : Token::END_ARRAY;
+        return this->current_token;
+    }
+
+    // Items after the first one must be preceded by a comma.
+    if (level.has_items)
+    {
+        if (',' != *this->pos)
+            return this->setInvalid();
+        this->pos++;
+        this->skipWhitespaces();
+        if (this->pos == this->end)
+            return this->setInvalid();
+    }
+    level.has_items = true;
+
+    if (!is_object)
+        return this->parseValue();
+
+    // Key and colon.
+    this->token_begin = this->pos;
+    if (!this->parseString())
+        return this->setInvalid();
+
+    this->skipWhitespaces();
+    if (this->pos == this->end || ':' != *this->pos)
+        return this->setInvalid();
+    this->pos++;
+
+    this->current_key = this->current_text;
+    this->value_after_key = true;
+    this->current_token = Token::KEY;
+    return this->current_token;
+}
+
+bool JsonStreamReader::nextKey()
+{
+    return Token::KEY == this->next();
+}
+
+bool JsonStreamReader::nextElement()
+{
+    Token token = this->next();
+    return Token::END_ARRAY != token && Token::INVALID != token && Token::END_DOCUMENT != token;
+}
+
+std::string_view JsonStreamReader::skipValue()
+{
+    const char* value_begin = this->token_begin;
+
+    if (this->isContainer())
+    {
+        const std::size_t depth = this->levels.size();
+        while (this->levels.size() >= depth && !this->hasError())
+            this->next();
+    }
+
+    if (this->hasError())
+        return {};
+
+    return std::string_view(value_begin, static_cast<std::size_t>(this->pos - value_begin));
+}
+
+double JsonStreamReader::toDouble(double default_value, bool* ok) const
+{
+    double value;
+    if (Token::NUMBER != this->current_token || !parseFloat(this->current_text, value))
+        return setOk(ok, false, default_value);
+    return setOk(ok, true, value);
+}
+
+long long JsonStreamReader::toInteger(long long default_value, bool* ok) const
+{
+    if (Token::NUMBER != this->current_token)
+        return setOk(ok, false, default_value);
+
+    long long value;
+    const char* text_end = this->current_text.data() + this->current_text.size();
+    auto result = std::from_chars(this->current_text.data(), text_end, value);
+    if (std::errc() == result.ec && result.ptr == text_end)
+        return setOk(ok, true, value);
+
+    // Numbers with fraction or exponent.
+    double double_value;
+    if (!parseFloat(this->current_text, double_value))
+        return setOk(ok, false, default_value);
+    return setOk(ok, true, static_cast<long long>(double_value));
+}
+
+bool JsonStreamReader::toBool(bool default_value, bool* ok) const
+{
+    if (Token::BOOL != this->current_token)
+        return setOk(ok, false, default_value);
+    return setOk(ok, true, 't' == this->current_text.front());
+}
+
+QString JsonStreamReader::toString(const QString &default_value, bool* ok) const
+{
+    if (Token::STRING != this->current_token)
+        return setOk(ok, false, default_value);
+    if (ok)
+        *ok = true;
+
+    if (!this->has_escapes)
+        return QString::fromUtf8(this->current_text.data(), static_cast<int>(this->current_text.size()));
+
+    // Decode the escape sequences.
+    QString result;
+    result.reserve(static_cast<int>(this->current_text.size()));
+    const char* it = this->current_text.data();
+    const char* text_end = it + this->current_text.size();
+    const char* chunk = it;
+
+    while (it < text_end)
+    {
+        if ('\\' != *it)
+        {
+            it++;
+            continue;
+        }
+
+        result.append(QString::fromUtf8(chunk, static_cast<int>(it - chunk)));
+        it++;
+        switch (*it)
+        {
+        case 'b': result.append(QChar('\b')); break;
+        case 'f': result.append(QChar('\f')); break;
+        case 'n': result.append(QChar('\n')); break;
+        case 'r': result.append(QChar('\r')); break;
+        case 't': result.append(QChar('\t')); break;
+        case 'u':
+        {
+            unsigned int code = 0;
+            if (text_end - it > 4)
+                std::from_chars(it + 1, it + 5, code, 16);
+            result.append(QChar(static_cast<char16_t>(code)));
+            it += 4;
+            break;
+        }
+        default: result.append(QChar(*it)); break;
+        }
+        it++;
+        chunk = it;
+    }
+    result.append(QString::fromUtf8(chunk, static_cast<int>(text_end - chunk)));
+
+    return result;
+}
+
+long double JsonStreamReader::toLongDouble(long double default_value, bool* ok) const
+{
+    long double value;
+    if ((Token::NUMBER != this->current_token && Token::STRING != this->current_token) ||
+            !parseFloat(this->current_text, value))
+        return setOk(ok, false, default_value);
+    return setOk(ok, true, value);
+}
+
+JsonStreamReader::Token JsonStreamReader::parseValue()
+{
+    if (this->pos == this->end)
+        return this->setInvalid();
+
+    this->token_begin = this->pos;
+    const char c = *this->pos;
+
+    if ('{' == c || '[' == c)
+    {
+        this->pos++;
+        this->levels.push_back({'{' == c, false});
+        this->current_token = '{' == c ? Token::BEGIN_OBJECT : Token::BEGIN_ARRAY;
+    }
+    else if ('"' == c)
+    {
+        this->current_token = this->parseString() ? Token::STRING : Token::INVALID;
+    }
+    else if ('-' == c || (c >= '0' && c <= '9'))
+    {
+        const char* number_begin = this->pos;
+        while (this->pos < this->end && (std::isdigit(static_cast<unsigned char>(*this->pos)) ||
+                                         '-' == *this->pos || '+' == *this->pos || '.' == *this->pos ||
+                                         'e' == *this->pos || 'E' == *this->pos))
+            this->pos++;
+        this->current_text = std::string_view(number_begin, static_cast<std::size_t>(this->pos - number_begin));
+        // Malformed numbers make the document invalid, instead of being read as the default values.
+        if (!isNumber(this->current_text))
+            return this->setInvalid();
+        this->current_token = Token::NUMBER;
+    }
+    else
+    {
+        // Literals.
+        auto matchLiteral = [this](const char* literal, std::size_t length)
+        {
+            if (static_cast<std::size_t>(this->end - this->pos) < length ||
+                    0 != std::memcmp(this->pos, literal, length))
+                return false;
+            this->current_text = std::string_view(this->pos, length);
+            this->pos += length;
+            return true;
+        };
+
+        if (matchLiteral("true", 4) || matchLiteral("false", 5))
+            this->current_token = Token::BOOL;
+        else if (matchLiteral("null", 4))
+            this->current_token = Token::NULL_VALUE;
+        else
+            this->current_token = Token::INVALID;
+    }
+
+    return this->current_token;
+}
+
+bool JsonStreamReader::parseString()
+{
+    if (this->pos == this->end || '"' != *this->pos)
+        return false;
+
+    const char* string_begin = ++this->pos;
+    this->has_escapes = false;
+
+    while (this->pos < this->end && '"' != *this->pos)
+    {
+        if ('\\' == *this->pos)
+        {
+            this->has_escapes = true;
+            this->pos++;
+        }
+        else if (static_cast<unsigned char>(*this->pos) < 0x20)
+            return false;
+        this->pos++;
+    }
+
+    if (this->pos >= this->end)
+        return false;
+
+    this->current_text = std::string_view(string_begin, static_cast<std::size_t>(this->pos - string_begin));
+    this->pos++;
+    return true;
+}
+
+void JsonStreamReader::skipWhitespaces()
+{
+    while (this->pos < this->end &&
+           (' ' == *this->pos || '\n' == *this->pos || '\r' == *this->pos || '\t' == *this->pos))
+        this->pos++;
+}
+
+JsonStreamReader::Token JsonStreamReader::setInvalid()
+{
+    this->current_token = Token::INVALID;
+    this->current_text = {};
+    return this->current_token;
+}
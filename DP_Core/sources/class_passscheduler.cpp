@@ -0,0 +1,207 @@
+#include "includes/class_passscheduler.h"
+#include "includes/class_globalutils.h"
+
+#include <QCryptographicHash>
+
+#include <algorithm>
+#include <omp.h>
+
+const QMap<PassScheduler::ErrorEnum, QString> PassScheduler::ErrorListStringMap =
+{
+    {PassScheduler::ErrorEnum::CPF_NOT_VALID, "The CPF of %1 is not valid."},
+    {PassScheduler::ErrorEnum::WINDOW_OUTSIDE_OF_CPF, "The CPF of %1 has no data in the schedule window."},
+    {PassScheduler::ErrorEnum::PASSES_FAILED, "The passes of %1 could not be calculated."}
+};
+
+namespace
+{
+
+QDateTime stepDatetime(const dpslr::cpfutils::Pass::Step& step)
+{
+    return QDateTime(QDate::fromJulianDay(step.mjd + 2400001), QTime(0, 0), Qt::UTC)
+            .addMSecs(qRound64(static_cast<double>(step.fract_day) * 1000.0));
+}
+
+QDateTime recordDatetime(const CPFData::PositionRecord& record)
+{
+    return QDateTime(QDate::fromJulianDay(record.mjd + 2400001), QTime(0, 0), Qt::UTC)
+            .addMSecs(qRound64(static_cast<double>(record.sod) * 1000.0));
+}
+
+// The CPF identity is a hash of its positions, so it changes with each release, even if a file with the same name is
+// downloaded again, and with the releases merged into a stitched CPF, that has no file.
+QString cpfIdentity(const CPF& cpf)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const auto& record : cpf.getData().positionRecords())
+    {
+        // Converted to double, since the padding of the long doubles is not initialized.
+        const double values[] = {static_cast<double>(record.mjd), static_cast<double>(record.sod),
+                                 static_cast<double>(record.geocentric_pos[0]),
+                                 static_cast<double>(record.geocentric_pos[1]),
+                                 static_cast<double>(record.geocentric_pos[2])};
+        hash.addData(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+}
+
+PassScheduler::PassScheduler(const dpslr::geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                             const dpslr::geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                             unsigned int min_elev, long double interval) :
+    stat_geodetic(stat_geodetic),
+    stat_geocentric(stat_geocentric),
+    min_elev(min_elev),
+    interval(interval),
+    search_mode(dpslr::cpfutils::PassCalculator::SearchMode::ADAPTIVE),
+    dense_steps(true)
+{}
+
+void PassScheduler::setSearchMode(dpslr::cpfutils::PassCalculator::SearchMode mode, bool dense_steps)
+{
+    if (mode != this->search_mode || dense_steps != this->dense_steps)
+        this->clearCache();
+    this->search_mode = mode;
+    this->dense_steps = dense_steps;
+}
+
+const QStringList &PassScheduler::recomputedObjects() const
+{
+    return this->recomputed;
+}
+
+void PassScheduler::clearCache()
+{
+    this->cache.clear();
+}
+
+SalaraInformation PassScheduler::computeSchedule(const QList<CPFSelected> &cpf_list, const QDateTime &start,
+                                                 const QDateTime &end, QList<ScheduledPass> &schedule)
+{
+    SalaraInformation::ErrorList errors;
+    schedule.clear();
+    this->recomputed.clear();
+
+    // Objects whose CPF or window changed since the last schedule.
+    QList<int> pending;
+    QStringList keys;
+    QStringList identities;
+    for (int i = 0; i < cpf_list.size(); i++)
+    {
+        const CPFSelected& selected = cpf_list[i];
+        keys.append(selected.space_object->getILRSID().isEmpty() ? selected.space_object->getNorad() :
+                                                                   selected.space_object->getILRSID());
+        identities.append(selected.cpf ? cpfIdentity(*selected.cpf) : QString());
+
+        auto it = this->cache.constFind(keys.last());
+        if (it == this->cache.constEnd() || it->cpf_identity != identities.last() || it->start != start ||
+                it->end != end)
+            pending.append(i);
+    }
+
+    // The cache is not modified inside the parallel region. The failed objects are not cached, so they are calculated
+    // again by the next call.
+    QVector<CacheEntry> results(pending.size());
+    QVector<bool> calculated(pending.size(), false);
+
+    #pragma omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)
+    for (int p = 0; p < pending.size(); p++)
+    {
+        const CPFSelected& selected = cpf_list[pending[p]];
+        const QString name = selected.space_object->getPreferredName();
+        SalaraInformation::ErrorList object_errors;
+        CacheEntry& entry = results[p];
+        entry.cpf_identity = identities[pending[p]];
+        entry.start = start;
+        entry.end = end;
+
+        if (!selected.cpf || selected.cpf->getData().positionRecords().empty())
+        {
+            object_errors.append({ErrorEnum::CPF_NOT_VALID, ErrorListStringMap[ErrorEnum::CPF_NOT_VALID].arg(name)});
+        }
+        else
+        {
+            // Window clipped to the CPF data.
+            const auto& records = selected.cpf->getData().positionRecords();
+            const QDateTime pass_start = std::max(start, recordDatetime(records.front()));
+            const QDateTime pass_end = std::min(end, recordDatetime(records.back()));
+
+            if (pass_start >= pass_end)
+            {
+                object_errors.append({ErrorEnum::WINDOW_OUTSIDE_OF_CPF,
+                                      ErrorListStringMap[ErrorEnum::WINDOW_OUTSIDE_OF_CPF].arg(name)});
+            }
+            else
+            {
+                int mjd_start, mjd_end;
+                double sod_start, sod_end;
+                GlobalUtils::datetimeToModifiedJulianDate(pass_start.toUTC(), mjd_start, sod_start);
+                GlobalUtils::datetimeToModifiedJulianDate(pass_end.toUTC(), mjd_end, sod_end);
+
+                dpslr::cpfutils::PassCalculator calculator(*selected.cpf, this->stat_geodetic, this->stat_geocentric,
+                                                           this->min_elev, this->interval);
+                calculator.setSearchMode(this->search_mode, this->dense_steps);
+                if (dpslr::cpfutils::PassCalculator::ResultCodes::NOT_ERROR !=
+                        calculator.getPasses(mjd_start, sod_start, mjd_end, sod_end, entry.passes))
+                    object_errors.append({ErrorEnum::PASSES_FAILED,
+                                          ErrorListStringMap[ErrorEnum::PASSES_FAILED].arg(name)});
+                else
+                    calculated[p] = true;
+            }
+        }
+
+        #pragma omp critical
+        {
+            errors.append(object_errors);
+        }
+    }
+
+    for (int p = 0; p < pending.size(); p++)
+    {
+        this->recomputed.append(cpf_list[pending[p]].space_object->getPreferredName());
+        if (calculated[p])
+            this->cache.insert(keys[pending[p]], std::move(results[p]));
+        else
+            this->cache.remove(keys[pending[p]]);
+    }
+
+    // Merge the passes of all the objects.
+    for (int i = 0; i < cpf_list.size(); i++)
+    {
+        auto it = this->cache.constFind(keys[i]);
+        if (it == this->cache.constEnd())
+            continue;
+
+        for (const auto& pass : it->passes)
+        {
+            ScheduledPass scheduled;
+            scheduled.space_object = cpf_list[i].space_object;
+            scheduled.cpf_name = QString::fromStdString(cpf_list[i].cpf->getSourceFilename());
+            scheduled.start = stepDatetime(pass.start);
+            scheduled.culmination = stepDatetime(pass.culmination);
+            scheduled.end = stepDatetime(pass.end);
+            scheduled.max_elevation = pass.culmination.elev;
+            scheduled.pass = pass;
+            schedule.append(std::move(scheduled));
+        }
+    }
+
+    std::stable_sort(schedule.begin(), schedule.end(), [](const ScheduledPass& a, const ScheduledPass& b)
+    {
+        return a.start < b.start;
+    });
+
+    // Overlaps. The passes are sorted by start, so each pass is only compared with the next ones that start before
+    // its end.
+    for (int i = 0; i < schedule.size(); i++)
+    {
+        for (int j = i + 1; j < schedule.size() && schedule[j].start < schedule[i].end; j++)
+        {
+            schedule[i].overlaps.append(j);
+            schedule[j].overlaps.append(i);
+        }
+    }
+
+    return SalaraInformation(errors);
+}
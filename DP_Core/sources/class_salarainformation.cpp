@@ -1,6 +1,11 @@
 #include "includes/class_salarainformation.h"
 #include "includes/global_texts.h"
 
+#include <QMessageBox>
+
+static_assert(SalaraInformation::CRITICAL == QMessageBox::Critical &&
+              SalaraInformation::WARNING == QMessageBox::Warning &&
+              SalaraInformation::INFO == QMessageBox::Information, "Message types must match QMessageBox::Icon.");
 
 bool SalaraInformation::containsError(int error_code) const
 {
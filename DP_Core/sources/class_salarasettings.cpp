@@ -1,11 +1,50 @@
 #include "includes/class_salarasettings.h"
 #include "includes/class_globalutils.h"
+#include "includes/global_texts.h"
 
 #include <dpslr_math.h>
 
+#include <QCoreApplication>
 #include <QFileInfo>
 
 
+SalaraInformation SalaraSettings::initConsoleApp(const QString &app_name)
+{
+    // Variables.
+    QString globalconfiglink_filename = FILE_GLOBALCONFIGLINK;
+    QString globalconfig_filename = FILE_GLOBALCONFIG;
+    QString stationdata_filename = FILE_STATIONDATA;
+    QDir globalconfiglink_dir, globalconfig_dir, stationdata_dir;
+
+    // Init names. No styles, fonts or dialogs are used by console applications.
+    QCoreApplication::setOrganizationName(NAME_ORGANIZATION);
+    QCoreApplication::setOrganizationDomain(NAME_ORGANIZATION);
+    QCoreApplication::setApplicationName(app_name);
+
+    // Get dir and name of the global config file from the global config path file
+    globalconfiglink_dir.setPath(QCoreApplication::instance()->applicationDirPath());
+    globalconfiglink_dir.cdUp();
+    if(!QFile(globalconfiglink_dir.path()+'/'+globalconfiglink_filename).exists())
+        return SalaraInformation({0, "Global configuration file link '"+globalconfiglink_filename+
+                                  "' not found in the deployment directory: "+globalconfiglink_dir.path()});
+
+    // Get the global config file path
+    QSettings salara_globalconfig_path(globalconfiglink_dir.path()+"/"+globalconfiglink_filename, QSettings::IniFormat);
+    globalconfig_dir.setPath(salara_globalconfig_path.value("SalaraGlobalConfig/GlobalConfigLink").toString());
+    if(!QFile(globalconfig_dir.path()+"/"+globalconfig_filename).exists())
+        return SalaraInformation({0, "Global configuration file '"+globalconfig_filename+
+                                  "' not found in the main directory: "+globalconfig_dir.path()});
+    this->setGlobalConfig(globalconfig_dir.path()+"/"+globalconfig_filename);
+
+    // Load the station data.
+    stationdata_dir.setPath(this->getGlobalConfigString("SalaraProjectDataPaths/SP_StationData"));
+    if(!stationdata_dir.exists(stationdata_filename))
+        return SalaraInformation({0, "Station data file '"+stationdata_filename+"' not found in the data directory: "+
+                                  stationdata_dir.path()});
+
+    return this->setStationData(stationdata_dir.path()+"/"+stationdata_filename);
+}
+
 SalaraInformation SalaraSettings::setGlobalConfig(const QString &path)
 {
     // Clear the settings.
@@ -4,6 +4,35 @@
 #include <QJsonDocument>
 #include <QDebug>
 #include <QFile>
+#include <QSaveFile>
+
+namespace
+{
+
+// Size of the chunks written to the CSV file.
+constexpr int kCSVChunkSize = 64 * 1024;
+
+// Values with separators, quotes or line breaks are quoted, doubling the inner quotes.
+void appendCSVField(QByteArray& buffer, const QString& value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    if (!utf8.contains(';') && !utf8.contains('"') && !utf8.contains('\n') && !utf8.contains('\r'))
+    {
+        buffer.append(utf8);
+        return;
+    }
+
+    buffer.append('"');
+    for (char c : utf8)
+    {
+        if ('"' == c)
+            buffer.append('"');
+        buffer.append(c);
+    }
+    buffer.append('"');
+}
+
+}
 
 
 const QMap<SpaceObjectFileManager::ErrorEnum, QString> SpaceObjectFileManager::ErrorListStringMap =
@@ -20,7 +49,10 @@ const QMap<SpaceObjectFileManager::ErrorEnum, QString> SpaceObjectFileManager::E
      "The json file '"+QString(FILE_SPACEOBJECTSSETS)+"' can not be open."},
     {SpaceObjectFileManager::ErrorEnum::INTEGRITY_ERROR,
      "The json file '"+QString(FILE_SPACEOBJECTSDATA)+"' has integrity errors."},
-    {SpaceObjectFileManager::ErrorEnum::SCHEME_NOT_VALID, "The model has no valid scheme."}
+    {SpaceObjectFileManager::ErrorEnum::SCHEME_NOT_VALID, "The model has no valid scheme."},
+    {SpaceObjectFileManager::ErrorEnum::CSVFILE_NOT_OPEN, "The CSV file '%1' can not be open."},
+    {SpaceObjectFileManager::ErrorEnum::EXPORT_CANCELLED, "The export to '%1' was cancelled."},
+    {SpaceObjectFileManager::ErrorEnum::CSVFILE_NOT_WRITTEN, "The CSV file '%1' could not be written."}
 };
 
 SalaraInformation SpaceObjectFileManager::
@@ -210,7 +242,7 @@ saveSpaceObjectsData(const QString& path_data, const QString& version_name, cons
 
     // Variables.
     QJsonObject jsonobject;
-    QFile spaceobjectsdatafile(path_data);
+    QSaveFile spaceobjectsdatafile(path_data);
 
     // Update the data.
     jsonobject.insert("VersionName", version_name);
@@ -222,13 +254,17 @@ saveSpaceObjectsData(const QString& path_data, const QString& version_name, cons
     // JsonDocument (it will save in the file).
     QJsonDocument jsondocument(jsonobject);
 
-    // Save the data.
+    // Save the data. The file is written to a temporary file that replaces the previous one when it is complete, so
+    // an interrupted save never leaves a truncated data file.
     if(!spaceobjectsdatafile.open(QIODevice::WriteOnly))
     {
         return SalaraInformation({ErrorEnum::DATAFILE_NOT_OPEN, ErrorListStringMap[ErrorEnum::DATAFILE_NOT_OPEN]});
     }
     spaceobjectsdatafile.write(jsondocument.toJson(QJsonDocument::Indented));
-    spaceobjectsdatafile.close();
+    if(!spaceobjectsdatafile.commit())
+    {
+        return SalaraInformation({ErrorEnum::DATAFILE_NOT_OPEN, ErrorListStringMap[ErrorEnum::DATAFILE_NOT_OPEN]});
+    }
     return SalaraInformation();
 }
 
@@ -346,3 +382,101 @@ SalaraInformation SpaceObjectFileManager::getCurrentSet(const QString& path_sets
 
     return SalaraInformation();
 }
+
+SalaraInformation SpaceObjectFileManager::exportSpaceObjectsCSV(const QString &path_csv, const SpaceObjectModel &model,
+                                                                const QVector<int> &rows,
+                                                                const std::atomic_bool *cancel,
+                                                                const ProgressCallback &progress)
+{
+    // Exported columns. They are resolved once, by the index in the scheme.
+    const int norad_column = model.findColumnSectionByIndex("NORAD");
+    const int cospar_column = model.findColumnSectionByIndex("COSPAR");
+    const int name_column = model.findColumnSectionByIndex("Name");
+    const int ilrs_column = model.findColumnSectionByIndex("ILRSName");
+    const int altitude_column = model.findColumnSectionByIndex("Altitude");
+    const int rcs_column = model.findColumnSectionByIndex("RadarCrossSection");
+    const int debris_column = model.findColumnSectionByIndex("IsDebris");
+    for (int column : {norad_column, cospar_column, name_column, ilrs_column, altitude_column, rcs_column,
+                       debris_column})
+    {
+        if (-1 == column)
+            return SalaraInformation({ErrorEnum::SCHEME_NOT_VALID, ErrorListStringMap[ErrorEnum::SCHEME_NOT_VALID]});
+    }
+
+    // The rows are written to a temporary file that replaces the previous export only when it is complete, so a
+    // cancelled or failed export keeps the previous file.
+    QSaveFile file(path_csv);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return SalaraInformation({ErrorEnum::CSVFILE_NOT_OPEN,
+                                  ErrorListStringMap[ErrorEnum::CSVFILE_NOT_OPEN].arg(path_csv)});
+
+    auto writeBuffer = [&file](QByteArray& buffer)
+    {
+        const bool written = file.write(buffer) == buffer.size();
+        buffer.truncate(0);
+        return written;
+    };
+    const SalaraInformation write_error({ErrorEnum::CSVFILE_NOT_WRITTEN,
+                                         ErrorListStringMap[ErrorEnum::CSVFILE_NOT_WRITTEN].arg(path_csv)});
+
+    auto value = [&model](int row, int column)
+    {
+        return model.data(model.index(row, column), JsonTableModel::DISPLAY_ROLE);
+    };
+
+    QByteArray buffer;
+    buffer.reserve(kCSVChunkSize + 1024);
+    buffer.append("NORAD;COSPAR;NAME;ILRS;ALTITUDE;RCS;DEBRIS");
+
+    const std::size_t total = static_cast<std::size_t>(rows.size());
+    std::size_t written = 0;
+
+    for (int row : rows)
+    {
+        if (cancel && *cancel)
+        {
+            file.cancelWriting();
+            return SalaraInformation({ErrorEnum::EXPORT_CANCELLED,
+                                      ErrorListStringMap[ErrorEnum::EXPORT_CANCELLED].arg(path_csv)});
+        }
+
+        buffer.append('\n');
+        appendCSVField(buffer, value(row, norad_column).toString());
+        buffer.append(';');
+        appendCSVField(buffer, value(row, cospar_column).toString());
+        buffer.append(';');
+        appendCSVField(buffer, value(row, name_column).toString());
+        buffer.append(';');
+        buffer.append(value(row, ilrs_column).toString().isEmpty() ? "No" : "Yes");
+        buffer.append(';');
+        appendCSVField(buffer, value(row, altitude_column).toString());
+        buffer.append(';');
+        buffer.append(QByteArray::number(value(row, rcs_column).toDouble()));
+        buffer.append(';');
+        appendCSVField(buffer, value(row, debris_column).toString());
+
+        written++;
+
+        if (buffer.size() >= kCSVChunkSize)
+        {
+            if (!writeBuffer(buffer))
+            {
+                file.cancelWriting();
+                return write_error;
+            }
+            if (progress)
+                progress(written, total);
+        }
+    }
+
+    if (!writeBuffer(buffer) || !file.commit())
+    {
+        file.cancelWriting();
+        return write_error;
+    }
+
+    if (progress)
+        progress(written, total);
+
+    return SalaraInformation();
+}
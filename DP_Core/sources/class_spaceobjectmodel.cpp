@@ -27,6 +27,7 @@ void SpaceObjectModel::disableAll()
         {
             obj["EnablementPolicy"] = SpaceObject::EnablementPolicy::DISABLED;
             this->jsonarray.replace(i, obj);
+            this->updateCachedRow(i);
             QModelIndex element = this->index(i, en_policy_column);
             emit this->dataChanged(element, element);
         }
@@ -163,6 +164,7 @@ bool SpaceObjectModel::setData(const QModelIndex &index, const QVariant &value,
             auto change_enablement_policy = [&](SpaceObject::EnablementPolicy target_policy){
                 current_object["EnablementPolicy"] = target_policy;
                 jsonarray.replace(index.row(), current_object);
+                this->updateCachedRow(index.row());
                 emit dataChanged(index, index);
             };
 
@@ -0,0 +1,331 @@
+#include "includes/class_spaceobjectsjournal.h"
+#include "includes/class_spaceobjectfilemanager.h"
+#include "includes/class_spaceobjectmodel.h"
+
+#include <QDir>
+#include <QJsonDocument>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const QString kBackupPrefix = QStringLiteral("SP_SpaceObjectsData_bkp_");
+const QString kSnapshotSuffix = QStringLiteral(".json");
+const QString kJournalSuffix = QStringLiteral(".journal");
+const QString kBackupDateFormat = QStringLiteral("yyyyMMdd_hhmmss_zzz");
+const QString kOldBackupDateFormat = QStringLiteral("yyyyMMdd_hhmmss");
+const QString kTimeKey = QStringLiteral("Time");
+const QString kOperationKey = QStringLiteral("Operation");
+const QString kRowKey = QStringLiteral("Row");
+const QString kObjectKey = QStringLiteral("Object");
+
+const QMap<SpaceObjectsJournal::Operation, QString> kOperationStringMap =
+{
+    {SpaceObjectsJournal::Operation::EDIT, "Edit"},
+    {SpaceObjectsJournal::Operation::INSERT, "Insert"},
+    {SpaceObjectsJournal::Operation::REMOVE, "Remove"}
+};
+
+const QMap<SpaceObjectsJournal::ErrorEnum, QString> SpaceObjectsJournal::ErrorListStringMap =
+{
+    {SpaceObjectsJournal::ErrorEnum::SNAPSHOT_NOT_SAVED, "The space objects backup snapshot %1 could not be saved."},
+    {SpaceObjectsJournal::ErrorEnum::JOURNAL_NOT_OPEN, "The space objects backup journal %1 could not be opened."},
+    {SpaceObjectsJournal::ErrorEnum::JOURNAL_NOT_WRITTEN, "The space objects backup journal %1 could not be written."},
+    {SpaceObjectsJournal::ErrorEnum::BACKUP_NOT_FOUND, "There is no space objects backup before %1."},
+    {SpaceObjectsJournal::ErrorEnum::SNAPSHOT_INVALID, "The space objects backup snapshot %1 is not valid."}
+};
+
+namespace
+{
+
+// Flushes the file and waits until the data is written to disk.
+bool syncFile(QFile& file)
+{
+    if (!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return 0 == _commit(file.handle());
+#else
+    return 0 == ::fsync(file.handle());
+#endif
+}
+
+// Start date of a backup, from the snapshot file name. Backups made before the journal have no milliseconds.
+QDateTime backupDate(const QString& snapshot_name)
+{
+    QString date_string = snapshot_name.mid(kBackupPrefix.size());
+    date_string.chop(kSnapshotSuffix.size());
+    QDateTime date = QDateTime::fromString(date_string, kBackupDateFormat);
+    if (!date.isValid())
+        date = QDateTime::fromString(date_string, kOldBackupDateFormat);
+    date.setTimeSpec(Qt::UTC);
+    return date;
+}
+
+}
+
+SpaceObjectsJournal::SpaceObjectsJournal() :
+    max_backups(0),
+    max_records(0),
+    records(0),
+    model(nullptr),
+    bulk_depth(0),
+    bulk_changed(false)
+{}
+
+SpaceObjectsJournal::~SpaceObjectsJournal()
+{
+    this->detachModel();
+    this->close();
+}
+
+void SpaceObjectsJournal::setBackupDirectory(const QString &dir, int max_backups, int max_records)
+{
+    this->close();
+    this->backup_dir = dir;
+    this->max_backups = max_backups;
+    this->max_records = max_records;
+}
+
+void SpaceObjectsJournal::close()
+{
+    if (this->journal_file.isOpen())
+        this->journal_file.close();
+    this->records = 0;
+}
+
+SalaraInformation SpaceObjectsJournal::startBackup(const QJsonArray &data, const QJsonArray &extraparameters)
+{
+    this->close();
+
+    QDateTime version_date = QDateTime::currentDateTimeUtc();
+    QString backup_name = this->backup_dir + '/' + kBackupPrefix + version_date.toString(kBackupDateFormat);
+
+    // The snapshot is written before the journal is created, so a journal always has its snapshot.
+    SalaraInformation errors = SpaceObjectFileManager::saveSpaceObjectsData(
+                backup_name + kSnapshotSuffix, "Space Objects Data Backup " + version_date.toString("yyyyMMdd.hhmmss"),
+                version_date, "This is a Space Objects Data Backup.", data, extraparameters);
+    if (errors.hasError())
+        return SalaraInformation({ErrorEnum::SNAPSHOT_NOT_SAVED,
+                                  ErrorListStringMap[ErrorEnum::SNAPSHOT_NOT_SAVED].arg(backup_name + kSnapshotSuffix)});
+
+    this->journal_file.setFileName(backup_name + kJournalSuffix);
+    if (!this->journal_file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return SalaraInformation({ErrorEnum::JOURNAL_NOT_OPEN,
+                                  ErrorListStringMap[ErrorEnum::JOURNAL_NOT_OPEN].arg(this->journal_file.fileName())});
+
+    this->pruneBackups();
+
+    return SalaraInformation();
+}
+
+SalaraInformation SpaceObjectsJournal::record(Operation operation, int row, const QJsonObject &object,
+                                              const QJsonArray &data, const QJsonArray &extraparameters)
+{
+    // Compaction. The new snapshot already contains the change.
+    if (!this->journal_file.isOpen() || this->records >= this->max_records)
+        return this->startBackup(data, extraparameters);
+
+    QJsonObject record;
+    record.insert(kTimeKey, QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs));
+    record.insert(kOperationKey, kOperationStringMap[operation]);
+    record.insert(kRowKey, row);
+    if (Operation::REMOVE != operation)
+        record.insert(kObjectKey, object);
+
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    if (this->journal_file.write(line) != line.size() || !syncFile(this->journal_file))
+        return SalaraInformation({ErrorEnum::JOURNAL_NOT_WRITTEN,
+                                  ErrorListStringMap[ErrorEnum::JOURNAL_NOT_WRITTEN].arg(this->journal_file.fileName())});
+
+    this->records++;
+
+    return SalaraInformation();
+}
+
+void SpaceObjectsJournal::attachModel(const SpaceObjectModel *model, const ErrorCallback &error_callback)
+{
+    this->detachModel();
+    this->model = model;
+    this->error_callback = error_callback;
+
+    this->model_connections.append(QObject::connect(model, &QAbstractItemModel::dataChanged,
+        [this](const QModelIndex& top_left, const QModelIndex& bottom_right, const QVector<int>& roles)
+    {
+        // The edited rows that are not submitted yet do not change the data.
+        if (1 == roles.size() && Qt::EditRole == roles.first())
+            return;
+        this->recordModelRows(Operation::EDIT, top_left.row(), bottom_right.row());
+    }));
+
+    this->model_connections.append(QObject::connect(model, &QAbstractItemModel::rowsInserted,
+        [this](const QModelIndex&, int first, int last)
+    {
+        this->recordModelRows(Operation::INSERT, first, last);
+    }));
+
+    this->model_connections.append(QObject::connect(model, &QAbstractItemModel::rowsRemoved,
+        [this](const QModelIndex&, int first, int last)
+    {
+        this->recordModelRows(Operation::REMOVE, first, last);
+    }));
+
+    // The whole data was replaced, so the journal of the previous data is useless.
+    this->model_connections.append(QObject::connect(model, &QAbstractItemModel::modelReset, [this]
+    {
+        this->close();
+    }));
+}
+
+void SpaceObjectsJournal::detachModel()
+{
+    for (const auto& connection : this->model_connections)
+        QObject::disconnect(connection);
+    this->model_connections.clear();
+    this->model = nullptr;
+    this->error_callback = ErrorCallback();
+    this->bulk_depth = 0;
+    this->bulk_changed = false;
+}
+
+void SpaceObjectsJournal::beginBulkChange()
+{
+    this->bulk_depth++;
+}
+
+SalaraInformation SpaceObjectsJournal::endBulkChange()
+{
+    if (this->bulk_depth > 0)
+        this->bulk_depth--;
+
+    if (this->bulk_depth > 0 || !this->bulk_changed)
+        return SalaraInformation();
+
+    this->bulk_changed = false;
+    return this->snapshotModel();
+}
+
+SalaraInformation SpaceObjectsJournal::snapshotModel()
+{
+    if (!this->model)
+        return SalaraInformation();
+    return this->startBackup(this->model->getJsonarray(), this->modelExtraParameters());
+}
+
+void SpaceObjectsJournal::recordModelRows(Operation operation, int first, int last)
+{
+    if (this->bulk_depth > 0)
+    {
+        this->bulk_changed = true;
+        return;
+    }
+
+    // The removed rows are journaled as removals of the first one, so they can be replayed in order. If a record
+    // starts a new backup, its snapshot already contains the rest of the rows.
+    SalaraInformation errors;
+    for (int row = first; row <= last && !errors.hasError(); row++)
+    {
+        const bool new_backup = !this->journal_file.isOpen() || this->records >= this->max_records;
+        const int journal_row = Operation::REMOVE == operation ? first : row;
+        const QJsonObject object = Operation::REMOVE == operation ? QJsonObject() : this->model->getJsonObject(row);
+        errors = this->record(operation, journal_row, object, this->model->getJsonarray(),
+                              this->modelExtraParameters());
+        if (new_backup)
+            break;
+    }
+
+    if (errors.hasError() && this->error_callback)
+        this->error_callback(errors);
+}
+
+QJsonArray SpaceObjectsJournal::modelExtraParameters() const
+{
+    return QJsonArray::fromStringList(this->model->getExtraParameters().keys());
+}
+
+SalaraInformation SpaceObjectsJournal::restore(const QString &dir, const QDateTime &datetime, QJsonArray &data)
+{
+    // Newest snapshot that starts before the datetime.
+    QDir backup_directory(dir);
+    QString snapshot_name;
+    for (const auto& name : backup_directory.entryList({kBackupPrefix + '*' + kSnapshotSuffix}, QDir::Files))
+    {
+        QDateTime date = backupDate(name);
+        if (date.isValid() && date <= datetime && (snapshot_name.isEmpty() || date > backupDate(snapshot_name)))
+            snapshot_name = name;
+    }
+
+    if (snapshot_name.isEmpty())
+        return SalaraInformation({ErrorEnum::BACKUP_NOT_FOUND,
+                                  ErrorListStringMap[ErrorEnum::BACKUP_NOT_FOUND].arg(datetime.toString(Qt::ISODate))});
+
+    QFile snapshot_file(backup_directory.filePath(snapshot_name));
+    if (!snapshot_file.open(QIODevice::ReadOnly))
+        return SalaraInformation({ErrorEnum::SNAPSHOT_INVALID,
+                                  ErrorListStringMap[ErrorEnum::SNAPSHOT_INVALID].arg(snapshot_file.fileName())});
+
+    QJsonDocument snapshot = QJsonDocument::fromJson(snapshot_file.readAll());
+    snapshot_file.close();
+    if (!snapshot.isObject() || !snapshot.object()["SpaceObjectsArray"].isArray())
+        return SalaraInformation({ErrorEnum::SNAPSHOT_INVALID,
+                                  ErrorListStringMap[ErrorEnum::SNAPSHOT_INVALID].arg(snapshot_file.fileName())});
+
+    QJsonArray restored = snapshot.object()["SpaceObjectsArray"].toArray();
+
+    // Apply the journal records until the datetime. The backups made before the journal existed have no journal.
+    QString journal_name = snapshot_name;
+    journal_name.chop(kSnapshotSuffix.size());
+    QFile journal(backup_directory.filePath(journal_name + kJournalSuffix));
+    if (journal.open(QIODevice::ReadOnly))
+    {
+        while (!journal.atEnd())
+        {
+            QByteArray line = journal.readLine();
+
+            // An incomplete line can only be the last one, written when the application was stopped.
+            QJsonParseError parse_error;
+            QJsonDocument record_doc = QJsonDocument::fromJson(line, &parse_error);
+            if (QJsonParseError::NoError != parse_error.error || !line.endsWith('\n'))
+                break;
+
+            QJsonObject record = record_doc.object();
+            if (QDateTime::fromString(record[kTimeKey].toString(), Qt::ISODateWithMs) > datetime)
+                break;
+
+            Operation operation = kOperationStringMap.key(record[kOperationKey].toString(), Operation::EDIT);
+            int row = record[kRowKey].toInt(-1);
+
+            if (Operation::INSERT == operation && row >= 0 && row <= restored.size())
+                restored.insert(row, record[kObjectKey].toObject());
+            else if (Operation::EDIT == operation && row >= 0 && row < restored.size())
+                restored.replace(row, record[kObjectKey].toObject());
+            else if (Operation::REMOVE == operation && row >= 0 && row < restored.size())
+                restored.removeAt(row);
+        }
+        journal.close();
+    }
+
+    data = restored;
+
+    return SalaraInformation();
+}
+
+void SpaceObjectsJournal::pruneBackups() const
+{
+    // The names are sorted by date, so the oldest backups are the first ones.
+    QDir backup_directory(this->backup_dir);
+    QStringList snapshots = backup_directory.entryList({kBackupPrefix + '*' + kSnapshotSuffix}, QDir::Files,
+                                                       QDir::Name);
+
+    for (int i = 0; i < snapshots.size() - this->max_backups; i++)
+    {
+        QString journal_name = snapshots[i];
+        journal_name.chop(kSnapshotSuffix.size());
+        backup_directory.remove(snapshots[i]);
+        backup_directory.remove(journal_name + kJournalSuffix);
+    }
+}
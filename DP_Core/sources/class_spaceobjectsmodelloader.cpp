@@ -131,10 +131,10 @@ void SpaceObjectsModelLoader::loadEnabledObjectsInSet(SpaceObjectSet* set)
     QStringList enabled_objects = set->getEnabled();
     if(enabled_objects.isEmpty())
         return;
-    // Filter model by enabled norads. Prepend \\b0* and append \\b to save leading zeros and ensure it is a word.
+    // Filter model by enabled norads. Leading zeros are ignored.
     JsonTableSortFilterProxyModel sortmodel;
     sortmodel.setSourceModel(this->spaceobject_model);
-    sortmodel.setFilter(norad_column, "\\b0*" + enabled_objects.join("\\b|\\b0*") + "\\b");
+    sortmodel.setSetFilter(norad_column, enabled_objects, true);
     for (int i = 0; i < sortmodel.rowCount(); i++)
     {
         QModelIndex index = sortmodel.index(i, enablement_column);
@@ -6,6 +6,9 @@
 #include <QJsonObject>
 #include <QDir>
 
+#include <omp.h>
+
+#include "includes/class_jsonstreamreader.h"
 #include "includes/class_statsfilemanager.h"
 #include "includes/class_calibrationfilemanager.h"
 #include "includes/class_salarasettings.h"
@@ -56,6 +59,8 @@ const QMap<TrackingFileManager::ErrorEnum, QString> TrackingFileManager::ErrorLi
      "The tracking json file %1 does not exist."},
     {TrackingFileManager::ErrorEnum::TRACKFILE_NOT_REMOVABLE,
      "The tracking json file %1 could not be removed."},
+    {TrackingFileManager::ErrorEnum::LOAD_CANCELLED,
+     "The loading of the trackings directory %1 was cancelled."},
 };
 
 // TODO: long double?
@@ -178,17 +183,50 @@ SalaraInformation TrackingFileManager::removeCurrentTracking(const QString &trac
 }
 
 SalaraInformation TrackingFileManager::readTrackingDir(const QString &dir, const QString& calib_path,
-                                                       std::vector<Tracking> &tracks)
+                                                       std::vector<Tracking> &tracks, const std::atomic_bool *cancel,
+                                                       const ProgressCallback &progress)
 {
-    Tracking t;
+    const QFileInfoList files = QDir(dir).entryInfoList({"*.dptr"}, QDir::Files, QDir::Name);
+    const int nfiles = files.size();
+
+    // Each file is parsed into its own slot, so the output order does not depend on the threads scheduling.
+    std::vector<Tracking> loaded(nfiles);
+    std::vector<SalaraInformation> loaded_errors(nfiles);
+    std::vector<char> processed(nfiles, 0);
+    std::size_t processed_count = 0;
+
+    #pragma omp parallel for num_threads(omp_get_max_threads()) schedule(dynamic)
+    for (int i = 0; i < nfiles; i++)
+    {
+        if (cancel && *cancel)
+            continue;
+
+        loaded_errors[i] = TrackingFileManager::readTracking(files[i].fileName(), files[i].canonicalPath(),
+                                                             calib_path, loaded[i]);
+        processed[i] = 1;
+
+        #pragma omp critical
+        {
+            processed_count++;
+            if (progress)
+                progress(processed_count, static_cast<std::size_t>(nfiles));
+        }
+    }
+
+    // Move the valid trackings to the output.
     SalaraInformation result;
-    for (auto&& file : QDir(dir).entryInfoList({"*.dptr"}, QDir::Files))
+    tracks.reserve(tracks.size() + static_cast<std::size_t>(nfiles));
+    for (int i = 0; i < nfiles; i++)
     {
-        auto errors = TrackingFileManager::readTracking(file.fileName(), file.canonicalPath(), calib_path, t);
-        result.append(errors);
-        if (!errors.hasError())
-            tracks.push_back(t);
+        result.append(loaded_errors[i]);
+        if (processed[i] && !loaded_errors[i].hasError())
+            tracks.push_back(std::move(loaded[i]));
     }
+
+    if (processed_count < static_cast<std::size_t>(nfiles))
+        result.append({{TrackingFileManager::ErrorEnum::LOAD_CANCELLED,
+                        TrackingFileManager::ErrorListStringMap[ErrorEnum::LOAD_CANCELLED].arg(dir)}});
+
     return result;
 }
 
@@ -309,133 +347,199 @@ SalaraInformation TrackingFileManager::readTrackingFromFile(const QString &file_
 {
     QFile track_file(file_path);
     // Check if file could be opened.
-    if(!track_file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if(!track_file.open(QIODevice::ReadOnly))
         return SalaraInformation({TrackingFileManager::ErrorEnum::TRACKFILE_NOT_OPEN,
                                   ErrorListStringMap[ErrorEnum::TRACKFILE_NOT_OPEN].arg(file_path)});
 
-    // Read all.
-    QString track_string = track_file.readAll().simplified();
-    track_file.close();
-    // Loads the json document.
-    QJsonDocument track_jsondocument = QJsonDocument::fromJson(track_string.toUtf8());
+    // Map the file. If it is not possible, read all.
+    QByteArray track_buffer;
+    const char* track_data = reinterpret_cast<const char*>(track_file.map(0, track_file.size()));
+    if (!track_data)
+    {
+        track_buffer = track_file.readAll();
+        track_data = track_buffer.constData();
+    }
 
-    // Check if scheme is valid
+    // The document is decoded while it is parsed, without building the json DOM.
+    JsonStreamReader reader(track_data, static_cast<std::size_t>(track_file.size()));
     SalaraInformation errors;
+    Tracking result;
 
-    // Check if data file is valid
-    if (track_jsondocument.isNull())
+    // Small nested values are decoded with the json DOM.
+    auto subDocument = [&reader]
     {
-        errors.append({{ErrorEnum::TRACKFILE_INVALID, ErrorListStringMap[ErrorEnum::TRACKFILE_INVALID].arg(file_path)}});
-    }
-    else
+        std::string_view raw = reader.skipValue();
+        return QJsonDocument::fromJson(QByteArray::fromRawData(raw.data(), static_cast<int>(raw.size())));
+    };
+
+    // Appends the times of an ET array. The times are stored as strings to keep the precision. Invalid times are
+    // discarded.
+    auto readTimes = [&reader](std::vector<long double>& times)
     {
-        // Ensure object is cleared
-        track = Tracking();
-
-        // Data
-        track.date_start = QDateTime::fromString(track_jsondocument[kDateStartKey].toString(), Qt::ISODateWithMs);
-        track.date_end = QDateTime::fromString(track_jsondocument[kDateEndKey].toString(), Qt::ISODateWithMs);
-        track.filter_mode = static_cast<Tracking::FilterMode>(track_jsondocument[kFilterModeKey].toInt());
-        track.station_name = track_jsondocument[kStationNameKey].toString();
-        track.station_id = track_jsondocument[kStationIdKey].toInt();
-        track.cfg_id = track_jsondocument[kCfgIdKey].toString();
-        track.obj_name = track_jsondocument[kObjNameKey].toString();
-        track.obj_norad = track_jsondocument[kObjNoradKey].toString();
-        track.obj_bs = track_jsondocument[kObjBSKey].toInt();
-        track.rf = track_jsondocument[kRFKey].toDouble();
-        track.nshots = track_jsondocument[kNShotsKey].toInt();
-        track.rnshots = track_jsondocument[kRNShotsKey].toInt();
-        track.unshots = track_jsondocument[kUNShotsKey].toInt();
-        track.tror_rfrms = track_jsondocument[kTRORRFRMSKey].toDouble();
-        track.tror_1rms = track_jsondocument[kTROR1RMSKey].toDouble();
-        track.release = track_jsondocument[kReleaseKey].toInt();
-        track.ephemeris_file = track_jsondocument[kEphemerisKey].toString();
-
-        // Stats
-        track.stats_rfrms = StatsFileManager::fromJson(track_jsondocument[kStatsRFRMSKey].toObject());
-        track.stats_1rms = StatsFileManager::fromJson(track_jsondocument[kStats1RMSKey].toObject());
-
-        // Meteo
-        for (auto&& meteo : track_jsondocument[kMeteoKey].toArray())
+        if (JsonStreamReader::Token::BEGIN_ARRAY != reader.token())
+            return;
+        while (reader.nextElement())
         {
-            track.meteo_data.push_back(MeteoData::fromJson(meteo.toObject()));
+            bool ok;
+            long double value = reader.toLongDouble(0.L, &ok);
+            if (ok)
+                times.push_back(value);
+            else if (reader.isContainer())
+                reader.skipValue();
         }
+    };
 
-        // Calibration data and overall value
-        track.cal_val_overall = track_jsondocument[kOverallCalKey].toDouble();
-        QJsonArray array = track_jsondocument[kCalDataKey].toArray();
-        for (const auto& elem : std::as_const(array))
+    if (JsonStreamReader::Token::BEGIN_OBJECT == reader.next())
+    {
+        while (reader.nextKey() && !reader.hasError())
         {
-            QJsonObject obj = elem.toObject();
-            Calibration calib;
-            SalaraInformation e = calib_path.isEmpty() ?
-                        CalibrationFileManager::readCalibration(obj[kCalFileKey].toString(), calib) :
-                        CalibrationFileManager::readCalibration(obj[kCalFileKey].toString(), calib_path, calib);
-
-            if (e.hasError())
-                errors.append(e);
-            else
+            reader.next();
+
+            // Data
+            if (reader.isKey(kDateStartKey))
+                result.date_start = QDateTime::fromString(reader.toString(), Qt::ISODateWithMs);
+            else if (reader.isKey(kDateEndKey))
+                result.date_end = QDateTime::fromString(reader.toString(), Qt::ISODateWithMs);
+            else if (reader.isKey(kFilterModeKey))
+                result.filter_mode = static_cast<Tracking::FilterMode>(reader.toInteger());
+            else if (reader.isKey(kStationNameKey))
+                result.station_name = reader.toString();
+            else if (reader.isKey(kStationIdKey))
+                result.station_id = static_cast<unsigned int>(reader.toInteger());
+            else if (reader.isKey(kCfgIdKey))
+                result.cfg_id = reader.toString();
+            else if (reader.isKey(kObjNameKey))
+                result.obj_name = reader.toString();
+            else if (reader.isKey(kObjNoradKey))
+                result.obj_norad = reader.toString();
+            else if (reader.isKey(kObjBSKey))
+                result.obj_bs = static_cast<unsigned int>(reader.toInteger());
+            else if (reader.isKey(kRFKey))
+                result.rf = reader.toDouble();
+            else if (reader.isKey(kNShotsKey))
+                result.nshots = static_cast<std::size_t>(reader.toInteger());
+            else if (reader.isKey(kRNShotsKey))
+                result.rnshots = static_cast<std::size_t>(reader.toInteger());
+            else if (reader.isKey(kUNShotsKey))
+                result.unshots = static_cast<std::size_t>(reader.toInteger());
+            else if (reader.isKey(kTRORRFRMSKey))
+                result.tror_rfrms = reader.toDouble();
+            else if (reader.isKey(kTROR1RMSKey))
+                result.tror_1rms = reader.toDouble();
+            else if (reader.isKey(kReleaseKey))
+                result.release = static_cast<unsigned int>(reader.toInteger());
+            else if (reader.isKey(kEphemerisKey))
+                result.ephemeris_file = reader.toString();
+
+            // Stats
+            else if (reader.isKey(kStatsRFRMSKey))
+                result.stats_rfrms = StatsFileManager::fromJson(subDocument().object());
+            else if (reader.isKey(kStats1RMSKey))
+                result.stats_1rms = StatsFileManager::fromJson(subDocument().object());
+
+            // Meteo
+            else if (reader.isKey(kMeteoKey))
             {
-                Tracking::CalibrationSpan span = static_cast<decltype(span)>(obj[kCalSpanKey].toInt());
-                track.cal_data[span][calib.date_start] = calib;
+                for (auto&& meteo : subDocument().array())
+                    result.meteo_data.push_back(MeteoData::fromJson(meteo.toObject()));
             }
-        }
 
-        // Ranges
-        array = track_jsondocument[kRangesKey].toArray();
-        for (const auto& elem : std::as_const(array))
-        {
-            QJsonObject obj = elem.toObject();
-            Tracking::RangeData range;
-            // TODO: check values of enum
-            range.flag = static_cast<Tracking::RangeData::FilterFlag>(obj[kFlagKey].toInt());
-            try
-            {
-                range.start_time = std::stold(obj[kStartKey].toString().toStdString());
-            }
-            catch (...)
+            // Calibration data and overall value
+            else if (reader.isKey(kOverallCalKey))
+                result.cal_val_overall = reader.toDouble();
+            else if (reader.isKey(kCalDataKey))
             {
-                range.start_time = 0.L;
+                QJsonArray array = subDocument().array();
+                for (const auto& elem : std::as_const(array))
+                {
+                    QJsonObject obj = elem.toObject();
+                    Calibration calib;
+                    SalaraInformation e = calib_path.isEmpty() ?
+                                CalibrationFileManager::readCalibration(obj[kCalFileKey].toString(), calib) :
+                                CalibrationFileManager::readCalibration(obj[kCalFileKey].toString(), calib_path, calib);
+
+                    if (e.hasError())
+                        errors.append(e);
+                    else
+                    {
+                        Tracking::CalibrationSpan span = static_cast<decltype(span)>(obj[kCalSpanKey].toInt());
+                        result.cal_data[span][calib.date_start] = std::move(calib);
+                    }
+                }
             }
 
-            range.tof_2w = obj[kToFKey].toDouble();
-            range.pre_2w = obj[kPredKey].toDouble();
-            range.trop_corr_2w = obj[kTropCorrKey].toDouble();
-            range.bias = obj[kBiasKey].toDouble();
-            track.ranges.push_back(range);
-        }
-
-        // TODO: include fail for failed converssions?
-        // ET
-        QJsonObject et_object = track_jsondocument[kEtKey].toObject();
-        if (!et_object.empty())
-        {
-            array = et_object[kTAKey].toArray();
-            for (const auto& elem : std::as_const(array))
+            // Ranges. The number of shots is stored before the ranges, so it is used to reserve the memory.
+            else if (reader.isKey(kRangesKey) && JsonStreamReader::Token::BEGIN_ARRAY == reader.token())
             {
-                try
+                result.ranges.reserve(result.nshots);
+                while (reader.nextElement())
                 {
-                    track.tA.push_back(std::stold(elem.toString().toStdString()));
+                    Tracking::RangeData range;
+                    if (JsonStreamReader::Token::BEGIN_OBJECT != reader.token())
+                    {
+                        reader.skipValue();
+                        continue;
+                    }
+                    while (reader.nextKey())
+                    {
+                        reader.next();
+                        // TODO: check values of enum
+                        if (reader.isKey(kFlagKey))
+                            range.flag = static_cast<Tracking::RangeData::FilterFlag>(reader.toInteger());
+                        else if (reader.isKey(kStartKey))
+                            range.start_time = reader.toLongDouble();
+                        else if (reader.isKey(kToFKey))
+                            range.tof_2w = reader.toDouble();
+                        else if (reader.isKey(kPredKey))
+                            range.pre_2w = reader.toDouble();
+                        else if (reader.isKey(kTropCorrKey))
+                            range.trop_corr_2w = reader.toDouble();
+                        else if (reader.isKey(kBiasKey))
+                            range.bias = reader.toDouble();
+
+                        // Unknown keys or values with unexpected types.
+                        if (reader.isContainer())
+                            reader.skipValue();
+                    }
+                    result.ranges.push_back(range);
                 }
-                catch(...){}
             }
 
-            array = et_object[kTBKey].toArray();
-            for (const auto& elem : std::as_const(array))
+            // TODO: include fail for failed converssions?
+            // ET
+            else if (reader.isKey(kEtKey) && JsonStreamReader::Token::BEGIN_OBJECT == reader.token())
             {
-                try
+                while (reader.nextKey())
                 {
-                    track.tB.push_back(std::stold(elem.toString().toStdString()));
+                    reader.next();
+                    if (reader.isKey(kTAKey))
+                        readTimes(result.tA);
+                    else if (reader.isKey(kTBKey))
+                        readTimes(result.tB);
+                    else if (reader.isKey(kETPrecisionKey))
+                        result.et_precision = static_cast<unsigned int>(reader.toInteger());
+
+                    if (reader.isContainer())
+                        reader.skipValue();
                 }
-                catch(...){}
             }
 
-            track.et_precision = et_object[kETPrecisionKey].toInt();
-        }
+            // TODO telescope
 
-        // TODO telescope
+            // Other keys or values with unexpected types.
+            if (reader.isContainer())
+                reader.skipValue();
+        }
     }
 
+    // Check if data file is valid
+    if (reader.hasError() || JsonStreamReader::Token::END_DOCUMENT != reader.next())
+        errors.append({{ErrorEnum::TRACKFILE_INVALID, ErrorListStringMap[ErrorEnum::TRACKFILE_INVALID].arg(file_path)}});
+    else
+        track = std::move(result);
+
+    track_file.close();
+
     // Return the errors
     return errors;
 }
@@ -0,0 +1,227 @@
+#include "includes/interface_cpfdownloadengine.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <mutex>
+
+const QString kSyncCacheFilename = QStringLiteral("SP_CPFSyncCache.json");
+const QString kChecksumKey = QStringLiteral("SHA256");
+const QString kETagKey = QStringLiteral("ETag");
+const QString kLastModifiedKey = QStringLiteral("LastModified");
+
+namespace
+{
+
+// Release date of a CPF, from its name: <target>_cpf_<yymmdd>_<sequence>.<provider>
+QDate cpfReleaseDate(const QString& file_name)
+{
+    static const QRegularExpression date_regex(QStringLiteral("_cpf_(\\d{6})_"),
+                                               QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = date_regex.match(file_name);
+    return match.hasMatch() ? QDate::fromString("20" + match.captured(1), "yyyyMMdd") : QDate();
+}
+
+QString fileChecksum(const QString& path)
+{
+    QFile file(path);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file))
+        return QString();
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+// Replaces the destination file with the downloaded one and returns the checksum of the new content (empty on
+// failure). QSaveFile writes the content next to the destination and renames it over the old file on commit, so the
+// readers always see a complete version, the old one or the new one.
+QString replaceFile(const QString& source_path, const QString& dest_path)
+{
+    QFile source(source_path);
+    if (!source.open(QIODevice::ReadOnly))
+        return QString();
+    const QByteArray content = source.readAll();
+
+    QSaveFile dest(dest_path);
+    if (source.error() != QFileDevice::NoError || !dest.open(QIODevice::WriteOnly) ||
+            dest.write(content) != content.size() || !dest.commit())
+        return QString();
+
+    return QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex());
+}
+
+QJsonObject cacheEntry(const QString& checksum, const CPFDownloadEngine::RemoteFileInfo& info)
+{
+    QJsonObject entry{{kChecksumKey, checksum}};
+    if (!info.etag.isEmpty())
+        entry.insert(kETagKey, info.etag);
+    if (info.last_modified.isValid())
+        entry.insert(kLastModifiedKey, info.last_modified.toUTC().toString(Qt::ISODate));
+    return entry;
+}
+
+// The remote file changed if the server sends a value cached from the previous download that is different now. The
+// ETag is compared first, as in the HTTP conditional requests, and the dates with a resolution of seconds.
+bool remoteChanged(const QJsonObject& entry, const CPFDownloadEngine::RemoteFileInfo& info)
+{
+    if (!info.etag.isEmpty() && entry.contains(kETagKey))
+        return entry[kETagKey].toString() != info.etag;
+    if (info.last_modified.isValid() && entry.contains(kLastModifiedKey))
+        return QDateTime::fromString(entry[kLastModifiedKey].toString(), Qt::ISODate).toSecsSinceEpoch() !=
+                info.last_modified.toSecsSinceEpoch();
+    return false;
+}
+
+}
+
+SalaraInformation CPFDownloadEngine::remoteFileInfo(const QString &, RemoteFileInfo &info)
+{
+    info = RemoteFileInfo();
+    return SalaraInformation();
+}
+
+SalaraInformation CPFDownloadEngine::syncCPFs(const SpaceObjectsList &objects, const QDateTime &since,
+                                             const QString &dest_dir, QStringList &downloaded)
+{
+    downloaded.clear();
+
+    QStringList remote_files;
+    SalaraInformation errors = this->listCPFs(remote_files);
+    if (errors.hasError())
+        return errors;
+
+    QDir dest_directory(dest_dir);
+    if (!dest_directory.exists() && !dest_directory.mkpath("."))
+        return SalaraInformation({ErrorEnum::PERMISSIONS_ERROR, ErrorEnumStringMap[ErrorEnum::PERMISSIONS_ERROR]},
+                                 dest_dir);
+
+    // Cache of the fetched files. The entries of the files removed from the directory are discarded.
+    QJsonObject cache;
+    QFile cache_file(dest_directory.filePath(kSyncCacheFilename));
+    if (cache_file.open(QIODevice::ReadOnly))
+    {
+        QJsonObject stored = QJsonDocument::fromJson(cache_file.readAll()).object();
+        cache_file.close();
+        for (auto it = stored.constBegin(); it != stored.constEnd(); it++)
+            if (dest_directory.exists(it.key()))
+                cache.insert(it.key(), it.value());
+    }
+
+    // The CPF names start with the ILRS name of the target.
+    QStringList prefixes;
+    for (const auto& object : objects)
+        prefixes.append(object->getPreferredName().toLower().remove(' ') + "_cpf_");
+
+    // Releases of the objects since the given date.
+    QStringList candidates;
+    for (const auto& file_name : remote_files)
+    {
+        const QString lower_name = file_name.toLower();
+        if (!prefixes.isEmpty() && std::none_of(prefixes.cbegin(), prefixes.cend(), [&lower_name](const auto& prefix)
+        {
+            return lower_name.startsWith(prefix);
+        }))
+            continue;
+
+        const QDate release_date = cpfReleaseDate(file_name);
+        if (since.isValid() && release_date.isValid() && release_date < since.date())
+            continue;
+
+        candidates.append(file_name);
+    }
+
+    // The engines download the files to a temporary directory inside the destination, so a failed download never
+    // leaves a partial file in the destination.
+    QTemporaryDir temp_dir(dest_directory.filePath(".cpf_sync_XXXXXX"));
+    if (!candidates.isEmpty() && !temp_dir.isValid())
+        return SalaraInformation({ErrorEnum::PERMISSIONS_ERROR, ErrorEnumStringMap[ErrorEnum::PERMISSIONS_ERROR]},
+                                 temp_dir.errorString());
+
+    // A local file is up to date if it matches the cached checksum and the remote metadata did not change since it
+    // was downloaded. A local file that is not in the cache (copied by other means) is added to it instead of being
+    // downloaded again.
+    std::mutex result_mutex;
+    auto sync = [&](const QString& file_name)
+    {
+        QJsonObject entry;
+        {
+            std::lock_guard<std::mutex> lock(result_mutex);
+            entry = cache.value(file_name).toObject();
+        }
+
+        // Without metadata (the server can not give it), only the local copy is checked.
+        RemoteFileInfo info;
+        SalaraInformation file_errors = this->remoteFileInfo(file_name, info);
+        if (file_errors.hasError())
+            info = RemoteFileInfo();
+
+        QString checksum;
+        const QString local_path = dest_directory.filePath(file_name);
+        if (QFileInfo::exists(local_path))
+        {
+            checksum = fileChecksum(local_path);
+            const QString cached_checksum = entry[kChecksumKey].toString();
+            if (!checksum.isEmpty() && (cached_checksum.isEmpty() || checksum == cached_checksum) &&
+                    !remoteChanged(entry, info))
+            {
+                // The cached metadata is kept if the server did not send it this time.
+                if (info.isEmpty())
+                    entry.insert(kChecksumKey, checksum);
+                std::lock_guard<std::mutex> lock(result_mutex);
+                cache.insert(file_name, info.isEmpty() ? entry : cacheEntry(checksum, info));
+                return;
+            }
+        }
+
+        file_errors = this->getCPF(file_name, temp_dir.path());
+        if (!file_errors.hasError())
+        {
+            checksum = replaceFile(temp_dir.filePath(file_name), local_path);
+            if (checksum.isEmpty())
+                file_errors = SalaraInformation({ErrorEnum::WRITE_FAILED, ErrorEnumStringMap[ErrorEnum::WRITE_FAILED]},
+                                                file_name);
+        }
+
+        std::lock_guard<std::mutex> lock(result_mutex);
+        errors.append(file_errors);
+        if (!file_errors.hasError())
+        {
+            downloaded.append(file_name);
+            cache.insert(file_name, cacheEntry(checksum, info));
+        }
+    };
+
+    // Engines that are not reentrant check and download the files one by one in the calling thread.
+    const int max_downloads = std::max(1, this->maxConcurrentDownloads());
+    if (1 == max_downloads)
+    {
+        for (const auto& file_name : candidates)
+            sync(file_name);
+    }
+    else
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(max_downloads);
+        QList<QFuture<void>> futures;
+        for (const auto& file_name : candidates)
+            futures.append(QtConcurrent::run(&pool, [&sync, file_name]{sync(file_name);}));
+        for (auto& future : futures)
+            future.waitForFinished();
+    }
+
+    QSaveFile cache_save(dest_directory.filePath(kSyncCacheFilename));
+    if (!cache_save.open(QIODevice::WriteOnly) ||
+            cache_save.write(QJsonDocument(cache).toJson(QJsonDocument::Indented)) < 0 || !cache_save.commit())
+        errors.append(SalaraInformation({ErrorEnum::WRITE_FAILED, ErrorEnumStringMap[ErrorEnum::WRITE_FAILED]},
+                                        cache_save.fileName()));
+
+    return errors;
+}
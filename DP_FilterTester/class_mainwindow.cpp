@@ -6,7 +6,6 @@
 #include "ui_form_mainwindow.h"
 #include "algorithms.h"
 #include <class_trackingfilemanager.h>
-#include <class_salarasettings.h>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -74,10 +73,8 @@ void MainWindow::openFile()
         QStringList tokens = fileinfo.fileName().split("_");
         if (tokens.size() > 3)
         {
-            QString calib_path = SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_HistoricalCalibrations");
-            calib_path += "/" + tokens[2].left(8) ;
-
-            auto errors = TrackingFileManager::readTracking(fileinfo.fileName(), fileinfo.absolutePath(), calib_path, tr);
+            // The calibrations are looked up in the historical calibrations index.
+            auto errors = TrackingFileManager::readTracking(fileinfo.fileName(), fileinfo.absolutePath(), tr);
             if (errors.hasError())
             {
                 errors.showErrors("AlgorithmsTester", SalaraInformation::WARNING, "Errors at tracking reading", this);
@@ -105,17 +105,3 @@ void ErrorPlot::setSamples(const QVector<QPointF>& samples)
 
     this->replot();
 }
-
-QVector<QPointF> ErrorPlot::getThreshSamples() const
-{
-    QVector<QPointF> thresh_points;
-    QwtSLRArraySeriesData *curve_data = static_cast<QwtSLRArraySeriesData *>(this->plot_curve->data());
-    QVector<QPointF> samples = curve_data->samples();
-    std::copy_if(std::make_move_iterator(samples.begin()), std::make_move_iterator(samples.end()),
-                 std::back_inserter(thresh_points),
-                 [this](const auto& p)
-    {return p.y() > this->mark_thresh2->value().y() && p.y() < this->mark_thresh1->value().y();});
-
-    return thresh_points;
-
-}
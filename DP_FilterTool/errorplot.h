@@ -44,9 +44,6 @@ public:
     ErrorPlot( QWidget *parent = nullptr, QString title = "");
     void setSamples( const QVector<QPointF> &samples );
 
-    QVector<QPointF> getThreshSamples() const;
-
-
 private:
     QwtPlotMarker *mark_thresh1;
     QwtPlotMarker *mark_thresh2;
@@ -20,11 +20,13 @@
 #include "class_cpf.h"
 #include "cpfutils.h"
 #include "common.h"
+#include <algorithms.h>
 #include <utils.h>
 
 #include <class_trackingfilemanager.h>
 #include <class_salarasettings.h>
 
+#include <algorithm>
 #include <set>
 
 // Helper
@@ -433,21 +435,21 @@ MainWindow::MainWindow()
         QProgressDialog pd("Autofiltrado en proceso.", "", 0, 0, this);
         pd.setCancelButton(nullptr);
 
-        auto future = QtConcurrent::run([this]
+        const auto samples = this->d_plot->getSelectedSamples();
+        QVector<QPointF> selected_samples;
+        auto future = QtConcurrent::run([this, &samples, &selected_samples]
         {
-            int i = 0;
-            int changed;
-            do
-            {
-                QMetaObject::invokeMethod(this, &MainWindow::threshFilter, Qt::BlockingQueuedConnection, &changed);
-                i++;
-            } while(changed > 0 && i < 20);
+            selected_samples = this->threshFilterSamples(samples, 20);
         });
 
         QFutureWatcher<void> fw;
         QObject::connect(&fw, &QFutureWatcher<void>::finished, &pd, &QProgressDialog::accept, Qt::QueuedConnection);
         fw.setFuture(future);
         pd.exec();
+        future.waitForFinished();
+
+        if (selected_samples.size() != samples.size())
+            this->d_plot->setSamples(selected_samples);
 
         hlay->setEnabled(true);
     });
@@ -838,23 +840,32 @@ MainWindow::MainWindow()
 
 int MainWindow::threshFilter()
 {
-    auto thresh_samples = this->error_plot->getThreshSamples();
     auto samples = this->d_plot->getSelectedSamples();
+    auto selected_samples = this->threshFilterSamples(samples, 1);
 
-    if (thresh_samples.size() != samples.size())
-    {
-        decltype(samples) selected_samples;
-        std::copy_if(std::make_move_iterator(samples.begin()), std::make_move_iterator(samples.end()),
-                     std::back_inserter(selected_samples), [&thresh_samples](const auto& p)
-        {
-            auto it = std::find_if(thresh_samples.begin(), thresh_samples.end(),
-                                   [&p](const auto& t){return p.x() == t.x();});
-            return it != thresh_samples.end();
-        });
+    if (selected_samples.size() != samples.size())
         this->d_plot->setSamples(selected_samples);
+
+    return samples.size() - selected_samples.size();
+}
+
+QVector<QPointF> MainWindow::threshFilterSamples(QVector<QPointF> samples, unsigned max_iter) const
+{
+    // Threshold filter of LibDPSLR, the same used by the batch filter. The time of the samples is in nanoseconds.
+    std::sort(samples.begin(), samples.end(), [](const auto& a, const auto& b){return a.x() < b.x();});
+    std::vector<double> times, resids;
+    for (const auto& p : std::as_const(samples))
+    {
+        times.push_back(p.x() * 1e-9);
+        resids.push_back(p.y());
     }
 
-    return samples.size() - thresh_samples.size();
+    QVector<QPointF> selected_samples;
+    for (const auto& idx : dpslr::algorithms::threshPostfilterSLR(times, resids, this->tracking->data.obj_bs, 2.5, 9,
+                                                                  max_iter))
+        selected_samples.append(samples[static_cast<int>(idx)]);
+
+    return selected_samples;
 }
 
 void MainWindow::closeEvent(QCloseEvent* event)
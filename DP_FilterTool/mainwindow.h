@@ -32,6 +32,9 @@ private slots:
 private:
     void closeEvent(QCloseEvent* event) override;
 
+    // Applies the threshold filter to the samples and returns the accepted ones.
+    QVector<QPointF> threshFilterSamples(QVector<QPointF> samples, unsigned max_iter) const;
+
     Ui::MainWindow *ui;
     TrackingData* tracking;
     Plot* d_plot;
@@ -3,6 +3,7 @@
 #include <qwt_curve_fitter.h>
 #include <qwt_series_data.h>
 #include <qwt_point_data.h>
+#include <algorithms.h>
 #include <dpslr_math.h>
 
 #include <cmath>
@@ -323,58 +324,19 @@ void Plot::setSamples(const QVector<QPointF> &samples)
 
     auto curve_samples = curve_data->samples();
     std::sort(curve_samples.begin(), curve_samples.end(), [](const auto& a, const auto& b){return a.x() < b.x();});
-    QVector<QPointF> oY;
-    QVector<double> oY_original;
-
-    std::vector<double> xbin, ybin;
-    double time_orig = curve_samples.front().x();
 
+    // Same fit used by the threshold filter. The time is in nanoseconds.
+    std::vector<double> times, resids;
     for (const auto& p : std::as_const(curve_samples))
     {
-        if (p.x() - time_orig > this->bin_size * 1e9)
-        {
-            auto coefs = dpslr::math::polynomialFit(xbin, ybin, 9);
-            for (auto it_x = xbin.begin(), it_y = ybin.begin(); it_x != xbin.end() && it_y != ybin.end(); ++it_x, ++it_y)
-            {
-                oY.append({*it_x, dpslr::math::applyPolynomial(coefs, *it_x)});
-                oY_original.append(*it_y);
-            }
-            xbin.clear();
-            ybin.clear();
-            time_orig = p.x();
-
-        }
-
-        xbin.push_back(p.x());
-        ybin.push_back(p.y());
+        times.push_back(p.x() * 1e-9);
+        resids.push_back(p.y());
     }
+    std::vector<double> fit = dpslr::algorithms::binPolynomialFit(times, resids, this->bin_size, 9);
 
-    // TODO: control polynomial fit (matrix is not inversible)
-    if (!xbin.empty() && !ybin.empty())
-    {
-        auto coefs = dpslr::math::polynomialFit(xbin, ybin, 9);
-        for (auto it_x = xbin.begin(), it_y = ybin.begin(); it_x != xbin.end() && it_y != ybin.end(); ++it_x, ++it_y)
-        {
-            oY.append({*it_x, dpslr::math::applyPolynomial(coefs, *it_x)});
-            oY_original.append(*it_y);
-        }
-    }
-
-
-
-//    for (const auto& p : std::as_const(curve_samples))
-//    {
-//        double y = coefs[0];
-
-//        for(int i=1; i<coefs.size(); i++)
-//            y=y+coefs[i]*std::pow(p.x(),i);
-
-//        oY.append(QPointF(p.x(),y));
-//        oY_original.append(p.y());
-
-
-//    }
-
+    QVector<QPointF> oY;
+    for (std::size_t i = 0; i < fit.size(); i++)
+        oY.append({curve_samples[static_cast<int>(i)].x(), fit[i]});
 
     fitt_data->append(oY);
 
@@ -1,5 +1,6 @@
 #include "class_spaceobjectsmanagermainwindowcontroller.h"
 #include "interface_spaceobjectsearchengine.h"
+#include "interface_cpfdownloadengine.h"
 #include "form_satellite.h"
 #include "form_save.h"
 
@@ -9,6 +10,7 @@
 #include <class_guiloader.h>
 
 #include <QInputDialog>
+#include <QMessageBox>
 #include <QDesktopServices>
 #include <QFileDialog>
 #include <QClipboard>
@@ -16,9 +18,14 @@
 #include <QMetaObject>
 #include <QThread>
 #include <QApplication>
+#include <QProgressDialog>
 
+#include <atomic>
 #include <set>
 
+// Days of CPF releases downloaded by the CPF synchronization, as the days searched by the CPF loaders.
+constexpr int kCPFSyncDays = 6;
+
 using FilterColumntype = SpaceObjectsManagerMainWindowView::FilterColumnType;
 using FilterType = SpaceObjectsManagerMainWindowView::FilterType;
 using FilterKeyType = QPair<FilterColumntype, FilterType>;
@@ -56,9 +63,19 @@ SpaceObjectsManagerMainWindowController::SpaceObjectsManagerMainWindowController
     // Load app settings.
     this->backup_enabled = SalaraSettings::instance().getAppConfigBool("Backup/enabled");
     this->max_backup_files = SalaraSettings::instance().getAppConfigInt("Backup/max_files");
+    this->max_journal_records = SalaraSettings::instance().getAppConfigInt("Backup/max_journal_records");
+    if (this->max_journal_records <= 0)
+        this->max_journal_records = 500;
+    this->journal.setBackupDirectory(this->dir_backup.path(), this->max_backup_files, this->max_journal_records);
 
     // Create the model and load the scheme
     this->model = new SpaceObjectModel(this);
+    // Every change of the data is journaled in the backups.
+    if (this->backup_enabled)
+        this->journal.attachModel(this->model, [this](const SalaraInformation& errors)
+        {
+            this->showBackupErrors(errors);
+        });
     this->slotLoadSpaceObjectsSchemeFile();
 
     // Create the sort model and assign it to table_view and set the filtering for all columns.
@@ -199,6 +216,7 @@ void SpaceObjectsManagerMainWindowController::connectViewSignals()
             selected_rows_model.append(this->sortmodel->mapToSource(row));
         }
 
+        this->journal.beginBulkChange();
         for (const auto& row : selected_rows_model)
         {
             // Only change enablement policy if it is not always enabled or always disabled
@@ -208,6 +226,7 @@ void SpaceObjectsManagerMainWindowController::connectViewSignals()
                 this->model->setData(row, policy, Qt::UserRole);
             }
         }
+        this->showBackupErrors(this->journal.endBulkChange());
     });
 
     QObject::connect(this->spaceobjects_view, &SpaceObjectsManagerMainWindowView::signalCopyTriggered, this,
@@ -247,6 +266,9 @@ void SpaceObjectsManagerMainWindowController::connectViewSignals()
 
     QObject::connect(this->spaceobjects_view, &SpaceObjectsManagerMainWindowView::signalExportToCSV,
                      this, &SpaceObjectsManagerMainWindowController::exportToCSV);
+
+    QObject::connect(this->spaceobjects_view, &SpaceObjectsManagerMainWindowView::signalSyncCPFs,
+                     this, &SpaceObjectsManagerMainWindowController::syncCPFs);
 }
 
 void SpaceObjectsManagerMainWindowController::exportToCSV() const
@@ -276,68 +298,97 @@ void SpaceObjectsManagerMainWindowController::exportToCSV() const
     if(!filename.contains(".csv"))
         filename+=".csv";
 
-    QFile file(filename);
-    if(file.open(QIODevice::WriteOnly | QIODevice::Text))
+    // Resolve the source rows once, in the selection order.
+    QVector<int> rows;
+    rows.reserve(list.size());
+    for(const auto& object : list)
+        rows.push_back(this->sortmodel->mapToSource(object).row());
+
+    // Progress dialog. The export runs in the controller thread, so the view stays responsive and can cancel it.
+    std::atomic_bool cancel(false);
+    QProgressDialog* progress_dialog = nullptr;
+    QMetaObject::Connection cancel_connection;
+    GuiLoader::exec([&progress_dialog, &cancel_connection, &cancel, total = rows.size(),
+                    view = this->spaceobjects_view]
     {
-        QTextStream stream(&file);
+        progress_dialog = new QProgressDialog("Exporting space objects...", "Cancel", 0, total, view);
+        progress_dialog->setWindowModality(Qt::WindowModal);
+        progress_dialog->setMinimumDuration(500);
+        cancel_connection = QObject::connect(progress_dialog, &QProgressDialog::canceled, [&cancel]{cancel = true;});
+    });
 
-        stream<<"NORAD;COSPAR;NAME;ILRS;ALTITUDE;RCS;DEBRIS";
+    SalaraInformation errors = SpaceObjectFileManager::exportSpaceObjectsCSV(
+                filename, *this->model, rows, &cancel, [progress_dialog](std::size_t written, std::size_t)
+    {
+        GuiLoader::async([progress_dialog, written]{progress_dialog->setValue(static_cast<int>(written));});
+    });
 
-        for(const auto& object : list)
-        {
-            stream<<"\n";
-            stream << this->sortmodel->data(this->sortmodel->index(object.row(),1),0).toString() <<";";
-            stream << this->sortmodel->data(this->sortmodel->index(object.row(),5),0).toString() <<";";
-            stream << this->sortmodel->data(this->sortmodel->index(object.row(),2),0).toString() <<";";
-            if(this->sortmodel->data(this->sortmodel->index(object.row(),3),0).toString().isEmpty())
-                stream << "No" << ";";
-            else
-                stream << "Yes" << ";";
-            stream << this->sortmodel->data(this->sortmodel->index(object.row(),14),0).toString() <<";";
-            stream << this->sortmodel->data(this->sortmodel->index(object.row(),15),0).toDouble() <<";";
-            stream << this->sortmodel->data(this->sortmodel->index(object.row(),10),0).toString();
-        }
+    GuiLoader::exec([progress_dialog, &cancel_connection]
+    {
+        QObject::disconnect(cancel_connection);
+        progress_dialog->deleteLater();
+    });
 
-        file.close();
+    if (errors.hasError() && !cancel)
+    {
+        GuiLoader::exec([&errors, view = this->spaceobjects_view]{
+            errors.showErrors(WARNING_SPACEOBJECTMANAGER, SalaraInformation::WARNING, "", view);});
     }
 }
 
-void SpaceObjectsManagerMainWindowController::makeDataBackup() const
+void SpaceObjectsManagerMainWindowController::syncCPFs() const
 {
-    if (this->backup_enabled)
+    SpaceObjectsList objects;
+    for (const auto& object : this->model->getObjectsList())
+        if (object->getEnablementPolicy() == SpaceObject::ENABLED ||
+                object->getEnablementPolicy() == SpaceObject::ALWAYS_ENABLED)
+            objects.append(object);
+
+    if (objects.isEmpty())
     {
-        QDateTime version_date = QDateTime::currentDateTimeUtc();
-        SpaceObjectModel::ExtraParametersMap extraparameters = this->model->getExtraParameters();
-        QStringList extraparameters_names(extraparameters.keys());
-        QJsonArray extraparameters_array(QJsonArray::fromStringList(extraparameters_names));
-        QString backup_file = this->dir_backup.path() + "/SP_SpaceObjectsData_bkp_" +
-                version_date.toString("yyyyMMdd_hhmmss") + ".json";
-        SpaceObjectFileManager::saveSpaceObjectsData(backup_file, "Space Objects Data Backup " +
-                                                     version_date.toString("yyyyMMdd.hhmmss"),
-                                                     version_date,
-                                                     "This is a Space Objects Data Backup.",
-                                                     this->model->getJsonarray(),
-                                                     extraparameters_array);
-
-        QDir backup_directory(this->dir_backup.path());
-        QStringList backup_files = backup_directory.entryList(QDir::Files, QDir::Time | QDir::Reversed);
-        int backup_directory_size = backup_files.size();
-
-        if (backup_directory_size > this->max_backup_files)
-        {
-            int i = 0;
+        GuiLoader::exec([view = this->spaceobjects_view]{
+        SalaraInformation::showInfo(INFO_SPACEOBJECTMANAGER, "No objects enabled.", "", view);});
+        return;
+    }
 
-            while (i < backup_directory_size - this->max_backup_files)
-            {
-                backup_directory.remove(backup_files[i]);
-                i++;
-            }
-        }
+    // The new releases of the enabled objects are downloaded to the current CPFs directory by every engine.
+    const QString dest_dir = SalaraSettings::instance().getGlobalConfigString("SalaraProjectDataPaths/SP_CurrentCPF");
+    const QDateTime since = QDateTime::currentDateTimeUtc().addDays(-kCPFSyncDays);
+    SalaraInformation errors;
+    QStringList downloaded;
+    for (const auto& engine : this->plugins_cpf_engines)
+    {
+        QStringList engine_downloaded;
+        errors.append(engine->syncCPFs(objects, since, dest_dir, engine_downloaded));
+        downloaded.append(engine_downloaded);
+    }
+
+    if (errors.hasError())
+    {
+        GuiLoader::exec([&errors, view = this->spaceobjects_view]{
+            errors.showErrors(WARNING_SPACEOBJECTMANAGER, SalaraInformation::WARNING, "", view);});
+    }
+    else
+    {
+        GuiLoader::exec([&downloaded, view = this->spaceobjects_view]{
+            SalaraInformation::showInfo(INFO_SPACEOBJECTMANAGER, QString("%1 CPFs downloaded.").arg(downloaded.size()),
+                                        downloaded.join('\n'), view);});
     }
 }
 
+void SpaceObjectsManagerMainWindowController::showBackupErrors(const SalaraInformation &errors) const
+{
+    if (errors.hasError())
+        GuiLoader::exec([view = this->spaceobjects_view, &errors]{
+            errors.showErrors(WARNING_SPACEOBJECTMANAGER, SalaraInformation::WARNING, "", view);
+        });
+}
+
 void SpaceObjectsManagerMainWindowController::loadSystemSet()
 {
+    // The enablement of all the objects changes, so it is backed up with a snapshot instead of one record per row.
+    this->journal.beginBulkChange();
+
     // First disable all that are not always enabled or always disabled
     this->model->disableAll();
 
@@ -357,6 +408,8 @@ void SpaceObjectsManagerMainWindowController::loadSystemSet()
                                    this->set_listmodel->stringList().indexOf(this->system_set));
     }
 
+    this->showBackupErrors(this->journal.endBulkChange());
+
     // Update labels.
     this->updateCounterLabels();
 }
@@ -371,9 +424,10 @@ void SpaceObjectsManagerMainWindowController::loadEnabledObjectsInSet(SpaceObjec
     if(enabled_objects.isEmpty())
         return;
 
-    // Filter model by enabled norads. Prepend \\b0* and append \\b to save leading zeros and ensure it is a word.
-    JsonTableSortFilterProxyModel aux_sortmodel({{norad_column, "\\b0*" + enabled_objects.join("\\b|\\b0*") + "\\b"}});
+    // Filter model by enabled norads. Leading zeros are ignored.
+    JsonTableSortFilterProxyModel aux_sortmodel;
     aux_sortmodel.setSourceModel(this->model);
+    aux_sortmodel.setSetFilter(norad_column, enabled_objects, true);
     for (int i = 0; i < aux_sortmodel.rowCount(); i++)
     {
         QModelIndex index = aux_sortmodel.index(i, enablement_column);
@@ -461,9 +515,11 @@ void SpaceObjectsManagerMainWindowController::slotLoadSet()
         SpaceObjectSet* set = this->list_sets[current_index];
         // First disable all.
         this->spaceobjects_view->setUpdatesEnabled(false);
+        this->journal.beginBulkChange();
         this->model->disableAll();
         // Then load enabled objects and update labels
         this->loadEnabledObjectsInSet(set);
+        this->showBackupErrors(this->journal.endBulkChange());
         this->updateCounterLabels();
         this->loaded_set = set->getName();
         GuiLoader::setViewProperty(this->spaceobjects_view, "setCurrentLoadedSet", this->loaded_set);
@@ -651,6 +707,9 @@ void SpaceObjectsManagerMainWindowController::slotLoadSpaceObjectsDataFile(const
     // If there is not an error in scheme, then initialize elements in GUI that depends on it
     if(!errors.containsError(SpaceObjectFileManager::SCHEME_NOT_VALID))
     {
+        // The backups of the previous data are closed. The first change will start a new backup.
+        this->journal.close();
+
         // Diabled save.
         GuiLoader::setViewProperty(this->spaceobjects_view, "setSaveObjectsEnabled", false);
         GuiLoader::setViewProperty(this->spaceobjects_view, "setNewSetEnabled", this->model->rowCount()>0);
@@ -662,8 +721,10 @@ void SpaceObjectsManagerMainWindowController::slotLoadSpaceObjectsDataFile(const
         // Set enablement policy based on current loaded set, if any
         if (SpaceObjectSet* set = this->getSpaceObjectSetByName(this->loaded_set))
         {
+            this->journal.beginBulkChange();
             this->model->disableAll();
             this->loadEnabledObjectsInSet(set);
+            this->showBackupErrors(this->journal.endBulkChange());
         }
         this->updateCounterLabels();
     }
@@ -720,7 +781,9 @@ void SpaceObjectsManagerMainWindowController::slotDeleteSet()
     // If loaded set is to be eliminated, then disable all objects.
     if(selected_set->getName() == this->loaded_set)
     {
+        this->journal.beginBulkChange();
         this->model->disableAll();
+        this->showBackupErrors(this->journal.endBulkChange());
         this->loaded_set = "";
         GuiLoader::setViewProperty(this->spaceobjects_view, "setCurrentLoadedSet", QString());
     }
@@ -932,6 +995,8 @@ void SpaceObjectsManagerMainWindowController::slotRemoveObject()
     if (selected_indexes.size() == this->model->rowCount())
     {
         this->model->clearContents();
+        // The reset closes the backup. Start a new one with the empty data.
+        this->showBackupErrors(this->journal.snapshotModel());
         // Enables the MainWindow.
         GuiLoader::setViewProperty(this->spaceobjects_view, "setEnabled", true);
         return;
@@ -987,8 +1052,6 @@ void SpaceObjectsManagerMainWindowController::slotEditObject()
         // Enable saving, since a row has been edited
         GuiLoader::setViewProperty(this->spaceobjects_view, "setSaveObjectsEnabled", true);
         this->sortmodel->invalidate();
-        // Make backup.
-        this->makeDataBackup();
     }
     // Reload the selection.
     this->slotSelectionChanged();
@@ -1022,7 +1085,6 @@ void SpaceObjectsManagerMainWindowController::slotAddObject()
         // Enable save since a new row has been inserted
         GuiLoader::setViewProperty(this->spaceobjects_view, "setSaveObjectsEnabled", true);
         this->sortmodel->invalidate();
-        this->makeDataBackup();
         // Map the selection.
         QModelIndex index = this->sortmodel->mapFromSource(this->model->index(this->model->rowCount()-1, 0));
         QMetaObject::invokeMethod(this->spaceobjects_view->getTableSelectionModel(), "select", Qt::AutoConnection,
@@ -1090,7 +1152,8 @@ void SpaceObjectsManagerMainWindowController::slotSelectionChanged()
 void SpaceObjectsManagerMainWindowController::start()
 {
     SalaraInformation plugins_errors = this->loadPlugins(
-                PluginCategory::EXTERNAL_TOOL | PluginCategory::SPACE_OBJECT_SEARCH_ENGINE);
+                PluginCategory::EXTERNAL_TOOL | PluginCategory::SPACE_OBJECT_SEARCH_ENGINE |
+                PluginCategory::CPF_DOWNLOAD_ENGINE);
 
     if (plugins_errors.hasError())
     {
@@ -1106,6 +1169,10 @@ void SpaceObjectsManagerMainWindowController::start()
         this->plugins_search_engines.push_back(qobject_cast<SpaceObjectSearchEngine*>(search_engine));
     }
 
+    for (const auto& cpf_engine : this->plugins.values(PluginCategory::CPF_DOWNLOAD_ENGINE))
+        this->plugins_cpf_engines.push_back(qobject_cast<CPFDownloadEngine*>(cpf_engine));
+    GuiLoader::setViewProperty(this->spaceobjects_view, "setSyncCPFsEnabled", !this->plugins_cpf_engines.isEmpty());
+
     this->loadExternalToolsActionsToView();
     this->slotLoadSpaceObjectsDataFile();
     this->slotLoadSpaceObjectsSetsFile();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <class_salaramainwindowcontroller.h>
+#include <class_spaceobjectsjournal.h>
 #include "class_spaceobjectsmanagermainwindowview.h"
 
 #include <QDateTime>
@@ -10,6 +11,7 @@ class SpaceObjectModel;
 class JsonTableSortFilterProxyModel;
 class SpaceObjectSet;
 class SpaceObjectSearchEngine;
+class CPFDownloadEngine;
 
 class SpaceObjectsManagerMainWindowController : public SalaraMainWindowController
 {
@@ -37,10 +39,11 @@ private slots:
     void slotSetCurrentSystemSet();
 
     void exportToCSV() const;
+    void syncCPFs() const;
 
 private:
 
-    void makeDataBackup() const;
+    void showBackupErrors(const SalaraInformation& errors) const;
     void loadSystemSet();
     void saveSets();
     void loadEnabledObjectsInSet(SpaceObjectSet *set);
@@ -62,6 +65,7 @@ private:
     QStringListModel* set_listmodel;
     QList<SpaceObjectSet*> list_sets;
     QList<SpaceObjectSearchEngine*> plugins_search_engines;
+    QList<CPFDownloadEngine*> plugins_cpf_engines;
 
     QString filedata_versionname;
     QString filedata_comment;
@@ -78,5 +82,7 @@ private:
     QDir dir_backup;
     bool backup_enabled;
     int max_backup_files;
+    int max_journal_records;
+    SpaceObjectsJournal journal;
 };
 
@@ -47,6 +47,11 @@ SpaceObjectsManagerMainWindowView::SpaceObjectsManagerMainWindowView(QWidget *pa
     this->export_csv_ = this->menu_export_->addAction("Export to CSV", this,
                                                       &SpaceObjectsManagerMainWindowView::signalExportToCSV);
 
+    // Enabled when a CPF download engine is loaded.
+    this->sync_cpfs_ = this->menu_data_->addAction("Download CPFs of enabled objects", this,
+                                                   &SpaceObjectsManagerMainWindowView::signalSyncCPFs);
+    this->sync_cpfs_->setEnabled(false);
+
     makeConnections();
 }
 
@@ -306,6 +311,11 @@ void SpaceObjectsManagerMainWindowView::setSaveSetsEnabled(bool enabled)
     this->m_ui->pb_saveset->setEnabled(enabled);
 }
 
+void SpaceObjectsManagerMainWindowView::setSyncCPFsEnabled(bool enabled)
+{
+    this->sync_cpfs_->setEnabled(enabled);
+}
+
 void SpaceObjectsManagerMainWindowView::setCurrentSystemSet(const QString &set_name)
 {
     this->m_ui->lb_current_set->setText(set_name);
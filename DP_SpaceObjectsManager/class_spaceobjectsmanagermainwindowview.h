@@ -57,6 +57,7 @@ public slots:
     void setEnabledNumber(int num);
     void setSaveObjectsEnabled(bool enabled);
     void setSaveSetsEnabled(bool enabled);
+    void setSyncCPFsEnabled(bool enabled);
     void setCurrentSystemSet(const QString& set_name);
     void setCurrentLoadedSet(const QString& set_name);
     void setNewSetEnabled(bool enabled);
@@ -89,6 +90,7 @@ signals:
     void signalSetFilter(FilterColumnType filter_column, FilterType filter_type);
 
     void signalExportToCSV();
+    void signalSyncCPFs();
 
 protected:
     void closeEvent(QCloseEvent* event) override;
@@ -104,6 +106,7 @@ private:
     QMenu* menu_data_;
     QMenu* menu_export_;
     QAction *export_csv_;
+    QAction *sync_cpfs_;
 
     void makeConnections();
 };
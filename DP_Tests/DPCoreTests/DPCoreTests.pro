@@ -0,0 +1,33 @@
+include ($$_PRO_FILE_PWD_/../DP_Tests.pri)
+include ($$_PRO_FILE_PWD_/../../DP_Dependencies.pri)
+
+TARGET = tst_dpcore
+
+QT += testlib widgets network
+CONFIG += c++17
+
+# The tests use the example files shipped with DP_Core and the dummy plugin of the DummyPlugin project.
+DEFINES += DP_EXAMPLES_DIR=\\\"$$DP_ROOT/DP_Core/resources/examples\\\"
+DEFINES += DP_TEST_PLUGINS_DIR=\\\"$$DP_DEPLOY/tests/plugins\\\"
+
+HEADERS += \
+    fakehttpserver.h \
+    testutils.h \
+    tst_cpfsync.h \
+    tst_curlmanager.h \
+    tst_globalutils.h \
+    tst_jsonstreamreader.h \
+    tst_passscheduler.h \
+    tst_spaceobjectfilemanager.h \
+    tst_spaceobjectsjournal.h
+
+SOURCES += \
+    fakehttpserver.cpp \
+    main.cpp \
+    tst_cpfsync.cpp \
+    tst_curlmanager.cpp \
+    tst_globalutils.cpp \
+    tst_jsonstreamreader.cpp \
+    tst_passscheduler.cpp \
+    tst_spaceobjectfilemanager.cpp \
+    tst_spaceobjectsjournal.cpp
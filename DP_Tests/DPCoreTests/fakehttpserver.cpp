@@ -0,0 +1,293 @@
+#include "fakehttpserver.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+
+#include <memory>
+
+namespace
+{
+
+const char* kHttpDateFormat = "ddd, dd MMM yyyy hh:mm:ss 'GMT'";
+
+QByteArray httpDate(const QDateTime& time)
+{
+    return QLocale::c().toString(time.toUTC(), kHttpDateFormat).toLatin1();
+}
+
+QDateTime fromHttpDate(const QByteArray& date)
+{
+    QDateTime time = QLocale::c().toDateTime(QString::fromLatin1(date), kHttpDateFormat);
+    time.setTimeSpec(Qt::UTC);
+    return time;
+}
+
+}
+
+FakeHttpServer::FakeHttpServer(const QString &root_dir) :
+    root(root_dir),
+    listen_port(0),
+    latency_ms(0),
+    ignore_range(false),
+    connection_count(0),
+    range_count(0),
+    not_modified_count(0)
+{
+    QObject::connect(this, &QTcpServer::newConnection, this, &FakeHttpServer::acceptConnections);
+}
+
+FakeHttpServer::~FakeHttpServer()
+{
+    // The server is closed in its thread and moved back, so it can be destroyed here.
+    if (this->thread.isRunning())
+    {
+        QThread* owner_thread = QCoreApplication::instance()->thread();
+        QMetaObject::invokeMethod(this, [this, owner_thread]
+        {
+            this->close();
+            for (auto socket : this->findChildren<QTcpSocket*>())
+                delete socket;
+            this->moveToThread(owner_thread);
+        }, Qt::BlockingQueuedConnection);
+        this->thread.quit();
+        this->thread.wait();
+    }
+}
+
+bool FakeHttpServer::start()
+{
+    this->thread.start();
+    this->moveToThread(&this->thread);
+
+    bool result = false;
+    QMetaObject::invokeMethod(this, [this, &result]
+    {
+        result = this->listen(QHostAddress::LocalHost);
+        this->listen_port = this->serverPort();
+    }, Qt::BlockingQueuedConnection);
+    return result;
+}
+
+QString FakeHttpServer::url(const QString &path) const
+{
+    return QString("http://127.0.0.1:%1/%2").arg(this->listen_port).arg(path);
+}
+
+void FakeHttpServer::setLatency(int latency_ms)
+{
+    QMutexLocker lock(&this->mutex);
+    this->latency_ms = latency_ms;
+}
+
+void FakeHttpServer::setIgnoreRange(bool ignore)
+{
+    QMutexLocker lock(&this->mutex);
+    this->ignore_range = ignore;
+}
+
+void FakeHttpServer::dropRequests(const QString &path, int count, DropMode mode)
+{
+    QMutexLocker lock(&this->mutex);
+    this->drops.insert(path, qMakePair(count, mode));
+}
+
+void FakeHttpServer::resetStatistics()
+{
+    QMutexLocker lock(&this->mutex);
+    this->connection_count = 0;
+    this->request_count.clear();
+    this->range_count = 0;
+    this->not_modified_count = 0;
+}
+
+int FakeHttpServer::connections() const
+{
+    QMutexLocker lock(&this->mutex);
+    return this->connection_count;
+}
+
+int FakeHttpServer::requests(const QString &path) const
+{
+    QMutexLocker lock(&this->mutex);
+    if (!path.isEmpty())
+        return this->request_count.value(path);
+
+    int total = 0;
+    for (int count : this->request_count)
+        total += count;
+    return total;
+}
+
+int FakeHttpServer::rangeRequests() const
+{
+    QMutexLocker lock(&this->mutex);
+    return this->range_count;
+}
+
+int FakeHttpServer::notModifiedResponses() const
+{
+    QMutexLocker lock(&this->mutex);
+    return this->not_modified_count;
+}
+
+void FakeHttpServer::acceptConnections()
+{
+    while (QTcpSocket* socket = this->nextPendingConnection())
+    {
+        {
+            QMutexLocker lock(&this->mutex);
+            this->connection_count++;
+        }
+
+        // Each connection keeps its own buffer, since the requests can arrive in several pieces.
+        auto buffer = std::make_shared<QByteArray>();
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket, buffer]
+        {
+            buffer->append(socket->readAll());
+
+            int end;
+            while ((end = buffer->indexOf("\r\n\r\n")) >= 0)
+            {
+                const QList<QByteArray> lines = buffer->left(end).split('\n');
+                buffer->remove(0, end + 4);
+
+                const QList<QByteArray> request_line = lines.first().trimmed().split(' ');
+                if (request_line.size() < 2)
+                {
+                    socket->abort();
+                    return;
+                }
+
+                QHash<QByteArray, QByteArray> headers;
+                for (int i = 1; i < lines.size(); i++)
+                {
+                    const int colon = lines[i].indexOf(':');
+                    if (colon > 0)
+                        headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+                }
+
+                const QByteArray path = request_line[1].split('?').first();
+                const bool head = "HEAD" == request_line[0];
+
+                int latency;
+                {
+                    QMutexLocker lock(&this->mutex);
+                    latency = this->latency_ms;
+                }
+                if (latency > 0)
+                    QTimer::singleShot(latency, socket, [this, socket, path, headers, head]
+                    {
+                        this->respond(socket, path, headers, head);
+                    });
+                else
+                    this->respond(socket, path, headers, head);
+            }
+        });
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void FakeHttpServer::respond(QTcpSocket *socket, const QByteArray &path, const QHash<QByteArray, QByteArray> &headers,
+                             bool head)
+{
+    const QString file_name = QUrl::fromPercentEncoding(path).mid(1);
+    QFile file(this->root.filePath(file_name));
+
+    QPair<int, DropMode> drop(0, DropMode::BEFORE_RESPONSE);
+    bool ignore;
+    {
+        QMutexLocker lock(&this->mutex);
+        this->request_count[file_name]++;
+        ignore = this->ignore_range;
+        auto it = this->drops.find(file_name);
+        if (it != this->drops.end() && it->first > 0)
+        {
+            drop = *it;
+            it->first--;
+        }
+    }
+
+    if (drop.first > 0 && DropMode::BEFORE_RESPONSE == drop.second)
+    {
+        socket->abort();
+        return;
+    }
+
+    if (file_name.isEmpty() || !file.open(QIODevice::ReadOnly))
+    {
+        socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        return;
+    }
+
+    const QByteArray content = file.readAll();
+    const QDateTime last_modified = QFileInfo(file).lastModified();
+    const QByteArray etag = '"' + QCryptographicHash::hash(content, QCryptographicHash::Md5).toHex() + '"';
+
+    QByteArray common_headers = "ETag: " + etag + "\r\nLast-Modified: " + httpDate(last_modified) +
+            "\r\nConnection: keep-alive\r\n";
+
+    // The ETag has precedence over the date, as in HTTP.
+    bool not_modified = false;
+    if (headers.contains("if-none-match"))
+        not_modified = headers.value("if-none-match") == etag;
+    else if (headers.contains("if-modified-since"))
+        not_modified = last_modified.toSecsSinceEpoch() <=
+                fromHttpDate(headers.value("if-modified-since")).toSecsSinceEpoch();
+
+    if (not_modified)
+    {
+        {
+            QMutexLocker lock(&this->mutex);
+            this->not_modified_count++;
+        }
+        socket->write("HTTP/1.1 304 Not Modified\r\n" + common_headers + "\r\n");
+        return;
+    }
+
+    // Only the ranges from an offset to the end are supported, which is what the resumed downloads request.
+    QByteArray status = "200 OK";
+    QByteArray body = content;
+    const QByteArray range = headers.value("range");
+    if (!ignore && range.startsWith("bytes=") && range.endsWith('-'))
+    {
+        {
+            QMutexLocker lock(&this->mutex);
+            this->range_count++;
+        }
+        const qint64 offset = range.mid(6, range.size() - 7).toLongLong();
+        if (offset >= content.size())
+        {
+            socket->write("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" +
+                          QByteArray::number(content.size()) + "\r\n" + common_headers + "Content-Length: 0\r\n\r\n");
+            return;
+        }
+        status = "206 Partial Content";
+        body = content.mid(static_cast<int>(offset));
+        common_headers += "Content-Range: bytes " + QByteArray::number(offset) + '-' +
+                QByteArray::number(content.size() - 1) + '/' + QByteArray::number(content.size()) + "\r\n";
+    }
+
+    socket->write("HTTP/1.1 " + status + "\r\n" + common_headers + "Content-Length: " +
+                  QByteArray::number(body.size()) + "\r\n\r\n");
+
+    // The answers to HEAD requests have the headers of the GET ones, without body.
+    if (head)
+        return;
+
+    if (drop.first > 0)
+    {
+        // The length announced is not reached, so the client gets a partial file.
+        socket->write(body.left(body.size() / 2));
+        socket->disconnectFromHost();
+        return;
+    }
+
+    socket->write(body);
+}
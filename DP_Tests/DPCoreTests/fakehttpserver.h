@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QTcpServer>
+#include <QThread>
+
+class QTcpSocket;
+
+// Minimal HTTP/1.1 server that serves the files of a directory, run in its own thread so the tests can block while
+// waiting for the transfers. It supports keep-alive connections, HEAD requests, byte range requests from an offset,
+// ETags and If-Modified-Since, and can inject latency and dropped connections.
+class FakeHttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+
+    enum class DropMode
+    {
+        BEFORE_RESPONSE,    // The connection is reset without sending anything.
+        MID_BODY            // The connection is closed after sending the headers and half the body.
+    };
+
+    explicit FakeHttpServer(const QString& root_dir);
+    ~FakeHttpServer() override;
+
+    bool start();
+    QString url(const QString& path) const;
+
+    // Fault injection.
+    void setLatency(int latency_ms);
+    void setIgnoreRange(bool ignore);
+    void dropRequests(const QString& path, int count, DropMode mode);
+
+    // Statistics.
+    void resetStatistics();
+    int connections() const;
+    int requests(const QString& path = QString()) const;
+    int rangeRequests() const;
+    int notModifiedResponses() const;
+
+private:
+    void acceptConnections();
+    void readRequests(QTcpSocket* socket);
+    void respond(QTcpSocket* socket, const QByteArray& path, const QHash<QByteArray, QByteArray>& headers, bool head);
+
+    QThread thread;
+    QDir root;
+    quint16 listen_port;
+
+    mutable QMutex mutex;
+    int latency_ms;
+    bool ignore_range;
+    QHash<QString, QPair<int, DropMode>> drops;
+    int connection_count;
+    QHash<QString, int> request_count;
+    int range_count;
+    int not_modified_count;
+};
@@ -0,0 +1,46 @@
+#include "tst_cpfsync.h"
+#include "tst_curlmanager.h"
+#include "tst_globalutils.h"
+#include "tst_jsonstreamreader.h"
+#include "tst_passscheduler.h"
+#include "tst_spaceobjectfilemanager.h"
+#include "tst_spaceobjectsjournal.h"
+
+#include <QCoreApplication>
+#include <QtTest>
+
+// Runs all the DP_Core test classes. The arguments are passed to each one, so a test function can be selected with
+// the usual QtTest options.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Child process of the journal crash test.
+    if (3 == argc && QString(argv[1]) == "--journal-writer")
+        return TestSpaceObjectsJournal::runWriter(argv[2]);
+
+    int status = 0;
+
+    TestSpaceObjectFileManager spaceobjectfilemanager;
+    status |= QTest::qExec(&spaceobjectfilemanager, argc, argv);
+
+    TestSpaceObjectsJournal spaceobjectsjournal;
+    status |= QTest::qExec(&spaceobjectsjournal, argc, argv);
+
+    TestGlobalUtils globalutils;
+    status |= QTest::qExec(&globalutils, argc, argv);
+
+    TestCurlManager curlmanager;
+    status |= QTest::qExec(&curlmanager, argc, argv);
+
+    TestCPFSync cpfsync;
+    status |= QTest::qExec(&cpfsync, argc, argv);
+
+    TestPassScheduler passscheduler;
+    status |= QTest::qExec(&passscheduler, argc, argv);
+
+    TestJsonStreamReader jsonstreamreader;
+    status |= QTest::qExec(&jsonstreamreader, argc, argv);
+
+    return status;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "class_spaceobjectfilemanager.h"
+#include "class_spaceobjectmodel.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+
+// Helpers shared by the DP_Core tests.
+namespace testutils
+{
+
+inline QString examplePath(const QString& filename)
+{
+    return QString(DP_EXAMPLES_DIR) + '/' + filename;
+}
+
+// Synthetic space object that passes the mandatory and unique checks of the space objects scheme. Some optional
+// values are left empty or zero, as in the real catalogues.
+inline QJsonObject makeSpaceObject(int i)
+{
+    return QJsonObject{
+        {"EnablementPolicy", 0 == i % 2 ? SpaceObject::ENABLED : SpaceObject::DISABLED},
+        {"NORAD", QString::number(10000 + i)},
+        {"Name", QString("OBJECT %1").arg(i)},
+        {"ILRSName", 0 == i % 3 ? QString("ilrs%1").arg(i) : QString()},
+        {"Abbreviation", QString("O%1").arg(i)},
+        {"COSPAR", QString("%1-%2A").arg(1960 + i % 60).arg(i, 5, 10, QChar('0'))},
+        {"ILRSID", QString()},
+        {"SIC", QString()},
+        {"Classification", QString()},
+        {"LaserRetroReflector", i % 3},
+        {"IsDebris", (i / 3) % 3},
+        {"TrackPolicy", 1},
+        {"Priority", 0},
+        {"ProviderCPF", "All"},
+        {"Altitude", 0 == i % 5 ? 0. : 300.5 + (i * 37) % 36000},
+        {"RadarCrossSection", 0 == i % 4 ? 0. : 0.0123456789 * i},
+        {"NormalPointIndicator", 30},
+        {"BinSize", 15},
+        {"Inclination", 0},
+        {"Amplification", 100},
+        {"LaserID", "EKSPLA_NL317SH"},
+        {"DetectorID", "ROA_SPAD"},
+        {"CounterID", "ROA_SR620"},
+        {"Picture", QString()}};
+}
+
+inline QJsonArray makeSpaceObjects(int count)
+{
+    QJsonArray objects;
+    for (int i = 0; i < count; i++)
+        objects.append(makeSpaceObject(i));
+    return objects;
+}
+
+// Loads the example scheme and the synthetic objects in the model. Returns false if the data is not valid.
+inline bool loadSpaceObjects(SpaceObjectModel& model, int count)
+{
+    if (SpaceObjectFileManager::loadSpaceObjectsScheme(examplePath("SP_SpaceObjectsScheme.json"), model).hasError())
+        return false;
+    return model.setJsonData(makeSpaceObjects(count)).isEmpty();
+}
+
+}
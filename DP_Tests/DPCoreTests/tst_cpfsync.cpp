@@ -0,0 +1,300 @@
+#include "tst_cpfsync.h"
+#include "testutils.h"
+
+#include "interface_cpfdownloadengine.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+#include <QtTest>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+
+namespace
+{
+
+const char* kPrefixes[] = {"ilrs0", "object1", "object2"};
+const QDate kFirstRelease(2026, 10, 1);
+const int kReleaseDays = 10;
+
+// Engine that serves the files of a directory, as a CPF server.
+class DirectoryCPFEngine : public CPFDownloadEngine
+{
+public:
+    // With max_downloads 0 the engine uses the default concurrency.
+    DirectoryCPFEngine(const QString& server_dir, int max_downloads = 0) :
+        CPFDownloadEngine(CPFDownloadEngine::NORMAL_ENGINE),
+        server(server_dir),
+        max_downloads(max_downloads)
+    {}
+
+    SalaraInformation listCPFs(QStringList& files) override
+    {
+        files = this->server.entryList(QDir::Files, QDir::Name);
+        return SalaraInformation();
+    }
+
+    SalaraInformation getCPF(const QString& file_name, const QString& dest_path) override
+    {
+        this->requests++;
+        const int active = ++this->active;
+        int max_active = this->max_active;
+        while (active > max_active && !this->max_active.compare_exchange_weak(max_active, active));
+
+        // Some latency, so the concurrent downloads overlap.
+        QThread::msleep(5);
+
+        SalaraInformation result;
+        if (this->failing.contains(file_name) ||
+                !QFile::copy(this->server.filePath(file_name), QDir(dest_path).filePath(file_name)))
+            result = SalaraInformation({ErrorEnum::DOWNLOAD_FAILED, ErrorEnumStringMap[ErrorEnum::DOWNLOAD_FAILED]},
+                                       file_name);
+        this->active--;
+        return result;
+    }
+
+    // The modification date of the server file, as the Last-Modified header of a HTTP server.
+    SalaraInformation remoteFileInfo(const QString& file_name, RemoteFileInfo& info) override
+    {
+        info = RemoteFileInfo();
+        if (this->with_metadata)
+            info.last_modified = QFileInfo(this->server.filePath(file_name)).lastModified();
+        return SalaraInformation();
+    }
+
+    int maxConcurrentDownloads() const override
+    {
+        return this->max_downloads > 0 ? this->max_downloads : CPFDownloadEngine::maxConcurrentDownloads();
+    }
+
+    bool with_metadata = true;
+    QSet<QString> failing;
+    std::atomic_int requests{0};
+    std::atomic_int max_active{0};
+
+private:
+    QDir server;
+    int max_downloads;
+    std::atomic_int active{0};
+};
+
+QByteArray fileContent(const QString& path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+bool writeContent(const QString& path, const QByteArray& content)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+}
+
+// Rewrites a server file, dated later than the previous version.
+bool republish(const QString& path, const QByteArray& content)
+{
+    const QDateTime previous = QFileInfo(path).lastModified();
+    QFile file(path);
+    return writeContent(path, content) && file.open(QIODevice::ReadWrite) &&
+           file.setFileTime(previous.addSecs(60), QFileDevice::FileModificationTime);
+}
+
+QStringList sorted(QStringList list)
+{
+    list.sort();
+    return list;
+}
+
+// Files of the destination directory, without the synchronization cache.
+QStringList localCPFs(const QString& dir)
+{
+    return QDir(dir).entryList({"*_cpf_*"}, QDir::Files, QDir::Name);
+}
+
+bool hasTemporaryDirs(const QString& dir)
+{
+    return !QDir(dir).entryList({".cpf_sync_*"}, QDir::Dirs | QDir::Hidden).isEmpty();
+}
+
+}
+
+void TestCPFSync::initTestCase()
+{
+    // Objects 0, 1 and 2 of the synthetic catalogue. Only the first one has an ILRS name.
+    QVERIFY(testutils::loadSpaceObjects(this->model, 3));
+    QVERIFY(this->server_dir.isValid());
+    QVERIFY(this->dest_dir.isValid());
+
+    for (const char* prefix : kPrefixes)
+        for (int i = 0; i < kReleaseDays; i++)
+        {
+            const QString name = QString("%1_cpf_%2_%3.hts").arg(prefix)
+                    .arg(kFirstRelease.addDays(i).toString("yyMMdd")).arg(7001 + i);
+            QVERIFY(writeContent(QDir(this->server_dir.path()).filePath(name), ("CPF " + name).toLatin1()));
+        }
+}
+
+void TestCPFSync::init()
+{
+    QDir dir(this->dest_dir.path());
+    QVERIFY(dir.removeRecursively());
+    QVERIFY(QDir().mkpath(dir.path()));
+}
+
+void TestCPFSync::syncDownloadsOnlyNewReleases()
+{
+    DirectoryCPFEngine engine(this->server_dir.path());
+    const QDate since = kFirstRelease.addDays(5);
+    const QStringList expected = this->serverFiles({"ilrs0", "object1"}, since);
+
+    const SpaceObjectsList objects = this->selectObjects({"ilrs0", "OBJECT 1"});
+    QCOMPARE(objects.size(), 2);
+
+    QStringList downloaded;
+    SalaraInformation result = engine.syncCPFs(objects, since.startOfDay(Qt::UTC), this->dest_dir.path(), downloaded);
+    QVERIFY(!result.hasError());
+    QCOMPARE(sorted(downloaded), expected);
+    QCOMPARE(localCPFs(this->dest_dir.path()), expected);
+    for (const auto& name : expected)
+        QCOMPARE(fileContent(QDir(this->dest_dir.path()).filePath(name)),
+                 fileContent(QDir(this->server_dir.path()).filePath(name)));
+    QCOMPARE(engine.requests.load(), expected.size());
+    QVERIFY(!hasTemporaryDirs(this->dest_dir.path()));
+
+    // Everything is up to date, so nothing is downloaded again.
+    result = engine.syncCPFs(objects, since.startOfDay(Qt::UTC), this->dest_dir.path(), downloaded);
+    QVERIFY(!result.hasError());
+    QVERIFY(downloaded.isEmpty());
+    QCOMPARE(engine.requests.load(), expected.size());
+}
+
+void TestCPFSync::emptyObjectListSyncsAll()
+{
+    DirectoryCPFEngine engine(this->server_dir.path());
+    QStringList downloaded;
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+    QCOMPARE(downloaded.size(), static_cast<int>(std::size(kPrefixes)) * kReleaseDays);
+}
+
+void TestCPFSync::changedLocalFilesAreReplaced()
+{
+    DirectoryCPFEngine engine(this->server_dir.path());
+    QStringList downloaded;
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+
+    // A local copy that doesn't match the cached checksum is downloaded again.
+    const QString name = downloaded.first();
+    const QString local_path = QDir(this->dest_dir.path()).filePath(name);
+    QVERIFY(writeContent(local_path, "CORRUPTED"));
+
+#ifdef Q_OS_UNIX
+    // The file is replaced with a rename, so a reader that opened the old version keeps reading it.
+    QFile reader(local_path);
+    QVERIFY(reader.open(QIODevice::ReadOnly));
+#endif
+
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+    QCOMPARE(downloaded, QStringList{name});
+    QCOMPARE(fileContent(local_path), fileContent(QDir(this->server_dir.path()).filePath(name)));
+
+#ifdef Q_OS_UNIX
+    QCOMPARE(reader.readAll(), QByteArray("CORRUPTED"));
+#endif
+}
+
+void TestCPFSync::republishedFilesAreReplaced()
+{
+    // Copy of a release in its own server, so the shared server files are not changed.
+    QTemporaryDir server_dir;
+    QVERIFY(server_dir.isValid());
+    const QString name = this->serverFiles({"ilrs0"}, kFirstRelease).first();
+    const QString server_path = QDir(server_dir.path()).filePath(name);
+    QVERIFY(QFile::copy(QDir(this->server_dir.path()).filePath(name), server_path));
+
+    DirectoryCPFEngine engine(server_dir.path());
+    QStringList downloaded;
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+    QCOMPARE(downloaded, QStringList{name});
+
+    // The local copy matches the cached checksum, but the server has a new version with the same name.
+    QVERIFY(republish(server_path, "CPF REPUBLISHED"));
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+    QCOMPARE(downloaded, QStringList{name});
+    QCOMPARE(fileContent(QDir(this->dest_dir.path()).filePath(name)), QByteArray("CPF REPUBLISHED"));
+
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+    QVERIFY(downloaded.isEmpty());
+
+    // Without remote metadata the new version can not be detected, so only the local copy is checked.
+    engine.with_metadata = false;
+    QVERIFY(republish(server_path, "CPF REPUBLISHED AGAIN"));
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+    QVERIFY(downloaded.isEmpty());
+    QCOMPARE(engine.requests.load(), 2);
+}
+
+void TestCPFSync::failedDownloadsKeepPreviousFile()
+{
+    DirectoryCPFEngine engine(this->server_dir.path());
+    QStringList downloaded;
+    QVERIFY(!engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded).hasError());
+
+    const QString name = downloaded.first();
+    const QString local_path = QDir(this->dest_dir.path()).filePath(name);
+    QVERIFY(writeContent(local_path, "PREVIOUS"));
+    engine.failing.insert(name);
+
+    SalaraInformation result = engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), downloaded);
+    QVERIFY(result.hasError());
+    QCOMPARE(result.getErrors().size(), 1);
+    QCOMPARE(result.getErrors().first().first, static_cast<int>(CPFDownloadEngine::DOWNLOAD_FAILED));
+    QVERIFY(downloaded.isEmpty());
+    QCOMPARE(fileContent(local_path), QByteArray("PREVIOUS"));
+    QVERIFY(!hasTemporaryDirs(this->dest_dir.path()));
+}
+
+void TestCPFSync::concurrentDownloadsMatchSerial()
+{
+    DirectoryCPFEngine serial_engine(this->server_dir.path(), 1);
+    QStringList serial_downloaded;
+    QVERIFY(!serial_engine.syncCPFs({}, QDateTime(), this->dest_dir.path(), serial_downloaded).hasError());
+    QCOMPARE(serial_engine.max_active.load(), 1);
+
+    QTemporaryDir concurrent_dir;
+    DirectoryCPFEngine concurrent_engine(this->server_dir.path());
+    QStringList concurrent_downloaded;
+    QVERIFY(!concurrent_engine.syncCPFs({}, QDateTime(), concurrent_dir.path(), concurrent_downloaded).hasError());
+    QVERIFY(concurrent_engine.max_active > 1 &&
+            concurrent_engine.max_active <= CPFDownloadEngine::kDefaultConcurrentDownloads);
+
+    QCOMPARE(sorted(concurrent_downloaded), sorted(serial_downloaded));
+    QCOMPARE(localCPFs(concurrent_dir.path()), localCPFs(this->dest_dir.path()));
+    for (const auto& name : localCPFs(this->dest_dir.path()))
+        QCOMPARE(fileContent(QDir(concurrent_dir.path()).filePath(name)),
+                 fileContent(QDir(this->dest_dir.path()).filePath(name)));
+}
+
+SpaceObjectsList TestCPFSync::selectObjects(const QStringList &names) const
+{
+    SpaceObjectsList objects;
+    for (const auto& object : this->model.getObjectsList())
+        if (names.contains(object->getPreferredName()))
+            objects.append(object);
+    return objects;
+}
+
+QStringList TestCPFSync::serverFiles(const QStringList &prefixes, const QDate &since) const
+{
+    QStringList files;
+    for (const auto& prefix : prefixes)
+        for (int i = 0; i < kReleaseDays; i++)
+            if (kFirstRelease.addDays(i) >= since)
+                files.append(QString("%1_cpf_%2_%3.hts").arg(prefix)
+                             .arg(kFirstRelease.addDays(i).toString("yyMMdd")).arg(7001 + i));
+    files.sort();
+    return files;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "class_spaceobjectmodel.h"
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class TestCPFSync : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void syncDownloadsOnlyNewReleases();
+    void emptyObjectListSyncsAll();
+    void changedLocalFilesAreReplaced();
+    void republishedFilesAreReplaced();
+    void failedDownloadsKeepPreviousFile();
+    void concurrentDownloadsMatchSerial();
+
+private:
+    SpaceObjectsList selectObjects(const QStringList& names) const;
+    QStringList serverFiles(const QStringList& prefixes, const QDate& since) const;
+
+    SpaceObjectModel model;
+    QTemporaryDir server_dir;
+    QTemporaryDir dest_dir;
+};
@@ -0,0 +1,278 @@
+#include "tst_curlmanager.h"
+#include "fakehttpserver.h"
+
+#include "class_curlmanagerfactory.h"
+#include "class_salarasettings.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QtTest>
+
+namespace
+{
+
+const int kFiles = 16;
+const int kFileSize = 256 * 1024;
+const int kLatencyMs = 20;
+const int kMaxTransfers = 4;
+const int kMaxHostConnections = 2;
+
+}
+
+void TestCurlManager::initTestCase()
+{
+    QVERIFY(this->config_dir.isValid());
+    QVERIFY(this->server_dir.isValid());
+    QVERIFY(this->download_dir.isValid());
+
+    // The manager reads the certificates path from the global configuration, which is not used by the HTTP tests.
+    if (!SalaraSettings::instance().getGlobalConfig())
+        SalaraSettings::instance().setGlobalConfig(this->config_dir.filePath("SP_GlobalConfig.ini"));
+
+    QRandomGenerator generator(37);
+    for (int i = 0; i < kFiles; i++)
+    {
+        QByteArray content(kFileSize, Qt::Uninitialized);
+        for (auto& byte : content)
+            byte = static_cast<char>(generator.bounded(256));
+        this->files.append(QString("file%1.dat").arg(i));
+        this->writeServerFile(this->files.last(), content);
+    }
+
+    // The manager is released with the factory.
+    this->manager = CurlManagerFactory::instance().createManager();
+    this->manager->setMaxConcurrentTransfers(kMaxTransfers);
+    this->manager->setMaxHostConnections(kMaxHostConnections);
+    QObject::connect(this->manager, &CurlManager::transferFinished, this,
+                     [this](int id, CurlManager::ResultCodes code, bool modified)
+    {
+        QMutexLocker lock(&this->results_mutex);
+        this->results.insert(id, {code, modified});
+    }, Qt::DirectConnection);
+}
+
+void TestCurlManager::init()
+{
+    // Each test uses a new server, so there are no open connections or pending faults from the previous ones.
+    this->server = new FakeHttpServer(this->server_dir.path());
+    QVERIFY(this->server->start());
+
+    QDir dir(this->download_dir.path());
+    QVERIFY(dir.removeRecursively());
+    QVERIFY(QDir().mkpath(dir.path()));
+}
+
+void TestCurlManager::cleanup()
+{
+    this->manager->cancelTransfers();
+    this->manager->waitForTransfers();
+    delete this->server;
+    this->server = nullptr;
+}
+
+void TestCurlManager::queuedDownloadsReuseConnections()
+{
+    this->server->setLatency(kLatencyMs);
+
+    const QList<Result> results = this->queueAndWait(this->files);
+    QCOMPARE(results.size(), kFiles);
+    for (int i = 0; i < kFiles; i++)
+    {
+        QCOMPARE(results[i].code, CurlManager::CODE_OK);
+        QVERIFY(results[i].modified);
+        QCOMPARE(this->downloadedFile(this->files[i]), this->serverFile(this->files[i]));
+        QVERIFY(!QFile::exists(this->download_dir.filePath(this->files[i] + ".part")));
+    }
+
+    // All the transfers go to the same host, so they share the allowed connections.
+    QCOMPARE(this->server->requests(), kFiles);
+    QVERIFY(this->server->connections() <= kMaxHostConnections);
+}
+
+void TestCurlManager::droppedConnectionsAreRetried()
+{
+    this->server->setLatency(kLatencyMs);
+    this->server->dropRequests(this->files[0], 2, FakeHttpServer::DropMode::BEFORE_RESPONSE);
+    this->server->dropRequests(this->files[1], 1, FakeHttpServer::DropMode::BEFORE_RESPONSE);
+
+    const QList<Result> results = this->queueAndWait(this->files.mid(0, 4));
+    for (int i = 0; i < results.size(); i++)
+    {
+        QCOMPARE(results[i].code, CurlManager::CODE_OK);
+        QCOMPARE(this->downloadedFile(this->files[i]), this->serverFile(this->files[i]));
+    }
+    QVERIFY(this->server->requests(this->files[0]) >= 3);
+    QVERIFY(this->server->requests(this->files[1]) >= 2);
+}
+
+void TestCurlManager::retriesAreLimited()
+{
+    CurlManager::TransferOptions options;
+    options.max_retries = 1;
+    this->server->dropRequests(this->files[0], 10, FakeHttpServer::DropMode::BEFORE_RESPONSE);
+
+    const QList<Result> results = this->queueAndWait({this->files[0]}, options);
+    QVERIFY(results.first().code != CurlManager::CODE_OK);
+    QVERIFY(!results.first().modified);
+    QVERIFY(!QFile::exists(this->download_dir.filePath(this->files[0])));
+}
+
+void TestCurlManager::interruptedDownloadsAreResumed()
+{
+    this->server->dropRequests(this->files[0], 1, FakeHttpServer::DropMode::MID_BODY);
+
+    const QList<Result> results = this->queueAndWait({this->files[0]});
+    QCOMPARE(results.first().code, CurlManager::CODE_OK);
+    QCOMPARE(this->downloadedFile(this->files[0]), this->serverFile(this->files[0]));
+
+    // The second request only asks for the missing part.
+    QCOMPARE(this->server->requests(this->files[0]), 2);
+    QCOMPARE(this->server->rangeRequests(), 1);
+}
+
+void TestCurlManager::ignoredRangeRestartsDownload()
+{
+    // A partial file that doesn't match the remote one. The server sends the whole file, which replaces it.
+    QFile part(this->download_dir.filePath(this->files[0] + ".part"));
+    QVERIFY(part.open(QIODevice::WriteOnly));
+    part.write(QByteArray(1000, 'X'));
+    part.close();
+    this->server->setIgnoreRange(true);
+
+    const QList<Result> results = this->queueAndWait({this->files[0]});
+    QCOMPARE(results.first().code, CurlManager::CODE_OK);
+    QCOMPARE(this->downloadedFile(this->files[0]), this->serverFile(this->files[0]));
+    QCOMPARE(this->server->rangeRequests(), 0);
+}
+
+void TestCurlManager::unmodifiedFilesAreSkipped()
+{
+    const QStringList files = this->files.mid(0, 4);
+
+    for (const auto& result : this->queueAndWait(files))
+        QVERIFY(CurlManager::CODE_OK == result.code && result.modified);
+
+    // Nothing changed, so the server only answers that the files were not modified.
+    for (const auto& result : this->queueAndWait(files))
+        QVERIFY(CurlManager::CODE_OK == result.code && !result.modified);
+    QCOMPARE(this->server->notModifiedResponses(), files.size());
+
+    // Only the changed file is downloaded again.
+    QByteArray content = this->serverFile(files[0]);
+    content[0] = static_cast<char>(content[0] + 1);
+    this->writeServerFile(files[0], content);
+
+    const QList<Result> results = this->queueAndWait(files);
+    QVERIFY(results[0].modified);
+    for (int i = 1; i < results.size(); i++)
+        QVERIFY(!results[i].modified);
+    QCOMPARE(this->downloadedFile(files[0]), content);
+}
+
+void TestCurlManager::remoteFileInfoDetectsChanges()
+{
+    const QString url = this->server->url(this->files[0]);
+    QByteArray etag;
+    QDateTime modified;
+    QCOMPARE(this->manager->remoteFileInfo(url, 0, etag, modified), CurlManager::CODE_OK);
+    QVERIFY(!etag.isEmpty());
+    QCOMPARE(modified.toSecsSinceEpoch(),
+             QFileInfo(this->server_dir.filePath(this->files[0])).lastModified().toSecsSinceEpoch());
+
+    // The same file gives the same values, and a new content with the same name gives new ones.
+    QByteArray same_etag;
+    QDateTime same_modified;
+    QCOMPARE(this->manager->remoteFileInfo(url, 0, same_etag, same_modified), CurlManager::CODE_OK);
+    QCOMPARE(same_etag, etag);
+    QCOMPARE(same_modified, modified);
+
+    QByteArray content = this->serverFile(this->files[0]);
+    content[0] = static_cast<char>(content[0] + 1);
+    this->writeServerFile(this->files[0], content);
+
+    QByteArray new_etag;
+    QDateTime new_modified;
+    QCOMPARE(this->manager->remoteFileInfo(url, 0, new_etag, new_modified), CurlManager::CODE_OK);
+    QVERIFY(new_etag != etag);
+    QVERIFY(new_modified > modified);
+
+    // Missing files are reported as HTTP errors.
+    QCOMPARE(this->manager->remoteFileInfo(this->server->url("missing.dat"), 0, new_etag, new_modified),
+             CurlManager::CODE_HTTP_RETURNED_ERROR);
+    QVERIFY(new_etag.isEmpty() && !new_modified.isValid());
+}
+
+void TestCurlManager::cancelledTransfersKeepDestination()
+{
+    QCOMPARE(this->queueAndWait({this->files[0]}).first().code, CurlManager::CODE_OK);
+    const QByteArray previous = this->downloadedFile(this->files[0]);
+
+    // The server takes longer than the test to answer, so the transfers are running or queued when cancelled.
+    CurlManager::TransferOptions options;
+    options.conditional = false;
+    this->server->setLatency(5000);
+    const QList<int> ids = this->queue(this->files, options);
+    QThread::msleep(200);
+    this->manager->cancelTransfers();
+    this->manager->waitForTransfers();
+
+    for (const auto& result : this->takeResults(ids))
+        QCOMPARE(result.code, CurlManager::CODE_ABORTED_BY_CALLBACK);
+    QCOMPARE(this->downloadedFile(this->files[0]), previous);
+    for (int i = 1; i < kFiles; i++)
+        QVERIFY(!QFile::exists(this->download_dir.filePath(this->files[i])));
+}
+
+QList<int> TestCurlManager::queue(const QStringList &files, const CurlManager::TransferOptions &options)
+{
+    QList<int> ids;
+    for (const auto& file : files)
+        ids.append(this->manager->queueDownload(this->server->url(file), 0, this->download_dir.filePath(file),
+                                                options));
+    return ids;
+}
+
+QList<TestCurlManager::Result> TestCurlManager::queueAndWait(const QStringList &files,
+                                                             const CurlManager::TransferOptions &options)
+{
+    const QList<int> ids = this->queue(files, options);
+    this->manager->waitForTransfers();
+    return this->takeResults(ids);
+}
+
+QList<TestCurlManager::Result> TestCurlManager::takeResults(const QList<int> &ids)
+{
+    // The transfers that were not reported keep the default result, which is not valid.
+    QMutexLocker lock(&this->results_mutex);
+    QList<Result> results;
+    for (int id : ids)
+        results.append(this->results.take(id));
+    return results;
+}
+
+void TestCurlManager::writeServerFile(const QString &name, const QByteArray &content)
+{
+    QFile file(this->server_dir.filePath(name));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+    file.close();
+
+    // The dates of the server have a resolution of seconds, so the changes are dated later than the previous ones.
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.setFileTime(QDateTime::currentDateTime().addSecs(2), QFileDevice::FileModificationTime);
+}
+
+QByteArray TestCurlManager::serverFile(const QString &name) const
+{
+    QFile file(this->server_dir.filePath(name));
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+QByteArray TestCurlManager::downloadedFile(const QString &name) const
+{
+    QFile file(this->download_dir.filePath(name));
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
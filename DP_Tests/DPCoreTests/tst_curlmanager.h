@@ -0,0 +1,55 @@
+#pragma once
+
+#include "class_curlmanager.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QTemporaryDir>
+
+class FakeHttpServer;
+
+class TestCurlManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result
+    {
+        CurlManager::ResultCodes code = CurlManager::CODE_END;
+        bool modified = false;
+    };
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void queuedDownloadsReuseConnections();
+    void droppedConnectionsAreRetried();
+    void retriesAreLimited();
+    void interruptedDownloadsAreResumed();
+    void ignoredRangeRestartsDownload();
+    void unmodifiedFilesAreSkipped();
+    void remoteFileInfoDetectsChanges();
+    void cancelledTransfersKeepDestination();
+
+private:
+    QList<int> queue(const QStringList& files,
+                     const CurlManager::TransferOptions& options = CurlManager::TransferOptions());
+    QList<Result> queueAndWait(const QStringList& files,
+                               const CurlManager::TransferOptions& options = CurlManager::TransferOptions());
+    QList<Result> takeResults(const QList<int>& ids);
+    void writeServerFile(const QString& name, const QByteArray& content);
+    QByteArray serverFile(const QString& name) const;
+    QByteArray downloadedFile(const QString& name) const;
+
+    QStringList files;
+    QTemporaryDir config_dir;
+    QTemporaryDir server_dir;
+    QTemporaryDir download_dir;
+    FakeHttpServer* server = nullptr;
+    CurlManager* manager = nullptr;
+    QMutex results_mutex;
+    QHash<int, Result> results;
+};
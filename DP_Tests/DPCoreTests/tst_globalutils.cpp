@@ -0,0 +1,122 @@
+#include "tst_globalutils.h"
+
+#include "class_globalutils.h"
+#include "global_texts.h"
+
+#include <QDir>
+#include <QFile>
+#include <QLibrary>
+#include <QtTest>
+
+namespace
+{
+
+// The copies of the dummy plugin are spread over some subdirs, as the plugins of the applications.
+const int kPluginDirs = 10;
+const int kPluginsPerDir = 30;
+const char* kManifestFilename = "SP_PluginsManifest.json";
+
+int countInfos(const SalaraInformation& result, const QString& text)
+{
+    int count = 0;
+    for (const auto& error : result.getErrors())
+        count += error.second.contains(text);
+    return count;
+}
+
+}
+
+void TestGlobalUtils::initTestCase()
+{
+    // The dummy plugin is built by the DummyPlugin project.
+    const QDir built_dir(DP_TEST_PLUGINS_DIR);
+    for (const auto& file : built_dir.entryList(QDir::Files))
+        if (QLibrary::isLibrary(file))
+            this->plugin_path = built_dir.filePath(file);
+    QVERIFY2(!this->plugin_path.isEmpty(), "The dummy plugin is not built.");
+    QVERIFY(this->plugins_dir.isValid());
+}
+
+void TestGlobalUtils::init()
+{
+    // A few hundred copies of the plugin, with the same name and version, and no manifest.
+    QDir dir(this->plugins_dir.path());
+    QVERIFY(dir.removeRecursively());
+    QVERIFY(QDir().mkpath(dir.path()));
+    const QString suffix = QFileInfo(this->plugin_path).suffix();
+    for (int i = 0; i < kPluginDirs; i++)
+    {
+        const QString subdir = QString("dir%1").arg(i);
+        QVERIFY(dir.mkpath(subdir));
+        for (int j = 0; j < kPluginsPerDir; j++)
+        {
+            const QString copy_path = dir.filePath(QString("%1/dummy%2.%3").arg(subdir).arg(j).arg(suffix));
+            QVERIFY(QFile::copy(this->plugin_path, copy_path));
+        }
+    }
+}
+
+void TestGlobalUtils::discoverySkipsUnrequestedCategories()
+{
+    PluginsMultiMap plugins;
+    SalaraInformation result = GlobalUtils::loadPlugins(QDir(this->plugins_dir.path()), PluginCategory::EXTERNAL_TOOL,
+                                                        plugins, true);
+    QVERIFY(!result.hasError());
+    QVERIFY(plugins.isEmpty());
+    QVERIFY(QFile::exists(QDir(this->plugins_dir.path()).filePath(kManifestFilename)));
+}
+
+void TestGlobalUtils::discoveryLoadsEachNameAndVersionOnce()
+{
+    PluginsMultiMap plugins;
+    SalaraInformation result = GlobalUtils::loadPlugins(QDir(this->plugins_dir.path()), PluginCategory::TLE_PROPAGATOR,
+                                                        plugins, true);
+    QCOMPARE(plugins.size(), 1);
+    QCOMPARE(plugins.first()->getPluginName(), QString("Dummy Test Plugin"));
+    QCOMPARE(countInfos(result, TEXT_ERROR_PLUGIN_ALREADY_LOADED), kPluginDirs * kPluginsPerDir - 1);
+}
+
+void TestGlobalUtils::discoveryRereadsChangedFiles()
+{
+    PluginsMultiMap plugins;
+    QDir dir(this->plugins_dir.path());
+    GlobalUtils::loadPlugins(dir, PluginCategory::EXTERNAL_TOOL, plugins, true);
+
+    // Replace a plugin with a file that is not a library. The manifest entry is not valid anymore, so the file is
+    // read again and reported.
+    const QString replaced = dir.filePath(QString("dir0/dummy0.%1").arg(QFileInfo(this->plugin_path).suffix()));
+    QVERIFY(QFile::remove(replaced));
+    QFile file(replaced);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("not a plugin");
+    file.close();
+
+    SalaraInformation result = GlobalUtils::loadPlugins(dir, PluginCategory::EXTERNAL_TOOL, plugins, true);
+    QVERIFY(plugins.isEmpty());
+    QCOMPARE(result.getErrors().size(), 1);
+}
+
+void TestGlobalUtils::discoveryBenchmark_data()
+{
+    QTest::addColumn<bool>("warm");
+    QTest::newRow("cold (no manifest)") << false;
+    QTest::newRow("warm (manifest)") << true;
+}
+
+void TestGlobalUtils::discoveryBenchmark()
+{
+    QFETCH(bool, warm);
+
+    QDir dir(this->plugins_dir.path());
+    PluginsMultiMap plugins;
+    if (warm)
+        GlobalUtils::loadPlugins(dir, PluginCategory::EXTERNAL_TOOL, plugins, true);
+
+    QBENCHMARK
+    {
+        if (!warm)
+            dir.remove(kManifestFilename);
+        GlobalUtils::loadPlugins(dir, PluginCategory::EXTERNAL_TOOL, plugins, true);
+    }
+    QVERIFY(plugins.isEmpty());
+}
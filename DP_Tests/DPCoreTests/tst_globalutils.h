@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class TestGlobalUtils : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void discoverySkipsUnrequestedCategories();
+    void discoveryLoadsEachNameAndVersionOnce();
+    void discoveryRereadsChangedFiles();
+    void discoveryBenchmark_data();
+    void discoveryBenchmark();
+
+private:
+    QTemporaryDir plugins_dir;
+    QString plugin_path;
+};
@@ -0,0 +1,137 @@
+#include "tst_jsonstreamreader.h"
+
+#include "class_jsonstreamreader.h"
+
+#include <QtTest>
+
+#include <clocale>
+#include <string>
+
+namespace
+{
+
+// Locales with comma as decimal separator. Not all of them are installed everywhere.
+const char* kCommaLocales[] = {"de_DE.UTF-8", "de_DE.utf8", "es_ES.UTF-8", "es_ES.utf8", "fr_FR.UTF-8", "de_DE"};
+
+// Reads the value of the key of a single key object.
+bool readSingleValue(JsonStreamReader& reader)
+{
+    return JsonStreamReader::Token::BEGIN_OBJECT == reader.next() && reader.nextKey() &&
+           JsonStreamReader::Token::INVALID != reader.next();
+}
+
+}
+
+void TestJsonStreamReader::readsNumbersWithCommaLocale()
+{
+    const std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+    const char* comma_locale = nullptr;
+    for (const char* name : kCommaLocales)
+        if (std::setlocale(LC_NUMERIC, name) && ',' == *std::localeconv()->decimal_point)
+        {
+            comma_locale = name;
+            break;
+        }
+    if (!comma_locale)
+    {
+        std::setlocale(LC_NUMERIC, previous.c_str());
+        QSKIP("No locale with comma decimal separator is installed.");
+    }
+
+    const std::string json = R"({"values": [1.5, -2.25e-3, "60235.123456789012"]})";
+    JsonStreamReader reader(json.data(), json.size());
+    bool ok = false;
+    double first = 0., second = 0.;
+    long double time = 0.L;
+    if (readSingleValue(reader) && reader.nextElement())
+    {
+        first = reader.toDouble(0., &ok);
+        if (ok && reader.nextElement())
+            second = reader.toDouble(0., &ok);
+        if (ok && reader.nextElement())
+            time = reader.toLongDouble(0.L, &ok);
+    }
+    std::setlocale(LC_NUMERIC, previous.c_str());
+
+    QVERIFY(ok);
+    QCOMPARE(first, 1.5);
+    QCOMPARE(second, -2.25e-3);
+    QVERIFY(qAbs(time - 60235.123456789012L) < 1e-9L);
+}
+
+void TestJsonStreamReader::rejectsMalformedNumbers_data()
+{
+    QTest::addColumn<QByteArray>("number");
+
+    QTest::newRow("two points") << QByteArray("1.2.3");
+    QTest::newRow("double sign") << QByteArray("--1");
+    QTest::newRow("leading zero") << QByteArray("01");
+    QTest::newRow("plus sign") << QByteArray("+1");
+    QTest::newRow("no fraction digits") << QByteArray("1.");
+    QTest::newRow("no exponent digits") << QByteArray("1e+");
+    QTest::newRow("sign only") << QByteArray("-");
+    QTest::newRow("sign inside") << QByteArray("1-2");
+}
+
+void TestJsonStreamReader::rejectsMalformedNumbers()
+{
+    QFETCH(QByteArray, number);
+
+    // A malformed number makes the document invalid, instead of being read as the default value.
+    const QByteArray json = "{\"value\": " + number + "}";
+    JsonStreamReader reader(json.constData(), static_cast<std::size_t>(json.size()));
+    QVERIFY(JsonStreamReader::Token::BEGIN_OBJECT == reader.next());
+    QVERIFY(reader.nextKey());
+    QVERIFY(JsonStreamReader::Token::INVALID == reader.next());
+    QVERIFY(reader.hasError());
+
+    bool ok = true;
+    QCOMPARE(reader.toDouble(-1., &ok), -1.);
+    QVERIFY(!ok);
+
+    // Malformed times stored as strings are reported by the conversion.
+    const QByteArray time_json = "{\"time\": \"" + number + "\"}";
+    JsonStreamReader time_reader(time_json.constData(), static_cast<std::size_t>(time_json.size()));
+    QVERIFY(readSingleValue(time_reader));
+    ok = true;
+    QVERIFY(-1.L == time_reader.toLongDouble(-1.L, &ok));
+    QVERIFY(!ok);
+}
+
+void TestJsonStreamReader::reportsConversionFailures()
+{
+    const std::string json = R"({"values": [12, 2.5e2, "text", true]})";
+    JsonStreamReader reader(json.data(), json.size());
+    QVERIFY(readSingleValue(reader));
+    bool ok = false;
+
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.toInteger(-1, &ok), 12LL);
+    QVERIFY(ok);
+    reader.toBool(false, &ok);
+    QVERIFY(!ok);
+
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.toInteger(-1, &ok), 250LL);
+    QVERIFY(ok);
+    QCOMPARE(reader.toDouble(-1., &ok), 250.);
+    QVERIFY(ok);
+
+    // A string that is not a number.
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.toString(QString(), &ok), QString("text"));
+    QVERIFY(ok);
+    QCOMPARE(reader.toDouble(-1., &ok), -1.);
+    QVERIFY(!ok);
+    QVERIFY(-1.L == reader.toLongDouble(-1.L, &ok));
+    QVERIFY(!ok);
+
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.toBool(false, &ok), true);
+    QVERIFY(ok);
+    QCOMPARE(reader.toInteger(-1, &ok), -1LL);
+    QVERIFY(!ok);
+
+    QVERIFY(!reader.nextElement());
+    QVERIFY(!reader.hasError());
+}
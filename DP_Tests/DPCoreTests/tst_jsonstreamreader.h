@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QObject>
+
+class TestJsonStreamReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsNumbersWithCommaLocale();
+    void rejectsMalformedNumbers_data();
+    void rejectsMalformedNumbers();
+    void reportsConversionFailures();
+};
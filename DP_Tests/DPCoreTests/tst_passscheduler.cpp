@@ -0,0 +1,295 @@
+#include "tst_passscheduler.h"
+#include "testutils.h"
+
+#include "class_globalutils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QtTest>
+
+#include <sgp4.h>
+
+namespace
+{
+
+const int kObjects = 200;
+const unsigned kMinElevation = 10;
+
+// The CPFs cover 2023-10-18 with a 2 minutes step. The schedule window leaves an hour at each side.
+const long double kCPFStartJD = 2460235.5L;
+const unsigned kCPFStep = 120;
+const QDateTime kWindowStart(QDate(2023, 10, 18), QTime(1, 0), Qt::UTC);
+const QDateTime kWindowEnd(QDate(2023, 10, 18), QTime(23, 0), Qt::UTC);
+
+// San Fernando (SFEL, 7824).
+const dpslr::geo::frames::GeodeticPoint<long double> kStationGeodetic(
+        36.46525L, -6.20548L, 98.177L, dpslr::geo::meas::Angle<long double>::Unit::DEGREES);
+const dpslr::geo::frames::GeocentricPoint<long double> kStationGeocentric(5105473.885L, -555110.526L, 3769892.958L);
+
+QString cpfName(int i)
+{
+    return QString("object%1_cpf_231018_00001.tle").arg(i);
+}
+
+// The passes of each object (by NORAD) calculated one after the other, as the schedule did before.
+QMap<QString, std::vector<dpslr::cpfutils::Pass>> serialPasses(const QList<CPFSelected>& cpf_list)
+{
+    int mjd_start, mjd_end;
+    double sod_start, sod_end;
+    GlobalUtils::datetimeToModifiedJulianDate(kWindowStart, mjd_start, sod_start);
+    GlobalUtils::datetimeToModifiedJulianDate(kWindowEnd, mjd_end, sod_end);
+
+    QMap<QString, std::vector<dpslr::cpfutils::Pass>> passes;
+    for (const auto& selected : cpf_list)
+    {
+        dpslr::cpfutils::PassCalculator calculator(*selected.cpf, kStationGeodetic, kStationGeocentric,
+                                                   kMinElevation);
+        calculator.setSearchMode(dpslr::cpfutils::PassCalculator::SearchMode::ADAPTIVE, true);
+        auto& object_passes = passes[selected.space_object->getNorad()];
+        if (dpslr::cpfutils::PassCalculator::ResultCodes::NOT_ERROR !=
+                calculator.getPasses(mjd_start, sod_start, mjd_end, sod_end, object_passes))
+            passes.remove(selected.space_object->getNorad());
+    }
+    return passes;
+}
+
+bool sameStep(const dpslr::cpfutils::Pass::Step& a, const dpslr::cpfutils::Pass::Step& b)
+{
+    return a.mjd == b.mjd && a.fract_day == b.fract_day && a.azim == b.azim && a.elev == b.elev;
+}
+
+// The schedule must have exactly the serial passes, since each object is calculated with the same call.
+void compareWithSerial(const QList<ScheduledPass>& schedule, const QList<CPFSelected>& cpf_list)
+{
+    const QMap<QString, std::vector<dpslr::cpfutils::Pass>> serial = serialPasses(cpf_list);
+    QCOMPARE(serial.size(), cpf_list.size());
+
+    QMap<QString, QList<const ScheduledPass*>> scheduled;
+    for (const auto& pass : schedule)
+        scheduled[pass.space_object->getNorad()].append(&pass);
+
+    int total = 0;
+    for (auto it = serial.cbegin(); it != serial.cend(); ++it)
+    {
+        const QList<const ScheduledPass*> object_passes = scheduled.value(it.key());
+        QCOMPARE(static_cast<std::size_t>(object_passes.size()), it->size());
+        for (int i = 0; i < object_passes.size(); i++)
+        {
+            const dpslr::cpfutils::Pass& expected = it->at(static_cast<std::size_t>(i));
+            const dpslr::cpfutils::Pass& actual = object_passes[i]->pass;
+            QVERIFY(sameStep(actual.start, expected.start));
+            QVERIFY(sameStep(actual.culmination, expected.culmination));
+            QVERIFY(sameStep(actual.end, expected.end));
+            QCOMPARE(actual.steps.size(), expected.steps.size());
+            QCOMPARE(object_passes[i]->max_elevation, expected.culmination.elev);
+        }
+        total += object_passes.size();
+    }
+    QCOMPARE(schedule.size(), total);
+}
+
+}
+
+void TestPassScheduler::initTestCase()
+{
+    QVERIFY(this->cpf_dir.isValid());
+
+    for (int i = 0; i < kObjects; i++)
+    {
+        QVERIFY(this->writeCPF(i, (i * 7.3) - 360. * static_cast<int>(i * 7.3 / 360.)));
+        this->objects.append(std::make_shared<SpaceObject>(testutils::makeSpaceObject(i), QStringList()));
+    }
+}
+
+void TestPassScheduler::generatedCPFsAreLoaded()
+{
+    // The CPFs generated from the TLEs pass the validation of the CPF file manager, both as single files and as
+    // releases of a stitched CPF.
+    QTemporaryDir stitched_dir;
+    QVERIFY(stitched_dir.isValid());
+    QVERIFY(QDir(stitched_dir.path()).mkdir(kWindowEnd.date().toString("yyyyMMdd")));
+
+    for (int i : {0, 1, kObjects - 1})
+    {
+        const SpaceObject& object = *this->objects[i];
+        std::shared_ptr<CPF> cpf;
+        double t_days, c_days, r_days;
+        const SalaraInformation errors = CPFFileManager::loadSingleCPF(
+                    this->cpf_dir.path(), object, kWindowStart, kWindowEnd, CPFFileManager::MOST_CURRENT,
+                    CPFFileManager::ALL, CPFFileManager::NO_FORCE, CPFFileManager::NORMAL_PRIORITY, cpf, t_days,
+                    c_days, r_days);
+        QVERIFY(!errors.hasError());
+        QVERIFY(cpf);
+        QCOMPARE(QString::fromStdString(cpf->getHeader().basicInfo2Header()->norad), object.getNorad());
+        QVERIFY(cpf->getHeader().basicInfo2Header()->tiv_compatible);
+
+        QVERIFY(QFile::copy(this->cpf_dir.filePath(cpfName(i)), stitched_dir.filePath(
+                                kWindowEnd.date().toString("yyyyMMdd") + '/' + cpfName(i))));
+        std::shared_ptr<CPF> stitched;
+        QVERIFY(!CPFFileManager::loadStitchedCPF(stitched_dir.path(), object, kWindowStart, kWindowEnd,
+                                                 CPFFileManager::ALL, CPFFileManager::NORMAL_PRIORITY,
+                                                 stitched).hasError());
+        QVERIFY(stitched);
+        const CPF full(this->cpf_dir.filePath(cpfName(i)).toStdString(), CPF::OpenOptionEnum::ALL_DATA);
+        QCOMPARE(stitched->getData().positionRecords().size(), full.getData().positionRecords().size());
+    }
+}
+
+void TestPassScheduler::scheduleMatchesSerialPasses()
+{
+    const QList<CPFSelected> cpf_list = this->loadCPFs();
+    QCOMPARE(cpf_list.size(), kObjects);
+
+    PassScheduler scheduler(kStationGeodetic, kStationGeocentric, kMinElevation);
+    QList<ScheduledPass> schedule;
+    QVERIFY(!scheduler.computeSchedule(cpf_list, kWindowStart, kWindowEnd, schedule).hasError());
+    QCOMPARE(scheduler.recomputedObjects().size(), kObjects);
+    QVERIFY(schedule.size() > kObjects);
+
+    compareWithSerial(schedule, cpf_list);
+}
+
+void TestPassScheduler::scheduleIsSortedWithOverlaps()
+{
+    PassScheduler scheduler(kStationGeodetic, kStationGeocentric, kMinElevation);
+    QList<ScheduledPass> schedule;
+    QVERIFY(!scheduler.computeSchedule(this->loadCPFs(), kWindowStart, kWindowEnd, schedule).hasError());
+
+    for (int i = 0; i < schedule.size(); i++)
+    {
+        QVERIFY(schedule[i].start >= kWindowStart && schedule[i].end <= kWindowEnd);
+        QVERIFY(schedule[i].start <= schedule[i].culmination && schedule[i].culmination <= schedule[i].end);
+        if (i > 0)
+            QVERIFY(schedule[i - 1].start <= schedule[i].start);
+
+        // The overlaps are symmetric and only list the passes that share time with this one.
+        for (int j = 0; j < schedule.size(); j++)
+        {
+            const bool overlap = i != j && schedule[i].start < schedule[j].end && schedule[j].start < schedule[i].end;
+            QCOMPARE(schedule[i].overlaps.contains(j), overlap);
+        }
+    }
+}
+
+void TestPassScheduler::cachedObjectsAreNotRecalculated()
+{
+    PassScheduler scheduler(kStationGeodetic, kStationGeocentric, kMinElevation);
+    QList<ScheduledPass> first, second;
+    QVERIFY(!scheduler.computeSchedule(this->loadCPFs(), kWindowStart, kWindowEnd, first).hasError());
+
+    // Loading the same files again doesn't change their identity.
+    const QList<CPFSelected> cpf_list = this->loadCPFs();
+    QVERIFY(!scheduler.computeSchedule(cpf_list, kWindowStart, kWindowEnd, second).hasError());
+    QVERIFY(scheduler.recomputedObjects().isEmpty());
+    QCOMPARE(second.size(), first.size());
+    compareWithSerial(second, cpf_list);
+
+    // A different window recalculates everything.
+    QVERIFY(!scheduler.computeSchedule(cpf_list, kWindowStart.addSecs(3600), kWindowEnd, second).hasError());
+    QCOMPARE(scheduler.recomputedObjects().size(), kObjects);
+}
+
+void TestPassScheduler::newReleasesAreRecalculated()
+{
+    PassScheduler scheduler(kStationGeodetic, kStationGeocentric, kMinElevation);
+    QList<ScheduledPass> schedule;
+    QVERIFY(!scheduler.computeSchedule(this->loadCPFs(), kWindowStart, kWindowEnd, schedule).hasError());
+
+    // New release of one of the CPFs, with a different orbit.
+    const int changed = 42;
+    QVERIFY(this->writeCPF(changed, 200.));
+
+    const QList<CPFSelected> cpf_list = this->loadCPFs();
+    QVERIFY(!scheduler.computeSchedule(cpf_list, kWindowStart, kWindowEnd, schedule).hasError());
+    QCOMPARE(scheduler.recomputedObjects(), QStringList{this->objects[changed]->getPreferredName()});
+    compareWithSerial(schedule, cpf_list);
+}
+
+void TestPassScheduler::stitchedReleasesAreRecalculated()
+{
+    // The stitched CPFs have no file, so a new release merged into them must also be detected.
+    QTemporaryDir stitched_dir;
+    QVERIFY(stitched_dir.isValid());
+    const QString date_folder = kWindowEnd.date().toString("yyyyMMdd");
+    QVERIFY(QDir(stitched_dir.path()).mkdir(date_folder));
+
+    const QList<int> stitched_objects = {3, 4, 5};
+    auto loadStitched = [&]()
+    {
+        QList<CPFSelected> cpf_list;
+        for (int i : stitched_objects)
+        {
+            std::shared_ptr<CPF> cpf;
+            if (!CPFFileManager::loadStitchedCPF(stitched_dir.path(), *this->objects[i], kWindowStart, kWindowEnd,
+                                                 CPFFileManager::ALL, CPFFileManager::NORMAL_PRIORITY,
+                                                 cpf).hasError())
+                cpf_list.append(CPFSelected(this->objects[i], cpf, 1., 1., 1.));
+        }
+        return cpf_list;
+    };
+
+    for (int i : stitched_objects)
+        QVERIFY(QFile::copy(this->cpf_dir.filePath(cpfName(i)),
+                            stitched_dir.filePath(date_folder + '/' + cpfName(i))));
+
+    PassScheduler scheduler(kStationGeodetic, kStationGeocentric, kMinElevation);
+    QList<ScheduledPass> schedule;
+    QList<CPFSelected> cpf_list = loadStitched();
+    QCOMPARE(cpf_list.size(), stitched_objects.size());
+    QVERIFY(!scheduler.computeSchedule(cpf_list, kWindowStart, kWindowEnd, schedule).hasError());
+    QCOMPARE(scheduler.recomputedObjects().size(), stitched_objects.size());
+
+    // Stitching the same releases again keeps the cached passes.
+    QVERIFY(!scheduler.computeSchedule(loadStitched(), kWindowStart, kWindowEnd, schedule).hasError());
+    QVERIFY(scheduler.recomputedObjects().isEmpty());
+
+    // New release of one of the objects, with a different orbit.
+    const int changed = stitched_objects[1];
+    const QString release_path = stitched_dir.filePath(date_folder + '/' + cpfName(changed));
+    QVERIFY(this->writeCPF(changed, 100.));
+    QVERIFY(QFile::remove(release_path));
+    QVERIFY(QFile::copy(this->cpf_dir.filePath(cpfName(changed)), release_path));
+
+    cpf_list = loadStitched();
+    QCOMPARE(cpf_list.size(), stitched_objects.size());
+    QVERIFY(!scheduler.computeSchedule(cpf_list, kWindowStart, kWindowEnd, schedule).hasError());
+    QCOMPARE(scheduler.recomputedObjects(), QStringList{this->objects[changed]->getPreferredName()});
+    compareWithSerial(schedule, cpf_list);
+}
+
+bool TestPassScheduler::writeCPF(int i, double raan)
+{
+    // Low orbits with different inclinations and planes, so the passes are spread over the day.
+    char line1[80], line2[80];
+    const int norad = 10000 + i;
+    std::snprintf(line1, sizeof(line1),
+                  "1 %05dU 23001A   23290.50000000  .00000000  00000-0  00000-0 0  9990", norad);
+    std::snprintf(line2, sizeof(line2), "2 %05d %8.4f %8.4f %07d %8.4f %8.4f %11.8f%5d0", norad, 50. + (i % 60),
+                  raan, 1000 + (i % 50) * 100, 90. + (i % 180), (i * 13.7) - 360. * static_cast<int>(i * 13.7 / 360.),
+                  12.5 + (i % 25) * 0.1, i % 100000);
+
+    TLE tle;
+    dpslr::sgp4::Elements elements;
+    CPF cpf;
+    if (!tle.parseLines(QString("OBJECT %1\n%2\n%3\n").arg(i).arg(line1).arg(line2).toStdString()) ||
+            dpslr::sgp4::SGP4Error::NOT_ERROR != dpslr::sgp4::parseTLE(tle, elements) ||
+            dpslr::sgp4::SGP4Error::NOT_ERROR != dpslr::sgp4::generateCPF(tle, elements, kCPFStartJD,
+                                                                          kCPFStartJD + 1.L, kCPFStep, cpf))
+        return false;
+
+    return CPF::WriteFileErrorEnum::NOT_ERROR ==
+            cpf.writeCPFFile(this->cpf_dir.filePath(cpfName(i)).toStdString(), true);
+}
+
+QList<CPFSelected> TestPassScheduler::loadCPFs() const
+{
+    QList<CPFSelected> cpf_list;
+    for (int i = 0; i < this->objects.size(); i++)
+    {
+        auto cpf = std::make_shared<CPF>(this->cpf_dir.filePath(cpfName(i)).toStdString(),
+                                         CPF::OpenOptionEnum::ALL_DATA);
+        cpf_list.append(CPFSelected(this->objects[i], cpf, 1., 1., 1.));
+    }
+    return cpf_list;
+}
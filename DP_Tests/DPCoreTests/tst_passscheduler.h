@@ -0,0 +1,27 @@
+#pragma once
+
+#include "class_passscheduler.h"
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class TestPassScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void generatedCPFsAreLoaded();
+    void scheduleMatchesSerialPasses();
+    void scheduleIsSortedWithOverlaps();
+    void cachedObjectsAreNotRecalculated();
+    void newReleasesAreRecalculated();
+    void stitchedReleasesAreRecalculated();
+
+private:
+    bool writeCPF(int i, double raan);
+    QList<CPFSelected> loadCPFs() const;
+
+    QTemporaryDir cpf_dir;
+    QList<std::shared_ptr<SpaceObject>> objects;
+};
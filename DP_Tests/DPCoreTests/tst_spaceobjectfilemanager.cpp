@@ -0,0 +1,143 @@
+#include "tst_spaceobjectfilemanager.h"
+#include "testutils.h"
+
+#include "class_jsontablemodel.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtTest>
+
+namespace
+{
+
+const int kExportObjects = 20000;
+
+// CSV export of the SpaceObjectsManager before the streaming exporter, reading each cell through the proxy.
+void previousExportToCSV(const QString& filename, const QSortFilterProxyModel& sortmodel,
+                         const QModelIndexList& list)
+{
+    QFile file(filename);
+    if(file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QTextStream stream(&file);
+
+        stream<<"NORAD;COSPAR;NAME;ILRS;ALTITUDE;RCS;DEBRIS";
+
+        for(const auto& object : list)
+        {
+            stream<<"\n";
+            stream << sortmodel.data(sortmodel.index(object.row(),1),0).toString() <<";";
+            stream << sortmodel.data(sortmodel.index(object.row(),5),0).toString() <<";";
+            stream << sortmodel.data(sortmodel.index(object.row(),2),0).toString() <<";";
+            if(sortmodel.data(sortmodel.index(object.row(),3),0).toString().isEmpty())
+                stream << "No" << ";";
+            else
+                stream << "Yes" << ";";
+            stream << sortmodel.data(sortmodel.index(object.row(),14),0).toString() <<";";
+            stream << sortmodel.data(sortmodel.index(object.row(),15),0).toDouble() <<";";
+            stream << sortmodel.data(sortmodel.index(object.row(),10),0).toString();
+        }
+
+        file.close();
+    }
+}
+
+QByteArray readAll(const QString& filename)
+{
+    QFile file(filename);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+}
+
+void TestSpaceObjectFileManager::exportCSVMatchesPreviousExporter()
+{
+    SpaceObjectModel model;
+    QVERIFY(testutils::loadSpaceObjects(model, kExportObjects));
+
+    // Selection of every other row of the view, sorted by name in descending order, so the proxy rows and the source
+    // rows are different.
+    JsonTableSortFilterProxyModel sortmodel;
+    sortmodel.setSourceModel(&model);
+    sortmodel.sort(model.findColumnSectionByIndex("Name"), Qt::DescendingOrder);
+
+    QModelIndexList list;
+    QVector<int> rows;
+    for (int i = 0; i < sortmodel.rowCount(); i += 2)
+    {
+        list.append(sortmodel.index(i, 0));
+        rows.push_back(sortmodel.mapToSource(list.back()).row());
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString previous_path = dir.filePath("previous.csv");
+    const QString streamed_path = dir.filePath("streamed.csv");
+
+    previousExportToCSV(previous_path, sortmodel, list);
+    QVERIFY(!SpaceObjectFileManager::exportSpaceObjectsCSV(streamed_path, model, rows).hasError());
+
+    const QByteArray previous = readAll(previous_path);
+    const QByteArray streamed = readAll(streamed_path);
+    QCOMPARE(previous.count('\n'), kExportObjects / 2);
+    QCOMPARE(streamed.size(), previous.size());
+    QVERIFY(streamed == previous);
+}
+
+void TestSpaceObjectFileManager::exportCSVQuotesSeparators()
+{
+    SpaceObjectModel model;
+    QVERIFY(testutils::loadSpaceObjects(model, 2));
+    model.setData(model.index(0, model.findColumnSectionByIndex("Name")), "NAME;WITH \"QUOTES\"",
+                  JsonTableModel::DIRECT_ROLE);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("quoted.csv");
+    QVERIFY(!SpaceObjectFileManager::exportSpaceObjectsCSV(path, model, {0}).hasError());
+
+    const QList<QByteArray> lines = readAll(path).split('\n');
+    QCOMPARE(lines.size(), 2);
+    QVERIFY(lines[1].contains(";\"NAME;WITH \"\"QUOTES\"\"\";"));
+}
+
+void TestSpaceObjectFileManager::exportCSVCancelKeepsPreviousFile()
+{
+    SpaceObjectModel model;
+    QVERIFY(testutils::loadSpaceObjects(model, 10));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("cancelled.csv");
+
+    // A cancelled export does not create the file, and does not replace a previous export.
+    std::atomic_bool cancel(true);
+    QVector<int> rows{0, 1, 2, 3};
+    SalaraInformation errors = SpaceObjectFileManager::exportSpaceObjectsCSV(path, model, rows, &cancel);
+    QVERIFY(errors.containsError(SpaceObjectFileManager::EXPORT_CANCELLED));
+    QVERIFY(!QFile::exists(path));
+
+    cancel = false;
+    QVERIFY(!SpaceObjectFileManager::exportSpaceObjectsCSV(path, model, rows, &cancel).hasError());
+    const QByteArray previous = readAll(path);
+    QCOMPARE(previous.count('\n'), rows.size());
+
+    cancel = true;
+    errors = SpaceObjectFileManager::exportSpaceObjectsCSV(path, model, {0}, &cancel);
+    QVERIFY(errors.containsError(SpaceObjectFileManager::EXPORT_CANCELLED));
+    QVERIFY(readAll(path) == previous);
+}
+
+void TestSpaceObjectFileManager::exportCSVWithoutSchemeFails()
+{
+    // Without scheme the exported columns are not found, so nothing is written.
+    SpaceObjectModel model;
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("noscheme.csv");
+
+    SalaraInformation errors = SpaceObjectFileManager::exportSpaceObjectsCSV(path, model, {});
+    QVERIFY(errors.containsError(SpaceObjectFileManager::SCHEME_NOT_VALID));
+    QVERIFY(!QFile::exists(path));
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QObject>
+
+class TestSpaceObjectFileManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void exportCSVMatchesPreviousExporter();
+    void exportCSVQuotesSeparators();
+    void exportCSVCancelKeepsPreviousFile();
+    void exportCSVWithoutSchemeFails();
+};
@@ -0,0 +1,217 @@
+#include "tst_spaceobjectsjournal.h"
+#include "testutils.h"
+
+#include "class_spaceobjectsjournal.h"
+
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QtTest>
+
+#include <limits>
+
+namespace
+{
+
+const int kObjects = 20;
+const int kWriterObjects = 200;
+const int kWriterMinChanges = 50;
+const char* kWriterArgument = "--journal-writer";
+
+// Waits until the clock advances, so the records and the snapshots have different times.
+QDateTime nextTime()
+{
+    QThread::msleep(3);
+    QDateTime time = QDateTime::currentDateTimeUtc();
+    QThread::msleep(3);
+    return time;
+}
+
+// Change number i made by the writer process.
+void applyWriterChange(SpaceObjectModel& model, int i)
+{
+    const QModelIndex index = model.index(i % model.rowCount(), model.findColumnSectionByIndex("Name"));
+    model.setData(index, QString("WRITER %1").arg(i), JsonTableModel::DIRECT_ROLE);
+}
+
+}
+
+int TestSpaceObjectsJournal::runWriter(const QString &dir)
+{
+    SpaceObjectModel model;
+    if (!testutils::loadSpaceObjects(model, kWriterObjects))
+        return 1;
+
+    SpaceObjectsJournal journal;
+    journal.setBackupDirectory(dir, 10, std::numeric_limits<int>::max());
+    journal.attachModel(&model);
+
+    QTextStream out(stdout);
+    for (int i = 0; ; i++)
+    {
+        applyWriterChange(model, i);
+        out << i << '\n';
+        out.flush();
+    }
+}
+
+void TestSpaceObjectsJournal::restoreToTimestamp()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    SpaceObjectModel model;
+    QVERIFY(testutils::loadSpaceObjects(model, kObjects));
+
+    // Small journals, so the changes are spread over several backups.
+    SpaceObjectsJournal journal;
+    journal.setBackupDirectory(dir.path(), 10, 4);
+    journal.attachModel(&model);
+
+    const QDateTime before_backups = nextTime();
+    const int name_column = model.findColumnSectionByIndex("Name");
+
+    QVector<QPair<QDateTime, QJsonArray>> states;
+    for (int step = 0; step < 15; step++)
+    {
+        const int row = (step * 7) % model.rowCount();
+        switch (step % 4)
+        {
+        case 0:
+        case 1:
+            model.setData(model.index(row, name_column), QString("EDITED %1").arg(step),
+                          JsonTableModel::DIRECT_ROLE);
+            break;
+        case 2:
+            model.insertRows(row, 2);
+            break;
+        case 3:
+            model.removeRows(row, 1);
+            break;
+        }
+
+        // Edits not submitted do not change the data.
+        model.setData(model.index(row, name_column), "NOT SUBMITTED", JsonTableModel::EDIT_ROLE);
+        model.revertEditedRow(row);
+
+        states.append({nextTime(), model.getJsonarray()});
+    }
+
+    QVERIFY(QDir(dir.path()).entryList({"*.journal"}, QDir::Files).size() > 1);
+
+    for (int i = 0; i < states.size(); i++)
+    {
+        QJsonArray restored;
+        QVERIFY(!SpaceObjectsJournal::restore(dir.path(), states[i].first, restored).hasError());
+        QVERIFY2(restored == states[i].second, qPrintable(QString("State %1 differs").arg(i)));
+    }
+
+    QJsonArray restored;
+    QVERIFY(SpaceObjectsJournal::restore(dir.path(), before_backups, restored)
+            .containsError(SpaceObjectsJournal::BACKUP_NOT_FOUND));
+}
+
+void TestSpaceObjectsJournal::bulkChangesAreSnapshotted()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    SpaceObjectModel model;
+    QVERIFY(testutils::loadSpaceObjects(model, kObjects));
+
+    SpaceObjectsJournal journal;
+    journal.setBackupDirectory(dir.path(), 10, 100);
+    journal.attachModel(&model);
+
+    model.setData(model.index(0, model.findColumnSectionByIndex("Name")), "BEFORE BULK", JsonTableModel::DIRECT_ROLE);
+    nextTime();
+
+    // The bulk change starts a new backup, instead of journaling each row.
+    journal.beginBulkChange();
+    model.disableAll();
+    QVERIFY(!journal.endBulkChange().hasError());
+
+    const QDateTime after_bulk = nextTime();
+    const QJsonArray expected = model.getJsonarray();
+
+    QCOMPARE(QDir(dir.path()).entryList({"*.json"}, QDir::Files).size(), 2);
+
+    QJsonArray restored;
+    QVERIFY(!SpaceObjectsJournal::restore(dir.path(), after_bulk, restored).hasError());
+    QVERIFY(restored == expected);
+}
+
+void TestSpaceObjectsJournal::truncatedLastRecordIsIgnored()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    SpaceObjectModel model;
+    QVERIFY(testutils::loadSpaceObjects(model, kObjects));
+
+    SpaceObjectsJournal journal;
+    journal.setBackupDirectory(dir.path(), 10, 100);
+    journal.attachModel(&model);
+
+    for (int i = 0; i < 5; i++)
+        applyWriterChange(model, i);
+    const QJsonArray expected = model.getJsonarray();
+    journal.close();
+
+    // Half of a record, as left by a crash while appending.
+    const QStringList journals = QDir(dir.path()).entryList({"*.journal"}, QDir::Files);
+    QCOMPARE(journals.size(), 1);
+    QFile journal_file(QDir(dir.path()).filePath(journals.first()));
+    QVERIFY(journal_file.open(QIODevice::WriteOnly | QIODevice::Append));
+    journal_file.write("{\"Object\":{\"Name\":\"TORN");
+    journal_file.close();
+
+    QJsonArray restored;
+    QVERIFY(!SpaceObjectsJournal::restore(dir.path(), nextTime(), restored).hasError());
+    QVERIFY(restored == expected);
+}
+
+void TestSpaceObjectsJournal::killedWriterRecovers()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QProcess writer;
+    writer.start(QCoreApplication::applicationFilePath(), {kWriterArgument, dir.path()});
+    QVERIFY(writer.waitForStarted());
+
+    // Kill the writer while it is appending, after some changes were journaled.
+    int journaled = -1;
+    QByteArray output;
+    while (journaled < kWriterMinChanges && writer.waitForReadyRead(10000))
+    {
+        output.append(writer.readAllStandardOutput());
+        const QList<QByteArray> lines = output.split('\n');
+        if (lines.size() > 1)
+            journaled = lines[lines.size() - 2].toInt();
+    }
+    writer.kill();
+    QVERIFY(writer.waitForFinished());
+    QVERIFY(journaled >= kWriterMinChanges);
+
+    // The changes printed were journaled. The next one may have been journaled before the kill.
+    output.append(writer.readAllStandardOutput());
+    const QList<QByteArray> lines = output.split('\n');
+    journaled = lines[lines.size() - 2].toInt();
+
+    QJsonArray restored;
+    QVERIFY(!SpaceObjectsJournal::restore(dir.path(), nextTime(), restored).hasError());
+
+    SpaceObjectModel model;
+    QVERIFY(testutils::loadSpaceObjects(model, kWriterObjects));
+    for (int i = 0; i <= journaled; i++)
+        applyWriterChange(model, i);
+    const QJsonArray acknowledged = model.getJsonarray();
+    applyWriterChange(model, journaled + 1);
+    const QJsonArray next = model.getJsonarray();
+
+    QVERIFY(restored == acknowledged || restored == next);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+class TestSpaceObjectsJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Journals changes of a model until the process is killed, printing the number of each change after it is
+    // journaled. Run by the crash test in a child process.
+    static int runWriter(const QString& dir);
+
+private slots:
+    void restoreToTimestamp();
+    void bulkChangesAreSnapshotted();
+    void truncatedLastRecordIsIgnored();
+    void killedWriterRecovers();
+};
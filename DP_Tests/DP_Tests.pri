@@ -0,0 +1,11 @@
+# Common settings of the test projects. The tests are built with the rest of the project and run with "make check".
+include ($$_PRO_FILE_PWD_/../../DP_Locations.pri)
+
+TEMPLATE = app
+DESTDIR = $$DP_DEPLOY/tests
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x070000
@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+
+SUBDIRS  = \
+        LibDPSLRTests \
+        LibJsonTableModelTests \
+        DummyPlugin \
+        DPCoreTests
+
+DPCoreTests.depends = DummyPlugin
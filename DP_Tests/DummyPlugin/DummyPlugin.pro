@@ -0,0 +1,16 @@
+# Minimal TLE propagator plugin used by the plugin discovery tests. It is not deployed with the plugins.
+include ($$_PRO_FILE_PWD_/../../DP_Locations.pri)
+include ($$_PRO_FILE_PWD_/../../DP_Dependencies.pri)
+
+TARGET = DP_TestDummyPlugin
+TEMPLATE = lib
+CONFIG += plugin c++17
+DESTDIR = $$DP_DEPLOY/tests/plugins
+
+QT += core widgets
+
+HEADERS += \
+    class_dummyplugin.h
+
+DISTFILES += \
+    dummyplugin.json
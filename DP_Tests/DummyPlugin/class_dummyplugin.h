@@ -0,0 +1,17 @@
+#pragma once
+
+#include <interface_tle_propagator.h>
+
+// Plugin that does nothing. The tests copy it many times to check the plugins discovery.
+class DummyPlugin : public TLEPropagator
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID TLEPropagator_iid FILE "dummyplugin.json")
+    Q_INTERFACES(TLEPropagator)
+
+public:
+    SalaraInformation propagateTLEs(const std::vector<TLE>&, const QString&) override
+    {
+        return SalaraInformation();
+    }
+};
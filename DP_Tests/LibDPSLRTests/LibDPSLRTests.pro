@@ -0,0 +1,32 @@
+include ($$_PRO_FILE_PWD_/../DP_Tests.pri)
+
+TARGET = tst_libdpslr
+
+# The library is plain C++, so are its tests. The benchmarks are run with "tst_libdpslr --bench".
+CONFIG -= qt
+CONFIG += c++14
+
+LIBS += -L$$DP_DEPLOY/lib/ -lLibDPSLR
+INCLUDEPATH += $$DP_ROOT/LibDPSLR/includes
+
+LIBS += -fopenmp
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_LFLAGS += -fopenmp
+
+HEADERS += \
+    testdata.h \
+    testing.h
+
+SOURCES += \
+    main.cpp \
+    tst_biases.cpp \
+    tst_cpfinterpolator.cpp \
+    tst_cpfstitcher.cpp \
+    tst_eventtimer.cpp \
+    tst_normalpoints.cpp \
+    tst_passcalculator.cpp \
+    tst_postfilters.cpp \
+    tst_rangegate.cpp \
+    tst_sgp4.cpp \
+    tst_tracking.cpp \
+    tst_troposphere.cpp
@@ -0,0 +1,47 @@
+#include "testing.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Runs the LibDPSLR tests. The arguments select the tests whose name contains any of them, and --bench also runs
+// the benchmarks (only the benchmarks when combined with --only-bench).
+int main(int argc, char *argv[])
+{
+    bool benchmarks = false;
+    bool only_benchmarks = false;
+    std::vector<const char*> filters;
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == std::strcmp(argv[i], "--bench"))
+            benchmarks = true;
+        else if (0 == std::strcmp(argv[i], "--only-bench"))
+            benchmarks = only_benchmarks = true;
+        else
+            filters.push_back(argv[i]);
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (const auto& test : dpslrtest::registry())
+    {
+        if ((test.benchmark && !benchmarks) || (!test.benchmark && only_benchmarks))
+            continue;
+        bool selected = filters.empty();
+        for (const char* filter : filters)
+            selected |= nullptr != std::strstr(test.name, filter);
+        if (!selected)
+            continue;
+
+        std::printf("%s %s\n", test.benchmark ? "BENCH" : "TEST ", test.name);
+        std::fflush(stdout);
+        const int previous_failures = dpslrtest::failures();
+        test.function();
+        const bool passed = previous_failures == dpslrtest::failures();
+        std::printf("%s %s\n", passed ? "PASS " : "FAIL ", test.name);
+        run++;
+        failed += !passed;
+    }
+
+    std::printf("Totals: %d passed, %d failed\n", run - failed, failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <class_cpf.h>
+#include <geo.h>
+#include <sgp4.h>
+
+#include <string>
+
+// Test data shared by the LibDPSLR tests: the San Fernando station and CPFs generated with SGP4, so the tests don't
+// depend on downloaded predictions.
+namespace dpslrtest
+{
+
+// LAGEOS 1 (about 5900 km high) and a low polar orbit (about 600 km high), with epoch 2023-10-17 12:00 UTC.
+const char* const kLageosTLE = "LAGEOS 1\n"
+        "1 08820U 76039A   23290.50000000  .00000000  00000-0  00000-0 0  9990\n"
+        "2 08820 109.8400 100.0000 0044000 250.0000 110.0000  6.38664000000000\n";
+const char* const kLowOrbitTLE = "CRYOSAT 2\n"
+        "1 39452U 13067B   23290.50000000  .00000000  00000-0  00000-0 0  9990\n"
+        "2 39452  87.3500 100.0000 0010000 250.0000 110.0000 15.22000000000000\n";
+
+// First day of the generated CPFs (2023-10-18 00:00 UTC).
+constexpr int kCPFStartMJD = 60235;
+constexpr long double kCPFStartJD = 2400000.5L + kCPFStartMJD;
+
+// San Fernando (SFEL, 7824).
+inline dpslr::geo::frames::GeodeticPoint<long double> stationGeodetic()
+{
+    return {36.46525L, -6.20548L, 98.177L, dpslr::geo::meas::Angle<long double>::Unit::DEGREES};
+}
+
+inline dpslr::geo::frames::GeocentricPoint<long double> stationGeocentric()
+{
+    return {5105473.885L, -555110.526L, 3769892.958L};
+}
+
+// CPF with the positions of the TLE orbit from the first CPF day, for the days and with the step (seconds) given.
+inline bool makeCPF(const char* tle_lines, int days, unsigned step, CPF& cpf)
+{
+    TLE tle;
+    dpslr::sgp4::Elements elements;
+    return tle.parseLines(tle_lines) &&
+           dpslr::sgp4::SGP4Error::NOT_ERROR == dpslr::sgp4::parseTLE(tle, elements) &&
+           dpslr::sgp4::SGP4Error::NOT_ERROR == dpslr::sgp4::generateCPF(tle, elements, kCPFStartJD,
+                                                                         kCPFStartJD + days, step, cpf);
+}
+
+} // END NAMESPACE dpslrtest.
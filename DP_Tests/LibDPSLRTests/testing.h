@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Minimal test support for the LibDPSLR tests. The library is plain C++, so the tests don't use Qt either.
+//
+// Each test is a function registered with DPSLR_TEST. The checks report the failures and let the test continue, except
+// REQUIRE, which returns from the test. The benchmarks are registered with DPSLR_BENCHMARK and only run with --bench.
+namespace dpslrtest
+{
+
+struct TestCase
+{
+    const char* name;
+    void (*function)();
+    bool benchmark;
+};
+
+inline std::vector<TestCase>& registry()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+struct Registrar
+{
+    Registrar(const char* name, void (*function)(), bool benchmark)
+    {
+        registry().push_back({name, function, benchmark});
+    }
+};
+
+inline void fail(const char* file, int line, const std::string& message)
+{
+    std::printf("    %s:%d: %s\n", file, line, message.c_str());
+    failures()++;
+}
+
+// Best wall time of the repetitions, in milliseconds.
+template <typename Function>
+double measure(Function&& function, int repetitions = 3)
+{
+    double best = 0.;
+    for (int i = 0; i < repetitions; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const double elapsed =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = 0 == i ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+inline std::string toString(double value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.12g", value);
+    return buffer;
+}
+
+inline void report(const std::string& label, double value, const char* unit)
+{
+    std::printf("    %-60s %14.3f %s\n", label.c_str(), value, unit);
+}
+
+} // END NAMESPACE dpslrtest.
+
+#define DPSLR_TEST_REGISTER(name, benchmark) \
+    static void name(); \
+    static const dpslrtest::Registrar name##_registrar(#name, name, benchmark); \
+    static void name()
+
+#define DPSLR_TEST(name) DPSLR_TEST_REGISTER(name, false)
+#define DPSLR_BENCHMARK(name) DPSLR_TEST_REGISTER(name, true)
+
+#define CHECK(condition) \
+    do { if (!(condition)) dpslrtest::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed."); } while (false)
+
+#define REQUIRE(condition) \
+    do { if (!(condition)) {dpslrtest::fail(__FILE__, __LINE__, "REQUIRE(" #condition ") failed."); return;} } \
+    while (false)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        const double actual_value = (actual); \
+        const double expected_value = (expected); \
+        if (!(std::abs(actual_value - expected_value) <= (tolerance))) \
+            dpslrtest::fail(__FILE__, __LINE__, std::string(#actual " = ") + dpslrtest::toString(actual_value) + \
+                            ", expected " + dpslrtest::toString(expected_value) + " +- " + \
+                            dpslrtest::toString(tolerance)); \
+    } while (false)
@@ -0,0 +1,263 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <algorithms.h>
+#include <rtfilter.h>
+
+#include <cmath>
+#include <random>
+
+using namespace dpslr;
+
+namespace
+{
+
+// Synthetic passes: 300 s at 1 kHz from 5 s after the rise over 20 degrees, with 30 ps gaussian noise.
+constexpr double kFireRate = 1000.;
+constexpr long double kDuration = 300.L;
+constexpr double kNoise = 30.;
+
+struct SyntheticPass
+{
+    CPF cpf;
+    int mjd;
+    std::vector<long double> start_times;
+    std::vector<double> tof_2w;             // Observed flight times (ps).
+    common::ResidualsData<> residuals;      // Observed minus predicted flight times (ps), not detrended.
+};
+
+// The observed flight time at t is the predicted one at t + time bias, plus the two way range bias.
+bool makePass(const char* tle, unsigned step, double time_bias, double range_bias, SyntheticPass& pass)
+{
+    if (!dpslrtest::makeCPF(tle, 1, step, pass.cpf))
+        return false;
+
+    cpfutils::PassCalculator calculator(pass.cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), 20);
+    calculator.setSearchMode(cpfutils::PassCalculator::SearchMode::ADAPTIVE, false);
+    std::vector<cpfutils::Pass> passes;
+    calculator.getPasses(dpslrtest::kCPFStartMJD, 3600.L, dpslrtest::kCPFStartMJD, 82800.L, passes);
+    if (passes.empty())
+        return false;
+
+    pass.mjd = passes.front().start.mjd;
+    const long double sod_start = passes.front().start.fract_day + 5.L;
+    const long double duration = std::min(kDuration, (passes.front().end.mjd - pass.mjd) * 86400.L +
+                                                     passes.front().end.fract_day - sod_start - 5.L);
+
+    cpfutils::CPFInterpolator interpolator(pass.cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    cpfutils::CPFInterpolator::InterpolationResult predicted, observed;
+    std::mt19937 generator(5);
+    std::normal_distribution<double> noise(0., kNoise);
+    const long double range_bias_ps = 2.L * range_bias / math::c * math::kSecondToPicosecond;
+    const std::size_t shots = static_cast<std::size_t>(duration * kFireRate);
+    for (std::size_t i = 0; i < shots; i++)
+    {
+        const long double t = sod_start + i / static_cast<long double>(kFireRate);
+        if (cpfutils::CPFInterpolator::NOT_ERROR != interpolator.interpolate(pass.mjd, t, predicted,
+                                                                             cpfutils::CPFInterpolator::INSTANT_VECTOR) ||
+                cpfutils::CPFInterpolator::NOT_ERROR != interpolator.interpolate(pass.mjd, t + time_bias, observed,
+                                                                                 cpfutils::CPFInterpolator::INSTANT_VECTOR))
+            return false;
+        const long double tof = observed.tof_2w * math::kSecondToPicosecond + range_bias_ps + noise(generator);
+        pass.start_times.push_back(t);
+        pass.tof_2w.push_back(static_cast<double>(tof));
+        pass.residuals.push_back({t, tof - predicted.tof_2w * math::kSecondToPicosecond});
+    }
+    return true;
+}
+
+// The linear model leaves out the second order term, which is about 0.1 mm for these biases.
+void checkEstimate(const algorithms::BiasEstimate& estimate, double time_bias, double range_bias)
+{
+    CHECK_NEAR(static_cast<double>(estimate.time_bias), time_bias, 5. * std::sqrt(estimate.var_time_bias));
+    CHECK_NEAR(static_cast<double>(estimate.range_bias), range_bias, 5. * std::sqrt(estimate.var_range_bias) + 5e-4);
+    CHECK_NEAR(static_cast<double>(estimate.rms_after), kNoise, 0.05 * kNoise);
+}
+
+void checkBatchAndStreaming(const char* tle, unsigned step, double time_bias, double range_bias)
+{
+    SyntheticPass pass;
+    REQUIRE(makePass(tle, step, time_bias, range_bias, pass));
+
+    algorithms::BiasEstimate batch;
+    REQUIRE(algorithms::BiasEstimErr::NOT_ERROR == algorithms::estimateBiases(
+                pass.cpf, pass.mjd, pass.residuals, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(),
+                batch));
+    CHECK(pass.residuals.size() == batch.ptn);
+    checkEstimate(batch, time_bias, range_bias);
+    CHECK(batch.rms_before > 10. * batch.rms_after);
+
+    // The streaming filter window must contain the time bias signature. The filter rejects the tails of the noise,
+    // so its estimate is compared with the expected noise of the batch one.
+    rtfilter::StreamingFilterConfig config;
+    config.win_upper = std::max(40000., 1.3 * std::abs(time_bias) * 5e7);
+    config.win_lower = -config.win_upper;
+    rtfilter::StreamingFilter filter(pass.cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), config);
+    REQUIRE(rtfilter::RTFilterError::NOT_ERROR == filter.startPass(pass.mjd, pass.start_times.front() - 1.L,
+                                                                   pass.start_times.back() -
+                                                                   pass.start_times.front() + 2.L));
+    std::size_t signal = 0;
+    for (std::size_t i = 0; i < pass.tof_2w.size(); i++)
+        signal += filter.classify(pass.start_times[i], pass.tof_2w[i]).signal;
+    CHECK(signal > 0.95 * pass.tof_2w.size());
+
+    algorithms::BiasEstimate streaming;
+    REQUIRE(algorithms::BiasEstimErr::NOT_ERROR == filter.biasEstimate(streaming));
+    CHECK(signal == streaming.ptn);
+    CHECK_NEAR(static_cast<double>(streaming.time_bias), static_cast<double>(batch.time_bias),
+               5. * std::sqrt(batch.var_time_bias));
+    CHECK_NEAR(static_cast<double>(streaming.range_bias), static_cast<double>(batch.range_bias),
+               5. * std::sqrt(batch.var_range_bias) + 5e-4);
+    CHECK(streaming.rms_after < batch.rms_after);
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(biasEstimationLageos)
+{
+    checkBatchAndStreaming(dpslrtest::kLageosTLE, 120, 1e-3, 0.3);
+}
+
+DPSLR_TEST(biasEstimationLowOrbit)
+{
+    checkBatchAndStreaming(dpslrtest::kLowOrbitTLE, 60, 2e-3, -0.5);
+}
+
+DPSLR_TEST(biasEstimationWithoutBiases)
+{
+    SyntheticPass pass;
+    REQUIRE(makePass(dpslrtest::kLowOrbitTLE, 60, 0., 0., pass));
+
+    algorithms::BiasEstimate estimate;
+    REQUIRE(algorithms::BiasEstimErr::NOT_ERROR == algorithms::estimateBiases(
+                pass.cpf, pass.mjd, pass.residuals, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(),
+                estimate));
+    checkEstimate(estimate, 0., 0.);
+    CHECK_NEAR(static_cast<double>(estimate.rms_before), kNoise, 0.05 * kNoise);
+}
+
+DPSLR_TEST(biasEstimationForgetting)
+{
+    // The biases change in the middle of the points. With forgetting, the estimation follows the new ones, and the
+    // weight of the old ones (0.999^20000) is negligible even for the RMS.
+    const std::size_t points = 40000;
+    const double ps_per_m = 2. / math::c * math::kSecondToPicosecond;
+    std::mt19937 generator(3);
+    std::normal_distribution<double> noise(0., kNoise);
+
+    rtfilter::StreamingBiasEstimator all, forgetting(0.999);
+    for (std::size_t i = 0; i < points; i++)
+    {
+        const bool second = i >= points / 2;
+        const double rate = 2e-5 * ((i % 1000) / 1000. - 0.5);
+        const double residual = (second ? 2e-3 : 1e-3) * rate * math::kSecondToPicosecond +
+                (second ? -0.2 : 0.3) * ps_per_m + noise(generator);
+        all.update(rate, residual);
+        forgetting.update(rate, residual);
+    }
+    CHECK(points == all.count());
+
+    algorithms::BiasEstimate estimate;
+    REQUIRE(algorithms::BiasEstimErr::NOT_ERROR == forgetting.estimate(estimate));
+    CHECK_NEAR(static_cast<double>(estimate.time_bias), 2e-3, 5. * std::sqrt(estimate.var_time_bias));
+    CHECK_NEAR(static_cast<double>(estimate.range_bias), -0.2, 5. * std::sqrt(estimate.var_range_bias));
+    CHECK_NEAR(static_cast<double>(estimate.rms_after), kNoise, 0.1 * kNoise);
+
+    // Without forgetting, the estimation is between both.
+    REQUIRE(algorithms::BiasEstimErr::NOT_ERROR == all.estimate(estimate));
+    CHECK(estimate.time_bias > 1.4e-3 && estimate.time_bias < 1.6e-3);
+    CHECK(estimate.rms_after > 2. * kNoise);
+
+    all.reset();
+    CHECK(0 == all.count());
+    CHECK(algorithms::BiasEstimErr::NOT_ENOUGH_POINTS == all.estimate(estimate));
+}
+
+DPSLR_TEST(biasEstimationRejectsInvalidInput)
+{
+    algorithms::BiasEstimate estimate;
+    const std::vector<long double> rates{1e-5L, 2e-5L, 3e-5L, 4e-5L}, resids{10.L, 20.L, 30.L, 40.L};
+
+    CHECK(algorithms::BiasEstimErr::DATA_SIZE_MISMATCH ==
+          algorithms::estimateBiases(rates, std::vector<long double>(resids.begin(), resids.end() - 1), estimate));
+    CHECK(algorithms::BiasEstimErr::NOT_ENOUGH_POINTS ==
+          algorithms::estimateBiases(std::vector<long double>(2, 1e-5L), std::vector<long double>(2, 10.L),
+                                     estimate));
+    CHECK(algorithms::BiasEstimErr::SINGULAR_GEOMETRY ==
+          algorithms::estimateBiases(std::vector<long double>(4, 1e-5L), resids, estimate));
+    CHECK(algorithms::BiasEstimErr::CPF_DATA_EMPTY ==
+          algorithms::estimateBiases(CPF(), dpslrtest::kCPFStartMJD, {{3600.L, 10.L}},
+                                     dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), estimate));
+
+    // Out of the CPF the rates can not be interpolated.
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+    CHECK(algorithms::BiasEstimErr::RATES_CALC_FAILED ==
+          algorithms::estimateBiases(cpf, dpslrtest::kCPFStartMJD + 2, {{3600.L, 10.L}},
+                                     dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), estimate));
+
+    rtfilter::StreamingBiasEstimator streaming;
+    for (int i = 0; i < 10; i++)
+        streaming.update(1e-5, 10.);
+    CHECK(algorithms::BiasEstimErr::SINGULAR_GEOMETRY == streaming.estimate(estimate));
+}
+
+DPSLR_BENCHMARK(biasEstimationStreamingCost)
+{
+    // Rates (from the predicted flight times) and residuals of a LAGEOS pass, repeated to have enough updates for the
+    // measurement.
+    SyntheticPass pass;
+    REQUIRE(makePass(dpslrtest::kLageosTLE, 120, 1e-3, 0.3, pass));
+    std::vector<double> rates, resids;
+    for (std::size_t i = 1; i + 1 < pass.residuals.size(); i++)
+    {
+        const long double before = pass.tof_2w[i - 1] - pass.residuals[i - 1].second;
+        const long double after = pass.tof_2w[i + 1] - pass.residuals[i + 1].second;
+        rates.push_back(static_cast<double>((after - before) * kFireRate / 2.L / math::kSecondToPicosecond));
+        resids.push_back(static_cast<double>(pass.residuals[i].second));
+    }
+
+    const std::size_t updates = 5000000;
+    rtfilter::StreamingBiasEstimator estimator(0.9999);
+    const double update_ms = dpslrtest::measure([&]
+    {
+        estimator.reset();
+        for (std::size_t i = 0; i < updates; i++)
+            estimator.update(rates[i % rates.size()], resids[i % resids.size()]);
+    });
+
+    algorithms::BiasEstimate estimate;
+    const std::size_t solves = 100000;
+    const double estimate_ms = dpslrtest::measure([&]
+    {
+        for (std::size_t i = 0; i < solves; i++)
+            estimator.estimate(estimate);
+    });
+    CHECK(algorithms::BiasEstimErr::NOT_ERROR == estimator.estimate(estimate));
+
+    // The same pass through the streaming filter, with the bias estimation of the signal shots.
+    rtfilter::StreamingFilterConfig config;
+    config.win_upper = 65000.;
+    config.win_lower = -65000.;
+    rtfilter::StreamingFilter filter(pass.cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), config);
+    std::size_t signal = 0;
+    const double filter_ms = dpslrtest::measure([&]
+    {
+        filter.startPass(pass.mjd, pass.start_times.front() - 1.L,
+                         pass.start_times.back() - pass.start_times.front() + 2.L);
+        for (std::size_t i = 0; i < pass.tof_2w.size(); i++)
+            signal += filter.classify(pass.start_times[i], pass.tof_2w[i]).signal;
+    });
+    CHECK(signal > 0);
+
+    const double batch_ms = dpslrtest::measure([&]
+    {
+        algorithms::estimateBiases(pass.cpf, pass.mjd, pass.residuals, dpslrtest::stationGeodetic(),
+                                   dpslrtest::stationGeocentric(), estimate);
+    });
+
+    dpslrtest::report("Streaming update per shot", update_ms * 1e6 / updates, "ns");
+    dpslrtest::report("Streaming estimate solve", estimate_ms * 1e6 / solves, "ns");
+    dpslrtest::report("Streaming filter classify per shot", filter_ms * 1e6 / pass.tof_2w.size(), "ns");
+    dpslrtest::report("Batch estimation (" + std::to_string(pass.residuals.size()) + " shots)", batch_ms, "ms");
+}
@@ -0,0 +1,425 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <cpfutils.h>
+#include <dpslr_math.h>
+#include <math_operators.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+
+using namespace dpslr;
+using namespace dpslr::cpfutils;
+
+// Heap allocations of the whole test program, to check the interpolation without allocations. GCC warns about the
+// free of the replaced operator new when it is inlined, though both of them are replaced.
+static std::atomic<std::size_t> allocations(0);
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace
+{
+
+// Instants compared in the equivalence tests (seconds between them).
+constexpr long double kCompareStep = 3.7L;
+
+// Result of the reference interpolation.
+struct ReferenceResult
+{
+    long double range;
+    long double tof_2w;
+    long double azimuth;
+    long double elevation;
+    long double diff_azimuth;
+    long double diff_elevation;
+    std::vector<long double> geocentric;
+};
+
+// Interpolation of the previous implementation (with the math library containers and two fixed light time iterations)
+// for the INSTANT_VECTOR and AVERAGE_DISTANCE modes, as the reference for the current one.
+class ReferenceInterpolator
+{
+public:
+
+    explicit ReferenceInterpolator(const CPF& cpf) :
+        stat_xyz(dpslrtest::stationGeocentric().store<std::vector<long double>>())
+    {
+        const auto& records = cpf.getData().positionRecords();
+        for (const auto& record : records)
+        {
+            this->times.push_back(record.sod - records.front().sod + (record.mjd - records.front().mjd) * 86400.L);
+            this->positions.push_back_row(record.geocentric_pos);
+        }
+        this->mjd_orig = records.front().mjd;
+        this->sod_orig = records.front().sod;
+
+        auto geodetic = dpslrtest::stationGeodetic();
+        geodetic.convert(geo::meas::Angle<long double>::Unit::RADIANS, geo::meas::Distance<long double>::Unit::METRES);
+        const long double lon = geodetic.lon, lat = geodetic.lat;
+        math::Matrix<long double> rot_long, rot_lat, rot_long_pi;
+        this->rotation = math::Matrix<long double>::I(3);
+        math::euclid3DRotMat(3, lon, rot_long);
+        math::euclid3DRotMat(2, static_cast<long double>(math::pi/2) - lat, rot_lat);
+        math::euclid3DRotMat(3, static_cast<long double>(math::pi), rot_long_pi);
+        this->rotation *= rot_long * rot_lat * rot_long_pi;
+    }
+
+    bool interpolate(int mjd, long double second, CPFInterpolator::InterpolationMode mode,
+                     ReferenceResult& result) const
+    {
+        using namespace dpslr::math_operators;
+
+        const long double x = (mjd - this->mjd_orig) * 86400 + second - this->sod_orig;
+        std::vector<long double> y;
+        if (math::LagrangeResult::NOT_ERROR != math::lagrangeInterp(this->times, this->positions, 9, x, y))
+            return false;
+
+        // Station and object at the instant.
+        std::vector<long double> topocentric = y - this->stat_xyz;
+        const long double distance = sqrtl(topocentric[0] * topocentric[0] + topocentric[1] * topocentric[1] +
+                                           topocentric[2] * topocentric[2]);
+        long double azimuth, elevation;
+        this->direction(topocentric, azimuth, elevation);
+        if (math::compareFloating(elevation, 90.0L) == 1)
+            elevation += 0.01L;
+
+        if (CPFInterpolator::INSTANT_VECTOR == mode)
+        {
+            result = {distance, 2 * distance / math::c, azimuth, elevation, 0.L, 0.L, y};
+            return true;
+        }
+
+        // Two iterations of the outbound light time, rotating the station during the flight time.
+        math::Matrix<long double> station_rotated, station_rotation;
+        station_rotated.push_back_row(this->stat_xyz);
+        std::vector<long double> outbound;
+        long double time_out = distance / math::c;
+        for (int i = 0; i < 2; i++)
+        {
+            if (math::LagrangeResult::NOT_ERROR != math::lagrangeInterp(this->times, this->positions, 9,
+                                                                        x + time_out, y))
+                return false;
+            outbound = y - station_rotated[0];
+            time_out = sqrtl(outbound[0] * outbound[0] + outbound[1] * outbound[1] + outbound[2] * outbound[2]) /
+                    math::c;
+            math::euclid3DRotMat(3, 6.300388L * (time_out / 86400.0L), station_rotation);
+            station_rotated *= station_rotation;
+        }
+
+        long double azi_out, elev_out;
+        this->direction(outbound, azi_out, elev_out);
+        long double diff_azim = 2 * (azimuth - azi_out);
+        if (diff_azim < -360)
+            diff_azim += 720;
+        if (diff_azim > +360)
+            diff_azim -= 720;
+
+        // Average distance, with the station and the object at the bounce time.
+        topocentric = y - this->stat_xyz;
+        const long double range = sqrtl(topocentric[0] * topocentric[0] + topocentric[1] * topocentric[1] +
+                                        topocentric[2] * topocentric[2]);
+        result = {range, 2 * range / math::c, azi_out, elev_out, diff_azim, 2 * (elevation - elev_out), y};
+        return true;
+    }
+
+private:
+
+    void direction(const std::vector<long double>& topocentric, long double& azimuth, long double& elevation) const
+    {
+        math::Matrix<long double> local;
+        local.push_back_row(topocentric);
+        local *= this->rotation;
+        elevation = atanl(local[0][2] / sqrtl(local[0][0] * local[0][0] + local[0][1] * local[0][1])) * 180 /
+                math::pi;
+        azimuth = atan2l(-local[0][1], local[0][0]) * 180 / math::pi;
+        if (azimuth < 0.L)
+            azimuth += 360.L;
+    }
+
+    std::vector<long double> stat_xyz;
+    std::vector<long double> times;
+    math::Matrix<long double> positions;
+    math::Matrix<long double> rotation;
+    int mjd_orig;
+    long double sod_orig;
+};
+
+// Maximum differences of the interpolation with the reference over the first CPF day.
+struct Differences
+{
+    std::size_t instants = 0;
+    double range = 0., tof_2w = 0., direction = 0., geocentric = 0.;
+};
+
+Differences compare(const CPF& cpf, const CPFInterpolator& interpolator, CPFInterpolator::InterpolationMode mode)
+{
+    const ReferenceInterpolator reference(cpf);
+    Differences differences;
+    CPFInterpolator::InterpolationResult result;
+    ReferenceResult expected;
+    for (long double s = 600.L; s < 86400.L - 600.L; s += kCompareStep)
+    {
+        const bool valid = reference.interpolate(dpslrtest::kCPFStartMJD, s, mode, expected);
+        CHECK(valid == (CPFInterpolator::NOT_ERROR == interpolator.interpolate(dpslrtest::kCPFStartMJD, s, result,
+                                                                                mode)));
+        if (!valid || CPFInterpolator::NOT_ERROR != result.error)
+            continue;
+
+        differences.instants++;
+        differences.range = std::max(differences.range, static_cast<double>(std::fabs(result.range - expected.range)));
+        differences.tof_2w = std::max(differences.tof_2w,
+                                      static_cast<double>(std::fabs(result.tof_2w - expected.tof_2w)));
+        for (long double d : {result.azimuth - static_cast<double>(expected.azimuth),
+                              result.elevation - static_cast<double>(expected.elevation),
+                              result.diff_azimuth - static_cast<double>(expected.diff_azimuth),
+                              result.diff_elevation - static_cast<double>(expected.diff_elevation)})
+            differences.direction = std::max(differences.direction, static_cast<double>(std::fabs(d)));
+        for (int c = 0; c < 3; c++)
+            differences.geocentric = std::max(differences.geocentric, std::fabs(
+                                                  result.geocentric[c] - static_cast<double>(expected.geocentric[c])));
+    }
+    return differences;
+}
+
+// CPF with the direction flag given from a common epoch CPF: the transmit record at t has the position at t + r/c,
+// and the receive record at t the position at t - r/c, where r is the geocentric distance.
+CPF directedCPF(const CPF& common, CPFData::DirectionFlagEnum flag)
+{
+    const auto& records = common.getData().positionRecords();
+    std::vector<long double> times;
+    math::Matrix<long double> positions;
+    for (const auto& record : records)
+    {
+        times.push_back((record.mjd - records.front().mjd) * 86400.L + record.sod - records.front().sod);
+        positions.push_back_row(record.geocentric_pos);
+    }
+
+    const long double sign = CPFData::DirectionFlagEnum::TRANSMIT == flag ? 1.L : -1.L;
+    CPF directed = common;
+    directed.getData().clearPositionRecords();
+    std::vector<long double> y;
+    for (std::size_t i = 0; i < records.size(); i++)
+    {
+        long double epoch = times[i];
+        bool valid = true;
+        for (int k = 0; k < 10 && valid; k++)
+        {
+            valid = math::LagrangeResult::X_OUT_OF_BOUNDS != math::lagrangeInterp(times, positions, 9, epoch, y);
+            epoch = times[i] + sign * sqrtl(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]) / math::c;
+        }
+        if (!valid || math::LagrangeResult::X_OUT_OF_BOUNDS == math::lagrangeInterp(times, positions, 9, epoch, y))
+            continue;
+
+        CPFData::PositionRecord record = records[i];
+        record.dir_flag = flag;
+        record.geocentric_pos = {y[0], y[1], y[2]};
+        directed.getData().addPositionRecord(record);
+    }
+    return directed;
+}
+
+// Maximum difference of the two way flight times (seconds) of two interpolators, from the middle to the last hour of the
+// first day, or one second if any interpolation fails.
+double maxTofDifference(const CPFInterpolator& a, const CPFInterpolator& b, CPFInterpolator::InterpolationMode mode)
+{
+    double max_difference = 0.;
+    CPFInterpolator::InterpolationResult result_a, result_b;
+    for (long double s = 43200.L; s < 82800.L; s += 11.3L)
+    {
+        if (CPFInterpolator::NOT_ERROR != a.interpolate(dpslrtest::kCPFStartMJD, s, result_a, mode) ||
+                CPFInterpolator::NOT_ERROR != b.interpolate(dpslrtest::kCPFStartMJD, s, result_b, mode))
+            return 1.;
+        max_difference = std::max(max_difference, static_cast<double>(std::fabs(result_a.tof_2w - result_b.tof_2w)));
+    }
+    return max_difference;
+}
+
+const CPFInterpolator::InterpolationMode kModes[] = {CPFInterpolator::INSTANT_VECTOR,
+                                                      CPFInterpolator::AVERAGE_DISTANCE,
+                                                      CPFInterpolator::INBOUND_VECTOR, CPFInterpolator::ONE_WAY};
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(interpolatorMatchesReference)
+{
+    for (const auto& data : {std::make_pair(dpslrtest::kLowOrbitTLE, 60u), std::make_pair(dpslrtest::kLageosTLE, 120u)})
+    {
+        CPF cpf;
+        REQUIRE(dpslrtest::makeCPF(data.first, 2, data.second, cpf));
+        CPFInterpolator interpolator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+
+        // The instant vector has no light time, so it is the same.
+        Differences differences = compare(cpf, interpolator, CPFInterpolator::INSTANT_VECTOR);
+        CHECK(differences.instants > 20000);
+        CHECK(0. == differences.range && 0. == differences.tof_2w && 0. == differences.direction &&
+              0. == differences.geocentric);
+
+        // Limited to the two iterations of the reference, the average distance is the same too.
+        interpolator.setLightTimeTolerance(1.L);
+        differences = compare(cpf, interpolator, CPFInterpolator::AVERAGE_DISTANCE);
+        CHECK(differences.instants > 20000);
+        CHECK(0. == differences.range && 0. == differences.tof_2w && 0. == differences.direction &&
+              0. == differences.geocentric);
+
+        // The converged light time only moves the bounce time some picoseconds, so the results change by less than
+        // a picosecond of flight time.
+        interpolator.setLightTimeTolerance(1e-12L);
+        differences = compare(cpf, interpolator, CPFInterpolator::AVERAGE_DISTANCE);
+        CHECK_NEAR(differences.tof_2w, 0., 1e-12);
+        CHECK_NEAR(differences.range, 0., 2e-4);
+        CHECK_NEAR(differences.direction, 0., 1e-8);
+        CHECK_NEAR(differences.geocentric, 0., 1e-3);
+    }
+}
+
+DPSLR_TEST(interpolatorLightTimeConverges)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+    CPFInterpolator interpolator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CPFInterpolator converged(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    converged.setLightTimeTolerance(0.L);
+    CHECK_NEAR(static_cast<double>(interpolator.lightTimeTolerance()), 1e-12, 0.);
+
+    for (auto mode : kModes)
+        CHECK_NEAR(maxTofDifference(interpolator, converged, mode), 0., 1e-15);
+
+    // The one way mode is the outbound leg, and the inbound vector is the mean of the outbound and inbound legs, that
+    // differ from the average distance less than a millimetre.
+    CPFInterpolator::InterpolationResult average, inbound, one_way;
+    for (long double s = 3600.L; s < 82800.L; s += 13.3L)
+    {
+        REQUIRE(CPFInterpolator::NOT_ERROR == interpolator.interpolate(dpslrtest::kCPFStartMJD, s, average));
+        REQUIRE(CPFInterpolator::NOT_ERROR == interpolator.interpolate(dpslrtest::kCPFStartMJD, s, inbound,
+                                                                      CPFInterpolator::INBOUND_VECTOR));
+        REQUIRE(CPFInterpolator::NOT_ERROR == interpolator.interpolate(dpslrtest::kCPFStartMJD, s, one_way,
+                                                                      CPFInterpolator::ONE_WAY));
+        CHECK(one_way.tof_2w == 2 * one_way.tof_1w);
+        CHECK(one_way.tof_1w == inbound.tof_1w);
+        CHECK_NEAR(static_cast<double>(inbound.range), static_cast<double>(average.range), 1e-3);
+        CHECK_NEAR(static_cast<double>(average.tof_2w), static_cast<double>(2 * average.tof_1w), 1e-20);
+    }
+}
+
+DPSLR_TEST(interpolatorDirectionFlags)
+{
+    CPF common;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, common));
+    CPFInterpolator reference(common, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+
+    // The transmit and receive records are converted to the common epoch, so every mode gives the same flight times
+    // (up to the fixture accuracy).
+    const CPF transmit = directedCPF(common, CPFData::DirectionFlagEnum::TRANSMIT);
+    const CPF receive = directedCPF(common, CPFData::DirectionFlagEnum::RECEIVE);
+    for (const CPF* directed : {&transmit, &receive})
+    {
+        REQUIRE(directed->getData().positionRecords().size() + 2 >= common.getData().positionRecords().size());
+        CPFInterpolator interpolator(*directed, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+        for (auto mode : kModes)
+            CHECK_NEAR(maxTofDifference(reference, interpolator, mode), 0., 1e-13);
+    }
+
+    // With transmit and receive records at the same epochs (as the lunar CPFs), only the transmit ones are used.
+    CPF both = transmit;
+    for (const auto& record : receive.getData().positionRecords())
+        both.getData().addPositionRecord(record);
+    CPFInterpolator both_interpolator(both, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CPFInterpolator transmit_interpolator(transmit, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    for (auto mode : kModes)
+        CHECK_NEAR(maxTofDifference(both_interpolator, transmit_interpolator, mode), 0., 0.);
+}
+
+DPSLR_TEST(interpolatorDoesNotAllocate)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+    const CPF transmit = directedCPF(cpf, CPFData::DirectionFlagEnum::TRANSMIT);
+    CPFInterpolator interpolator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CPFInterpolator transmit_interpolator(transmit, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+
+    CPFInterpolator::InterpolationResult result;
+    for (auto mode : kModes)
+    {
+        const std::size_t before = allocations;
+        for (long double s = 3600.L; s < 7200.L; s += 0.5L)
+        {
+            interpolator.interpolate(dpslrtest::kCPFStartMJD, s, result, mode);
+            transmit_interpolator.interpolate(dpslrtest::kCPFStartMJD, s, result, mode);
+        }
+        CHECK(before == allocations);
+    }
+}
+
+DPSLR_BENCHMARK(interpolatorThroughput)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+    CPFInterpolator interpolator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    const ReferenceInterpolator reference(cpf);
+
+    // An hour at 100 Hz for each mode, and the reference for the modes it has.
+    const std::size_t calls = 360000;
+    const char* const names[] = {"Instant vector", "Average distance", "Inbound vector", "One way"};
+    double sum = 0.;
+    for (auto mode : kModes)
+    {
+        CPFInterpolator::InterpolationResult result;
+        std::size_t before = allocations;
+        const double interpolator_ms = dpslrtest::measure([&]
+        {
+            for (std::size_t i = 0; i < calls; i++)
+            {
+                interpolator.interpolate(dpslrtest::kCPFStartMJD, 3600.L + i / 100.L, result, mode);
+                sum += static_cast<double>(result.tof_2w);
+            }
+        }, 1);
+        const double interpolator_allocations = static_cast<double>(allocations - before) / calls;
+        CHECK(0. == interpolator_allocations);
+        dpslrtest::report(std::string(names[mode]) + " per call", interpolator_ms * 1e6 / calls, "ns");
+        dpslrtest::report(std::string(names[mode]) + " allocations per call", interpolator_allocations, "");
+
+        if (mode > CPFInterpolator::AVERAGE_DISTANCE)
+            continue;
+        ReferenceResult expected;
+        before = allocations;
+        const double reference_ms = dpslrtest::measure([&]
+        {
+            for (std::size_t i = 0; i < calls; i++)
+            {
+                reference.interpolate(dpslrtest::kCPFStartMJD, 3600.L + i / 100.L, mode, expected);
+                sum += static_cast<double>(expected.tof_2w);
+            }
+        }, 1);
+        dpslrtest::report(std::string(names[mode]) + " per call (previous)", reference_ms * 1e6 / calls, "ns");
+        dpslrtest::report(std::string(names[mode]) + " allocations per call (previous)",
+                          static_cast<double>(allocations - before) / calls, "");
+    }
+    CHECK(sum > 0.);
+}
@@ -0,0 +1,359 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <cpfutils.h>
+#include <dpslr_math.h>
+#include <utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace dpslr;
+using namespace dpslr::cpfutils;
+
+namespace
+{
+
+// Daily releases of the low orbit: each one spans four days and is shifted 0.002 degrees of mean anomaly from the
+// previous one (about 240 m along the track), as the updated orbit determinations of a provider.
+constexpr int kReleases = 7;
+constexpr int kReleaseDays = 4;
+constexpr double kMeanAnomalyShift = 0.002;
+constexpr double kBlendTime = 1800.;
+
+// Release of the low orbit with the mean anomaly (degrees) given, between the julian dates given, and produced at the
+// modified julian datetime given.
+bool makeRelease(double mean_anomaly, long double jd_start, long double jd_end, unsigned step,
+                 long double production, CPF& cpf, const char* norad = "39452")
+{
+    char line_1[80], line_2[80];
+    std::snprintf(line_1, sizeof(line_1), "1 %sU 13067B   23290.50000000  .00000000  00000-0  00000-0 0  9990",
+                  norad);
+    std::snprintf(line_2, sizeof(line_2), "2 %s  87.3500 100.0000 0010000 250.0000 %8.4f 15.22000000000000",
+                  norad, mean_anomaly);
+    TLE tle;
+    sgp4::Elements elements;
+    if (!tle.parseLines(std::string("CRYOSAT 2\n") + line_1 + "\n" + line_2 + "\n") ||
+            sgp4::SGP4Error::NOT_ERROR != sgp4::parseTLE(tle, elements) ||
+            sgp4::SGP4Error::NOT_ERROR != sgp4::generateCPF(tle, elements, jd_start, jd_end, step, cpf))
+        return false;
+
+    CPFHeader::BasicInfo1Header h1 = *cpf.getHeader().basicInfo1Header();
+    h1.cpf_production_date = utils::modifiedJulianDatetimeToTimePoint(production);
+    cpf.getHeader().setBasicInfo1Header(h1);
+    return true;
+}
+
+bool makeDailyReleases(std::vector<CPF>& releases)
+{
+    releases.resize(kReleases);
+    for (int d = 0; d < kReleases; d++)
+        if (!makeRelease(110. + kMeanAnomalyShift * d, dpslrtest::kCPFStartJD + d,
+                         dpslrtest::kCPFStartJD + d + kReleaseDays, 60, dpslrtest::kCPFStartMJD + d, releases[d]))
+            return false;
+    return true;
+}
+
+long double seconds(int mjd, long double sod)
+{
+    return (mjd - dpslrtest::kCPFStartMJD) * 86400.L + sod;
+}
+
+// Nodes of a CPF as seconds from the first CPF day and positions, for the Lagrange interpolation.
+struct Nodes
+{
+    std::vector<long double> times;
+    math::Matrix<long double> positions;
+};
+
+Nodes nodes(const CPF& cpf)
+{
+    Nodes result;
+    for (const auto& record : cpf.getData().positionRecords())
+    {
+        result.times.push_back(seconds(record.mjd, record.sod));
+        result.positions.push_back_row(record.geocentric_pos);
+    }
+    return result;
+}
+
+// Maximum third difference of the positions (m/s3) sampled each second around the instant given.
+double maxJerk(const Nodes& nodes, long double instant, long double half_span)
+{
+    double max_jerk = 0.;
+    std::vector<long double> y[4];
+    for (long double t = instant - half_span; t < instant + half_span; t += 5.L)
+    {
+        for (int i = 0; i < 4; i++)
+            math::lagrangeInterp(nodes.times, nodes.positions, 9, t + i - 1, y[i]);
+        double jerk = 0.;
+        for (int c = 0; c < 3; c++)
+            jerk += std::pow(static_cast<double>(y[3][c] - 3 * y[2][c] + 3 * y[1][c] - y[0][c]), 2);
+        max_jerk = std::max(max_jerk, std::sqrt(jerk));
+    }
+    return max_jerk;
+}
+
+// Checks that the times of the records are increasing, with steps between the given ones (seconds).
+void checkSteps(const CPF& cpf, long double min_step, long double max_step)
+{
+    const auto& records = cpf.getData().positionRecords();
+    REQUIRE(records.size() > 1);
+    for (std::size_t i = 1; i < records.size(); i++)
+    {
+        const long double step = seconds(records[i].mjd, records[i].sod) -
+                seconds(records[i - 1].mjd, records[i - 1].sod);
+        CHECK(step >= min_step - 1e-6L && step <= max_step + 1e-6L);
+    }
+}
+
+// File in the temporary directory for the benchmark.
+std::string temporaryPath(const std::string& name)
+{
+    const char* dir = std::getenv("TMPDIR");
+    if (!dir)
+        dir = std::getenv("TEMP");
+    return std::string(dir ? dir : ".") + "/" + name;
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(stitcherSeamsAreContinuous)
+{
+    std::vector<CPF> releases;
+    REQUIRE(makeDailyReleases(releases));
+    CPFStitcher stitcher(kBlendTime);
+    for (const auto& release : releases)
+        REQUIRE(CPFStitcher::NOT_ERROR == stitcher.addRelease(release));
+    CHECK(kReleases == stitcher.releases());
+
+    CPF merged;
+    REQUIRE(CPFStitcher::NOT_ERROR == stitcher.stitch(merged));
+    CHECK(stitcher.gaps().empty());
+    checkSteps(merged, 60.L, 60.L);
+    CHECK(60 == merged.getHeader().basicInfo2Header()->time_between_entries.count());
+
+    // The merged CPF spans from the first release to the end of the last one.
+    const auto& records = merged.getData().positionRecords();
+    CHECK_NEAR(static_cast<double>(seconds(records.front().mjd, records.front().sod)), 0., 1e-6);
+    CHECK_NEAR(static_cast<double>(seconds(records.back().mjd, records.back().sod)),
+               (kReleases - 1 + kReleaseDays) * 86400., 1e-6);
+
+    // A seam at the start of each newer release, where the older one jumps about 240 m.
+    REQUIRE(kReleases - 1 == stitcher.seams().size());
+    for (std::size_t i = 0; i < stitcher.seams().size(); i++)
+    {
+        const CPFSeam& seam = stitcher.seams()[i];
+        CHECK(i == seam.older && i + 1 == seam.newer);
+        CHECK_NEAR(static_cast<double>(seconds(seam.mjd, seam.sod)), (i + 1) * 86400., 1e-6);
+        CHECK_NEAR(static_cast<double>(seam.jump), 240., 40.);
+    }
+
+    // The jerk of the merged orbit at the seams stays at the natural one (about 0.01 m/s3), while the plain
+    // concatenation has a spike.
+    CPFStitcher unblended(0.);
+    for (const auto& release : releases)
+        unblended.addRelease(release);
+    CPF concatenated;
+    REQUIRE(CPFStitcher::NOT_ERROR == unblended.stitch(concatenated));
+    const Nodes merged_nodes = nodes(merged), concatenated_nodes = nodes(concatenated);
+    for (const auto& seam : stitcher.seams())
+    {
+        const long double instant = seconds(seam.mjd, seam.sod);
+        CHECK(maxJerk(merged_nodes, instant, 2400.L) < 0.02);
+        CHECK(maxJerk(concatenated_nodes, instant, 2400.L) > 0.2);
+    }
+
+    // Out of the blend time the nodes are the ones of the newest release.
+    for (int d = 0; d < kReleases; d++)
+    {
+        const long double instant = (d + 0.5L) * 86400.L;
+        const auto& release_records = releases[d].getData().positionRecords();
+        const auto it = std::find_if(release_records.begin(), release_records.end(),
+                                     [&](const CPFData::PositionRecord& r)
+        {
+            return std::abs(seconds(r.mjd, r.sod) - instant) < 1.L;
+        });
+        REQUIRE(it != release_records.end());
+        const auto merged_it = std::find_if(records.begin(), records.end(), [&](const CPFData::PositionRecord& r)
+        {
+            return r.mjd == it->mjd && std::abs(r.sod - it->sod) < 1e-6L;
+        });
+        REQUIRE(merged_it != records.end());
+        for (int c = 0; c < 3; c++)
+            CHECK_NEAR(static_cast<double>(merged_it->geocentric_pos[c]), static_cast<double>(it->geocentric_pos[c]),
+                       0.);
+    }
+}
+
+DPSLR_TEST(stitcherDeduplicatesOffsetGrids)
+{
+    // A newer release with a step of 180 s on a grid shifted 30 s covers the middle of the older one.
+    CPF older, newer;
+    REQUIRE(makeRelease(110., dpslrtest::kCPFStartJD, dpslrtest::kCPFStartJD + 2, 60, dpslrtest::kCPFStartMJD,
+                        older));
+    REQUIRE(makeRelease(110. + kMeanAnomalyShift, dpslrtest::kCPFStartJD + 0.5L + 30.L / 86400.L,
+                        dpslrtest::kCPFStartJD + 1, 180, dpslrtest::kCPFStartMJD + 1, newer));
+    CPFStitcher stitcher;
+    REQUIRE(CPFStitcher::NOT_ERROR == stitcher.addRelease(older));
+    REQUIRE(CPFStitcher::NOT_ERROR == stitcher.addRelease(newer));
+
+    CPF merged;
+    REQUIRE(CPFStitcher::NOT_ERROR == stitcher.stitch(merged));
+    CHECK(stitcher.gaps().empty());
+    CHECK(2 == stitcher.seams().size());
+    // The nodes of the older release closer than half its step to the newer ones are dropped, and the step is not
+    // uniform anymore.
+    checkSteps(merged, 30.L, 180.L);
+    CHECK(0 == merged.getHeader().basicInfo2Header()->time_between_entries.count());
+}
+
+DPSLR_TEST(stitcherSplitsAtGaps)
+{
+    // Two steps between the releases are not a gap, three steps are.
+    CPF first, close, far;
+    REQUIRE(makeRelease(110., dpslrtest::kCPFStartJD, dpslrtest::kCPFStartJD + 1, 60, dpslrtest::kCPFStartMJD, first));
+    REQUIRE(makeRelease(110., dpslrtest::kCPFStartJD + 1 + 120.L / 86400.L, dpslrtest::kCPFStartJD + 2, 60,
+                        dpslrtest::kCPFStartMJD + 1, close));
+    REQUIRE(makeRelease(110., dpslrtest::kCPFStartJD + 1 + 180.L / 86400.L, dpslrtest::kCPFStartJD + 2, 60,
+                        dpslrtest::kCPFStartMJD + 1, far));
+
+    CPFStitcher stitcher;
+    CPF merged;
+    stitcher.addRelease(first);
+    stitcher.addRelease(close);
+    REQUIRE(CPFStitcher::NOT_ERROR == stitcher.stitch(merged));
+    CHECK(stitcher.gaps().empty());
+    checkSteps(merged, 60.L, 120.L);
+
+    // With a gap, the single CPF is refused and it is not modified.
+    stitcher.clear();
+    stitcher.addRelease(first);
+    stitcher.addRelease(far);
+    CPF refused;
+    CHECK(CPFStitcher::EPHEMERIS_GAP == stitcher.stitch(refused));
+    CHECK(refused.getData().positionRecords().empty());
+    REQUIRE(1 == stitcher.gaps().size());
+    const CPFGap& gap = stitcher.gaps().front();
+    CHECK_NEAR(static_cast<double>(seconds(gap.mjd_start, gap.sod_start)), 86400., 1e-6);
+    CHECK_NEAR(static_cast<double>(seconds(gap.mjd_end, gap.sod_end)), 86580., 1e-6);
+
+    // Split at the gap, each part is continuous, has its own span, and is not interpolated over the gap.
+    std::vector<CPF> segments;
+    REQUIRE(CPFStitcher::NOT_ERROR == stitcher.stitch(segments));
+    REQUIRE(2 == segments.size());
+    CHECK(stitcher.seams().empty());
+    for (const auto& segment : segments)
+    {
+        checkSteps(segment, 60.L, 60.L);
+        CHECK(60 == segment.getHeader().basicInfo2Header()->time_between_entries.count());
+    }
+    CHECK(first.getData().positionRecords().size() == segments[0].getData().positionRecords().size());
+    CHECK(far.getData().positionRecords().size() == segments[1].getData().positionRecords().size());
+
+    CPFInterpolator::InterpolationResult result;
+    CPFInterpolator interpolator(segments[0], dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CHECK(CPFInterpolator::NOT_ERROR == interpolator.interpolate(dpslrtest::kCPFStartMJD, 43200.L, result));
+    CHECK(CPFInterpolator::NOT_ERROR != interpolator.interpolate(dpslrtest::kCPFStartMJD + 1, 90.L, result));
+    CPFInterpolator after(segments[1], dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CHECK(CPFInterpolator::NOT_ERROR == after.interpolate(dpslrtest::kCPFStartMJD + 1, 43200.L, result));
+}
+
+DPSLR_TEST(stitcherRejectsInvalidReleases)
+{
+    CPF release, other;
+    REQUIRE(makeRelease(110., dpslrtest::kCPFStartJD, dpslrtest::kCPFStartJD + 1, 60, dpslrtest::kCPFStartMJD,
+                        release));
+    REQUIRE(makeRelease(110., dpslrtest::kCPFStartJD, dpslrtest::kCPFStartJD + 1, 60, dpslrtest::kCPFStartMJD,
+                        other, "39453"));
+
+    CPFStitcher stitcher;
+    CPF merged;
+    std::vector<CPF> segments;
+    CHECK(CPFStitcher::NO_RELEASES == stitcher.stitch(merged));
+    CHECK(CPFStitcher::NO_RELEASES == stitcher.stitch(segments));
+    CHECK(CPFStitcher::CPF_NOT_VALID == stitcher.addRelease(CPF()));
+    REQUIRE(CPFStitcher::NOT_ERROR == stitcher.addRelease(release));
+    CHECK(CPFStitcher::TARGET_MISMATCH == stitcher.addRelease(other));
+    CHECK(1 == stitcher.releases());
+
+    stitcher.clear();
+    CHECK(0 == stitcher.releases() && stitcher.seams().empty() && stitcher.gaps().empty());
+    CHECK(CPFStitcher::NOT_ERROR == stitcher.addRelease(other));
+}
+
+DPSLR_BENCHMARK(stitcherLoadTime)
+{
+    // A week of passes served from the newest release of each day, loading the release file for each pass, against
+    // loading the releases once and stitching them.
+    std::vector<CPF> releases;
+    REQUIRE(makeDailyReleases(releases));
+    std::vector<std::string> paths;
+    for (int d = 0; d < kReleases; d++)
+    {
+        paths.push_back(temporaryPath("dpslr_stitcher_" + std::to_string(d) + ".cpf"));
+        REQUIRE(CPF::WriteFileErrorEnum::NOT_ERROR == releases[d].writeCPFFile(paths.back(), true));
+    }
+
+    std::vector<Pass> passes, day_passes;
+    for (int d = 0; d < kReleases; d++)
+    {
+        PassCalculator day_calculator(releases[d], dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), 10);
+        day_calculator.setSearchMode(PassCalculator::SearchMode::ADAPTIVE, false);
+        REQUIRE(PassCalculator::NOT_ERROR == day_calculator.getPasses(dpslrtest::kCPFStartMJD + d, 600.L,
+                                                                      dpslrtest::kCPFStartMJD + d, 85800.L,
+                                                                      day_passes));
+        passes.insert(passes.end(), day_passes.begin(), day_passes.end());
+    }
+    REQUIRE(!passes.empty());
+
+    // Positions of each pass at 1 s.
+    double sum = 0.;
+    const auto serve = [&](CPFInterpolator& interpolator, const Pass& pass)
+    {
+        CPFInterpolator::InterpolationResult result;
+        const long double duration = (pass.end.mjd - pass.start.mjd) * 86400.L + pass.end.fract_day -
+                pass.start.fract_day;
+        for (long double t = 0.L; t < duration; t += 1.L)
+        {
+            interpolator.interpolate(pass.start.mjd, pass.start.fract_day + t, result,
+                                     CPFInterpolator::INSTANT_VECTOR);
+            sum += static_cast<double>(result.tof_2w);
+        }
+    };
+
+    const double reload_ms = dpslrtest::measure([&]
+    {
+        for (const auto& pass : passes)
+        {
+            CPF release(paths[static_cast<std::size_t>(pass.start.mjd - dpslrtest::kCPFStartMJD)],
+                        CPF::OpenOptionEnum::ALL_DATA);
+            CPFInterpolator interpolator(release, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+            serve(interpolator, pass);
+        }
+    });
+
+    const double stitch_ms = dpslrtest::measure([&]
+    {
+        CPFStitcher stitcher;
+        for (const auto& path : paths)
+            stitcher.addRelease(CPF(path, CPF::OpenOptionEnum::ALL_DATA));
+        CPF merged;
+        stitcher.stitch(merged);
+        CPFInterpolator interpolator(merged, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+        for (const auto& pass : passes)
+            serve(interpolator, pass);
+    });
+    CHECK(sum > 0.);
+    CHECK(stitch_ms < reload_ms);
+
+    for (const auto& path : paths)
+        std::remove(path.c_str());
+
+    dpslrtest::report("Passes in a week", static_cast<double>(passes.size()), "");
+    dpslrtest::report("Reloading the release of each pass", reload_ms, "ms");
+    dpslrtest::report("Stitching the releases once", stitch_ms, "ms");
+    dpslrtest::report("Load time saved", reload_ms / stitch_ms, "x");
+}
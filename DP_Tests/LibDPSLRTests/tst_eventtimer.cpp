@@ -0,0 +1,245 @@
+#include "testing.h"
+
+#include <eventtimer.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+using namespace dpslr::eventtimer;
+
+namespace
+{
+
+// kHz system: 10 kHz fire rate with 1 ns of jitter, and flight times of 100 ms that grow 20 us per second (low orbit
+// rate), so there are 1000 pulses in flight. The epochs are picoseconds from the start of the pass.
+constexpr std::int64_t kFirePeriod = 100000000;
+constexpr std::int64_t kFireJitter = 1000;
+constexpr std::int64_t kFlightTime = 100000000000;
+constexpr double kFlightRate = 2e-5;
+// Window of +-10 ns around the predictions, and returns with 100 ps of noise and a bias of 2 ns.
+constexpr std::int64_t kWindow = 10000;
+constexpr double kReturnNoise = 100.;
+constexpr double kReturnBias = 2000.;
+
+struct EpochStreams
+{
+    std::vector<std::int64_t> starts;
+    std::vector<std::int64_t> predicted;
+    std::vector<std::int64_t> stops;
+    std::vector<std::size_t> returns;       // Start index of each stop, or starts.size() if it is noise.
+};
+
+// Returns in a fraction of the starts, and the same number of uniform noise stops over the whole stream.
+void makeStreams(std::size_t shots, double return_rate, EpochStreams& streams)
+{
+    std::mt19937 generator(11);
+    std::uniform_int_distribution<std::int64_t> jitter(-kFireJitter, kFireJitter);
+    std::uniform_real_distribution<double> draw(0., 1.);
+    std::normal_distribution<double> noise(kReturnBias, kReturnNoise);
+
+    std::vector<std::pair<std::int64_t, std::size_t>> stops;
+    for (std::size_t i = 0; i < shots; i++)
+    {
+        const std::int64_t start = static_cast<std::int64_t>(i) * kFirePeriod + jitter(generator);
+        const std::int64_t predicted = kFlightTime + static_cast<std::int64_t>(kFlightRate * start);
+        streams.starts.push_back(start);
+        streams.predicted.push_back(predicted);
+        if (draw(generator) < return_rate)
+            stops.push_back({start + predicted + static_cast<std::int64_t>(noise(generator)), i});
+    }
+
+    const std::int64_t span = streams.starts.back() + streams.predicted.back();
+    std::uniform_int_distribution<std::int64_t> uniform(0, span);
+    for (std::size_t i = 0, noise_stops = stops.size(); i < noise_stops; i++)
+        stops.push_back({uniform(generator), shots});
+
+    std::sort(stops.begin(), stops.end());
+    for (const auto& stop : stops)
+    {
+        streams.stops.push_back(stop.first);
+        streams.returns.push_back(stop.second);
+    }
+}
+
+// Exhaustive search of the candidates of each stop, without the merge.
+std::vector<EpochMatch> bruteForce(const EpochStreams& streams, std::int64_t win_lower, std::int64_t win_upper)
+{
+    std::vector<EpochMatch> matches;
+    std::vector<unsigned> start_stops(streams.starts.size(), 0);
+    for (std::size_t s = 0; s < streams.stops.size(); s++)
+    {
+        EpochMatch match{};
+        for (std::size_t i = 0; i < streams.starts.size(); i++)
+        {
+            const std::int64_t residual = streams.stops[s] - streams.starts[i] - streams.predicted[i];
+            if (residual < win_lower || residual > win_upper)
+                continue;
+            if (0 == match.candidates++ || std::llabs(residual) < std::llabs(match.tof_2w - match.pred_2w))
+            {
+                match.start_idx = i;
+                match.start = streams.starts[i];
+                match.tof_2w = streams.stops[s] - streams.starts[i];
+                match.pred_2w = streams.predicted[i];
+            }
+        }
+        if (0 == match.candidates)
+            continue;
+        match.stop_idx = s;
+        match.stop = streams.stops[s];
+        match.ambiguous = match.candidates > 1;
+        matches.push_back(match);
+        start_stops[match.start_idx]++;
+    }
+    for (auto& match : matches)
+        match.shared_start = start_stops[match.start_idx] > 1;
+    return matches;
+}
+
+bool sameMatch(const EpochMatch& a, const EpochMatch& b)
+{
+    return a.start_idx == b.start_idx && a.stop_idx == b.stop_idx && a.start == b.start && a.stop == b.stop &&
+           a.tof_2w == b.tof_2w && a.pred_2w == b.pred_2w && a.candidates == b.candidates &&
+           a.ambiguous == b.ambiguous && a.shared_start == b.shared_start;
+}
+
+void checkBruteForce(const EpochStreams& streams, std::int64_t win_lower, std::int64_t win_upper)
+{
+    std::vector<EpochMatch> matches;
+    REQUIRE(MatchEpochsError::NOT_ERROR == matchEpochs(streams.starts, streams.predicted, streams.stops, win_lower,
+                                                       win_upper, matches));
+    const std::vector<EpochMatch> expected = bruteForce(streams, win_lower, win_upper);
+    REQUIRE(expected.size() == matches.size());
+    for (std::size_t i = 0; i < matches.size(); i++)
+        CHECK(sameMatch(matches[i], expected[i]));
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(matchEpochsRecoversReturns)
+{
+    // 2 s of shots, with 1000 pulses in flight.
+    EpochStreams streams;
+    makeStreams(20000, 0.2, streams);
+
+    std::vector<EpochMatch> matches;
+    REQUIRE(MatchEpochsError::NOT_ERROR == matchEpochs(streams.starts, streams.predicted, streams.stops, -kWindow,
+                                                       kWindow, matches));
+
+    // Every return is matched with its fire. The window is shorter than the fire period, so nothing is ambiguous, and
+    // only a few noise stops fall inside a window.
+    std::size_t returns = 0, noise = 0;
+    for (const auto& match : matches)
+    {
+        CHECK(!match.ambiguous && 1 == match.candidates);
+        CHECK(match.tof_2w == match.stop - match.start);
+        CHECK(std::llabs(match.tof_2w - match.pred_2w) <= kWindow);
+        if (streams.returns[match.stop_idx] == match.start_idx)
+            returns++;
+        else
+            noise++;
+    }
+    const std::size_t expected_returns = static_cast<std::size_t>(
+                std::count_if(streams.returns.begin(), streams.returns.end(),
+                              [&](std::size_t i){return i < streams.starts.size();}));
+    CHECK(expected_returns == returns);
+    CHECK(noise < expected_returns * 2 * kWindow / kFirePeriod + 10);
+
+    checkBruteForce(streams, -kWindow, kWindow);
+}
+
+DPSLR_TEST(matchEpochsAmbiguity)
+{
+    // With a window wider than the fire period, the noise and the returns have several candidates.
+    EpochStreams streams;
+    makeStreams(5000, 0.2, streams);
+    checkBruteForce(streams, -kFirePeriod - kFirePeriod / 2, kFirePeriod + kFirePeriod / 2);
+    checkBruteForce(streams, -kFirePeriod / 4, 2 * kFirePeriod);
+
+    // Two returns of the same pulse share the start, and the nearest start to the prediction wins the ambiguity.
+    const std::vector<std::int64_t> starts{0, 1000, 2000, 3000}, predicted{50000, 50000, 50000, 50000};
+    const std::vector<std::int64_t> stops{51010, 51100, 52550};
+    std::vector<EpochMatch> matches;
+    REQUIRE(MatchEpochsError::NOT_ERROR == matchEpochs(starts, predicted, stops, -600, 600, matches));
+    REQUIRE(3 == matches.size());
+    CHECK(1 == matches[0].start_idx && 1 == matches[0].candidates && !matches[0].ambiguous);
+    CHECK(1 == matches[1].start_idx && matches[0].shared_start && matches[1].shared_start);
+    CHECK(3 == matches[2].start_idx && 2 == matches[2].candidates && matches[2].ambiguous);
+    CHECK(!matches[2].shared_start);
+    CHECK(-450 == matches[2].tof_2w - matches[2].pred_2w);
+
+    // The window limits are included.
+    REQUIRE(MatchEpochsError::NOT_ERROR == matchEpochs(starts, predicted, {50900, 52100, 52101}, -100, 100, matches));
+    REQUIRE(2 == matches.size());
+    CHECK(1 == matches[0].start_idx && -100 == matches[0].tof_2w - matches[0].pred_2w);
+    CHECK(2 == matches[1].start_idx && 100 == matches[1].tof_2w - matches[1].pred_2w);
+}
+
+DPSLR_TEST(matchEpochsToRangeData)
+{
+    const std::vector<std::int64_t> starts{1000000000000, 1000000100000}, predicted{90000, 90000};
+    std::vector<EpochMatch> matches;
+    REQUIRE(MatchEpochsError::NOT_ERROR == matchEpochs(starts, predicted, {1000000140000, 1000000190010},
+                                                       -60000, 60000, matches));
+    REQUIRE(2 == matches.size());
+    CHECK(matches[0].ambiguous && !matches[1].ambiguous);
+
+    const dpslr::common::RangeData ranges = matchesToRangeData(matches);
+    REQUIRE(2 == ranges.size());
+    CHECK_NEAR(static_cast<double>(std::get<0>(ranges[1])), 1.0000001, 1e-15);
+    CHECK_NEAR(static_cast<double>(std::get<1>(ranges[1])), 90010., 0.);
+    CHECK_NEAR(static_cast<double>(std::get<2>(ranges[1])), 90000., 0.);
+    CHECK_NEAR(static_cast<double>(std::get<3>(ranges[1])), 0., 0.);
+    CHECK(1 == matchesToRangeData(matches, true).size());
+}
+
+DPSLR_TEST(matchEpochsRejectsInvalidInput)
+{
+    std::vector<EpochMatch> matches;
+    const std::vector<std::int64_t> starts{0, 1000, 2000}, predicted{50000, 50000, 50000}, stops{51000, 52000};
+
+    CHECK(MatchEpochsError::DATA_SIZE_MISMATCH == matchEpochs(starts, {50000, 50000}, stops, -10, 10, matches));
+    CHECK(MatchEpochsError::WINDOW_NOT_VALID == matchEpochs(starts, predicted, stops, 10, -10, matches));
+    CHECK(MatchEpochsError::STARTS_NOT_SORTED == matchEpochs({0, 2000, 1000}, predicted, stops, -10, 10, matches));
+    CHECK(MatchEpochsError::STOPS_NOT_SORTED == matchEpochs(starts, predicted, {52000, 51000}, -10, 10, matches));
+
+    // The expected stop of the second start is before the first one, so the merge could skip candidates.
+    CHECK(MatchEpochsError::PREDICTIONS_NOT_VALID == matchEpochs(starts, {50000, 48000, 50000}, stops, -10, 10,
+                                                                 matches));
+    CHECK(matches.empty());
+
+    // Equal expected stops are valid.
+    CHECK(MatchEpochsError::NOT_ERROR == matchEpochs(starts, {50000, 49000, 48000}, {50005}, -10, 10, matches));
+    CHECK(1 == matches.size() && 3 == matches[0].candidates);
+
+    CHECK(MatchEpochsError::NOT_ERROR == matchEpochs({}, {}, stops, -10, 10, matches) && matches.empty());
+    CHECK(MatchEpochsError::NOT_ERROR == matchEpochs(starts, predicted, {}, -10, 10, matches) && matches.empty());
+}
+
+DPSLR_BENCHMARK(matchEpochsThroughput)
+{
+    // One minute at 10 kHz with 100 ms flight times: 600000 starts, 20% of returns and the same number of noise stops.
+    EpochStreams streams;
+    makeStreams(600000, 0.2, streams);
+
+    std::vector<EpochMatch> matches;
+    const double match_ms = dpslrtest::measure([&]
+    {
+        matchEpochs(streams.starts, streams.predicted, streams.stops, -kWindow, kWindow, matches);
+    });
+    CHECK(matches.size() >= streams.stops.size() / 2);
+
+    dpslr::common::RangeData ranges;
+    const double ranges_ms = dpslrtest::measure([&]
+    {
+        ranges = matchesToRangeData(matches);
+    });
+    CHECK(ranges.size() == matches.size());
+
+    dpslrtest::report("Starts", static_cast<double>(streams.starts.size()), "");
+    dpslrtest::report("Stops", static_cast<double>(streams.stops.size()), "");
+    dpslrtest::report("Matching", match_ms, "ms");
+    dpslrtest::report("Matching per stop", match_ms * 1e6 / streams.stops.size(), "ns");
+    dpslrtest::report("Matching throughput", streams.starts.size() / match_ms / 1000., "Mstarts/s");
+    dpslrtest::report("Conversion to range data", ranges_ms, "ms");
+}
@@ -0,0 +1,168 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <crdutils.h>
+
+#include <cmath>
+#include <random>
+
+using namespace dpslr;
+
+namespace
+{
+
+// Synthetic LAGEOS pass: 600 s at 10 Hz from 11:59:10, with 20 ps gaussian noise, 10% of uniform outliers in
+// +-3 ns and a quadratic residual signature. The bins of 120 s are fixed from the start of the day, so the first and
+// last ones are partial.
+constexpr double kFireRate = 10.;
+constexpr double kBinSize = 120.;
+constexpr double kStart = 43150.;
+constexpr int kShots = 6000;
+constexpr double kNoise = 20.;
+constexpr double kOutliers = 0.1;
+
+struct SyntheticPass
+{
+    CRD crd;
+    common::ResidualsData<> residuals;
+    std::vector<long double> true_tof;   // Time of flight without noise, in seconds.
+};
+
+long double signature(long double t)
+{
+    const long double dt = t - kStart;
+    return 500.L + 2.L * dt - 0.003L * dt * dt;
+}
+
+void makePass(SyntheticPass& pass)
+{
+    CRDConfiguration::SystemConfiguration system_cfg{};
+    system_cfg.system_cfg_id = "std";
+    system_cfg.transmit_wavelength = 532;
+    pass.crd.getConfiguration().systemConfiguration() = system_cfg;
+    CRDConfiguration::LaserConfiguration laser_cfg{};
+    laser_cfg.fire_rate = kFireRate;
+    pass.crd.getConfiguration().laserConfiguration() = laser_cfg;
+
+    std::mt19937 generator(7);
+    std::normal_distribution<double> noise(0., kNoise);
+    std::uniform_real_distribution<double> outlier(-3000., 3000.), draw(0., 1.);
+
+    std::vector<CRDData::FullRateRecord> records;
+    for (int i = 0; i < kShots; i++)
+    {
+        const long double t = kStart + i / kFireRate;
+        const long double predicted = 0.04L + 1e-6L * (t - kStart);
+        const long double residual = signature(t) + (draw(generator) < kOutliers ? outlier(generator) :
+                                                                                   noise(generator));
+        CRDData::FullRateRecord record{};
+        record.time_tag = t;
+        record.time_flight = predicted + residual * 1e-12L;
+        record.system_cfg_id = "std";
+        record.epoch_event = CRDData::EpochEventEnum::GROUND_TRANSMIT_TIME_2W;
+        record.filter_flag = CRDData::FilterFlagEnum::DATA;
+        records.push_back(record);
+        pass.residuals.push_back({t, residual});
+        pass.true_tof.push_back(predicted + signature(t) * 1e-12L);
+    }
+    pass.crd.getData().setFullRateRecords(records);
+}
+
+// Records of the pass in the day fixed bin of the time.
+std::size_t recordsInBin(double time_tag)
+{
+    const double bin_start = std::floor(time_tag / kBinSize) * kBinSize;
+    const double first = std::max(bin_start, kStart);
+    const double last = std::min(bin_start + kBinSize, kStart + kShots / kFireRate);
+    return static_cast<std::size_t>(std::llround((last - first) * kFireRate));
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(normalPointsMatchTruth)
+{
+    SyntheticPass pass;
+    makePass(pass);
+    REQUIRE(crdutils::NPGenErr::NOT_ERROR == crdutils::generateNormalPoints(kBinSize, pass.residuals, pass.crd));
+
+    const auto& normal_points = pass.crd.getData().normalPointRecords();
+    REQUIRE(6 == normal_points.size());
+
+    // A gaussian truncated at 2.5 sigma has 0.936 of the sigma and keeps 98.8% of the points, so about 89% of the
+    // records are accepted (the outliers inside the window are less than 2% more). The margins are about 3 sigma.
+    const double truncated_rms = 0.936 * kNoise;
+    for (std::size_t i = 0; i < normal_points.size(); i++)
+    {
+        const auto& np = normal_points[i];
+        const double bin_start = std::floor((kStart + i * kBinSize) / kBinSize) * kBinSize;
+        CHECK(np.time_tag >= bin_start && np.time_tag < bin_start + kBinSize);
+
+        // The epoch is a record of the pass, and the time of flight is the true one there, with the noise of the mean.
+        const std::size_t k = static_cast<std::size_t>(std::llround((np.time_tag - kStart) * kFireRate));
+        REQUIRE(k < pass.true_tof.size());
+        const std::size_t records = recordsInBin(static_cast<double>(np.time_tag));
+        CHECK_NEAR(static_cast<double>((np.time_flight - pass.true_tof[k]) * 1e12L), 0.,
+                   4. * kNoise / std::sqrt(0.9 * records));
+
+        REQUIRE(np.bin_rms && np.bin_skew && np.bin_kurtosis && np.bin_peak);
+        CHECK_NEAR(*np.bin_rms, truncated_rms, 0.1 * truncated_rms);
+        CHECK_NEAR(*np.bin_skew, 0., 0.3);
+        CHECK(np.raw_ranges > 0.85 * records && np.raw_ranges < 0.93 * records);
+        CHECK_NEAR(np.window_length, kBinSize, 0.);
+        CHECK_NEAR(np.return_rate, 100. * np.raw_ranges / (kBinSize * kFireRate), 1e-9);
+    }
+}
+
+DPSLR_TEST(normalPointsSkipNoiseAndSparseBins)
+{
+    SyntheticPass pass;
+    makePass(pass);
+
+    // The second bin is flagged as noise, and the third one only keeps two records.
+    std::vector<CRDData::FullRateRecord> records = pass.crd.getData().fullRateRecords();
+    for (std::size_t i = 0; i < records.size(); i++)
+    {
+        const double t = static_cast<double>(records[i].time_tag);
+        if ((t >= 43200. && t < 43320.) || (t > 43320.15 && t < 43440.))
+            records[i].filter_flag = CRDData::FilterFlagEnum::NOISE_EXCLUDED_RETURN;
+    }
+    pass.crd.getData().setFullRateRecords(records);
+
+    CHECK(crdutils::NPGenErr::SOME_BINS_CALC_FAILED ==
+          crdutils::generateNormalPoints(kBinSize, pass.residuals, pass.crd));
+
+    const auto& normal_points = pass.crd.getData().normalPointRecords();
+    REQUIRE(4 == normal_points.size());
+    for (const auto& np : normal_points)
+        CHECK(np.time_tag < 43200. || np.time_tag >= 43440.);
+}
+
+DPSLR_TEST(normalPointsRejectInvalidInput)
+{
+    SyntheticPass pass;
+    makePass(pass);
+
+    CHECK(crdutils::NPGenErr::BIN_SIZE_NOT_VALID == crdutils::generateNormalPoints(0., pass.residuals, pass.crd));
+
+    common::ResidualsData<> missing(pass.residuals.begin(), pass.residuals.end() - 1);
+    CHECK(crdutils::NPGenErr::RESIDS_NOT_MATCHING == crdutils::generateNormalPoints(kBinSize, missing, pass.crd));
+
+    CRD without_cfg(2.f);
+    without_cfg.getData().setFullRateRecords(pass.crd.getData().fullRateRecords());
+    CHECK(crdutils::NPGenErr::CRD_CFG_NOT_VALID ==
+          crdutils::generateNormalPoints(kBinSize, pass.residuals, without_cfg));
+
+    CRD empty(2.f);
+    CHECK(crdutils::NPGenErr::CRD_DATA_EMPTY == crdutils::generateNormalPoints(kBinSize, pass.residuals, empty));
+}
+
+DPSLR_TEST(normalPointBinSizeByOrbit)
+{
+    CPF lageos, low_orbit;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLageosTLE, 1, 300, lageos));
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, low_orbit));
+
+    CHECK_NEAR(crdutils::normalPointBinSize(lageos), 120., 0.);
+    CHECK_NEAR(crdutils::normalPointBinSize(low_orbit), 15., 0.);
+    CHECK_NEAR(crdutils::normalPointBinSize(CPF()), 0., 0.);
+}
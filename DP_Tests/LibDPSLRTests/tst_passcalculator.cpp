@@ -0,0 +1,142 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <cpfutils.h>
+
+#include <cmath>
+
+using namespace dpslr::cpfutils;
+
+namespace
+{
+
+// Precision of the adaptive search over the brute force one (its step), with margin for the rounding of the times.
+constexpr double kBruteForceStep = 1.;
+constexpr double kTimeMargin = 1e-3;
+// Time tolerance of the adaptive search refinements (seconds).
+constexpr double kRefinementTolerance = 1e-4;
+
+// Seconds from the start of the first CPF day.
+double seconds(const Pass::Step& step)
+{
+    return (step.mjd - dpslrtest::kCPFStartMJD) * 86400. + static_cast<double>(step.fract_day);
+}
+
+PassCalculator makeCalculator(const CPF& cpf, unsigned min_elev, PassCalculator::SearchMode mode)
+{
+    PassCalculator calculator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), min_elev,
+                              kBruteForceStep);
+    calculator.setSearchMode(mode, false);
+    return calculator;
+}
+
+// Passes between the seconds given from the start of the first CPF day.
+bool passesBetween(const PassCalculator& calculator, double start, double end, std::vector<Pass>& passes)
+{
+    const int mjd_start = dpslrtest::kCPFStartMJD + static_cast<int>(start / 86400.);
+    const int mjd_end = dpslrtest::kCPFStartMJD + static_cast<int>(end / 86400.);
+    return PassCalculator::NOT_ERROR == calculator.getPasses(
+                mjd_start, start - (mjd_start - dpslrtest::kCPFStartMJD) * 86400., mjd_end,
+                end - (mjd_end - dpslrtest::kCPFStartMJD) * 86400., passes);
+}
+
+// The brute force search keeps the samples above the minimum elevation, so the exact rise is within the step before
+// its first sample and the exact set within the step after its last one.
+void checkAgainstBruteForce(const Pass& adaptive, const Pass& brute_force)
+{
+    CHECK(seconds(adaptive.start) <= seconds(brute_force.start) + kTimeMargin);
+    CHECK(seconds(adaptive.start) > seconds(brute_force.start) - kBruteForceStep - kTimeMargin);
+    CHECK(seconds(adaptive.end) >= seconds(brute_force.end) - kTimeMargin);
+    CHECK(seconds(adaptive.end) < seconds(brute_force.end) + kBruteForceStep + kTimeMargin);
+    CHECK_NEAR(adaptive.start.elev, adaptive.min_elev, std::abs(adaptive.start.elev_rate) * kRefinementTolerance);
+    CHECK_NEAR(adaptive.end.elev, adaptive.min_elev, std::abs(adaptive.end.elev_rate) * kRefinementTolerance);
+
+    // The culmination is refined, so it can't be lower than the best sample.
+    CHECK(adaptive.culmination.elev >= brute_force.culmination.elev - 1e-9);
+    CHECK_NEAR(seconds(adaptive.culmination), seconds(brute_force.culmination), kBruteForceStep);
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(passCalculatorMatchesBruteForce)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLageosTLE, 2, 120, cpf));
+
+    std::vector<Pass> adaptive, brute_force;
+    REQUIRE(passesBetween(makeCalculator(cpf, 10, PassCalculator::SearchMode::ADAPTIVE), 3600., 90000., adaptive));
+    REQUIRE(passesBetween(makeCalculator(cpf, 10, PassCalculator::SearchMode::FIXED_STEP), 3600., 90000.,
+                          brute_force));
+
+    REQUIRE(!brute_force.empty());
+    REQUIRE(adaptive.size() == brute_force.size());
+    for (std::size_t i = 0; i < adaptive.size(); i++)
+        checkAgainstBruteForce(adaptive[i], brute_force[i]);
+}
+
+DPSLR_TEST(passCalculatorFindsGrazingPasses)
+{
+    // Each low orbit pass, with the minimum elevation at the integer below its culmination, is a grazing pass. Many of
+    // them are shorter than the search step.
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 7, 60, cpf));
+
+    std::vector<Pass> passes;
+    REQUIRE(passesBetween(makeCalculator(cpf, 0, PassCalculator::SearchMode::ADAPTIVE), 3600., 522000., passes));
+    REQUIRE(!passes.empty());
+
+    std::size_t short_passes = 0;
+    for (const auto& pass : passes)
+    {
+        if (pass.culmination.elev < 1.)
+            continue;
+
+        const unsigned min_elev = static_cast<unsigned>(std::floor(pass.culmination.elev));
+        const double culmination = seconds(pass.culmination);
+        std::vector<Pass> adaptive, brute_force;
+        REQUIRE(passesBetween(makeCalculator(cpf, min_elev, PassCalculator::SearchMode::ADAPTIVE),
+                              culmination - 900., culmination + 900., adaptive));
+        REQUIRE(passesBetween(makeCalculator(cpf, min_elev, PassCalculator::SearchMode::FIXED_STEP),
+                              culmination - 900., culmination + 900., brute_force));
+
+        // Passes that last less than the brute force step can fall between its samples.
+        if (brute_force.empty())
+        {
+            CHECK(adaptive.size() <= 1);
+            CHECK(adaptive.empty() || seconds(adaptive[0].end) - seconds(adaptive[0].start) < kBruteForceStep);
+            continue;
+        }
+
+        CHECK(1 == brute_force.size());
+        REQUIRE(1 == adaptive.size());
+        checkAgainstBruteForce(adaptive[0], brute_force[0]);
+        if (seconds(adaptive[0].end) - seconds(adaptive[0].start) < 60.)
+            short_passes++;
+    }
+    CHECK(short_passes >= 5);
+}
+
+DPSLR_BENCHMARK(passCalculatorLageosWeek)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLageosTLE, 9, 120, cpf));
+
+    const PassCalculator fixed = makeCalculator(cpf, 10, PassCalculator::SearchMode::FIXED_STEP);
+    const PassCalculator adaptive = makeCalculator(cpf, 10, PassCalculator::SearchMode::ADAPTIVE);
+    PassCalculator dense = makeCalculator(cpf, 10, PassCalculator::SearchMode::ADAPTIVE);
+    dense.setSearchMode(PassCalculator::SearchMode::ADAPTIVE, true);
+
+    std::vector<Pass> fixed_passes, adaptive_passes, dense_passes;
+    const double fixed_ms = dpslrtest::measure([&]{passesBetween(fixed, 86400., 691200., fixed_passes);}, 1);
+    const double adaptive_ms = dpslrtest::measure([&]{passesBetween(adaptive, 86400., 691200., adaptive_passes);});
+    const double dense_ms = dpslrtest::measure([&]{passesBetween(dense, 86400., 691200., dense_passes);});
+
+    CHECK(fixed_passes.size() == adaptive_passes.size());
+    CHECK(fixed_passes.size() == dense_passes.size());
+
+    dpslrtest::report("LAGEOS 7 days over 10 deg, passes", static_cast<double>(adaptive_passes.size()), "");
+    dpslrtest::report("Fixed step (1 s)", fixed_ms, "ms");
+    dpslrtest::report("Adaptive", adaptive_ms, "ms");
+    dpslrtest::report("Adaptive with dense steps (1 s)", dense_ms, "ms");
+    dpslrtest::report("Adaptive speed-up", fixed_ms / adaptive_ms, "x");
+}
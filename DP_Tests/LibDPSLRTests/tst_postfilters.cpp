@@ -0,0 +1,144 @@
+#include "testing.h"
+
+#include <algorithms.h>
+
+#include <cmath>
+#include <random>
+
+using namespace dpslr;
+
+namespace
+{
+
+// Synthetic pass: ten bins of 60 s at 20 Hz separated by gaps of 1 s, so they are the bins of the fit, with a residual
+// signature that changes with each bin, 20 ps of gaussian noise and 30% of uniform noise in +-2 ns.
+constexpr double kFireRate = 20.;
+constexpr int kBins = 10;
+constexpr double kBinSize = 60.;
+constexpr double kBinPeriod = 61.;
+constexpr double kNoise = 20.;
+constexpr double kOutliers = 0.3;
+constexpr double kOutlierSpan = 2000.;
+
+// Cubic signature of each bin, in picoseconds.
+double signature(double t)
+{
+    const double bin = std::floor(t / kBinPeriod);
+    const double dt = t - bin * kBinPeriod;
+    return 100. * bin + (3. - 0.2 * bin) * dt - 0.05 * dt * dt + 0.0004 * dt * dt * dt;
+}
+
+std::vector<double> pointTimes()
+{
+    std::vector<double> times;
+    for (int bin = 0; bin < kBins; bin++)
+        for (int i = 0; i < static_cast<int>(kBinSize * kFireRate); i++)
+            times.push_back(bin * kBinPeriod + i / kFireRate);
+    return times;
+}
+
+struct SyntheticResiduals
+{
+    std::vector<double> times;
+    std::vector<double> resids;
+    std::vector<char> signal;
+};
+
+void makeResiduals(SyntheticResiduals& data)
+{
+    std::mt19937 generator(7);
+    std::normal_distribution<double> noise(0., kNoise);
+    std::uniform_real_distribution<double> draw(0., 1.);
+    std::uniform_real_distribution<double> outlier(-kOutlierSpan, kOutlierSpan);
+    for (double t : pointTimes())
+    {
+        const bool signal = draw(generator) >= kOutliers;
+        data.times.push_back(t);
+        data.resids.push_back(signature(t) + (signal ? noise(generator) : outlier(generator)));
+        data.signal.push_back(signal);
+    }
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(binPolynomialFitFollowsEachBin)
+{
+    // Without noise, the fit of each bin is the cubic of that bin, up to the conditioning of the higher degree fits
+    // (hundredths of picosecond).
+    const std::vector<double> bin_times = pointTimes();
+    std::vector<double> bin_resids;
+    for (double t : bin_times)
+        bin_resids.push_back(signature(t));
+
+    for (unsigned degree : {3u, 9u})
+    {
+        const std::vector<double> fit = algorithms::binPolynomialFit(bin_times, bin_resids, kBinSize, degree);
+        REQUIRE(fit.size() == bin_resids.size());
+        double max_error = 0.;
+        for (std::size_t i = 0; i < fit.size(); i++)
+            max_error = std::max(max_error, std::abs(fit[i] - bin_resids[i]));
+        CHECK_NEAR(max_error, 0., 0.02);
+    }
+
+    // A single bin of a line is the line, and an invalid input gives an empty fit.
+    const std::vector<double> line = algorithms::binPolynomialFit({0., 1., 2., 3.}, {1., 3., 5., 7.}, 10., 1);
+    REQUIRE(4 == line.size());
+    for (std::size_t i = 0; i < line.size(); i++)
+        CHECK_NEAR(line[i], 1. + 2. * i, 1e-9);
+    CHECK(algorithms::binPolynomialFit({}, {}, kBinSize).empty());
+    CHECK(algorithms::binPolynomialFit({0., 1.}, {0.}, kBinSize).empty());
+    CHECK(algorithms::binPolynomialFit({0., 1.}, {0., 1.}, 0.).empty());
+}
+
+DPSLR_TEST(threshPostfilterSeparatesSignal)
+{
+    SyntheticResiduals data;
+    makeResiduals(data);
+
+    const std::vector<std::size_t> accepted = algorithms::threshPostfilterSLR(data.times, data.resids, kBinSize, 2.5,
+                                                                              3);
+    REQUIRE(!accepted.empty());
+    CHECK(std::is_sorted(accepted.begin(), accepted.end()));
+
+    std::size_t signal = 0, accepted_signal = 0;
+    for (char s : data.signal)
+        signal += s;
+    for (std::size_t idx : accepted)
+        accepted_signal += data.signal[idx];
+
+    // Nearly all the signal is kept (2.5 sigma keeps 98.8% of it), and only the noise that falls in the band around
+    // the signature (+-50 ps out of +-2 ns, so about 1% of the accepted points) is accepted.
+    const double recall = accepted_signal * 100. / signal;
+    const double precision = accepted_signal * 100. / accepted.size();
+    CHECK(recall > 97.);
+    CHECK(precision > 98.5);
+
+    // The accepted residuals are within the threshold of the signature.
+    double max_dev = 0.;
+    for (std::size_t idx : accepted)
+        max_dev = std::max(max_dev, std::abs(data.resids[idx] - signature(data.times[idx])));
+    CHECK(max_dev < 4. * kNoise);
+}
+
+DPSLR_TEST(threshPostfilterIterations)
+{
+    SyntheticResiduals data;
+    makeResiduals(data);
+
+    // A single iteration only rejects the points beyond 2.5 times the deviation of everything, which is dominated
+    // by the noise, so it keeps more points than the converged filter.
+    const auto one = algorithms::threshPostfilterSLR(data.times, data.resids, kBinSize, 2.5, 3, 1);
+    const auto converged = algorithms::threshPostfilterSLR(data.times, data.resids, kBinSize, 2.5, 3);
+    CHECK(one.size() > converged.size());
+
+    // The converged selection is a fixed point.
+    const auto again = algorithms::threshPostfilterSLR(helpers::extract(data.times, converged),
+                                                       helpers::extract(data.resids, converged), kBinSize, 2.5, 3, 1);
+    CHECK(again.size() == converged.size());
+
+    // Invalid input.
+    CHECK(algorithms::threshPostfilterSLR({}, {}, kBinSize).empty());
+    CHECK(algorithms::threshPostfilterSLR({0., 1.}, {0.}, kBinSize).empty());
+    CHECK(algorithms::threshPostfilterSLR(data.times, data.resids, 0.).empty());
+    CHECK(algorithms::threshPostfilterSLR(data.times, data.resids, kBinSize, 0.).empty());
+}
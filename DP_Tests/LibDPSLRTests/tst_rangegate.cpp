@@ -0,0 +1,194 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <cpfutils.h>
+#include <dpslr_math.h>
+
+#include <cmath>
+
+using namespace dpslr::cpfutils;
+
+namespace
+{
+
+// Margin of the prepared intervals around the passes, for the time biases (seconds).
+constexpr long double kMargin = 5.L;
+// The prepared tolerance is checked between the nodes, so some margin is left for the rest of the segments.
+constexpr double kTolerance = 1e-13;
+constexpr double kMaxError = 1.5e-13;
+// Instants compared for each fire rate. The shots are spread over the whole pass, on the fire rate grid.
+constexpr std::size_t kComparedShots = 40000;
+
+struct PassWindow
+{
+    int mjd;
+    long double sod_start;
+    long double duration;
+};
+
+// First pass over 10 degrees of the CPF, from its second hour.
+bool firstPass(const CPF& cpf, PassWindow& window)
+{
+    PassCalculator calculator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric(), 10);
+    calculator.setSearchMode(PassCalculator::SearchMode::ADAPTIVE, false);
+    std::vector<Pass> passes;
+    if (PassCalculator::NOT_ERROR != calculator.getPasses(dpslrtest::kCPFStartMJD, 3600.L,
+                                                          dpslrtest::kCPFStartMJD + 1, 0.L, passes) ||
+            passes.empty())
+        return false;
+
+    const Pass& pass = passes.front();
+    window.mjd = pass.start.mjd;
+    window.sod_start = pass.start.fract_day;
+    window.duration = (pass.end.mjd - pass.start.mjd) * 86400.L + pass.end.fract_day - pass.start.fract_day;
+    return true;
+}
+
+// Maximum difference with the light time flight time of the interpolator (seconds) of the shots fired at the rate
+// during the pass.
+double maxDifference(const CPF& cpf, const RangeGatePredictor& predictor, const PassWindow& window, double rate)
+{
+    CPFInterpolator interpolator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CPFInterpolator::InterpolationResult result;
+    const std::size_t shots = static_cast<std::size_t>(window.duration * rate);
+    const std::size_t stride = std::max<std::size_t>(1, shots / kComparedShots);
+
+    double max_difference = 0.;
+    for (std::size_t i = 0; i < shots; i += stride)
+    {
+        const long double sod = window.sod_start + i / static_cast<long double>(rate);
+        double tof_2w;
+        if (!predictor.tof(window.mjd, sod, tof_2w))
+            return 1.;
+        interpolator.interpolate(window.mjd, sod, result, CPFInterpolator::AVERAGE_DISTANCE);
+        max_difference = std::max(max_difference, std::abs(tof_2w - static_cast<double>(result.tof_2w)));
+    }
+    return max_difference;
+}
+
+void checkAccuracy(const char* tle, unsigned step)
+{
+    CPF cpf;
+    PassWindow window;
+    REQUIRE(dpslrtest::makeCPF(tle, 1, step, cpf));
+    REQUIRE(firstPass(cpf, window));
+
+    RangeGatePredictor predictor(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    REQUIRE(RangeGatePredictor::NOT_ERROR == predictor.prepare(window.mjd, window.sod_start - kMargin,
+                                                               window.duration + 2 * kMargin, kTolerance));
+    CHECK(predictor.maxError() <= kTolerance);
+    CHECK_NEAR(predictor.segments() * predictor.segmentLength(), static_cast<double>(window.duration + 2 * kMargin),
+               1e-6);
+
+    for (double rate : {1000., 2000., 5000., 10000.})
+        CHECK_NEAR(maxDifference(cpf, predictor, window, rate), 0., kMaxError);
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(rangeGateMatchesInterpolatorLageos)
+{
+    checkAccuracy(dpslrtest::kLageosTLE, 120);
+}
+
+DPSLR_TEST(rangeGateMatchesInterpolatorLowOrbit)
+{
+    checkAccuracy(dpslrtest::kLowOrbitTLE, 60);
+}
+
+DPSLR_TEST(rangeGateAppliesBiases)
+{
+    CPF cpf;
+    PassWindow window;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+    REQUIRE(firstPass(cpf, window));
+
+    RangeGatePredictor predictor(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    REQUIRE(RangeGatePredictor::NOT_ERROR == predictor.prepare(window.mjd, window.sod_start - kMargin,
+                                                               window.duration + 2 * kMargin));
+
+    // The time bias moves the instant, and the range bias adds its two way flight time.
+    const double time_bias = 0.01;
+    const double range_bias = 1.5;
+    predictor.setTimeBias(time_bias);
+    predictor.setRangeBias(range_bias);
+    CHECK_NEAR(predictor.timeBias(), time_bias, 0.);
+    CHECK_NEAR(predictor.rangeBias(), range_bias, 1e-12);
+
+    CPFInterpolator interpolator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CPFInterpolator::InterpolationResult result;
+    const long double sod = window.sod_start + 100.L;
+    double tof_2w;
+    REQUIRE(predictor.tof(window.mjd, sod, tof_2w));
+    interpolator.interpolate(window.mjd, sod + time_bias, result, CPFInterpolator::AVERAGE_DISTANCE);
+    CHECK_NEAR(tof_2w, static_cast<double>(result.tof_2w) + 2. * range_bias / dpslr::math::c, kMaxError);
+
+    // Outside of the prepared interval, including the time bias.
+    CHECK(!predictor.tof(window.mjd, window.sod_start - kMargin - 0.02L, tof_2w));
+    CHECK(!predictor.tof(window.mjd, window.sod_start + window.duration + kMargin, tof_2w));
+}
+
+DPSLR_TEST(rangeGateRejectsInvalidParameters)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+    RangeGatePredictor predictor(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+
+    CHECK(RangeGatePredictor::PARAMETERS_NOT_VALID == predictor.prepare(dpslrtest::kCPFStartMJD, 3600.L, 0.L));
+    CHECK(RangeGatePredictor::PARAMETERS_NOT_VALID == predictor.prepare(dpslrtest::kCPFStartMJD, 3600.L, 600.L,
+                                                                        0.));
+    CHECK(RangeGatePredictor::PARAMETERS_NOT_VALID == predictor.prepare(dpslrtest::kCPFStartMJD, 3600.L, 600.L,
+                                                                        kTolerance, 0));
+    CHECK(RangeGatePredictor::INTERVAL_OUTSIDE_OF_CPF == predictor.prepare(dpslrtest::kCPFStartMJD + 1, 3600.L,
+                                                                           600.L));
+    CHECK(predictor.empty());
+
+    RangeGatePredictor empty(CPF(), dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    CHECK(RangeGatePredictor::CPF_NOT_VALID == empty.prepare(dpslrtest::kCPFStartMJD, 3600.L, 600.L));
+}
+
+DPSLR_BENCHMARK(rangeGateThroughput)
+{
+    CPF cpf;
+    PassWindow window;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLageosTLE, 1, 120, cpf));
+    REQUIRE(firstPass(cpf, window));
+
+    RangeGatePredictor predictor(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    const double prepare_ms = dpslrtest::measure([&]
+    {
+        predictor.prepare(window.mjd, window.sod_start - kMargin, window.duration + 2 * kMargin);
+    });
+
+    // The whole pass at 10 kHz with the predictor, and a part of it with the interpolator.
+    const std::size_t shots = static_cast<std::size_t>(window.duration * 10000.L);
+    double sum = 0.;
+    const double predictor_ms = dpslrtest::measure([&]
+    {
+        double tof_2w;
+        for (std::size_t i = 0; i < shots; i++)
+            if (predictor.tof(window.mjd, window.sod_start + i / 10000.L, tof_2w))
+                sum += tof_2w;
+    });
+
+    const std::size_t interpolated = 50000;
+    CPFInterpolator interpolator(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    const double interpolator_ms = dpslrtest::measure([&]
+    {
+        CPFInterpolator::InterpolationResult result;
+        for (std::size_t i = 0; i < interpolated; i++)
+        {
+            interpolator.interpolate(window.mjd, window.sod_start + i / 10000.L, result,
+                                     CPFInterpolator::AVERAGE_DISTANCE);
+            sum += static_cast<double>(result.tof_2w);
+        }
+    });
+    CHECK(sum > 0.);
+
+    dpslrtest::report("LAGEOS pass duration", static_cast<double>(window.duration), "s");
+    dpslrtest::report("Prepare (" + std::to_string(predictor.segments()) + " segments)", prepare_ms, "ms");
+    dpslrtest::report("Predictor, whole pass at 10 kHz", predictor_ms, "ms");
+    dpslrtest::report("Predictor per shot", predictor_ms * 1e6 / shots, "ns");
+    dpslrtest::report("Interpolator per shot", interpolator_ms * 1e6 / interpolated, "ns");
+    dpslrtest::report("Predictor throughput", shots / predictor_ms / 1000., "Mshots/s");
+}
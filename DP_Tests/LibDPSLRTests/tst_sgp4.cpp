@@ -0,0 +1,237 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <sgp4.h>
+#include <utils.h>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+
+using namespace dpslr::sgp4;
+
+namespace
+{
+
+// Verification TLEs and vectors published with the revised SGP4 (Vallado et al., AIAA 2006-6753, SGP4-VER.TLE).
+// 00005 is a near Earth orbit and 08195 a 12 hour resonant deep space orbit.
+const char* kTLE00005 = "00005\n"
+        "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753\n"
+        "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667\n";
+const char* kTLE08195 = "08195\n"
+        "1 08195U 75081A   06176.33215444  .00000099  00000-0  11873-3 0   813\n"
+        "2 08195  64.1586 279.0717 6877146 264.7651  20.2257  2.00491383225656\n";
+
+struct Vector
+{
+    double tsince;
+    std::array<double, 3> r;
+    std::array<double, 3> v;
+};
+
+const Vector kVectors00005[] = {
+    {0., {7022.46529266, -1400.08296755, 0.03995155}, {1.893841015, 6.405893759, 4.534807250}},
+    {360., {-7154.03120202, -3783.17682504, -3536.19412294}, {4.741887409, -4.151817765, -2.093935425}},
+    {720., {-7134.59340119, 6531.68641334, 3260.27186483}, {-4.113793027, -2.911922039, -2.557327851}}};
+
+const Vector kVectors08195[] = {
+    {0., {2349.89483350, -14785.93811562, 0.02119378}, {2.721488096, -3.256811655, 4.498416672}}};
+
+// The vectors are printed with 8 decimals for the position (km) and 9 for the velocity (km/s).
+constexpr double kPositionTolerance = 1e-7;
+constexpr double kVelocityTolerance = 1e-8;
+
+constexpr int kBenchmarkObjects = 10000;
+constexpr int kBenchmarkChunk = 1000;
+constexpr int kBenchmarkEpochs = 24 * 60 + 1;
+constexpr int kBenchmarkSerialObjects = 500;
+
+bool parse(const char* lines, Elements& elements)
+{
+    TLE tle;
+    return tle.parseLines(lines) && SGP4Error::NOT_ERROR == parseTLE(tle, elements);
+}
+
+void checkVectors(const Elements& elements, const Vector* vectors, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        ResonanceState resonance;
+        std::array<double, 3> r, v;
+        CHECK(SGP4Error::NOT_ERROR == propagate(elements, vectors[i].tsince, resonance, r, v));
+        for (int k = 0; k < 3; k++)
+        {
+            CHECK_NEAR(r[k], vectors[i].r[k], kPositionTolerance);
+            CHECK_NEAR(v[k], vectors[i].v[k], kVelocityTolerance);
+        }
+    }
+}
+
+// Synthetic catalogue: mostly low orbits, with some 12 hour orbits that use the deep space model.
+std::vector<Elements> makeCatalogue(int count)
+{
+    std::vector<Elements> catalogue;
+    catalogue.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        const bool deep = 0 == i % 10;
+        const int norad = 10000 + i;
+        char line1[80], line2[80];
+        std::snprintf(line1, sizeof(line1),
+                      "1 %05dU 58002B   23290.50000000  .00000023  00000-0  28098-4 0  4753", norad);
+        std::snprintf(line2, sizeof(line2), "2 %05d %8.4f %8.4f %07d %8.4f %8.4f %11.8f%5d0", norad,
+                      deep ? 64.1586 : 51.6 + (i % 40), (i * 7.3) - 360. * static_cast<int>(i * 7.3 / 360.),
+                      deep ? 6877146 : 1000 + (i % 90) * 100, 90. + (i % 180),
+                      (i * 13.7) - 360. * static_cast<int>(i * 13.7 / 360.), deep ? 2.00491383 : 14.2 + (i % 17) * 0.1,
+                      i % 100000);
+
+        TLE tle;
+        Elements elements;
+        if (tle.parseLines("OBJECT\n" + std::string(line1) + '\n' + line2 + '\n') &&
+                SGP4Error::NOT_ERROR == parseTLE(tle, elements))
+            catalogue.push_back(elements);
+    }
+    return catalogue;
+}
+
+std::vector<long double> makeEpochs(long double jd_start, int count, double step_seconds)
+{
+    std::vector<long double> epochs(count);
+    for (int i = 0; i < count; i++)
+        epochs[i] = jd_start + i * step_seconds / 86400.0L;
+    return epochs;
+}
+
+}
+
+DPSLR_TEST(sgp4NearEarthVerificationVectors)
+{
+    Elements elements;
+    REQUIRE(parse(kTLE00005, elements));
+    CHECK(!elements.deep_space);
+    checkVectors(elements, kVectors00005, sizeof(kVectors00005) / sizeof(Vector));
+}
+
+DPSLR_TEST(sgp4DeepSpaceVerificationVectors)
+{
+    Elements elements;
+    REQUIRE(parse(kTLE08195, elements));
+    CHECK(elements.deep_space);
+    CHECK(2 == elements.irez);
+    checkVectors(elements, kVectors08195, sizeof(kVectors08195) / sizeof(Vector));
+}
+
+DPSLR_TEST(sgp4ResonanceStateContinuesIntegration)
+{
+    // Continuing the integration from the previous time gives the same results as integrating from the epoch.
+    Elements elements;
+    REQUIRE(parse(kTLE08195, elements));
+
+    ResonanceState continued;
+    for (double tsince = 0.; tsince <= 2880.; tsince += 120.)
+    {
+        ResonanceState fresh;
+        std::array<double, 3> r_continued, v_continued, r_fresh, v_fresh;
+        CHECK(SGP4Error::NOT_ERROR == propagate(elements, tsince, continued, r_continued, v_continued));
+        CHECK(SGP4Error::NOT_ERROR == propagate(elements, tsince, fresh, r_fresh, v_fresh));
+        for (int k = 0; k < 3; k++)
+        {
+            CHECK_NEAR(r_continued[k], r_fresh[k], 1e-9);
+            CHECK_NEAR(v_continued[k], v_fresh[k], 1e-12);
+        }
+    }
+}
+
+DPSLR_TEST(sgp4BatchMatchesSinglePropagation)
+{
+    std::vector<Elements> elements(2);
+    REQUIRE(parse(kTLE00005, elements[0]));
+    REQUIRE(parse(kTLE08195, elements[1]));
+    const long double jd_start = static_cast<long double>(elements[1].jd_epoch) + elements[1].jd_epoch_fraction;
+    const std::vector<long double> epochs = makeEpochs(jd_start, 200, 600.);
+
+    StateVectors states;
+    propagateBatch(elements, epochs, states);
+    REQUIRE(2 == states.objects && epochs.size() == states.epochs);
+
+    for (std::size_t i = 0; i < elements.size(); i++)
+        for (std::size_t j = 0; j < epochs.size(); j++)
+        {
+            std::array<double, 3> r, v;
+            const SGP4Error error = propagateToJulian(elements[i], epochs[j], r, v);
+            const std::size_t index = states.index(i, j);
+            CHECK(error == states.errors[index]);
+            CHECK_NEAR(states.x[index], r[0], 1e-9);
+            CHECK_NEAR(states.y[index], r[1], 1e-9);
+            CHECK_NEAR(states.z[index], r[2], 1e-9);
+            CHECK_NEAR(states.vx[index], v[0], 1e-12);
+            CHECK_NEAR(states.vy[index], v[1], 1e-12);
+            CHECK_NEAR(states.vz[index], v[2], 1e-12);
+        }
+}
+
+DPSLR_TEST(sgp4GeneratedCPFHeaders)
+{
+    // CPFs of consecutive days around the new year, generated in parallel as the propagator does. The sequence number
+    // is the day of year of the first position (2023-12-20 is the day 354) and the CPFs are valid for the loaders.
+    TLE tle;
+    Elements elements;
+    REQUIRE(tle.parseLines(dpslrtest::kLageosTLE) && SGP4Error::NOT_ERROR == parseTLE(tle, elements));
+    constexpr int kDays = 64;
+    constexpr long double kFirstJD = 2400000.5L + 60298;
+    std::vector<CPF> cpfs(kDays);
+
+    #pragma omp parallel for
+    for (int i = 0; i < kDays; i++)
+        generateCPF(tle, elements, kFirstJD + i, kFirstJD + i + 1, 300, cpfs[i]);
+
+    for (int i = 0; i < kDays; i++)
+    {
+        const auto& h1 = cpfs[i].getHeader().basicInfo1Header();
+        const auto& h2 = cpfs[i].getHeader().basicInfo2Header();
+        REQUIRE(h1 && h2);
+        CHECK((354 + i - 1) % 365 + 1 == h1->cpf_sequence_number);
+        CHECK(h2->tiv_compatible);
+        CHECK(CPFHeader::ReferenceFrameEnum::GEOCENTRIC_BODY_FIXED == h2->reference_frame);
+        CHECK(dpslr::utils::julianToTimePoint(kFirstJD + i) == h2->start_time);
+        CHECK(std::chrono::hours(24) == h2->end_time - h2->start_time);
+    }
+}
+
+DPSLR_BENCHMARK(sgp4Batch10kObjects24Hours)
+{
+    // 10k objects over 24 hours at 60 s. The batch is run in chunks of objects, to keep the memory of the results
+    // reasonable, and compared with a serial loop over a subset of the objects.
+    const std::vector<Elements> catalogue = makeCatalogue(kBenchmarkObjects);
+    REQUIRE(kBenchmarkObjects == static_cast<int>(catalogue.size()));
+    const std::vector<long double> epochs = makeEpochs(2460238.0L, kBenchmarkEpochs, 60.);
+
+    StateVectors states;
+    const double batch_ms = dpslrtest::measure([&]
+    {
+        for (int first = 0; first < kBenchmarkObjects; first += kBenchmarkChunk)
+        {
+            const std::vector<Elements> chunk(catalogue.begin() + first, catalogue.begin() + first + kBenchmarkChunk);
+            propagateBatch(chunk, epochs, states);
+        }
+    }, 1);
+
+    std::array<double, 3> r, v;
+    double checksum = 0.;
+    const double serial_ms = dpslrtest::measure([&]
+    {
+        for (int i = 0; i < kBenchmarkSerialObjects; i++)
+            for (const auto& epoch : epochs)
+            {
+                propagateToJulian(catalogue[i], epoch, r, v);
+                checksum += r[0];
+            }
+    }, 1);
+
+    const double states_total = static_cast<double>(kBenchmarkObjects) * kBenchmarkEpochs;
+    const double serial_states = static_cast<double>(kBenchmarkSerialObjects) * kBenchmarkEpochs;
+    dpslrtest::report("propagateBatch, 10k objects x 1441 epochs", batch_ms, "ms");
+    dpslrtest::report("propagateBatch, per state", batch_ms * 1e6 / states_total, "ns");
+    dpslrtest::report("serial propagateToJulian, per state", serial_ms * 1e6 / serial_states, "ns");
+    CHECK(std::isfinite(checksum));
+}
@@ -0,0 +1,227 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <sun.h>
+#include <tracking.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace dpslr;
+using namespace dpslr::tracking;
+
+namespace
+{
+
+constexpr double kDegToRad = math::pi / 180.;
+constexpr double kMJDToJ2000 = 2400000.5 - 2451545.0;
+
+// Accuracy of the table (interpolated from 1 s knots) against the CPF interpolation, in degrees.
+constexpr double kPointingTolerance = 0.01 / 3600.;
+
+// Angle between two directions, in degrees.
+double separation(double az_1, double el_1, double az_2, double el_2)
+{
+    const double cos_angle = std::sin(el_1 * kDegToRad) * std::sin(el_2 * kDegToRad) +
+            std::cos(el_1 * kDegToRad) * std::cos(el_2 * kDegToRad) * std::cos((az_1 - az_2) * kDegToRad);
+    return std::acos(std::max(-1., std::min(1., cos_angle))) / kDegToRad;
+}
+
+double sunSeparation(const TrackingPoint& point, const geo::frames::GeodeticPoint<long double>& geodetic)
+{
+    geo::frames::GeodeticPoint<long double> geodetic_deg = geodetic;
+    geodetic_deg.convert(geo::meas::Angle<long double>::Unit::DEGREES, geo::meas::Distance<long double>::Unit::METRES);
+    double sun_az, sun_el;
+    sun::simpleSunPosition(point.mjd + kMJDToJ2000 + static_cast<double>(point.sod) / 86400.,
+                           static_cast<double>(static_cast<long double>(geodetic_deg.lat)),
+                           static_cast<double>(static_cast<long double>(geodetic_deg.lon)), false, sun_az, sun_el);
+    return separation(point.az, point.el, sun_az, sun_el);
+}
+
+// The rows are separated by the rate limit of the mount at most, so there are no jumps.
+double maxStep(const TrackingTable& table)
+{
+    double max_step = 0.;
+    for (std::size_t i = 1; i < table.points.size(); i++)
+        max_step = std::max(max_step, separation(table.points[i].az, table.points[i].el, table.points[i - 1].az,
+                                                 table.points[i - 1].el));
+    return max_step;
+}
+
+// Maximum pointing difference (degrees) with the CPF interpolation of the rows not moved by the Sun or the keyhole.
+double maxPointingError(const CPF& cpf, const geo::frames::GeodeticPoint<long double>& geodetic,
+                        const geo::frames::GeocentricPoint<long double>& geocentric, const TrackingTable& table)
+{
+    cpfutils::CPFInterpolator interpolator(cpf, geodetic, geocentric);
+    cpfutils::CPFInterpolator::InterpolationResult result;
+    double max_error = 0.;
+    for (std::size_t i = 0; i < table.points.size(); i += 7)
+    {
+        const TrackingPoint& point = table.points[i];
+        if (point.sun_avoidance || point.keyhole)
+            continue;
+        interpolator.interpolate(point.mjd, point.sod, result);
+        max_error = std::max(max_error, separation(point.az, point.el, result.azimuth, result.elevation));
+    }
+    return max_error;
+}
+
+void checkLimits(const TrackingTable& table, const TrackingConfig& config)
+{
+    for (const auto& point : table.points)
+        CHECK(point.az >= config.az_min && point.az <= config.az_max);
+}
+
+// Passes over the horizon in the first days of the CPF.
+std::vector<cpfutils::Pass> passes(const CPF& cpf, const geo::frames::GeodeticPoint<long double>& geodetic,
+                                   const geo::frames::GeocentricPoint<long double>& geocentric, int days = 1)
+{
+    cpfutils::PassCalculator calculator(cpf, geodetic, geocentric, 0);
+    calculator.setSearchMode(cpfutils::PassCalculator::SearchMode::ADAPTIVE, false);
+    std::vector<cpfutils::Pass> result;
+    calculator.getPasses(dpslrtest::kCPFStartMJD, 3600.L, dpslrtest::kCPFStartMJD + days - 1, 82800.L, result);
+    return result;
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(trackingTableFollowsObject)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+    const auto geodetic = dpslrtest::stationGeodetic();
+    const auto geocentric = dpslrtest::stationGeocentric();
+    const std::vector<cpfutils::Pass> day_passes = passes(cpf, geodetic, geocentric);
+    REQUIRE(!day_passes.empty());
+
+    TrackingConfig config;
+    config.sun_avoid_angle = 0.;
+    for (const auto& pass : day_passes)
+    {
+        TrackingTable table;
+        REQUIRE(TrackingError::NOT_ERROR == generateTrackingTable(cpf, geodetic, geocentric, pass, config, table));
+
+        const double duration = (pass.end.mjd - pass.start.mjd) * 86400. +
+                static_cast<double>(pass.end.fract_day - pass.start.fract_day);
+        CHECK_NEAR(static_cast<double>(table.points.size()), duration * config.rate + 1., 1.);
+        CHECK(!table.sun_avoidance);
+        CHECK_NEAR(maxPointingError(cpf, geodetic, geocentric, table), 0., kPointingTolerance);
+        CHECK(maxStep(table) <= table.max_az_rate / config.rate + table.max_el_rate / config.rate + 1e-9);
+        checkLimits(table, config);
+    }
+}
+
+DPSLR_TEST(trackingTableOverheadPass)
+{
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 1, 60, cpf));
+
+    // Station on the ground track at 02:00, so the object passes 0.02 degrees from the zenith.
+    const long double culmination = 7200.L;
+    cpfutils::CPFInterpolator sfel(cpf, dpslrtest::stationGeodetic(), dpslrtest::stationGeocentric());
+    cpfutils::CPFInterpolator::InterpolationResult position;
+    REQUIRE(cpfutils::CPFInterpolator::NOT_ERROR == sfel.interpolate(dpslrtest::kCPFStartMJD, culmination, position));
+    const long double x = position.geocentric[0], y = position.geocentric[1], z = position.geocentric[2];
+    const long double a = 6378137.L, e2 = 0.00669438L;
+    const long double lat = std::atan(z / std::sqrt(x * x + y * y) / (1.L - e2));
+    const long double lon = std::atan2(y, x);
+    const long double n = a / std::sqrt(1.L - e2 * std::sin(lat) * std::sin(lat));
+    const geo::frames::GeodeticPoint<long double> geodetic(lat, lon, 0.L);
+    const geo::frames::GeocentricPoint<long double> geocentric(n * std::cos(lat) * std::cos(lon),
+                                                               n * std::cos(lat) * std::sin(lon),
+                                                               n * (1.L - e2) * std::sin(lat));
+
+    const cpfutils::Pass* overhead = nullptr;
+    const std::vector<cpfutils::Pass> day_passes = passes(cpf, geodetic, geocentric);
+    for (const auto& pass : day_passes)
+        if (pass.culmination.elev > 89.9)
+            overhead = &pass;
+    REQUIRE(overhead);
+
+    // Without the keyhole, the azimuth turns half a circle in a few seconds.
+    TrackingConfig config;
+    TrackingConfig raw_config = config;
+    raw_config.keyhole_elev = 90.;
+    TrackingTable table, raw_table;
+    REQUIRE(TrackingError::NOT_ERROR == generateTrackingTable(cpf, geodetic, geocentric, *overhead, raw_config,
+                                                              raw_table));
+    CHECK(!raw_table.keyhole);
+    CHECK(raw_table.max_az_rate > config.max_az_rate);
+
+    REQUIRE(TrackingError::NOT_ERROR == generateTrackingTable(cpf, geodetic, geocentric, *overhead, config, table));
+    CHECK(table.keyhole);
+    CHECK(table.max_az_rate <= config.max_az_rate + 1e-6);
+    CHECK(maxStep(table) <= (config.max_az_rate + table.max_el_rate) / config.rate);
+    CHECK_NEAR(maxPointingError(cpf, geodetic, geocentric, table), 0., kPointingTolerance);
+    checkLimits(table, config);
+
+    // The smoothed positions are a single block around the zenith, enlarged out of the keyhole elevation only as
+    // much as the rate limit needs.
+    std::size_t first = table.points.size(), last = 0;
+    for (std::size_t i = 0; i < table.points.size(); i++)
+    {
+        if (table.points[i].keyhole)
+        {
+            first = std::min(first, i);
+            last = i;
+        }
+        else
+            CHECK(table.points[i].el <= config.keyhole_elev);
+    }
+    REQUIRE(first <= last);
+    CHECK(last - first + 1 == static_cast<std::size_t>(std::count_if(table.points.begin(), table.points.end(),
+                                                                     [](const TrackingPoint& p){return p.keyhole;})));
+    CHECK((last - first) / config.rate < 60.);
+}
+
+DPSLR_TEST(trackingTableAvoidsTheSun)
+{
+    // The pass of three days that gets nearer to the Sun (about 16 degrees), with cones that contain it.
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLowOrbitTLE, 3, 60, cpf));
+    const auto geodetic = dpslrtest::stationGeodetic();
+    const auto geocentric = dpslrtest::stationGeocentric();
+
+    TrackingConfig free_config;
+    free_config.sun_avoid_angle = 0.;
+    cpfutils::Pass nearest;
+    double nearest_separation = 180.;
+    for (const auto& pass : passes(cpf, geodetic, geocentric, 3))
+    {
+        TrackingTable table;
+        REQUIRE(TrackingError::NOT_ERROR == generateTrackingTable(cpf, geodetic, geocentric, pass, free_config,
+                                                                  table));
+        if (table.min_sun_separation < nearest_separation)
+        {
+            nearest = pass;
+            nearest_separation = table.min_sun_separation;
+        }
+    }
+    REQUIRE(nearest_separation < 20.);
+
+    for (double cone : {30., 60.})
+    {
+        TrackingConfig config;
+        config.sun_avoid_angle = cone;
+        TrackingTable table;
+        REQUIRE(TrackingError::NOT_ERROR == generateTrackingTable(cpf, geodetic, geocentric, nearest, config, table));
+        CHECK(table.sun_avoidance);
+        CHECK_NEAR(table.min_sun_separation, nearest_separation, 1e-6);
+
+        // The mount never enters the cone, and it follows the object out of the cone and its margin.
+        double min_commanded = 180., max_accel = 0.;
+        for (const auto& point : table.points)
+        {
+            min_commanded = std::min(min_commanded, sunSeparation(point, geodetic));
+            max_accel = std::max({max_accel, std::abs(point.az_accel), std::abs(point.el_accel)});
+            CHECK(point.sun_avoidance || point.sun_separation >= cone);
+            if (point.sun_separation > cone + config.sun_margin)
+                CHECK(!point.sun_avoidance);
+        }
+        CHECK(min_commanded >= cone - 0.01);
+        CHECK(max_accel < 0.5);
+        CHECK(maxStep(table) <= (table.max_az_rate + table.max_el_rate) / config.rate);
+        CHECK_NEAR(maxPointingError(cpf, geodetic, geocentric, table), 0., kPointingTolerance);
+        checkLimits(table, config);
+    }
+}
@@ -0,0 +1,254 @@
+#include "testing.h"
+#include "testdata.h"
+
+#include <algorithms.h>
+#include <cpfutils.h>
+#include <geo.h>
+
+#include <cmath>
+#include <random>
+
+using namespace dpslr;
+using namespace dpslr::geo;
+
+namespace
+{
+
+constexpr double kDegToRad = math::pi / 180.;
+constexpr double kWavelength = 0.532;
+constexpr meteo::WtrVapPressModel kVapourModel = meteo::WtrVapPressModel::GIACOMO_DAVIS;
+// The batch and the scalar functions must agree well under a micrometre.
+constexpr double kBatchTolerance = 1e-9;
+
+// Meteo records every minute for 40 minutes, with random values of a typical site.
+meteo::MeteoSeries makeRecords()
+{
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> draw(0., 1.);
+    meteo::MeteoSeries records;
+    for (int i = 0; i <= 40; i++)
+    {
+        records.times.push_back(i * 60.L);
+        records.pres.push_back(930. + 5. * draw(generator));
+        records.temp.push_back(285. + 10. * draw(generator));
+        records.rh.push_back(30. + 40. * draw(generator));
+    }
+    return records;
+}
+
+// Shots over the records (and a bit out of them), with elevations from 20 to 80 degrees.
+void makeShots(std::size_t shots, std::vector<long double>& times, std::vector<double>& elevations)
+{
+    times.resize(shots);
+    elevations.resize(shots);
+    for (std::size_t i = 0; i < shots; i++)
+    {
+        times[i] = -30.L + i * (2460.L / shots);
+        elevations[i] = (50. + 30. * std::sin(i * 6. / shots)) * kDegToRad;
+    }
+}
+
+double maxBatchDifference(tropo::TropoModel model, std::size_t shots)
+{
+    std::vector<long double> times;
+    std::vector<double> elevations, delays;
+    makeShots(shots, times, elevations);
+    meteo::MeteoSeries shot_meteo;
+    if (!meteo::interpolateMeteo(makeRecords(), times, shot_meteo) ||
+            !tropo::pathDelayBatch(shot_meteo, elevations, kWavelength, 36.46 * kDegToRad, 98.2, model, kVapourModel,
+                                   delays))
+        return 1.;
+
+    double max_difference = 0.;
+    for (std::size_t i = 0; i < shots; i++)
+    {
+        const double scalar = tropo::TropoModel::MARINI_MURRAY == model ?
+                    tropo::pathDelayMariniMurray(shot_meteo.pres[i], shot_meteo.temp[i], shot_meteo.rh[i],
+                                                 elevations[i], kWavelength, 36.46 * kDegToRad, 98.2, kVapourModel) :
+                    tropo::pathDelayMendesPavlis(shot_meteo.pres[i], shot_meteo.temp[i], shot_meteo.rh[i],
+                                                 elevations[i], kWavelength, 36.46 * kDegToRad, 98.2, kVapourModel);
+        max_difference = std::max(max_difference, std::abs(scalar - delays[i]));
+    }
+    return max_difference;
+}
+
+} // END ANONYMOUS NAMESPACE.
+
+DPSLR_TEST(tropoBatchMatchesScalar)
+{
+    CHECK_NEAR(maxBatchDifference(tropo::TropoModel::MARINI_MURRAY, 1000000), 0., kBatchTolerance);
+    CHECK_NEAR(maxBatchDifference(tropo::TropoModel::MENDES_PAVLIS, 1000000), 0., kBatchTolerance);
+}
+
+DPSLR_TEST(tropoMendesPavlisReference)
+{
+    // Test cases of the IERS Conventions (2010) routines FCUL_ZD_HPA and FCUL_A. The zenith delay differs by 4 um
+    // (2e-6 relative) from the published value, due to the rounded constants of the dispersion.
+    CHECK_NEAR(tropo::zenithDelayMendesPavlis(798.4188, 14.322, 0.532, 30.67166667 * kDegToRad, 2010.344),
+               1.935225924846803, 5e-6);
+    CHECK_NEAR(tropo::mappingFunctionFCULa(15. * kDegToRad, 300.15, 30.67166667 * kDegToRad, 2075.),
+               3.800243667312344, 1e-12);
+    CHECK_NEAR(tropo::mappingFunctionFCULa(90. * kDegToRad, 300.15, 30.67166667 * kDegToRad, 2075.), 1., 1e-15);
+
+    // Both models agree within a few millimetres at usual elevations.
+    for (double el : {20., 45., 90.})
+    {
+        const double mm = tropo::pathDelayMariniMurray(1013.25, 288.15, 50., el * kDegToRad, kWavelength,
+                                                       40. * kDegToRad, 0., kVapourModel);
+        const double mp = tropo::pathDelayMendesPavlis(1013.25, 288.15, 50., el * kDegToRad, kWavelength,
+                                                       40. * kDegToRad, 0., kVapourModel);
+        CHECK_NEAR(mp, mm, 0.01);
+    }
+}
+
+DPSLR_TEST(tropoMeteoInterpolation)
+{
+    const meteo::MeteoSeries records = makeRecords();
+    meteo::MeteoSeries result;
+
+    // Clamped out of the records, equal at the records and linear between them.
+    REQUIRE(meteo::interpolateMeteo(records, {-5.L, 0.L, 30.L, 90.L, 2400.L, 3000.L}, result));
+    REQUIRE(6 == result.pres.size() && 6 == result.temp.size() && 6 == result.rh.size());
+    CHECK_NEAR(result.pres[0], records.pres[0], 0.);
+    CHECK_NEAR(result.pres[1], records.pres[0], 0.);
+    CHECK_NEAR(result.pres[2], (records.pres[0] + records.pres[1]) / 2., 1e-12);
+    CHECK_NEAR(result.temp[3], (records.temp[1] + records.temp[2]) / 2., 1e-12);
+    CHECK_NEAR(result.rh[3], (records.rh[1] + records.rh[2]) / 2., 1e-12);
+    CHECK_NEAR(result.pres[4], records.pres[40], 0.);
+    CHECK_NEAR(result.pres[5], records.pres[40], 0.);
+
+    CHECK(!meteo::interpolateMeteo(meteo::MeteoSeries(), {0.L}, result));
+    meteo::MeteoSeries missing = records;
+    missing.rh.pop_back();
+    CHECK(!meteo::interpolateMeteo(missing, {0.L}, result));
+    meteo::MeteoSeries unsorted = records;
+    std::swap(unsorted.times[3], unsorted.times[4]);
+    CHECK(!meteo::interpolateMeteo(unsorted, {0.L}, result));
+
+    std::vector<double> delays;
+    CHECK(!tropo::pathDelayBatch(records, {0.5}, kWavelength, 0.6, 0., tropo::TropoModel::MARINI_MURRAY,
+                                 kVapourModel, delays));
+}
+
+DPSLR_TEST(tropoFullRateResiduals)
+{
+    // Full rate flight times of 10 minutes of a LAGEOS pass at 10 Hz, with meteo records every minute.
+    CPF cpf;
+    REQUIRE(dpslrtest::makeCPF(dpslrtest::kLageosTLE, 1, 120, cpf));
+    const auto geodetic = dpslrtest::stationGeodetic();
+    const auto geocentric = dpslrtest::stationGeocentric();
+    cpfutils::PassCalculator calculator(cpf, geodetic, geocentric, 20);
+    std::vector<cpfutils::Pass> passes;
+    REQUIRE(cpfutils::PassCalculator::NOT_ERROR == calculator.getPasses(dpslrtest::kCPFStartMJD, 3600.L,
+                                                                        dpslrtest::kCPFStartMJD, 82800.L, passes));
+    REQUIRE(!passes.empty());
+    const int mjd = passes.front().start.mjd;
+    const long double sod_start = passes.front().start.fract_day;
+
+    cpfutils::CPFInterpolator interpolator(cpf, geodetic, geocentric);
+    cpfutils::CPFInterpolator::InterpolationResult result;
+    common::FlightTimeData ftdata;
+    std::vector<long double> times;
+    std::vector<double> elevations;
+    for (int i = 0; i < 6000; i++)
+    {
+        const long double t = sod_start + i / 10.L;
+        REQUIRE(cpfutils::CPFInterpolator::NOT_ERROR == interpolator.interpolate(
+                    mjd, t, result, cpfutils::CPFInterpolator::INSTANT_VECTOR));
+        ftdata.push_back({t, result.tof_2w});
+        times.push_back(t);
+        elevations.push_back(static_cast<double>(result.elevation) * kDegToRad);
+    }
+
+    std::vector<CRDData::MeteorologicalRecord> meteo_records;
+    const meteo::MeteoSeries records = makeRecords();
+    for (std::size_t i = 0; i < 12; i++)
+    {
+        CRDData::MeteorologicalRecord record{};
+        record.time_tag = sod_start - 30.L + records.times[i];
+        record.surface_pressure = records.pres[i];
+        record.surface_temperature = records.temp[i];
+        record.surface_relative_humidity = records.rh[i];
+        meteo_records.push_back(record);
+    }
+
+    // The two way correction is the scalar model with the meteo interpolated at each shot.
+    meteo::MeteoSeries shot_meteo, shifted = records;
+    for (auto& time : shifted.times)
+        time += sod_start - 30.L;
+    REQUIRE(meteo::interpolateMeteo(shifted, times, shot_meteo));
+
+    const double lat = 36.46525 * kDegToRad, alt = 98.177;
+    for (auto model : {tropo::TropoModel::MARINI_MURRAY, tropo::TropoModel::MENDES_PAVLIS})
+    {
+        common::ResidualsData<> rdata;
+        std::vector<long double> pred_dist, trop_corr;
+        REQUIRE(algorithms::FullRateResCalcErr::NOT_ERROR == algorithms::calculateFullRateResiduals(
+                    cpf, mjd, ftdata, meteo_records, geodetic, geocentric, kWavelength, 30, rdata, pred_dist,
+                    trop_corr, model));
+        REQUIRE(ftdata.size() == trop_corr.size() && ftdata.size() == pred_dist.size());
+
+        double max_difference = 0.;
+        for (std::size_t i = 0; i < ftdata.size(); i++)
+        {
+            const double delay = tropo::TropoModel::MARINI_MURRAY == model ?
+                        tropo::pathDelayMariniMurray(shot_meteo.pres[i], shot_meteo.temp[i], shot_meteo.rh[i],
+                                                     elevations[i], kWavelength, lat, alt, kVapourModel) :
+                        tropo::pathDelayMendesPavlis(shot_meteo.pres[i], shot_meteo.temp[i], shot_meteo.rh[i],
+                                                     elevations[i], kWavelength, lat, alt, kVapourModel);
+            const double corr_2w = 2. * delay / math::c * math::kSecondToPicosecond;
+            max_difference = std::max(max_difference, std::abs(static_cast<double>(trop_corr[i]) - corr_2w));
+        }
+        // 0.01 ps is 1.5 um one way.
+        CHECK_NEAR(max_difference, 0., 0.01);
+    }
+
+    // An unknown model can't be calculated.
+    common::ResidualsData<> rdata;
+    std::vector<long double> pred_dist, trop_corr;
+    CHECK(algorithms::FullRateResCalcErr::RESIDS_CALC_FAILED == algorithms::calculateFullRateResiduals(
+              cpf, mjd, ftdata, meteo_records, geodetic, geocentric, kWavelength, 30, rdata, pred_dist, trop_corr,
+              static_cast<tropo::TropoModel>(0)));
+}
+
+DPSLR_BENCHMARK(tropoThroughput)
+{
+    // One million shots over 40 minutes of meteo records.
+    const std::size_t shots = 1000000;
+    const meteo::MeteoSeries records = makeRecords();
+    std::vector<long double> times;
+    std::vector<double> elevations, delays;
+    makeShots(shots, times, elevations);
+
+    meteo::MeteoSeries shot_meteo;
+    const double interpolation_ms = dpslrtest::measure([&]
+    {
+        meteo::interpolateMeteo(records, times, shot_meteo);
+    });
+    const double marini_ms = dpslrtest::measure([&]
+    {
+        tropo::pathDelayBatch(shot_meteo, elevations, kWavelength, 0.6, 98.2, tropo::TropoModel::MARINI_MURRAY,
+                              kVapourModel, delays);
+    });
+    const double mendes_ms = dpslrtest::measure([&]
+    {
+        tropo::pathDelayBatch(shot_meteo, elevations, kWavelength, 0.6, 98.2, tropo::TropoModel::MENDES_PAVLIS,
+                              kVapourModel, delays);
+    });
+
+    // The previous per shot correction, with the scalar function.
+    double sum = 0.;
+    const double scalar_ms = dpslrtest::measure([&]
+    {
+        for (std::size_t i = 0; i < shots; i++)
+            sum += tropo::pathDelayMariniMurray(shot_meteo.pres[i], shot_meteo.temp[i], shot_meteo.rh[i],
+                                                elevations[i], kWavelength, 0.6, 98.2, kVapourModel);
+    });
+    CHECK(sum > 0.);
+
+    dpslrtest::report("Meteo interpolation, 1M shots", interpolation_ms, "ms");
+    dpslrtest::report("Batch Marini-Murray, 1M shots", marini_ms, "ms");
+    dpslrtest::report("Batch Mendes-Pavlis, 1M shots", mendes_ms, "ms");
+    dpslrtest::report("Scalar Marini-Murray, 1M shots", scalar_ms, "ms");
+    dpslrtest::report("Batch Marini-Murray throughput", shots / marini_ms / 1000., "Mshots/s");
+}
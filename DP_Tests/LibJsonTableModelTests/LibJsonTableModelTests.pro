@@ -0,0 +1,13 @@
+include ($$_PRO_FILE_PWD_/../DP_Tests.pri)
+
+TARGET = tst_jsontablemodel
+
+QT += testlib
+QT -= gui
+CONFIG += c++17
+
+LIBS += -L$$DP_DEPLOY/lib/ -lLibJsonTableModel
+INCLUDEPATH += $$DP_ROOT/LibJsonTableModel/includes
+
+SOURCES += \
+    tst_jsontablemodel.cpp
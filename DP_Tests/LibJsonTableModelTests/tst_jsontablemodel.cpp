@@ -0,0 +1,459 @@
+#include "class_jsontablemodel.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSet>
+#include <QtTest>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int kNoradColumn = 0;
+const int kNameColumn = 1;
+const int kCosparColumn = 3;
+const int kAltitudeColumn = 4;
+const int kLaunchColumn = 5;
+const int kCatalogueRows = 50000;
+const int kSetObjects = 2000;
+const int kBenchmarkRows = 100000;
+
+// Scheme with the columns of the space objects catalogue used by the tests.
+QJsonArray catalogueScheme()
+{
+    return QJsonArray{
+        QJsonObject{{"Index", "NORAD"}, {"Title", "NORAD"}, {"Type", "NumericID"}},
+        QJsonObject{{"Index", "Name"}, {"Title", "Name"}, {"Type", "String"}},
+        QJsonObject{{"Index", "Enabled"}, {"Title", "Enabled"}, {"Type", "Bool"}, {"Default", 0}},
+        QJsonObject{{"Index", "COSPAR"}, {"Title", "COSPAR"}, {"Type", "String"}},
+        QJsonObject{{"Index", "Altitude"}, {"Title", "Altitude"}, {"Type", "Double"}},
+        QJsonObject{{"Index", "LaunchDate"}, {"Title", "Launch date"}, {"Type", "Date"}}};
+}
+
+// Synthetic catalogue with NORADs 1 to rows. Some of them are stored with leading zeros, as in the old catalogues.
+QJsonArray makeCatalogue(int rows)
+{
+    QJsonArray catalogue;
+    for (int i = 0; i < rows; i++)
+    {
+        const int norad = i + 1;
+        const QString norad_str = (0 == i % 7) ? QString("%1").arg(norad, 5, 10, QChar('0')) : QString::number(norad);
+        const int year = 1960 + i % 60;
+        catalogue.append(QJsonObject{{"NORAD", norad_str}, {"Name", QString("OBJECT %1").arg(norad)},
+                                     {"Enabled", 0},
+                                     {"COSPAR", QString("%1-%2A").arg(year).arg(1 + i % 150, 3, 10, QChar('0'))},
+                                     {"Altitude", 300. + (i * 37) % 36000},
+                                     {"LaunchDate", QString("%1%2%3.000000").arg(year)
+                                      .arg(1 + i % 12, 2, 10, QChar('0')).arg(1 + i % 28, 2, 10, QChar('0'))}});
+    }
+    return catalogue;
+}
+
+// Source rows accepted by a proxy, in proxy order.
+QVector<int> acceptedRows(const QSortFilterProxyModel& proxy)
+{
+    QVector<int> rows;
+    for (int i = 0; i < proxy.rowCount(); i++)
+        rows.push_back(proxy.mapToSource(proxy.index(i, 0)).row());
+    return rows;
+}
+
+// Proxy that evaluates the regular expression filters as before they were compiled: a new regular expression for
+// every row and filter. Used as the reference for the re-filter benchmark.
+class PerRowRegexProxyModel : public QSortFilterProxyModel
+{
+public:
+    void setFilters(const JsonTableSortFilterProxyModel::AppliedFilters& filters)
+    {
+        this->filters = filters;
+        this->invalidateFilter();
+    }
+
+    void refilter()
+    {
+        this->invalidateFilter();
+    }
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override
+    {
+        bool accept = true;
+        for (auto it = this->filters.cbegin(); it != this->filters.cend() && accept; it++)
+        {
+            QVariant value = sourceModel()->data(sourceModel()->index(source_row, it.key(), source_parent));
+            if (value.canConvert<QString>())
+                accept = value.toString().contains(QRegularExpression(it.value()));
+        }
+        return accept;
+    }
+
+private:
+    JsonTableSortFilterProxyModel::AppliedFilters filters;
+};
+
+// Proxy that counts the rows evaluated, to check how many times the model is filtered.
+class CountingProxyModel : public JsonTableSortFilterProxyModel
+{
+public:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override
+    {
+        this->evaluated_rows++;
+        return JsonTableSortFilterProxyModel::filterAcceptsRow(source_row, source_parent);
+    }
+
+    mutable int evaluated_rows = 0;
+};
+
+// Model that can also convert the cells directly from the json objects, as data did before the cache, to check the
+// cache against them and to compare the cost.
+class ShadowCheckModel : public JsonTableModel
+{
+public:
+    QVariant data(const QModelIndex& index, int role) const override
+    {
+        if (this->bypass_cache && index.isValid() &&
+            (DIRECT_ROLE == role || DISPLAY_ROLE == role || OBJECT_ROLE == role))
+            return this->uncachedData(index.row(), index.column(), role);
+        return JsonTableModel::data(index, role);
+    }
+
+    QVariant uncachedData(int row, int column, int role) const
+    {
+        const QJsonObject object = jsonarray[row].toObject();
+        const QString& key = header[column]["Index"];
+        if (!object.contains(key))
+            return QVariant();
+        if (DIRECT_ROLE == role)
+            return QVariant(object[key]);
+        return jsonvalueToQvariant(object[key], header[column]["Type"], role);
+    }
+
+    // Number of cells whose cached value differs from the json objects.
+    int divergentCells() const
+    {
+        int divergent = 0;
+        for (int i = 0; i < rowCount(); i++)
+            for (int j = 0; j < columnCount(); j++)
+                for (int role : {DIRECT_ROLE, DISPLAY_ROLE, OBJECT_ROLE})
+                    if (!sameValue(JsonTableModel::data(index(i, j), role), uncachedData(i, j, role)))
+                        divergent++;
+        return divergent;
+    }
+
+    bool bypass_cache = false;
+
+private:
+    static bool sameValue(const QVariant& a, const QVariant& b)
+    {
+        if (QMetaType::QJsonValue == a.userType() || QMetaType::QJsonValue == b.userType())
+            return a.userType() == b.userType() && a.value<QJsonValue>() == b.value<QJsonValue>();
+        return a == b;
+    }
+};
+
+// Random value for a column of the catalogue scheme, with the json type of the column.
+QVariant randomValue(int column, std::mt19937& gen)
+{
+    const int n = static_cast<int>(gen() % 100000);
+    switch (column)
+    {
+    case kNoradColumn:
+        return QString::number(n);
+    case kNameColumn:
+        return QString("EDITED %1").arg(n);
+    case kCosparColumn:
+        return QString("%1-%2B").arg(1960 + n % 60).arg(n % 150, 3, 10, QChar('0'));
+    case kAltitudeColumn:
+        return 300. + n % 36000;
+    case kLaunchColumn:
+        return QString("%1%2%3.120000").arg(1960 + n % 60).arg(1 + n % 12, 2, 10, QChar('0'))
+                .arg(1 + n % 28, 2, 10, QChar('0'));
+    default:
+        return n % 2;
+    }
+}
+
+// Five regular expression filters over different columns.
+const JsonTableSortFilterProxyModel::AppliedFilters& benchmarkFilters()
+{
+    static const JsonTableSortFilterProxyModel::AppliedFilters filters{
+        {kNoradColumn, "[13579]$"},
+        {kNameColumn, "^OBJECT"},
+        {kCosparColumn, "^19[7-9]"},
+        {kAltitudeColumn, "\\d{3,}"},
+        {kLaunchColumn, "-0[1-6]-"}};
+    return filters;
+}
+
+}
+
+class TestJsonTableModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void setFilterSelectsEnabledObjects();
+    void batchedFiltersRefilterOnce();
+    void compiledFiltersMatchPerRowRegex();
+    void refilterBenchmark_data();
+    void refilterBenchmark();
+    void cacheMatchesJsonAfterRandomEdits();
+    void concurrentReadsMatchJson();
+    void scanBenchmark_data();
+    void scanBenchmark();
+    void sortBenchmark_data();
+    void sortBenchmark();
+};
+
+void TestJsonTableModel::setFilterSelectsEnabledObjects()
+{
+    JsonTableModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(kCatalogueRows)).isEmpty());
+
+    // Objects spread over the whole catalogue. The last ones are not in the catalogue.
+    QStringList enabled;
+    QStringList enabled_zeros;
+    QSet<int> expected;
+    for (int i = 0; i < kSetObjects; i++)
+    {
+        const int norad = 1 + i * 29;
+        enabled.append(QString::number(norad));
+        enabled_zeros.append("000" + QString::number(norad));
+        if (norad <= kCatalogueRows)
+            expected.insert(norad);
+    }
+
+    JsonTableSortFilterProxyModel set_proxy;
+    set_proxy.setSourceModel(&model);
+    set_proxy.setSetFilter(kNoradColumn, enabled, true);
+
+    QSet<int> accepted;
+    for (int i = 0; i < set_proxy.rowCount(); i++)
+        accepted.insert(set_proxy.data(set_proxy.index(i, kNoradColumn)).toInt());
+    QCOMPARE(set_proxy.rowCount(), expected.size());
+    QCOMPARE(accepted, expected);
+
+    // The leading zeros of the set values are ignored too.
+    JsonTableSortFilterProxyModel zeros_proxy;
+    zeros_proxy.setSourceModel(&model);
+    zeros_proxy.setSetFilter(kNoradColumn, enabled_zeros, true);
+    QCOMPARE(acceptedRows(zeros_proxy), acceptedRows(set_proxy));
+
+    // The regular expression used before the set filters must select the same rows.
+    JsonTableSortFilterProxyModel regex_proxy;
+    regex_proxy.setSourceModel(&model);
+    regex_proxy.setFilter(kNoradColumn, "\\b0*" + enabled.join("\\b|\\b0*") + "\\b");
+    QCOMPARE(acceptedRows(regex_proxy), acceptedRows(set_proxy));
+}
+
+void TestJsonTableModel::batchedFiltersRefilterOnce()
+{
+    JsonTableModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(1000)).isEmpty());
+
+    // The proxy only filters the rows after its mapping is built.
+    CountingProxyModel proxy;
+    proxy.setSourceModel(&model);
+    QCOMPARE(proxy.rowCount(), model.rowCount());
+    proxy.evaluated_rows = 0;
+
+    proxy.beginFiltersUpdate();
+    for (auto it = benchmarkFilters().cbegin(); it != benchmarkFilters().cend(); it++)
+        proxy.setFilter(it.key(), it.value());
+    proxy.setRangeFilter(kAltitudeColumn, 1000., QVariant());
+    QCOMPARE(proxy.evaluated_rows, 0);
+    proxy.endFiltersUpdate();
+
+    QCOMPARE(proxy.evaluated_rows, model.rowCount());
+}
+
+void TestJsonTableModel::compiledFiltersMatchPerRowRegex()
+{
+    JsonTableModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(10000)).isEmpty());
+
+    JsonTableSortFilterProxyModel proxy(benchmarkFilters());
+    proxy.setSourceModel(&model);
+    PerRowRegexProxyModel reference;
+    reference.setSourceModel(&model);
+    reference.setFilters(benchmarkFilters());
+
+    QVERIFY(proxy.rowCount() > 0);
+    QVERIFY(proxy.rowCount() < model.rowCount());
+    QCOMPARE(acceptedRows(proxy), acceptedRows(reference));
+}
+
+void TestJsonTableModel::refilterBenchmark_data()
+{
+    QTest::addColumn<bool>("compiled");
+    QTest::newRow("per-row regex (before)") << false;
+    QTest::newRow("compiled filters (after)") << true;
+}
+
+void TestJsonTableModel::refilterBenchmark()
+{
+    QFETCH(bool, compiled);
+
+    JsonTableModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(kBenchmarkRows)).isEmpty());
+
+    // Time of a full re-filter of the model with the five filters.
+    if (compiled)
+    {
+        JsonTableSortFilterProxyModel proxy;
+        proxy.setSourceModel(&model);
+        QCOMPARE(proxy.rowCount(), model.rowCount());
+        QBENCHMARK
+        {
+            proxy.beginFiltersUpdate();
+            for (auto it = benchmarkFilters().cbegin(); it != benchmarkFilters().cend(); it++)
+                proxy.setFilter(it.key(), it.value());
+            proxy.endFiltersUpdate();
+        }
+    }
+    else
+    {
+        PerRowRegexProxyModel proxy;
+        proxy.setSourceModel(&model);
+        proxy.setFilters(benchmarkFilters());
+        QVERIFY(proxy.rowCount() > 0);
+        QBENCHMARK
+        {
+            proxy.refilter();
+        }
+    }
+}
+
+void TestJsonTableModel::cacheMatchesJsonAfterRandomEdits()
+{
+    ShadowCheckModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(300)).isEmpty());
+    QCOMPARE(model.divergentCells(), 0);
+
+    std::mt19937 gen(33);
+    for (int step = 1; step <= 2000; step++)
+    {
+        const int row = model.rowCount() > 0 ? static_cast<int>(gen() % model.rowCount()) : 0;
+        const int column = static_cast<int>(gen() % model.columnCount());
+        const QModelIndex index = model.index(row, column);
+
+        switch (gen() % 6)
+        {
+        case 0:
+        case 1:
+            model.setData(index, randomValue(column, gen), JsonTableModel::DIRECT_ROLE);
+            break;
+        case 2:
+            model.setData(index, randomValue(column, gen), JsonTableModel::EDIT_ROLE);
+            model.submitEditedRow(row);
+            break;
+        case 3:
+            model.setData(index, randomValue(column, gen), JsonTableModel::EDIT_ROLE);
+            model.revertEditedRow(row);
+            break;
+        case 4:
+            model.insertRows(row, 1);
+            break;
+        case 5:
+            if (model.rowCount() > 1)
+                model.removeRows(row, 1);
+            break;
+        }
+
+        if (0 == step % 100)
+            QCOMPARE(model.divergentCells(), 0);
+    }
+
+    // Replacing the data rebuilds the cache.
+    QVERIFY(model.setJsonData(makeCatalogue(100)).isEmpty());
+    QCOMPARE(model.divergentCells(), 0);
+}
+
+void TestJsonTableModel::concurrentReadsMatchJson()
+{
+    ShadowCheckModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(5000)).isEmpty());
+
+    // Reading the model does not modify it, so several threads (exports, filtering) can read it at the same time.
+    std::atomic<int> divergent(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++)
+        readers.emplace_back([&model, &divergent]{divergent += model.divergentCells();});
+    for (auto& reader : readers)
+        reader.join();
+
+    QCOMPARE(divergent.load(), 0);
+}
+
+void TestJsonTableModel::scanBenchmark_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("converted in each call (before)") << false;
+    QTest::newRow("cached (after)") << true;
+}
+
+void TestJsonTableModel::scanBenchmark()
+{
+    QFETCH(bool, cached);
+
+    ShadowCheckModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(kBenchmarkRows)).isEmpty());
+    model.bypass_cache = !cached;
+
+    // Read one column of all the rows, as an export or a filter does.
+    int valid = 0;
+    QBENCHMARK
+    {
+        valid = 0;
+        for (int i = 0; i < model.rowCount(); i++)
+            valid += model.data(model.index(i, kLaunchColumn), JsonTableModel::OBJECT_ROLE).isValid();
+    }
+    QCOMPARE(valid, model.rowCount());
+}
+
+void TestJsonTableModel::sortBenchmark_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("converted in each call (before)") << false;
+    QTest::newRow("cached (after)") << true;
+}
+
+void TestJsonTableModel::sortBenchmark()
+{
+    QFETCH(bool, cached);
+
+    ShadowCheckModel model;
+    model.setJsonScheme(catalogueScheme());
+    QVERIFY(model.setJsonData(makeCatalogue(kBenchmarkRows)).isEmpty());
+    model.bypass_cache = !cached;
+
+    JsonTableSortFilterProxyModel proxy;
+    proxy.setSourceModel(&model);
+    proxy.setSortRole(JsonTableModel::OBJECT_ROLE);
+
+    Qt::SortOrder order = Qt::AscendingOrder;
+    QBENCHMARK
+    {
+        proxy.sort(kLaunchColumn, order);
+        order = Qt::AscendingOrder == order ? Qt::DescendingOrder : Qt::AscendingOrder;
+    }
+
+    const QDate first = proxy.data(proxy.index(0, kLaunchColumn), JsonTableModel::OBJECT_ROLE).toDate();
+    const QDate last = proxy.data(proxy.index(proxy.rowCount() - 1, kLaunchColumn),
+                                  JsonTableModel::OBJECT_ROLE).toDate();
+    QVERIFY(first.isValid() && last.isValid() && first != last);
+}
+
+QTEST_GUILESS_MAIN(TestJsonTableModel)
+#include "tst_jsontablemodel.moc"
@@ -12,7 +12,9 @@ SUBDIRS  = \
 # ==== Tools projects ============================================================================
         DP_FilterTool \
         DP_FilterTester \
+        DP_BatchFilter \
 # ==== Test project ==============================================================================
+        DP_Tests \
 
 # ==== Main Dependencies =========================================================================
 DP_Core.depends = LibDPSLR LibJsonTableModel
@@ -21,6 +23,8 @@ DP_PredictionsGenerator.depends = DP_Core DP_MainWindowView
 DP_CPFManager.depends = DP_Core
 DP_FilterTool.depends = DP_Core
 DP_FilterTester.depends = DP_Core
+DP_BatchFilter.depends = DP_Core
+DP_Tests.depends = LibDPSLR LibJsonTableModel DP_Core
 
 
 RESOURCES += DP_Core/resources/common_resources.qrc \
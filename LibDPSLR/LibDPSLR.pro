@@ -22,9 +22,13 @@ SOURCES += \
     sources/common.cpp \
     sources/cpfutils.cpp \
     sources/crdutils.cpp \
+    sources/eventtimer.cpp \
     sources/geo.cpp \
     sources/helpers.cpp \
     sources/math.cpp \
+    sources/rtfilter.cpp \
+    sources/sgp4.cpp \
+    sources/tracking.cpp \
     sources/utils.cpp
 
 HEADERS += \
@@ -39,15 +43,19 @@ HEADERS += \
     includes/crdutils.h \
     includes/dpslr_math.h \
     includes/dpslr_interval.h \
+    includes/eventtimer.h \
     includes/geo.h \
     includes/helpers.h \
     includes/helpers.tpp \
     includes/libdpslr_global.h \
+    includes/sgp4.h \
     includes/sun.h \
     includes/math.tpp \
     includes/math_definitions.h \
     includes/math_operators.h \
     includes/math_operators.tpp \
+    includes/rtfilter.h \
+    includes/tracking.h \
     includes/utils.h
 
 DISTFILES += \
@@ -72,6 +72,18 @@ enum class ResiStatsCalcErr
     STATS_CALC_FAILED = 2,        ///< All bins statistics calculation failed
 };
 
+/// @enum BiasEstimErr
+/// @brief This enum represents the errors that could happen at time bias and range bias estimation.
+enum class BiasEstimErr
+{
+    NOT_ERROR = 0,                 ///< No error flag activated.
+    CPF_DATA_EMPTY = 1,            ///< CPF is empty or is not valid.
+    DATA_SIZE_MISMATCH = 2,        ///< The rates and the residuals have different sizes.
+    NOT_ENOUGH_POINTS = 3,         ///< There are less than three points.
+    SINGULAR_GEOMETRY = 4,         ///< The flight time rate does not change, so the biases can not be separated.
+    RATES_CALC_FAILED = 5          ///< The flight time rates calculation failed.
+};
+
 /// @struct DistStats
 struct DistStats
 {
@@ -110,6 +122,21 @@ struct ResidualsStats
     std::vector<BinStats> bins;     ///< Vector with the statistics of each bin.
     ResiStatsCalcErr error;         ///< Stores the error. See ::ResiStatsCalcErr for more information.
 };
+
+/// @struct BiasEstimate
+/// @note The time bias is positive if the object is ahead of the predictions, i.e., the observed flight time at t is
+///       the predicted at t + time bias. The range bias is added to the predicted one way range.
+struct BiasEstimate
+{
+    std::size_t ptn;               ///< Number of points used for the estimation.
+    long double time_bias;         ///< Time bias in seconds.
+    long double range_bias;        ///< Range bias in metres.
+    long double var_time_bias;     ///< Variance of the time bias in s^2.
+    long double var_range_bias;    ///< Variance of the range bias in m^2.
+    long double cov_time_range;    ///< Covariance between the time bias and the range bias in s*m.
+    long double rms_before;        ///< RMS of the residuals before removing the biases (ps).
+    long double rms_after;         ///< RMS of the residuals after removing the biases (ps).
+};
 // =====================================================================================================================
 
 
@@ -211,7 +238,12 @@ std::vector<std::vector<std::size_t>> extractBins(const common::ResidualsData<T,
 
 
 /**
- * @brief Generate residuals from full rate data. Also applies the Marini and Murray delay refraction correction.
+ * @brief Generate residuals from full rate data. Also applies the tropospheric delay refraction correction.
+ *
+ * The meteo data is linearly interpolated at the time tag of each record, and the tropospheric corrections of all the
+ * records are calculated at once with geo::tropo::pathDelayBatch. If the interpolation or the correction fails (for
+ * example, with an unknown tropospheric model), FullRateResCalcErr::RESIDS_CALC_FAILED is returned.
+ *
  * @param[in]  cpf, the CPF used to generate residuals.
  * @param[in]  mjd, the modified julian day when full rate starts
  * @param[in]  ftdata, the input flight time data. See ::FlightTimeData for more information.
@@ -223,6 +255,7 @@ std::vector<std::vector<std::size_t>> extractBins(const common::ResidualsData<T,
  * @param[out] rdata, the calculated residuals data. See ::ResidualsData for more information.
  * @param[out] pred_dist, the calculated predicted distance used to calculate each residual
  * @param[out] trop_corr, the troposheric correction used to calculate each residual
+ * @param[in]  tropo_model, the tropospheric model. See geo::tropo::TropoModel for more information.
  * @return The error code associated with the calculation process. See ::FullRateResCalcError for more information.
  */
 LIBDPSLR_EXPORT
@@ -231,7 +264,9 @@ FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, long long mjd, con
                                               const geo::frames::GeodeticPoint<long double>& stat_geodetic,
                                               const geo::frames::GeocentricPoint<long double>& stat_geocentric,
                                               double wl, std::size_t bs, common::ResidualsData<>& rdata,
-                                              std::vector<long double> &pred_dist, std::vector<long double> &trop_corr);
+                                              std::vector<long double> &pred_dist, std::vector<long double> &trop_corr,
+                                              geo::tropo::TropoModel tropo_model =
+                                                  geo::tropo::TropoModel::MARINI_MURRAY);
 
 /**
  * @brief Generate residuals from full rate data. Also applies the Marini and Murray delay refraction correction.
@@ -245,20 +280,23 @@ FullRateResCalcErr calculateFullRateResiduals(const common::RangeData &ranges_da
                                               common::ResidualsData<>& rdata);
 
 /**
- * @brief Generate residuals from full rate data. Also applies the Marini and Murray delay refraction correction.
+ * @brief Generate residuals from full rate data. Also applies the tropospheric delay refraction correction.
  * @param[in]  cpf, the CPF used to generate residuals.
  * @param[in]  crd, the CRD which contains the full rate data.
  * @param[in]  stat_geodetic, the geodetic position of the station.
  * @param[in]  stat_geocentric, the geocentric position of the station.
  * @param[in]  bs, the bin size in seconds used for detrending the residuals.
  * @param[out] rdata, the calculated residuals data. See ::ResidualsData for more information.
+ * @param[in]  tropo_model, the tropospheric model. See geo::tropo::TropoModel for more information.
  * @return The error code associated with the calculation process. See ::FullRateResCalcError for more information.
  */
 LIBDPSLR_EXPORT
 FullRateResCalcErr calculateFullRateResiduals(const CPF& cpf, const CRD& crd,
                                               const geo::frames::GeodeticPoint<long double>& stat_geodetic,
                                               const geo::frames::GeocentricPoint<long double>& stat_geocentric,
-                                              std::size_t bs, common::ResidualsData<> &rdata);
+                                              std::size_t bs, common::ResidualsData<> &rdata,
+                                              geo::tropo::TropoModel tropo_model =
+                                                  geo::tropo::TropoModel::MARINI_MURRAY);
 
 /**
  * @brief Calculate distribution statistics for residuals using process described by A.T. Sinclair.
@@ -343,6 +381,75 @@ LIBDPSLR_EXPORT
 std::vector<std::size_t> histPostfilterSLR(const std::vector<double> &times, const std::vector<double> &resids,
                                            double bs, double depth);
 
+/**
+ * @brief Bin by bin polynomial fit of the residuals.
+ *
+ * A new bin starts at the first point whose time is more than bs seconds after the first point of the current bin.
+ *
+ * @param[in] times, the timestamp of each residual in seconds. Must be sorted.
+ * @param[in] resids, the residuals.
+ * @param[in] bs, the bin size in seconds.
+ * @param[in] degree, the degree of the polynomial fit used in each bin.
+ * @return A vector with the fitted value of each residual. It will be empty if there is an error.
+ */
+LIBDPSLR_EXPORT
+std::vector<double> binPolynomialFit(const std::vector<double> &times, const std::vector<double> &resids, double bs,
+                                     unsigned degree = 9);
+
+/**
+ * @brief Iterative threshold filter around a bin by bin polynomial fit of the residuals.
+ *
+ * This is the same process used by the automatic filter of the Filter Tool. In each iteration, the residuals are
+ * fitted bin by bin with a polynomial and the points whose deviation from the fit is outside rf times the standard
+ * deviation of the deviations are rejected. The process stops when an iteration does not reject any point or when
+ * the maximum number of iterations is reached. See ::binPolynomialFit.
+ *
+ * @param[in] times, the timestamp of each residual in seconds. Must be sorted.
+ * @param[in] resids, the residuals.
+ * @param[in] bs, the bin size in seconds used for the polynomial fit.
+ * @param[in] rf, the rejection factor around the standard deviation of the deviations.
+ * @param[in] degree, the degree of the polynomial fit used in each bin.
+ * @param[in] max_iter, the maximum number of iterations.
+ * @return A vector with the indexes of the accepted residuals. It will be empty if there is an error.
+ */
+LIBDPSLR_EXPORT
+std::vector<std::size_t> threshPostfilterSLR(const std::vector<double> &times, const std::vector<double> &resids,
+                                             double bs, double rf = 2.5, unsigned degree = 9,
+                                             unsigned max_iter = 20);
+
+/**
+ * @brief Estimate the time bias and the range bias jointly by least squares.
+ *
+ * The residual of each point is modelled as tb * rate + 2 * rb / c, where tb is the time bias, rb is the range bias
+ * and rate is the rate of change of the predicted two way flight time at the point. The residuals must not be
+ * detrended, since the trend is what contains the time bias, and they should be filtered.
+ *
+ * @param[in]  rates, the rate of change of the predicted two way flight time at each point (s/s).
+ * @param[in]  resids, the residuals (observed minus predicted flight time) in picoseconds.
+ * @param[out] estimate, the estimated biases, with their covariance and the residuals improvement.
+ * @return The error code associated with the estimation. See ::BiasEstimErr for more information.
+ */
+LIBDPSLR_EXPORT
+BiasEstimErr estimateBiases(const std::vector<long double> &rates, const std::vector<long double> &resids,
+                            BiasEstimate &estimate);
+
+/**
+ * @brief Estimate the time bias and the range bias jointly by least squares, with the flight time rates interpolated
+ * from the CPF.
+ * @param[in]  cpf, the CPF used to generate the residuals.
+ * @param[in]  mjd, the modified julian day when the residuals start.
+ * @param[in]  rdata, the residuals data, not detrended. See ::ResidualsData for more information.
+ * @param[in]  stat_geodetic, the geodetic position of the station.
+ * @param[in]  stat_geocentric, the geocentric position of the station.
+ * @param[out] estimate, the estimated biases, with their covariance and the residuals improvement.
+ * @return The error code associated with the estimation. See ::BiasEstimErr for more information.
+ */
+LIBDPSLR_EXPORT
+BiasEstimErr estimateBiases(const CPF &cpf, long long mjd, const common::ResidualsData<> &rdata,
+                            const geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                            const geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                            BiasEstimate &estimate);
+
 // =====================================================================================================================
 
 }} // END NAMESPACES
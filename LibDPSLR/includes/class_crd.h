@@ -26,7 +26,7 @@
  * as convenient file naming generation using NORAD, mixed files generation, and others.
  *
  * About the data processing, the system contains methods for calculating the statistics data, the overall calibrations,
- * and the normal points [TODO]. Also the system permits calculating all this data by external methods, and including
+ * and the normal points. Also the system permits calculating all this data by external methods, and including
  * this data using setters. For external calculations you can also use our mathematical and helper methods in the
  * namespaces "dpslr::utils" and "dpslr::math".
  *
@@ -228,7 +228,7 @@
  *     - Calculate and generate the struct using the internal methods. [TODO]
  * 11. Generate the Normal Point Records if neccesary. You have two options:
  *     - Calculate externally and insert the structs (for example using "orbitnp.py").
- *     - Calculate and generate the struct using the internal methods. [TODO]
+ *     - Calculate and generate the structs using the internal methods (see crdutils::generateNormalPoints).
  * 12. Check the integrity of the data using the checking functions if neccesary [TODO].
  * 13. Write the ".frd" or ".npt" (for v1) or ".fr2" or ".np2" (for v2) files (or both) with all the necessary data.
  *     You have two options:
@@ -34,6 +34,12 @@
 #include "geo.h"
 // =====================================================================================================================
 
+// ========== C++ INCLUDES =============================================================================================
+#include <array>
+#include <atomic>
+#include <vector>
+// =====================================================================================================================
+
 
 // ========== DPSLR NAMESPACES =========================================================================================
 namespace dpslr{
@@ -65,11 +71,15 @@ public:
     };
 
     /// @enum InterpolationMode
-    /// This enum represents the interpolation modes.
+    /// This enum represents the interpolation modes. Except INSTANT_VECTOR, the modes solve the light time from the
+    /// station at the instant (transmit time) to the object (bounce time), iterating until the change of the flight
+    /// time is below the light time tolerance.
     enum InterpolationMode
     {
-        INSTANT_VECTOR = 0,
-        AVERAGE_DISTANCE = 1
+        INSTANT_VECTOR = 0,      ///< Station and object at the instant.
+        AVERAGE_DISTANCE = 1,    ///< Station and object at the bounce time.
+        INBOUND_VECTOR = 2,      ///< Outbound leg plus inbound leg (object at bounce time, station at receive time).
+        ONE_WAY = 3              ///< Only the outbound leg, for one way ranging (transponders).
     };
 
     /// @enum InterpolationFunction
@@ -93,6 +103,7 @@ public:
         long double mjdt;        ///< Interpolation modified julian datetime (day and fraction -> 12 decimals).
         long double range;       ///< One way range in meters (mm precission -> 3 decimals).
         long double tof_2w;      ///< Two way flight time in seconds (ps precission -> 12 decimals).
+        long double tof_1w;      ///< One way (outbound) flight time in seconds (ps precission -> 12 decimals).
         double azimuth;          ///< Azimuth in degrees (4 decimals).
         double elevation;                 ///< Elevation in degrees (4 decimals).
         double diff_azimuth;              ///< Receive-transmit azi at transmit time in degrees (4 decimals).
@@ -141,6 +152,18 @@ public:
                           InterpolationMode mode = InterpolationMode::AVERAGE_DISTANCE,
                           InterpolationFunction function = InterpolationFunction::LAGRANGE_9) const;
 
+    /**
+     * @brief Setter for the tolerance of the light time iterations. At least two iterations are always done.
+     * @param tolerance, the maximum change of the flight time between the last two iterations, in seconds.
+     */
+    void setLightTimeTolerance(long double tolerance);
+
+    /**
+     * @brief Getter for the tolerance of the light time iterations.
+     * @return the tolerance in seconds.
+     */
+    long double lightTimeTolerance() const;
+
     /**
      * @brief Get the station location of this cpf interpolator.
      * @param geodetic, the geodetic position of the station.
@@ -174,6 +197,17 @@ private:
 
     InterpolationError convertInterpError(dpslr::math::LagrangeResult error) const;
 
+    // Lagrange interpolation of the position records, without memory allocation.
+    dpslr::math::LagrangeResult lagrange(long double x, std::array<long double, 3>& y) const;
+
+    // Common epoch position of the object. The transmit and receive vectors are converted with the geocentric light
+    // time, so all the interpolation modes work with any direction flag of the records.
+    InterpolationError objectPosition(long double x, std::array<long double, 3>& y) const;
+
+    // Azimuth and elevation (degrees) of a topocentric vector.
+    void localDirection(const std::array<long double, 3>& topocentric, long double& azimuth,
+                        long double& elevation) const;
+
     // Station position data.
     // Station latitude in radians (north > 0). 8 decimals preccision (1.1mm).
     // Station longitude in radians (east > 0). 8 decimals preccision (1.1mm).
@@ -181,11 +215,15 @@ private:
     dpslr::geo::frames::GeodeticPoint<long double> stat_geodetic;
     // Station geocentric in metres
     dpslr::geo::frames::GeocentricPoint<long double> stat_geocentric;
+    std::array<long double, 3> stat_xyz;
     // Rotation matrix.
     dpslr::math::Matrix<long double> rotation_matrix;
-    // Position data used at interpolation. Loaded when data is loaded.
+    // Position data used at interpolation. Loaded when data is loaded. If the CPF has records with several direction
+    // flags, the common epoch records are used, then the transmit records, then the receive records.
     std::vector<long double> position_times;
-    dpslr::math::Matrix<long double> position_data;
+    std::vector<std::array<long double, 3>> position_data;
+    CPFData::DirectionFlagEnum direction;
+    long double light_time_tolerance;
 
     dpslr::common::optional<double> com_offset;
 
@@ -213,6 +251,9 @@ struct LIBDPSLR_EXPORT Pass
     long double interval;        ///< Interval between two steps in seconds
     unsigned int min_elev;       ///< Minimum elevation for pass.
     std::vector<Step> steps;     ///< Steps of the pass
+    Step start;                  ///< Rise of the pass, or the interval start if the pass was already in progress.
+    Step culmination;            ///< Step with the maximum elevation of the pass.
+    Step end;                    ///< Set of the pass, or the interval end if the pass was still in progress.
 };
 
 /**
@@ -231,6 +272,19 @@ public:
 
     };
 
+    /// @enum SearchMode
+    /// This enum represents the methods used for searching the passes.
+    enum class SearchMode
+    {
+        FIXED_STEP,    ///< The elevation is calculated at each interval step of the whole time window.
+        ADAPTIVE       ///< The elevation is sampled with a step bounded by its rate of change. The rise, set and
+                       ///< culmination are refined with root finding (sub-millisecond precision). The maxima are
+                       ///< found from the sign changes of the elevation rate, so grazing passes shorter than the
+                       ///< search step (60 s) are also found. The step is halved when a maximum and a minimum
+                       ///< inside it change the mean slope; extrema pairs that don't (not seen with real orbits
+                       ///< sampled at 60 s) can be missed.
+    };
+
     /**
      * @brief PassCalculator constructs the pass calculator by getting the data from CPF and the station location and
      * leaving it ready for calculating the passes of the CPF. CPF must be correctly opened and contain position records.
@@ -277,6 +331,23 @@ public:
      * @return the interval for interpolation in seconds.
      */
     long double interval() const;
+    /**
+     * @brief Setter for the search mode.
+     * @param mode the method used for searching the passes.
+     * @param dense_steps if true, the passes found with the adaptive mode are filled with the steps at each interval,
+     * as with the fixed step mode. Otherwise, only the start, culmination and end of the passes are calculated.
+     */
+    void setSearchMode(SearchMode mode, bool dense_steps = true);
+    /**
+     * @brief Getter for the search mode.
+     * @return the method used for searching the passes.
+     */
+    SearchMode searchMode() const;
+    /**
+     * @brief Checks if the passes found with the adaptive mode are filled with the steps at each interval.
+     * @return true if the steps are calculated, false otherwise.
+     */
+    bool denseSteps() const;
 
     /**
      * @brief Get passes within the given interval of time.
@@ -292,11 +363,263 @@ public:
 
 
 private:
+
+    ResultCodes getPassesFixedStep(int mjd_start, long double fract_day_start,
+                                   int mjd_end, long double fract_day_end, std::vector<Pass> &passes) const;
+
+    ResultCodes getPassesAdaptive(int mjd_start, long double fract_day_start,
+                                  int mjd_end, long double fract_day_end, std::vector<Pass> &passes) const;
+
     unsigned int min_elev_;
     long double interval_;
+    SearchMode search_mode_;
+    bool dense_steps_;
     CPFInterpolator interpolator_;
 };
 
+/**
+ * @brief This class implements a fast predictor of the two way flight time, for the range gate generation.
+ *
+ * The flight times of a pass are interpolated from the CPF only once (prepare), with the light time solution of the
+ * AVERAGE_DISTANCE mode, and approximated by a table of Chebyshev polynomials over uniform segments of the pass.
+ * Then, the flight time at any instant is evaluated with the polynomial of its segment (a few dozen flops, without
+ * memory allocation), so it can be used at the laser fire rate.
+ *
+ * The time bias and the range bias are applied at the evaluation, so they can be changed during the tracking without
+ * preparing the pass again. The biases can be set from a different thread than the one that evaluates the flight times,
+ * but prepare must not be called while other thread is evaluating.
+ */
+class LIBDPSLR_EXPORT RangeGatePredictor
+{
+public:
+
+    enum ResultCodes
+    {
+        NOT_ERROR,
+        CPF_NOT_VALID,
+        INTERVAL_OUTSIDE_OF_CPF,
+        PARAMETERS_NOT_VALID,
+        TOLERANCE_NOT_REACHED
+    };
+
+    /**
+     * @brief RangeGatePredictor constructs the predictor by getting the data from CPF and the station location. CPF
+     * must be correctly opened and contain position records.
+     * @param cpf for getting position records and center of mass correction.
+     * @param stat_geodetic the geodetic position of the station.
+     * @param stat_geocentric the geocentric position of the station.
+     */
+    RangeGatePredictor(const CPF& cpf, const dpslr::geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                       const dpslr::geo::frames::GeocentricPoint<long double> &stat_geocentric);
+
+    RangeGatePredictor(const RangeGatePredictor&) = delete;
+    RangeGatePredictor& operator=(const RangeGatePredictor&) = delete;
+
+    /**
+     * @brief Calculates the table of polynomials for the given interval. The segments are halved until the difference
+     * with the CPF interpolation, checked between the nodes of each segment, is below the tolerance. The interval
+     * should include a margin for the maximum time bias expected.
+     * @param mjd the modified julian date of interval start.
+     * @param sod_start the second of day of interval start.
+     * @param duration the duration of the interval in seconds.
+     * @param tolerance the maximum error allowed for the two way flight time in seconds. By default is 0.1 ps.
+     * @param degree the degree of the polynomials.
+     * @param max_segment the maximum length of the segments in seconds.
+     * @return The result of the operation. If the tolerance was not reached, the table of the shortest segments is
+     * kept, and its error can be checked with maxError.
+     */
+    ResultCodes prepare(int mjd, long double sod_start, long double duration, double tolerance = 1e-13,
+                        unsigned degree = 12, double max_segment = 60.);
+
+    /**
+     * @brief Evaluates the two way flight time at the given instant, with the biases applied.
+     * @param mjd the modified julian date of the instant.
+     * @param sod the second of day of the instant.
+     * @param tof_2w the returned two way flight time in seconds.
+     * @return false if the instant (with the time bias) is outside of the prepared interval, true otherwise.
+     */
+    bool tof(int mjd, long double sod, double &tof_2w) const;
+
+    /**
+     * @brief Setter for the time bias. The bias is added to the instant before the evaluation, so a positive bias
+     * means that the object is ahead of the predictions.
+     * @param time_bias the time bias in seconds.
+     */
+    void setTimeBias(double time_bias);
+    /**
+     * @brief Getter for the time bias.
+     * @return the time bias in seconds.
+     */
+    double timeBias() const;
+    /**
+     * @brief Setter for the range bias. The bias is added to the one way range of the predictions.
+     * @param range_bias the range bias in metres.
+     */
+    void setRangeBias(double range_bias);
+    /**
+     * @brief Getter for the range bias.
+     * @return the range bias in metres.
+     */
+    double rangeBias() const;
+
+    /**
+     * @brief Checks if the predictor has a prepared table.
+     * @return true if the table is empty, false otherwise.
+     */
+    bool empty() const;
+    /**
+     * @brief Getter for the length of the segments of the table.
+     * @return the length of the segments in seconds.
+     */
+    double segmentLength() const;
+    /**
+     * @brief Getter for the number of segments of the table.
+     * @return the number of segments.
+     */
+    std::size_t segments() const;
+    /**
+     * @brief Getter for the maximum difference with the CPF interpolation found at the checks of the table.
+     * @return the maximum error in seconds.
+     */
+    double maxError() const;
+
+private:
+
+    CPFInterpolator interpolator_;
+    int mjd_start_;
+    long double sod_start_;
+    double duration_;
+    unsigned degree_;
+    double segment_;
+    double inv_segment_;
+    std::size_t segments_;
+    double max_error_;
+    // Coefficients of the segments, degree + 1 for each one.
+    std::vector<double> coefs_;
+    std::atomic<double> time_bias_;
+    // Range bias as two way flight time (s).
+    std::atomic<double> range_bias_tof_;
+};
+
+/**
+ * @brief Seam between two releases in a stitched CPF.
+ */
+struct LIBDPSLR_EXPORT CPFSeam
+{
+    int mjd;                 ///< Modified julian date of the seam.
+    long double sod;         ///< Second of day of the seam.
+    std::size_t older;       ///< Index (in order of addition) of the release with lower precedence.
+    std::size_t newer;       ///< Index (in order of addition) of the release with higher precedence.
+    long double jump;        ///< Distance between the positions of both releases at the seam in metres.
+};
+
+/**
+ * @brief Interval of a stitched CPF not covered by any release.
+ */
+struct LIBDPSLR_EXPORT CPFGap
+{
+    int mjd_start;           ///< Modified julian date of the last node before the gap.
+    long double sod_start;   ///< Second of day of the last node before the gap.
+    int mjd_end;             ///< Modified julian date of the first node after the gap.
+    long double sod_end;     ///< Second of day of the first node after the gap.
+};
+
+/**
+ * @brief This class merges several releases of the CPF of an object into a single CPF.
+ *
+ * Each instant is taken from the release with the highest precedence that covers it. The precedence is the production
+ * date, then the sequence and subsequence numbers, so the newest release wins. Nodes of different releases closer than
+ * half the step are de-duplicated in favour of the newest one. The positions of the newer release near each seam are
+ * blended with the older one (the weight of the newer goes smoothly from zero at the seam to one at the blend time), so
+ * the interpolated orbit has no jumps at the seams.
+ *
+ * The merged CPF only contains position records, with the headers of the newest release and the merged span, so it
+ * can be used with CPFInterpolator, PassCalculator or RangeGatePredictor as a single release. Intervals not covered by
+ * any release (consecutive nodes separated by more than two steps) are not filled. They are reported as gaps, and the
+ * merged ephemeris is split there, so it is never interpolated across them.
+ */
+class LIBDPSLR_EXPORT CPFStitcher
+{
+public:
+
+    enum ResultCodes
+    {
+        NOT_ERROR,
+        NO_RELEASES,
+        CPF_NOT_VALID,
+        TARGET_MISMATCH,
+        EPHEMERIS_GAP
+    };
+
+    /**
+     * @brief CPFStitcher constructor.
+     * @param blend_time the maximum time at each side of a seam where the positions are blended, in seconds.
+     */
+    explicit CPFStitcher(double blend_time = 3600.);
+
+    /**
+     * @brief Adds a release to be merged. The CPF must have the basic headers and at least ten position records.
+     * @param cpf the release.
+     * @return CPF_NOT_VALID if the CPF is not valid, TARGET_MISMATCH if it is for a different object than the added
+     * releases, NOT_ERROR otherwise.
+     */
+    ResultCodes addRelease(const CPF& cpf);
+
+    /**
+     * @brief Removes all the added releases.
+     */
+    void clear();
+
+    /**
+     * @brief Merges the added releases into a single continuous CPF.
+     * @param merged the merged CPF. It is not modified if there is an error.
+     * @return NO_RELEASES if there are no releases, EPHEMERIS_GAP if the releases leave gaps (use the overload that
+     * splits the merged CPF in that case), NOT_ERROR otherwise.
+     */
+    ResultCodes stitch(CPF& merged);
+
+    /**
+     * @brief Merges the added releases, split at the gaps.
+     * @param segments the continuous parts of the merged CPF, sorted by time.
+     * @return NO_RELEASES if there are no releases, NOT_ERROR otherwise.
+     */
+    ResultCodes stitch(std::vector<CPF>& segments);
+
+    /**
+     * @brief Getter for the number of added releases.
+     * @return the number of releases.
+     */
+    std::size_t releases() const;
+
+    /**
+     * @brief Getter for the seams of the last merge.
+     * @return the seams, sorted by time.
+     */
+    const std::vector<CPFSeam>& seams() const;
+
+    /**
+     * @brief Getter for the gaps of the last merge.
+     * @return the gaps, sorted by time.
+     */
+    const std::vector<CPFGap>& gaps() const;
+
+private:
+
+    struct Release
+    {
+        CPFHeader header;
+        std::vector<CPFData::PositionRecord> positions;
+    };
+
+    // Checks if the release a has lower precedence than b.
+    bool precedes(const Release& a, const Release& b) const;
+
+    double blend_time_;
+    std::vector<Release> releases_;
+    std::vector<CPFSeam> seams_;
+    std::vector<CPFGap> gaps_;
+};
+
 }
 } // END NAMESPACES
 // =====================================================================================================================
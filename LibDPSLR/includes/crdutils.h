@@ -20,6 +20,7 @@
 #include "libdpslr_global.h"
 #include "class_crd.h"
 #include "class_cpf.h"
+#include "common.h"
 #include "geo.h"
 // =====================================================================================================================
 
@@ -57,6 +58,23 @@ enum class StatsGenErr
     SOME_BINS_CALC_FAILED = 5,   ///< The calculations failed for some bins
     STATS_CALC_FAILED     = 6    ///< The statistics calculation failed
 };
+
+/**
+ * @enum NPGenErr
+ * @brief This enum represents the errors that could happen at normal points generation.
+ */
+enum class NPGenErr
+{
+    NOT_ERROR             = 0,   ///< No error flag activated.
+    CPF_DATA_EMPTY        = 1,   ///< CPF is empty or is not valid.
+    CRD_CFG_NOT_VALID     = 2,   ///< CRD has no System Configuration record.
+    CRD_DATA_EMPTY        = 3,   ///< CRD Full Rate data is empty.
+    RESIDS_CALC_FAILED    = 4,   ///< The residuals calculation failed.
+    SOME_BINS_CALC_FAILED = 5,   ///< The normal points could not be formed for some bins.
+    NP_CALC_FAILED        = 6,   ///< No normal point could be formed.
+    RESIDS_NOT_MATCHING   = 7,   ///< The residuals do not match the CRD Full Rate records.
+    BIN_SIZE_NOT_VALID    = 8    ///< The bin size is not valid.
+};
 // =====================================================================================================================
 
 
@@ -91,6 +109,78 @@ StatsGenErr generateStatsRecord(std::size_t bs, const geo::frames::GeodeticPoint
  */
 LIBDPSLR_EXPORT
 OverallCaliGencErr generateOverallCalibration(CRDData::ShiftTypeEnum shift_option, CRD &crd);
+
+
+/**
+ * @brief Gets the ILRS normal point bin size for the object of a CPF, using the mean altitude of its positions.
+ *
+ * The ILRS recommends the bin size for each satellite. This function uses the values of the orbit classes:
+ * 15 s for LEO below 1000 km, 30 s up to 2500 km (Starlette, Ajisai, LARES), 120 s up to 10000 km (LAGEOS),
+ * 300 s up to 100000 km (GNSS, Etalon, geostationary) and 900 s beyond (lunar ranging). If the ILRS recommends a
+ * different value for a certain satellite, use it directly as bin size.
+ *
+ * @param[in] cpf, the CPF of the object.
+ * @return The bin size in seconds, or 0 if the CPF has no position records.
+ */
+LIBDPSLR_EXPORT
+double normalPointBinSize(const CPF &cpf);
+
+
+/**
+ * @brief Generate residuals from full rate data and form the normal points using the ILRS normal point algorithm.
+ *        Then generate the Normal Point Records into the CRD.
+ *
+ * The residuals are calculated using calculateFullRateResiduals, and then the normal points are formed with the
+ * overload that uses precalculated residuals. See that function for more details.
+ *
+ * @param[in] bs, the normal point bin size in seconds. See ::normalPointBinSize.
+ * @param[in]  stat_geodetic, the geodetic position of the station.
+ * @param[in]  stat_geocentric, the geocentric position of the station.
+ * @param[in] cpf, the CPF used to generate residuals.
+ * @param[out] crd, the CRD which contains the full rate data and where the generated records are stored.
+ * @param[in] rf, the rejection factor around RMS. It should be 2.5 for single-photon detector and 3 for multiple-photon.
+ * @param[in] tlrnc, tolerance factor for the convergence algorithm. Usually 0.1 for all systems.
+ * @param[in] min_ranges, the minimum number of accepted ranges for forming a normal point.
+ * @param[in] degree, the degree of the polynomial trend removed in each bin.
+ * @return The error code associated with the generation process. See ::NPGenErr for more details.
+ */
+LIBDPSLR_EXPORT
+NPGenErr generateNormalPoints(double bs, const geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                              const geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                              const CPF &cpf, CRD& crd, double rf = 2.5, double tlrnc = 0.1,
+                              unsigned min_ranges = 3, unsigned degree = 2);
+
+
+/**
+ * @brief Form the normal points from the residuals of the full rate data using the ILRS normal point algorithm.
+ *        Then generate the Normal Point Records into the CRD.
+ *
+ * The accepted full rate records (the ones not flagged as noise) are divided in bins fixed from the start of the day
+ * in a single pass over the data, so the records must be sorted by time. Each bin is processed independently (in
+ * parallel), as follows:
+ *  1. A polynomial of the given degree is fitted to the residuals and removed, so the residual signature of the bin
+ *     does not bias the statistics.
+ *  2. The points outside RF*RMS are iteratively rejected, as described by A.T. Sinclair (see calcBinStats).
+ *  3. The epoch of the normal point is the one of the accepted record nearest to the mean epoch of the accepted ones.
+ *  4. The normal point time of flight is the time of flight of that record minus its residual from the trend plus the
+ *     mean residual from the trend of the accepted records.
+ *
+ * The RMS, skew, kurtosis and peak minus mean (around RF*RMS) are stored in the records, as well as the accepted
+ * ranges. The return rate is calculated using the fire rate of the laser configuration, if any. The bins with less
+ * than min_ranges accepted ranges do not generate normal point. The old normal point records are replaced.
+ *
+ * @param[in] bs, the normal point bin size in seconds. See ::normalPointBinSize.
+ * @param[in] rdata, the residuals (in picoseconds) of each full rate record, in the same order.
+ * @param[out] crd, the CRD which contains the full rate data and where the generated records are stored.
+ * @param[in] rf, the rejection factor around RMS. It should be 2.5 for single-photon detector and 3 for multiple-photon.
+ * @param[in] tlrnc, tolerance factor for the convergence algorithm. Usually 0.1 for all systems.
+ * @param[in] min_ranges, the minimum number of accepted ranges for forming a normal point.
+ * @param[in] degree, the degree of the polynomial trend removed in each bin.
+ * @return The error code associated with the generation process. See ::NPGenErr for more details.
+ */
+LIBDPSLR_EXPORT
+NPGenErr generateNormalPoints(double bs, const common::ResidualsData<> &rdata, CRD& crd, double rf = 2.5,
+                              double tlrnc = 0.1, unsigned min_ranges = 3, unsigned degree = 2);
 // =====================================================================================================================
 
 }} // END NAMESPACES
@@ -0,0 +1,123 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file eventtimer.h
+ *
+ * @brief This file contains utilities for the epochs registered by the event timers.
+ *
+ * The event timers of the kHz systems register the start (fire) and stop (return) epochs in two independent streams.
+ * With flight times longer than the fire period there are several pulses in flight, so each stop must be associated
+ * with its fire using the predicted flight time.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+#pragma once
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "libdpslr_global.h"
+#include "common.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <cstdint>
+#include <vector>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace eventtimer{
+// =====================================================================================================================
+
+// ========== ENUMS ====================================================================================================
+
+/**
+ * @enum MatchEpochsError
+ * @brief This enum represents the errors that could happen when the start and stop epochs are matched.
+ */
+enum class MatchEpochsError
+{
+    NOT_ERROR             = 0,  ///< No error flag activated.
+    DATA_SIZE_MISMATCH    = 1,  ///< The start epochs and the predicted flight times have different sizes.
+    STARTS_NOT_SORTED     = 2,  ///< The start epochs are not sorted.
+    STOPS_NOT_SORTED      = 3,  ///< The stop epochs are not sorted.
+    WINDOW_NOT_VALID      = 4,  ///< The lower limit of the window is greater than the upper limit.
+    PREDICTIONS_NOT_VALID = 5   ///< The start epochs plus their predicted flight times decrease.
+};
+// =====================================================================================================================
+
+// ========== STRUCTS ==================================================================================================
+
+/**
+ * @brief Stop epoch associated with a start epoch. The epochs and the flight times are in picoseconds.
+ */
+struct LIBDPSLR_EXPORT EpochMatch
+{
+    std::size_t start_idx;     ///< Index of the start epoch.
+    std::size_t stop_idx;      ///< Index of the stop epoch.
+    std::int64_t start;        ///< Start epoch.
+    std::int64_t stop;         ///< Stop epoch.
+    std::int64_t tof_2w;       ///< Measured two way flight time (stop - start).
+    std::int64_t pred_2w;      ///< Predicted two way flight time of the start.
+    unsigned candidates;       ///< Number of starts whose window contains the stop.
+    bool ambiguous;            ///< True if there was more than one candidate. The nearest to the prediction is used.
+    bool shared_start;         ///< True if other stops are associated with the same start.
+};
+// =====================================================================================================================
+
+// ========== FUNCTIONS ================================================================================================
+
+/**
+ * @brief Associates each stop epoch with its start epoch, using the predicted flight times.
+ *
+ * A stop is associated with a start if the stop minus the start minus the predicted flight time is inside the window.
+ * The start plus its predicted flight time must not decrease from one start to the next, which is always true for a
+ * real orbit (the flight time rate is greater than -1), so the starts whose window contains a stop are consecutive,
+ * and both streams are processed in a single linear merge. Predictions that break this order are rejected. If several starts are candidates for a
+ * stop, the one whose residual is nearest to zero is used, and the match is flagged as ambiguous. The stops without
+ * candidates are not matched (noise outside the range gate).
+ *
+ * @param starts, the start epochs in picoseconds, sorted.
+ * @param predicted, the predicted two way flight time of each start in picoseconds.
+ * @param stops, the stop epochs in picoseconds, sorted. The origin must be the same as the start epochs.
+ * @param win_lower, the lower limit of the window around the predicted flight time in picoseconds.
+ * @param win_upper, the upper limit of the window around the predicted flight time in picoseconds.
+ * @param matches, the matched stops, in the order of the stops.
+ * @return the error that may have occurred.
+ */
+LIBDPSLR_EXPORT MatchEpochsError matchEpochs(const std::vector<std::int64_t>& starts,
+                                             const std::vector<std::int64_t>& predicted,
+                                             const std::vector<std::int64_t>& stops, std::int64_t win_lower,
+                                             std::int64_t win_upper, std::vector<EpochMatch>& matches);
+
+/**
+ * @brief Converts the matches to ranges data, with the original start epochs as time tags.
+ * @param matches, the matches generated by matchEpochs.
+ * @param skip_ambiguous, if true, the ambiguous matches are not converted.
+ * @return the ranges data, with the start epoch in seconds, the flight time and the predicted flight time in
+ * picoseconds, and without tropospheric correction.
+ */
+LIBDPSLR_EXPORT common::RangeData matchesToRangeData(const std::vector<EpochMatch>& matches,
+                                                     bool skip_ambiguous = false);
+// =====================================================================================================================
+
+}} // END NAMESPACES.
+// =====================================================================================================================
@@ -23,6 +23,7 @@
 
 // ========== C++ INCLUDES ===========================================================================================
 #include <tuple>
+#include <vector>
 // =====================================================================================================================
 
 namespace dpslr{
@@ -54,6 +55,21 @@ enum class WtrVapPressModel
 
 // =====================================================================================================================
 
+// ========== STRUCTS ==================================================================================================
+
+/**
+ * @brief Meteorological data series, stored as one vector per magnitude so they can be processed in vectorized loops.
+ */
+struct LIBDPSLR_EXPORT MeteoSeries
+{
+    std::vector<long double> times;   ///< Time tags (seconds). Must be increasing.
+    std::vector<double> pres;         ///< Atmospheric pressure (millibars).
+    std::vector<double> temp;         ///< Atmospheric temperature (Kelvin).
+    std::vector<double> rh;           ///< Relative humidity (percent eg, 50%).
+};
+
+// =====================================================================================================================
+
 // ========== FUNCTIONS ================================================================================================
 
 /**
@@ -76,6 +92,21 @@ enum class WtrVapPressModel
  */
  double waterVaporPressure(double rh, double temp, double pres, WtrVapPressModel mode);
 
+/**
+ * @brief Linearly interpolates the meteorological records at the given time tags.
+ *
+ * The time tags before the first record or after the last record get the values of the nearest record. The time tags
+ * must be increasing, so the records are traversed only once.
+ *
+ * @param records Meteorological records. The time tags must be increasing.
+ * @param times   Time tags where the records are interpolated (seconds). Must be increasing.
+ * @param result  Interpolated values, one for each time tag.
+ * @return False if there are no records, the sizes of the record vectors are different or the record time tags are
+ *         decreasing, true otherwise.
+ */
+LIBDPSLR_EXPORT bool interpolateMeteo(const MeteoSeries& records, const std::vector<long double>& times,
+                                      MeteoSeries& result);
+
  // =====================================================================================================================
 
 } // END NAMESPACE METEO.
@@ -84,6 +115,22 @@ enum class WtrVapPressModel
 /// Generic namespace for tropospheric models that calculate the path delay produced by the troposphere.
 namespace tropo{
 
+// ========== ENUMS ====================================================================================================
+
+/**
+ * @enum TropoModel
+ * @brief Represents the different models that can be used to calculate the tropospheric path delay.
+ * @see IERS TN 36, chap. 9.
+ * @see https://www.iers.org/IERS/EN/Publications/TechnicalNotes/tn36.html
+ */
+enum class TropoModel
+{
+    MARINI_MURRAY = 1,   ///< Marini and Murray model (1973). IERS TN 21, chap. 9.
+    MENDES_PAVLIS = 2    ///< Mendes and Pavlis zenith delay (2004) with FCULa mapping function. IERS TN 36, chap. 9.
+};
+
+// =====================================================================================================================
+
 // ========== FUNCTIONS ================================================================================================
 
 /**
@@ -106,6 +153,69 @@ namespace tropo{
 LIBDPSLR_EXPORT double pathDelayMariniMurray(double pres, double temp, double rh, double el, double wl, double phi,
                                              double ht, meteo::WtrVapPressModel wvpm);
 
+/**
+ * @brief Calculates the zenith tropospheric path delay (one way) using Mendes and Pavlis model (2004).
+ * @see IERS TN 36, chap. 9.2.
+ * @param pres Atmospheric pressure (mbar).
+ * @param e0   Water vapor pressure (mbar).
+ * @param wl   Beam wavelength (micrometres).
+ * @param lat  Geodetic latitude of the station (radians).
+ * @param ht   Height of the station above the ellipsoid (meters).
+ * @return One way zenith tropospheric path delay (meters).
+ */
+LIBDPSLR_EXPORT double zenithDelayMendesPavlis(double pres, double e0, double wl, double phi, double ht);
+
+/**
+ * @brief Calculates the FCULa mapping function of Mendes et al. (2002).
+ * @see IERS TN 36, chap. 9.2.
+ * @param el   Elevation of the target (radians).
+ * @param temp Surface temperature (Kelvin).
+ * @param lat  Geodetic latitude of the station (radians).
+ * @param ht   Height of the station above the ellipsoid (meters).
+ * @return Value of the mapping function.
+ */
+LIBDPSLR_EXPORT double mappingFunctionFCULa(double el, double temp, double phi, double ht);
+
+/**
+ * @brief Calculates the tropospheric path delay (one way) using Mendes and Pavlis zenith delay and FCULa mapping.
+ *
+ * This is the model recommended by the IERS Conventions (2010) for optical ranging. It uses the same inputs as the
+ * Marini and Murray model.
+ *
+ * @param pres Atmospheric pressure (mbar).
+ * @param temp Surface tempreature in (Kelvin).
+ * @param rh   Relative humidity (%, eg. 50%).
+ * @param el   Elevation of the target (radians).
+ * @param wl   Beam wavelength (micrometres).
+ * @param lat  Geodetic latitude of the station (radians).
+ * @param ht   Height of the station above the ellipsoid (meters).
+ * @param wvpm Water vapor pressure model. See ::WtrVapPressModel for more details.
+ * @return One way tropospheric path delay (meters).
+ */
+LIBDPSLR_EXPORT double pathDelayMendesPavlis(double pres, double temp, double rh, double el, double wl, double phi,
+                                             double ht, meteo::WtrVapPressModel wvpm);
+
+/**
+ * @brief Calculates the tropospheric path delay (one way) of many shots.
+ *
+ * The calculation is split in simple loops over each magnitude, without branches, so the compiler can vectorize them.
+ * The results are the same as calling the scalar function of the model for each shot.
+ *
+ * @param meteo Meteorological values of each shot, for example interpolated with meteo::interpolateMeteo. The time
+ *              tags are not used.
+ * @param el    Elevation of each shot (radians).
+ * @param wl    Beam wavelength (micrometres).
+ * @param lat   Latitude of the station (radians).
+ * @param ht    Height of the station (meters).
+ * @param model Tropospheric model. See ::TropoModel for more details.
+ * @param wvpm  Water vapor pressure model. See ::WtrVapPressModel for more details.
+ * @param delays One way tropospheric path delay of each shot (meters).
+ * @return False if the sizes of the meteorological values and the elevations are different, true otherwise.
+ */
+LIBDPSLR_EXPORT bool pathDelayBatch(const meteo::MeteoSeries& meteo, const std::vector<double>& el, double wl,
+                                    double phi, double ht, TropoModel model, meteo::WtrVapPressModel wvpm,
+                                    std::vector<double>& delays);
+
 // =====================================================================================================================
 
 } // END NAMESPACE TROPO.
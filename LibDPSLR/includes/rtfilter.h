@@ -0,0 +1,363 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file rtfilter.h
+ *
+ * @brief This file contains the real time (streaming) residuals calculation and filter for SLR.
+ *
+ * The filters of the algorithms module work over the complete data of a pass. The streaming filter receives the shots
+ * one by one (or in small batches) from the event timer while the pass is being tracked, and classifies each one as
+ * signal or noise using only the previous shots. The producer (the event timer thread) and the consumer (the filter
+ * thread) are decoupled by a lock-free single producer single consumer ring.
+ *
+ * All the memory is allocated when the filter is created and when a pass is started, so pushing and processing the
+ * shots do not allocate memory, and the work done for each shot is bounded by the configuration.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+#pragma once
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "libdpslr_global.h"
+#include "algorithms.h"
+#include "class_cpf.h"
+#include "cpfutils.h"
+#include "geo.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace rtfilter{
+// =====================================================================================================================
+
+// ========== ENUMS ====================================================================================================
+
+/**
+ * @enum RTFilterError
+ * @brief This enum represents the errors that could happen when a pass is started in the streaming filter.
+ */
+enum class RTFilterError
+{
+    NOT_ERROR             = 0,   ///< No error flag activated.
+    CPF_DATA_EMPTY        = 1,   ///< CPF is empty or is not valid.
+    CONFIG_NOT_VALID      = 2,   ///< The filter configuration is not valid.
+    STENCIL_CALC_FAILED   = 3    ///< The predictions of the pass could not be interpolated.
+};
+// =====================================================================================================================
+
+// ========== CLASSES ==================================================================================================
+
+/**
+ * @brief Lock-free ring for one producer thread and one consumer thread. The capacity is rounded up to a power of two
+ * and the buffer is allocated at construction, so push and pop never allocate memory.
+ */
+template <typename T>
+class SPSCRing
+{
+public:
+
+    explicit SPSCRing(std::size_t capacity) :
+        buffer(roundCapacity(capacity)),
+        mask(buffer.size() - 1),
+        head(0),
+        tail(0)
+    {}
+
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    /**
+     * @brief Stores an item. Must be called only from the producer thread.
+     * @return false if the ring is full.
+     */
+    bool push(const T& item)
+    {
+        const std::size_t head_pos = this->head.load(std::memory_order_relaxed);
+        if (head_pos - this->tail.load(std::memory_order_acquire) == this->buffer.size())
+            return false;
+        this->buffer[head_pos & this->mask] = item;
+        this->head.store(head_pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest item. Must be called only from the consumer thread.
+     * @return false if the ring is empty.
+     */
+    bool pop(T& item)
+    {
+        const std::size_t tail_pos = this->tail.load(std::memory_order_relaxed);
+        if (tail_pos == this->head.load(std::memory_order_acquire))
+            return false;
+        item = this->buffer[tail_pos & this->mask];
+        this->tail.store(tail_pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Number of stored items. It is only a snapshot if the other thread is working.
+    std::size_t size() const
+    {
+        return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const {return this->buffer.size();}
+
+private:
+
+    static std::size_t roundCapacity(std::size_t capacity)
+    {
+        std::size_t rounded = 2;
+        while (rounded < capacity)
+            rounded <<= 1;
+        return rounded;
+    }
+
+    std::vector<T> buffer;
+    std::size_t mask;
+    // The positions are written by different threads, so they are kept in different cache lines.
+    char pad0[64];
+    std::atomic<std::size_t> head;
+    char pad1[64];
+    std::atomic<std::size_t> tail;
+    char pad2[64];
+};
+
+/**
+ * @brief Recursive least squares estimation of the time bias and the range bias.
+ *
+ * It estimates the same model as algorithms::estimateBiases, but the normal equations are updated with each point, so
+ * the estimation is available at any moment of the pass with a constant cost per point. With a forgetting factor lower
+ * than 1, the weight of the previous points is multiplied by the factor at each update, so the estimation follows
+ * the changes of the biases.
+ */
+class LIBDPSLR_EXPORT StreamingBiasEstimator
+{
+public:
+
+    /**
+     * @brief StreamingBiasEstimator constructor.
+     * @param forgetting, the forgetting factor, in (0, 1]. 1 means that all the points have the same weight.
+     */
+    explicit StreamingBiasEstimator(double forgetting = 1.);
+
+    /// Removes all the points.
+    void reset();
+
+    /**
+     * @brief Adds a point to the estimation.
+     * @param rate, the rate of change of the predicted two way flight time (s/s).
+     * @param residual, the residual (observed minus predicted flight time) in picoseconds.
+     */
+    void update(double rate, double residual);
+
+    /**
+     * @brief Solves the current estimation.
+     * @param estimate, the estimated biases. With forgetting, the RMS values are weighted.
+     * @return the error that may have occurred.
+     */
+    algorithms::BiasEstimErr estimate(algorithms::BiasEstimate& estimate) const;
+
+    /// Number of points added since the last reset.
+    std::size_t count() const;
+
+private:
+
+    long double forgetting;
+    std::size_t points;
+    // Weighted sums, with the rates in ps/s relative to the first one.
+    long double rate_origin;
+    long double sum_w, sum_w2, sum_x, sum_y, sum_xx, sum_xy, sum_yy;
+};
+
+/**
+ * @brief Configuration of the streaming filter. The residuals values are two way picoseconds.
+ */
+struct LIBDPSLR_EXPORT StreamingFilterConfig
+{
+    double win_upper = 40000.;             ///< Upper limit of the residuals window.
+    double win_lower = -40000.;            ///< Lower limit of the residuals window.
+    double bin_width = 25.;                ///< Width of the histogram bins.
+    double depth = 600.;                   ///< Width of the signal band searched in the histogram.
+    double window = 1.;                    ///< Length of the sliding window in seconds.
+    unsigned min_photons = 5;              ///< Minimum shots of the signal band over the noise floor.
+    double rf = 2.5;                       ///< Rejection factor around the RMS of the signal trend.
+    double min_sigma = 10.;                ///< Minimum RMS used for the rejection.
+    double calibration = 0.;               ///< System delay subtracted to the flight times.
+    double stencil_step = 1.;              ///< Time between the cached predictions in seconds.
+    std::size_t queue_capacity = 4096;     ///< Capacity of the ring between the producer and the consumer.
+    std::size_t window_capacity = 65536;   ///< Maximum shots inside the sliding window.
+    std::uint64_t latency_budget = 100000; ///< Maximum time from push to classification in nanoseconds.
+    double bias_forgetting = 1.;           ///< Forgetting factor of the bias estimation for each signal shot.
+};
+
+/**
+ * @brief Classification of a shot.
+ */
+struct LIBDPSLR_EXPORT ShotResult
+{
+    long double start_time;   ///< Second of day of the shot.
+    double residual;          ///< Residual (ps). NaN if the prediction is not available.
+    bool signal;              ///< True if the shot was classified as signal.
+    std::uint64_t latency;    ///< Time from push to classification in nanoseconds (0 for classify).
+};
+
+/**
+ * @brief Streaming residuals calculation and filter.
+ *
+ * The predicted flight times of the pass are interpolated from the CPF when the pass is started, at a fixed step, and
+ * each shot uses a 6 points Lagrange interpolation over these cached values. The residuals inside the window are
+ * stored in a histogram of the last seconds (sliding window), where the band with more shots is searched. If this band
+ * has enough shots over the noise floor, the signal is detected, and the shots are classified using a line fitted to
+ * the signal shots of the sliding window (running sums) and the rejection factor around its RMS. While there are not
+ * enough signal shots for the fit, the shots inside the band are the signal.
+ *
+ * The shots are pushed by the producer thread (push) and classified by the consumer thread (process). The function
+ * classify can be used instead for single thread processing. Only one thread can push and only one can process.
+ */
+class LIBDPSLR_EXPORT StreamingFilter
+{
+public:
+
+    StreamingFilter(const CPF& cpf, const geo::frames::GeodeticPoint<long double>& stat_geodetic,
+                    const geo::frames::GeocentricPoint<long double>& stat_geocentric,
+                    const StreamingFilterConfig& config = StreamingFilterConfig());
+
+    StreamingFilter(const StreamingFilter&) = delete;
+    StreamingFilter& operator=(const StreamingFilter&) = delete;
+
+    /**
+     * @brief Prepares the filter for a new pass, interpolating the predictions and clearing the previous state. This
+     * function allocates memory, so it must be called before the shots arrive.
+     * @param mjd, the modified julian date of the pass start.
+     * @param sod_start, the second of day of the pass start.
+     * @param duration, the duration of the pass in seconds.
+     * @return the error that may have occurred.
+     */
+    RTFilterError startPass(int mjd, long double sod_start, long double duration);
+
+    /**
+     * @brief Stores a shot for the consumer. Must be called only from the producer thread.
+     * @param start_time, the second of day of the shot.
+     * @param tof_2w, the measured two way flight time in picoseconds.
+     * @return false if the queue is full and the shot was dropped.
+     */
+    bool push(long double start_time, double tof_2w);
+
+    /**
+     * @brief Classifies the pending shots. Must be called only from the consumer thread.
+     * @param results, the buffer where the results are stored, in the same order as the shots were pushed.
+     * @param max, the size of the buffer.
+     * @return the number of shots classified.
+     */
+    std::size_t process(ShotResult* results, std::size_t max);
+
+    /**
+     * @brief Classifies a shot directly, without the queue. It must not be mixed with process.
+     * @param start_time, the second of day of the shot.
+     * @param tof_2w, the measured two way flight time in picoseconds.
+     * @return the classification of the shot.
+     */
+    ShotResult classify(long double start_time, double tof_2w);
+
+    /// Number of shots pending in the queue.
+    std::size_t pending() const;
+    /// Number of shots dropped because the queue was full. It can be read from any thread.
+    std::size_t dropped() const;
+    /// Number of shots classified after the latency budget. It can be read from any thread.
+    std::size_t overruns() const;
+
+    /**
+     * @brief Gets the estimation of the time bias and range bias from the signal shots of the pass. The rates of the
+     * flight time are calculated from the cached predictions. Must be called only from the consumer thread.
+     * @param estimate, the estimated biases.
+     * @return the error that may have occurred.
+     */
+    algorithms::BiasEstimErr biasEstimate(algorithms::BiasEstimate& estimate) const;
+
+private:
+
+    struct QueuedShot
+    {
+        long double start_time;
+        double tof_2w;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    struct WindowShot
+    {
+        long double time;
+        double residual;
+        std::size_t bin;
+        bool signal;
+    };
+
+    bool predict(long double time, long double& tof_2w) const;
+    bool predictRate(long double time, long double& rate) const;
+    void expire(long double time);
+    void updateHistogram(std::size_t bin, bool add);
+    void addToFit(const WindowShot& shot, long double sign);
+
+    StreamingFilterConfig config;
+    cpfutils::CPFInterpolator interpolator;
+
+    // Cached predictions (ps) of the pass, at the stencil step from the pass start.
+    std::vector<long double> stencil;
+    long double pass_start;
+
+    // Time continuity at day change.
+    long double day_offset;
+    long double last_time;
+
+    // Sliding window. The shots are stored in a circular buffer, in arrival order.
+    std::vector<unsigned> histogram;
+    std::vector<WindowShot> window_shots;
+    std::size_t window_first;
+    std::size_t window_count;
+    std::size_t histogram_total;
+    std::size_t band_bins;
+
+    // Shots of each band of band_bins bins (by its first bin), and the band with more shots.
+    std::vector<unsigned> band_sums;
+    std::size_t best_band;
+    bool best_band_dirty;
+
+    // Running sums of the signal line fit, with times relative to fit_origin.
+    long double fit_origin;
+    long double fit_n, fit_t, fit_r, fit_tt, fit_tr, fit_rr;
+
+    StreamingBiasEstimator bias_estimator;
+
+    SPSCRing<QueuedShot> queue;
+    std::atomic<std::size_t> dropped_shots;
+    std::atomic<std::size_t> overrun_shots;
+};
+// =====================================================================================================================
+
+}} // END NAMESPACES.
+// =====================================================================================================================
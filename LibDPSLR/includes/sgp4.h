@@ -0,0 +1,220 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file sgp4.h
+ *
+ * @brief This file contains the SGP4/SDP4 propagator for TLEs.
+ *
+ * The implementation follows the revised SGP4 of Vallado, Crawford, Hujsak and Kelso ("Revisiting Spacetrack Report
+ * #3", AIAA 2006-6753), with the WGS-72 constants and the improved operation mode. The results are given in the TEME
+ * (True Equator, Mean Equinox) frame, as the original model.
+ *
+ * The TLEs are parsed and initialized once into an Elements struct. The batch functions propagate many objects over
+ * many epochs, in parallel (OpenMP) across the objects, and store the results as a structure of arrays.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+#pragma once
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "libdpslr_global.h"
+#include "class_tle.h"
+#include "class_cpf.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <array>
+#include <string>
+#include <vector>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace sgp4{
+// =====================================================================================================================
+
+// ========== ENUMS ====================================================================================================
+
+/**
+ * @enum SGP4Error
+ * @brief This enum represents the errors that could happen at the TLE initialization or at the propagation. The values
+ * are the error codes of the reference implementation.
+ */
+enum class SGP4Error
+{
+    NOT_ERROR                  = 0,    ///< No error.
+    ECCENTRICITY_OUT_OF_RANGE  = 1,    ///< Mean eccentricity is not in [0, 1).
+    MEAN_MOTION_NEGATIVE       = 2,    ///< Mean motion is negative.
+    PERT_ECCENTRICITY_INVALID  = 3,    ///< Perturbed eccentricity is not in [0, 1].
+    SEMILATUS_RECTUM_NEGATIVE  = 4,    ///< Semi-latus rectum is negative.
+    SATELLITE_DECAYED          = 6,    ///< The satellite has decayed (the position is under the Earth surface).
+    TLE_NOT_VALID              = 7     ///< The TLE lines could not be parsed.
+};
+// =====================================================================================================================
+
+// ========== STRUCTS ==================================================================================================
+
+/**
+ * @brief Mean elements of a TLE and the SGP4 coefficients derived from them. It is filled by @ref parseTLE and is
+ * not modified by the propagation, so it can be shared between threads.
+ */
+struct LIBDPSLR_EXPORT Elements
+{
+    std::string norad;              ///< NORAD catalog number.
+    std::string intl_designator;    ///< International designator (short COSPAR, e.g. 86061A).
+
+    // Epoch (Julian date, UTC) split in day and fraction to keep the precision.
+    double jd_epoch;
+    double jd_epoch_fraction;
+
+    // Mean elements (radians and radians/minute).
+    double bstar, ndot, nddot, ecco, argpo, inclo, mo, no_kozai, nodeo, no_unkozai;
+
+    // Near Earth coefficients.
+    bool simplified;
+    bool deep_space;
+    double a, alta, altp, gsto;
+    double aycof, con41, cc1, cc4, cc5, d2, d3, d4, delmo, eta, argpdot, omgcof, sinmao, t2cof, t3cof, t4cof, t5cof;
+    double x1mth2, x7thm1, mdot, nodedot, xlcof, xmcof, nodecf;
+
+    // Deep space coefficients.
+    int irez;
+    double d2201, d2211, d3210, d3222, d4410, d4422, d5220, d5232, d5421, d5433;
+    double dedt, del1, del2, del3, didt, dmdt, dnodt, domdt;
+    double e3, ee2, peo, pgho, pho, pinco, plo, se2, se3, sgh2, sgh3, sgh4, sh2, sh3, si2, si3, sl2, sl3, sl4;
+    double xfact, xgh2, xgh3, xgh4, xh2, xh3, xi2, xi3, xl2, xl3, xl4, xlamo, zmol, zmos;
+};
+
+/**
+ * @brief State of the numerical integrator of the deep space resonant orbits. The integration continues from the
+ * last propagated time, so propagating at increasing times with the same state avoids integrating from the epoch
+ * each time. A default constructed state starts from the epoch.
+ */
+struct LIBDPSLR_EXPORT ResonanceState
+{
+    double atime = 0.;
+    double xli = 0.;
+    double xni = 0.;
+};
+
+/**
+ * @brief Results of a batch propagation, as a structure of arrays. The results of the object i at the epoch j are at
+ * the index i * epochs + j of each array. Positions are in km and velocities in km/s.
+ */
+struct LIBDPSLR_EXPORT StateVectors
+{
+    std::size_t objects = 0;
+    std::size_t epochs = 0;
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<SGP4Error> errors;
+
+    inline std::size_t index(std::size_t object, std::size_t epoch) const {return object * this->epochs + epoch;}
+};
+// =====================================================================================================================
+
+// ========== FUNCTIONS ================================================================================================
+
+/**
+ * @brief Parses the TLE lines and initializes the SGP4 coefficients.
+ * @param[in] tle, the TLE to parse.
+ * @param[out] elements, the initialized elements.
+ * @return the error that may have occurred.
+ */
+LIBDPSLR_EXPORT SGP4Error parseTLE(const TLE& tle, Elements& elements);
+
+/**
+ * @brief Parses all the TLEs. The elements are in the same order as the TLEs.
+ * @param[in] tles, the TLEs to parse.
+ * @param[out] elements, the initialized elements.
+ * @return the error of each TLE.
+ */
+LIBDPSLR_EXPORT std::vector<SGP4Error> parseTLEs(const std::vector<TLE>& tles, std::vector<Elements>& elements);
+
+/**
+ * @brief Propagates the elements.
+ * @param[in] elements, the elements initialized with @ref parseTLE.
+ * @param[in] tsince, the time since the TLE epoch in minutes.
+ * @param[in,out] resonance, the integrator state for the deep space resonant orbits.
+ * @param[out] r, the TEME position in km.
+ * @param[out] v, the TEME velocity in km/s.
+ * @return the error that may have occurred.
+ */
+LIBDPSLR_EXPORT SGP4Error propagate(const Elements& elements, double tsince, ResonanceState& resonance,
+                                    std::array<double, 3>& r, std::array<double, 3>& v);
+
+/**
+ * @brief Propagates the elements to a Julian date.
+ * @param[in] elements, the elements initialized with @ref parseTLE.
+ * @param[in] jd, the Julian date (UTC).
+ * @param[out] r, the TEME position in km.
+ * @param[out] v, the TEME velocity in km/s.
+ * @return the error that may have occurred.
+ */
+LIBDPSLR_EXPORT SGP4Error propagateToJulian(const Elements& elements, long double jd,
+                                            std::array<double, 3>& r, std::array<double, 3>& v);
+
+/**
+ * @brief Propagates all the objects at all the epochs. The objects are propagated in parallel.
+ * @param[in] elements, the elements initialized with @ref parseTLE.
+ * @param[in] jd_epochs, the Julian dates (UTC) to propagate to, in increasing order.
+ * @param[out] states, the TEME state vectors.
+ */
+LIBDPSLR_EXPORT void propagateBatch(const std::vector<Elements>& elements, const std::vector<long double>& jd_epochs,
+                                    StateVectors& states);
+
+/**
+ * @brief Greenwich mean sidereal time (IAU 82) as used by SGP4.
+ * @param jd_ut1, the Julian date in UT1.
+ * @return the sidereal time in radians (0, 2pi).
+ */
+LIBDPSLR_EXPORT double gstime(double jd_ut1);
+
+/**
+ * @brief Rotates a TEME state vector to the Earth fixed frame. The polar motion is not applied, and UTC is used as
+ * UT1, which is enough for the TLE accuracy.
+ * @param[in] jd, the Julian date (UTC) of the state vector.
+ * @param[in] r_teme, the TEME position.
+ * @param[in] v_teme, the TEME velocity (km/s).
+ * @param[out] r_ecef, the Earth fixed position, with the same units as r_teme.
+ * @param[out] v_ecef, the Earth fixed velocity (km/s), if r_teme is in km.
+ */
+LIBDPSLR_EXPORT void temeToECEF(long double jd, const std::array<double, 3>& r_teme,
+                                const std::array<double, 3>& v_teme, std::array<double, 3>& r_ecef,
+                                std::array<double, 3>& v_ecef);
+
+/**
+ * @brief Generates a CPF (version 2, source "tle") from the TLE, with the Earth fixed positions between the dates.
+ * @param[in] tle, the TLE. The title is used as target name.
+ * @param[in] elements, the elements initialized from the TLE.
+ * @param[in] jd_start, the Julian date (UTC) of the first position.
+ * @param[in] jd_end, the Julian date (UTC) of the last position.
+ * @param[in] step, the time between positions in seconds.
+ * @param[out] cpf, the generated CPF.
+ * @return the first error that happened at the propagation. The CPF only contains the positions before it.
+ */
+LIBDPSLR_EXPORT SGP4Error generateCPF(const TLE& tle, const Elements& elements, long double jd_start,
+                                      long double jd_end, unsigned step, CPF& cpf);
+// =====================================================================================================================
+
+}} // END NAMESPACES.
+// =====================================================================================================================
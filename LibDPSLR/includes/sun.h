@@ -47,7 +47,7 @@ namespace sun{
 // Simple algorithm (VSOP87 algorithm is much more complicated). 0.01 degree accuracy, up to 2099. Only for non scientific purposes.
 //    Inspiration from: http ://stjarnhimlen.se/comp/tutorial.html#5
 // Book: Sun Position: Astronomical Algorithm in 9 Common Programming Languages
-void simpleSunPosition(double j2000, double lat, double lon, bool refr, double& az, double& el)
+inline void simpleSunPosition(double j2000, double lat, double lon, bool refr, double& az, double& el)
 {
     // Convert latitude and longitude to radians.
     double rlat = math::rad(lat);
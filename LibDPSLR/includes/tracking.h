@@ -0,0 +1,166 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file tracking.h
+ *
+ * @brief This file contains the generation of the mount tracking tables for SLR passes.
+ *
+ * The passes calculated with cpfutils have coarse steps. The mount needs a dense and smooth table of positions, with
+ * its velocities and accelerations, that respects the azimuth limits of the mount (cable wrap), that does not require
+ * impossible azimuth rates near the zenith (keyhole), and that never points the telescope near the Sun.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+#pragma once
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "libdpslr_global.h"
+#include "class_cpf.h"
+#include "cpfutils.h"
+#include "geo.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <vector>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace tracking{
+// =====================================================================================================================
+
+// ========== ENUMS ====================================================================================================
+
+/**
+ * @enum TrackingError
+ * @brief This enum represents the errors that could happen when a tracking table is generated.
+ */
+enum class TrackingError
+{
+    NOT_ERROR               = 0,   ///< No error flag activated.
+    CPF_DATA_EMPTY          = 1,   ///< CPF is empty or is not valid.
+    CONFIG_NOT_VALID        = 2,   ///< The configuration or the interval are not valid.
+    INTERPOLATION_FAILED    = 3,   ///< The positions of the interval could not be interpolated.
+    AZIMUTH_LIMITS_EXCEEDED = 4    ///< The azimuth of the pass does not fit in the azimuth limits of the mount.
+};
+// =====================================================================================================================
+
+// ========== STRUCTS ==================================================================================================
+
+/**
+ * @brief Configuration of the tracking table generation. The angles are in degrees.
+ */
+struct LIBDPSLR_EXPORT TrackingConfig
+{
+    double rate = 100.;               ///< Positions of the table per second.
+    double knot_step = 1.;            ///< Step of the CPF interpolations in seconds. The table is interpolated from them.
+    double sun_avoid_angle = 15.;     ///< Radius of the Sun exclusion cone. Zero disables the Sun avoidance.
+    double sun_margin = 2.;           ///< Width of the transition to the border of the Sun exclusion cone.
+    double keyhole_elev = 85.;        ///< Elevation over which the azimuth is smoothed if it is too fast.
+    double max_az_rate = 10.;         ///< Maximum azimuth rate of the mount in deg/s.
+    double az_min = -270.;            ///< Lower azimuth limit of the mount (cable wrap).
+    double az_max = 270.;             ///< Upper azimuth limit of the mount (cable wrap).
+};
+
+/**
+ * @brief Position of the tracking table. The azimuth is continuous in the mount range, so it can be out of [0, 360).
+ */
+struct LIBDPSLR_EXPORT TrackingPoint
+{
+    int mjd;                 ///< Modified julian date of the position.
+    long double sod;         ///< Second of day of the position.
+    double az;               ///< Azimuth of the mount in degrees.
+    double el;               ///< Elevation of the mount in degrees.
+    double az_rate;          ///< Azimuth rate in deg/s.
+    double el_rate;          ///< Elevation rate in deg/s.
+    double az_accel;         ///< Azimuth acceleration in deg/s^2.
+    double el_accel;         ///< Elevation acceleration in deg/s^2.
+    double sun_separation;   ///< Angle between the object and the Sun in degrees.
+    bool sun_avoidance;      ///< True if the mount is going around the Sun, so it is not pointing to the object.
+    bool keyhole;            ///< True if the azimuth is smoothed near the zenith.
+};
+
+/**
+ * @brief Tracking table of a pass.
+ */
+struct LIBDPSLR_EXPORT TrackingTable
+{
+    std::vector<TrackingPoint> points;   ///< Positions at the table rate.
+    double min_sun_separation;           ///< Minimum angle between the object and the Sun in degrees.
+    double max_az_rate;                  ///< Maximum absolute azimuth rate of the table in deg/s.
+    double max_el_rate;                  ///< Maximum absolute elevation rate of the table in deg/s.
+    bool sun_avoidance;                  ///< True if any position goes around the Sun.
+    bool keyhole;                        ///< True if the azimuth is smoothed near the zenith.
+};
+// =====================================================================================================================
+
+// ========== FUNCTIONS ================================================================================================
+
+/**
+ * @brief Generates the tracking table of the mount for an interval.
+ *
+ * The object is interpolated from the CPF at the knot step, and the Sun at the same instants. The positions of the
+ * table are interpolated from these knots as unit vectors in the local frame of the station, so the Sun separation is
+ * a dot product and there are no azimuth discontinuities near the zenith or at north.
+ *
+ * The positions inside the Sun exclusion cone are moved to the border of the cone, going around the Sun from the entry
+ * to the exit point by the shortest way (the highest one if the object crosses the Sun). The path starts to move away
+ * from the object at the margin of the cone, so the velocity is continuous. If the azimuth rate over the keyhole
+ * elevation exceeds the maximum of the mount, the azimuth is replaced by a cubic transition that keeps the rate under
+ * the maximum (the keyhole is enlarged if necessary). Finally, the azimuth is unwrapped and shifted by turns to fit in
+ * the mount limits, and the rates and accelerations are calculated with finite differences.
+ *
+ * @param cpf, the CPF of the object.
+ * @param stat_geodetic, the geodetic position of the station.
+ * @param stat_geocentric, the geocentric position of the station.
+ * @param mjd, the modified julian date of the interval start.
+ * @param sod_start, the second of day of the interval start.
+ * @param duration, the duration of the interval in seconds.
+ * @param config, the configuration of the table.
+ * @param table, the generated table.
+ * @return the error that may have occurred.
+ */
+LIBDPSLR_EXPORT TrackingError generateTrackingTable(const CPF& cpf,
+                                                    const geo::frames::GeodeticPoint<long double>& stat_geodetic,
+                                                    const geo::frames::GeocentricPoint<long double>& stat_geocentric,
+                                                    int mjd, long double sod_start, long double duration,
+                                                    const TrackingConfig& config, TrackingTable& table);
+
+/**
+ * @brief Generates the tracking table of the mount for a pass calculated with cpfutils::PassCalculator.
+ * @param cpf, the CPF of the object.
+ * @param stat_geodetic, the geodetic position of the station.
+ * @param stat_geocentric, the geocentric position of the station.
+ * @param pass, the pass. The table goes from the start to the end of the pass.
+ * @param config, the configuration of the table.
+ * @param table, the generated table.
+ * @return the error that may have occurred.
+ */
+LIBDPSLR_EXPORT TrackingError generateTrackingTable(const CPF& cpf,
+                                                    const geo::frames::GeodeticPoint<long double>& stat_geodetic,
+                                                    const geo::frames::GeocentricPoint<long double>& stat_geocentric,
+                                                    const cpfutils::Pass& pass, const TrackingConfig& config,
+                                                    TrackingTable& table);
+// =====================================================================================================================
+
+}} // END NAMESPACES.
+// =====================================================================================================================
@@ -20,6 +20,7 @@
 #include "includes/cpfutils.h"
 
 #include <iostream>
+#include <limits>
 
 namespace dpslr
 {
@@ -31,7 +32,8 @@ FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, long long mjd, con
                                               const geo::frames::GeodeticPoint<long double>& stat_geodetic,
                                               const geo::frames::GeocentricPoint<long double>& stat_geocentric,
                                               double wl, std::size_t bs, common::ResidualsData<>& rdata,
-                                              std::vector<long double> &pred_dist, std::vector<long double> &trop_corr)
+                                              std::vector<long double> &pred_dist, std::vector<long double> &trop_corr,
+                                              geo::tropo::TropoModel tropo_model)
 {
     // Check the CPF data.
     if (cpf.empty() || cpf.getData().positionRecords().empty())
@@ -41,9 +43,12 @@ FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, long long mjd, con
     rdata.clear();
 
     // Variables and containers.
-
     dpslr::cpfutils::CPFInterpolator::InterpolationResult interp_data;
-    std::size_t meteo_idx = 0;
+    std::vector<long double> pred_2w(ftdata.size());
+    std::vector<long double> times(ftdata.size());
+    std::vector<double> elevations(ftdata.size());
+    std::vector<double> delays;
+    long double day_offset = 0.L;
 
     // Vapor water pressure model.
     geo::meteo::WtrVapPressModel vwpm = geo::meteo::WtrVapPressModel::GIACOMO_DAVIS;
@@ -54,17 +59,15 @@ FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, long long mjd, con
     stat_geodetic_rad.convert(decltype(stat_geodetic_rad)::AngleType::Unit::RADIANS,
                               decltype(stat_geodetic_rad)::DistType::Unit::METRES);
 
-
-    // Calculate the residuals for each record.
+    // Calculate the predicted flight time and the elevation for each record.
     for (std::size_t i = 0; i < ftdata.size(); i++)
     {
-        // Get the meteo index whose meteo time tag is next to the current time tag.
-        while(meteo_idx < meteo_records.size() && ftdata[i].first > meteo_records[meteo_idx].time_tag)
-            meteo_idx++;
-
         // Control day change
         if (i > 0 && ftdata[i].first < ftdata[i - 1].first)
+        {
             mjd++;
+            day_offset += 86400.L;
+        }
 
         // Interpolate the CPF data to get the position for the current time tag.
         // For this algorithm is better to use the Instant Vector mode, as in NP calculation algorithm.
@@ -72,48 +75,70 @@ FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, long long mjd, con
                                                    cpfutils::CPFInterpolator::INSTANT_VECTOR);
 
         // Check the interpolation error.
-        if (cpfutils::CPFInterpolator::NOT_ERROR == interp_err ||
-                cpfutils::CPFInterpolator::INTERPOLATION_NOT_IN_THE_MIDDLE == interp_err)
-        {
-            long double corr_2w = 0.;
-            if (!meteo_records.empty())
-            {
-                // Get the necessary meteo data for calculating Marini and Murray delay refraction correction.
-                std::size_t selected = meteo_idx > 0 ? meteo_idx - 1 : 0;
-                double press = meteo_records[selected].surface_pressure;
-                double temp = meteo_records[selected].surface_temperature;
-                double humid = meteo_records[selected].surface_relative_humidity;
-                geo::meas::Angle<double> el(interp_data.elevation, geo::meas::Angle<double>::Unit::DEGREES);
-                el.convert(geo::meas::Angle<double>::Unit::RADIANS);
-
-                // Calculate the 2-way refraction correction using Marini and Murray in seconds.
-                auto corr = geo::tropo::pathDelayMariniMurray(press, temp, humid, el, wl, stat_geodetic_rad.lat,
-                                                              stat_geodetic_rad.alt, vwpm);
-                geo::meas::Distance<long double> corr_2w_unit(corr * 2.);
-                corr_2w_unit.convert(decltype(corr_2w_unit)::Unit::LIGHT_PS);
-                corr_2w = corr_2w_unit;
-            }
-            
-            long double pred_2w_ps = interp_data.tof_2w * math::kSecondToPicosecond;
+        if (cpfutils::CPFInterpolator::NOT_ERROR != interp_err &&
+                cpfutils::CPFInterpolator::INTERPOLATION_NOT_IN_THE_MIDDLE != interp_err)
+            return FullRateResCalcErr::RESIDS_CALC_FAILED;
+
+        pred_2w[i] = interp_data.tof_2w * math::kSecondToPicosecond;
+        times[i] = ftdata[i].first + day_offset;
+        elevations[i] = static_cast<double>(interp_data.elevation * math::pi / 180.L);
+    }
 
-            // Store the residual in picoseconds and the time tag in seconds.
-            rdata.push_back({ftdata[i].first, ftdata[i].second * math::kSecondToPicosecond - pred_2w_ps - corr_2w});
-            pred_dist.push_back(pred_2w_ps);
-            trop_corr.push_back(corr_2w);
+    // Calculate the tropospheric path delays of all the records, with the meteo data linearly interpolated.
+    if (!meteo_records.empty() && !ftdata.empty())
+    {
+        geo::meteo::MeteoSeries records;
+        geo::meteo::MeteoSeries shot_meteo;
+        long double meteo_offset = 0.L;
+        for (std::size_t i = 0; i < meteo_records.size(); i++)
+        {
+            if (i > 0 && meteo_records[i].time_tag < meteo_records[i - 1].time_tag)
+                meteo_offset += 86400.L;
+            records.times.push_back(meteo_records[i].time_tag + meteo_offset);
+            records.pres.push_back(meteo_records[i].surface_pressure);
+            records.temp.push_back(meteo_records[i].surface_temperature);
+            records.rh.push_back(meteo_records[i].surface_relative_humidity);
         }
-        else
+
+        // If the meteo data starts the day before the full rate data, use the same day origin.
+        if (records.times.front() - times.front() > 43200.L)
+            for (auto& time : records.times)
+                time -= 86400.L;
+
+        // Check the meteo interpolation and the tropospheric correction errors.
+        if (!geo::meteo::interpolateMeteo(records, times, shot_meteo) ||
+                !geo::tropo::pathDelayBatch(shot_meteo, elevations, wl, static_cast<double>(stat_geodetic_rad.lat),
+                                            static_cast<double>(stat_geodetic_rad.alt), tropo_model, vwpm, delays))
             return FullRateResCalcErr::RESIDS_CALC_FAILED;
     }
 
-    std::vector<std::remove_reference_t<decltype(rdata)>::value_type::first_type> times;
+    // Calculate the residuals for each record.
+    for (std::size_t i = 0; i < ftdata.size(); i++)
+    {
+        long double corr_2w = 0.;
+        if (!delays.empty())
+        {
+            // Convert the 2-way refraction correction to picoseconds.
+            geo::meas::Distance<long double> corr_2w_unit(delays[i] * 2.);
+            corr_2w_unit.convert(decltype(corr_2w_unit)::Unit::LIGHT_PS);
+            corr_2w = corr_2w_unit;
+        }
+
+        // Store the residual in picoseconds and the time tag in seconds.
+        rdata.push_back({ftdata[i].first, ftdata[i].second * math::kSecondToPicosecond - pred_2w[i] - corr_2w});
+        pred_dist.push_back(pred_2w[i]);
+        trop_corr.push_back(corr_2w);
+    }
+
+    std::vector<std::remove_reference_t<decltype(rdata)>::value_type::first_type> rtimes;
     std::vector<std::remove_reference_t<decltype(rdata)>::value_type::second_type> resid;
     for (const auto& data : rdata)
     {
-        times.push_back(data.first);
+        rtimes.push_back(data.first);
         resid.push_back(data.second);
     }
 
-    rdata = binPolynomialDetrend(bs, times, resid);
+    rdata = binPolynomialDetrend(bs, rtimes, resid);
 
     // Return no error.
     return FullRateResCalcErr::NOT_ERROR;
@@ -123,7 +148,8 @@ FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, long long mjd, con
 FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, const CRD &crd,
                                               const geo::frames::GeodeticPoint<long double> &stat_geodetic,
                                               const geo::frames::GeocentricPoint<long double> &stat_geocentric,
-                                              std::size_t bs, common::ResidualsData<> &rdata)
+                                              std::size_t bs, common::ResidualsData<> &rdata,
+                                              geo::tropo::TropoModel tropo_model)
 {
 
     // Check the CRD data.
@@ -149,7 +175,7 @@ FullRateResCalcErr calculateFullRateResiduals(const CPF &cpf, const CRD &crd,
     std::vector<long double> dummy;
 
     return calculateFullRateResiduals(cpf, mjd, ftdata, meteo_records, stat_geodetic, stat_geocentric,
-                                      wl, bs, rdata, dummy, dummy);
+                                      wl, bs, rdata, dummy, dummy, tropo_model);
 }
 
 
@@ -947,6 +973,81 @@ std::vector<std::size_t> histPostfilterSLR(const std::vector<double> &times, con
     return sel_indexes;
 }
 
+std::vector<double> binPolynomialFit(const std::vector<double> &times, const std::vector<double> &resids, double bs,
+                                     unsigned degree)
+{
+    // Check the input data.
+    if (times.empty() || times.size() != resids.size() || bs <= 0)
+        return {};
+
+    std::vector<double> fit;
+    fit.reserve(times.size());
+    std::size_t first = 0;
+
+    auto fit_bin = [&times, &resids, &fit, degree](std::size_t begin, std::size_t end)
+    {
+        std::vector<double> xbin(times.begin() + static_cast<long>(begin), times.begin() + static_cast<long>(end));
+        std::vector<double> ybin(resids.begin() + static_cast<long>(begin), resids.begin() + static_cast<long>(end));
+        auto coefs = dpslr::math::polynomialFit(xbin, ybin, degree);
+        for (const auto& x : xbin)
+            fit.push_back(dpslr::math::applyPolynomial(coefs, x));
+    };
+
+    for (std::size_t i = 0; i < times.size(); i++)
+    {
+        if (times[i] - times[first] > bs)
+        {
+            fit_bin(first, i);
+            first = i;
+        }
+    }
+    fit_bin(first, times.size());
+
+    return fit;
+}
+
+std::vector<std::size_t> threshPostfilterSLR(const std::vector<double> &times, const std::vector<double> &resids,
+                                             double bs, double rf, unsigned degree, unsigned max_iter)
+{
+    // Check the input data.
+    if (times.empty() || resids.empty() || times.size() != resids.size() || bs <= 0 || rf <= 0)
+        return {};
+
+    // Start with all the points selected.
+    std::vector<std::size_t> sel_indexes(times.size());
+    std::iota(sel_indexes.begin(), sel_indexes.end(), 0);
+
+    unsigned iter = 0;
+    bool changed = true;
+
+    while (changed && iter < max_iter && !sel_indexes.empty())
+    {
+        // Deviations from the polynomial fit of each bin. If the fit fails, the residual is used.
+        std::vector<double> sel_times = dpslr::helpers::extract(times, sel_indexes);
+        std::vector<double> sel_resids = dpslr::helpers::extract(resids, sel_indexes);
+        std::vector<double> fit = binPolynomialFit(sel_times, sel_resids, bs, degree);
+        std::vector<double> devs(sel_resids.size());
+        for (std::size_t i = 0; i < devs.size(); i++)
+        {
+            const double dev = sel_resids[i] - fit[i];
+            devs[i] = std::isnan(dev) ? sel_resids[i] : dev;
+        }
+
+        // Keep the points within the threshold.
+        double thresh = rf * dpslr::math::stddev(devs);
+        std::vector<std::size_t> next_indexes;
+        for (std::size_t i = 0; i < sel_indexes.size(); i++)
+            if (devs[i] > -thresh && devs[i] < thresh)
+                next_indexes.push_back(sel_indexes[i]);
+
+        changed = next_indexes.size() != sel_indexes.size();
+        sel_indexes = std::move(next_indexes);
+        iter++;
+    }
+
+    return sel_indexes;
+}
+
 template <typename T>
 std::vector<std::size_t> windowPrefilterPrivate(const std::vector<T> &resids, T upper, T lower)
 {
@@ -976,5 +1077,109 @@ std::vector<std::size_t> windowPrefilter(const std::vector<double> &resids, doub
     return windowPrefilterPrivate(resids, upper, lower);
 }
 
+BiasEstimErr estimateBiases(const std::vector<long double> &rates, const std::vector<long double> &resids,
+                            BiasEstimate &estimate)
+{
+    estimate = BiasEstimate();
+    estimate.ptn = resids.size();
+
+    // Check the input data.
+    if (rates.size() != resids.size())
+        return BiasEstimErr::DATA_SIZE_MISMATCH;
+    if (resids.size() < 3)
+        return BiasEstimErr::NOT_ENOUGH_POINTS;
+
+    // The model is resid = time_bias * rate_ps + bias_ps, with the rate in ps/s and the bias as two way picoseconds.
+    // Sums centered at the means, for a better conditioning.
+    const long double n = static_cast<long double>(resids.size());
+    long double mean_x = 0.L, mean_y = 0.L;
+    for (std::size_t i = 0; i < resids.size(); i++)
+    {
+        mean_x += rates[i] * math::kSecondToPicosecond;
+        mean_y += resids[i];
+    }
+    mean_x /= n;
+    mean_y /= n;
+
+    long double sxx = 0.L, sxy = 0.L, sum_xx = 0.L, sum_yy = 0.L;
+    for (std::size_t i = 0; i < resids.size(); i++)
+    {
+        const long double x = rates[i] * math::kSecondToPicosecond;
+        sxx += (x - mean_x) * (x - mean_x);
+        sxy += (x - mean_x) * (resids[i] - mean_y);
+        sum_xx += x * x;
+        sum_yy += resids[i] * resids[i];
+    }
+
+    if (sxx <= std::numeric_limits<long double>::epsilon() * sum_xx)
+        return BiasEstimErr::SINGULAR_GEOMETRY;
+
+    const long double time_bias = sxy / sxx;
+    const long double bias_ps = mean_y - time_bias * mean_x;
+
+    long double ssr = 0.L;
+    for (std::size_t i = 0; i < resids.size(); i++)
+    {
+        const long double res = resids[i] - time_bias * rates[i] * math::kSecondToPicosecond - bias_ps;
+        ssr += res * res;
+    }
+
+    // Covariance from the residual variance. The two way picoseconds are converted to one way metres.
+    const long double sigma2 = ssr / (n - 2.L);
+    const long double ps_to_m = static_cast<long double>(math::c) / (2.L * math::kSecondToPicosecond);
+    estimate.time_bias = time_bias;
+    estimate.range_bias = bias_ps * ps_to_m;
+    estimate.var_time_bias = sigma2 / sxx;
+    estimate.var_range_bias = sigma2 * (1.L / n + mean_x * mean_x / sxx) * ps_to_m * ps_to_m;
+    estimate.cov_time_range = -sigma2 * mean_x / sxx * ps_to_m;
+    estimate.rms_before = std::sqrt(sum_yy / n);
+    estimate.rms_after = std::sqrt(ssr / n);
+
+    return BiasEstimErr::NOT_ERROR;
+}
+
+BiasEstimErr estimateBiases(const CPF &cpf, long long mjd, const common::ResidualsData<> &rdata,
+                            const geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                            const geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                            BiasEstimate &estimate)
+{
+    // Time step (s) of the central differences of the predicted flight time.
+    const long double rate_delta = 0.05L;
+
+    estimate = BiasEstimate();
+
+    // Check the CPF data.
+    if (cpf.empty() || cpf.getData().positionRecords().empty())
+        return BiasEstimErr::CPF_DATA_EMPTY;
+
+    auto interpolator = cpfutils::CPFInterpolator(cpf, stat_geodetic, stat_geocentric);
+    cpfutils::CPFInterpolator::InterpolationResult interp_before, interp_after;
+    std::vector<long double> rates, resids;
+
+    for (std::size_t i = 0; i < rdata.size(); i++)
+    {
+        // Control day change
+        if (i > 0 && rdata[i].first < rdata[i - 1].first)
+            mjd++;
+
+        // Same interpolation mode as the residuals calculation.
+        auto err_before = interpolator.interpolate(mjd, rdata[i].first - rate_delta, interp_before,
+                                                   cpfutils::CPFInterpolator::INSTANT_VECTOR);
+        auto err_after = interpolator.interpolate(mjd, rdata[i].first + rate_delta, interp_after,
+                                                  cpfutils::CPFInterpolator::INSTANT_VECTOR);
+
+        if ((cpfutils::CPFInterpolator::NOT_ERROR != err_before &&
+             cpfutils::CPFInterpolator::INTERPOLATION_NOT_IN_THE_MIDDLE != err_before) ||
+                (cpfutils::CPFInterpolator::NOT_ERROR != err_after &&
+                 cpfutils::CPFInterpolator::INTERPOLATION_NOT_IN_THE_MIDDLE != err_after))
+            return BiasEstimErr::RATES_CALC_FAILED;
+
+        rates.push_back((interp_after.tof_2w - interp_before.tof_2w) / (2.L * rate_delta));
+        resids.push_back(rdata[i].second);
+    }
+
+    return estimateBiases(rates, resids, estimate);
+}
+
 }
 }
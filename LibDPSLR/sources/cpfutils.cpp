@@ -16,6 +16,43 @@
 
 #include "includes/cpfutils.h"
 #include "includes/math_operators.h"
+#include "includes/utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+
+using Vec3 = std::array<long double, 3>;
+
+// Earth rotation rate (radians per day), for the station rotation during the flight time.
+constexpr long double kEarthRotationDay = 6.300388L;
+// Light time iterations.
+constexpr long double kDefaultLightTimeTolerance = 1e-12L;
+constexpr unsigned kMaxLightTimeIterations = 10;
+
+inline Vec3 subtract(const Vec3& a, const Vec3& b)
+{
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+inline long double norm(const Vec3& v)
+{
+    return sqrtl(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+// Rotation of the vector around the z axis.
+inline Vec3 rotateZ(const Vec3& v, long double angle)
+{
+    const double s = std::sin(angle);
+    const double c = std::cos(angle);
+    return {v[0] * c - v[1] * s, v[0] * s + v[1] * c, v[2]};
+}
+
+}
 
 namespace dpslr {
 namespace cpfutils {
@@ -38,22 +75,44 @@ CPFInterpolator::CPFInterpolator(const CPF &cpf,
                                  const dpslr::geo::frames::GeodeticPoint<long double> &stat_geodetic,
                                  const dpslr::geo::frames::GeocentricPoint<long double> &stat_geocentric) :
     stat_geodetic(stat_geodetic),
-    stat_geocentric(stat_geocentric)
+    stat_geocentric(stat_geocentric),
+    stat_xyz(stat_geocentric.store<std::array<long double, 3>>()),
+    direction(CPFData::DirectionFlagEnum::COMMON_EPOCH),
+    light_time_tolerance(kDefaultLightTimeTolerance)
 {
     // TODO: improve error handling
     if (cpf.empty() || cpf.getData().positionRecords().empty())
         return;
 
-    this->mjd_orig = cpf.getData().positionRecords().front().mjd;
-    this->sod_orig = cpf.getData().positionRecords().front().sod;
-    this->mjd_end = cpf.getData().positionRecords().back().mjd;
-    this->sod_end = cpf.getData().positionRecords().back().sod;
+    // Use the records of only one direction flag (lunar CPFs have transmit and receive records at the same epochs).
+    const auto& records = cpf.getData().positionRecords();
+    auto hasDirection = [&records](CPFData::DirectionFlagEnum flag)
+    {
+        return std::any_of(records.begin(), records.end(),
+                           [flag](const CPFData::PositionRecord& rec){return rec.dir_flag == flag;});
+    };
+    if (!hasDirection(CPFData::DirectionFlagEnum::COMMON_EPOCH))
+        this->direction = hasDirection(CPFData::DirectionFlagEnum::TRANSMIT) ?
+                    CPFData::DirectionFlagEnum::TRANSMIT : CPFData::DirectionFlagEnum::RECEIVE;
 
     // Get position records and position times for interpolation calculations
-    for (const auto& pos_record : cpf.getData().positionRecords())
+    bool first = true;
+    for (const auto& pos_record : records)
     {
+        if (pos_record.dir_flag != this->direction)
+            continue;
+
+        if (first)
+        {
+            this->mjd_orig = pos_record.mjd;
+            this->sod_orig = pos_record.sod;
+            first = false;
+        }
+        this->mjd_end = pos_record.mjd;
+        this->sod_end = pos_record.sod;
+
         auto time_tag = pos_record.sod - this->sod_orig + (pos_record.mjd - this->mjd_orig) * 86400.L;
-        position_data.push_back_row(pos_record.geocentric_pos);
+        position_data.push_back(pos_record.geocentric_pos);
         position_times.push_back(time_tag);
     }
 
@@ -93,6 +152,16 @@ CPFInterpolator::InterpolationError CPFInterpolator::interpolate(long double mjt
     return this->interpolate(static_cast<int>(mjd), second, interp_res, mode, function);
 }
 
+void CPFInterpolator::setLightTimeTolerance(long double tolerance)
+{
+    this->light_time_tolerance = tolerance;
+}
+
+long double CPFInterpolator::lightTimeTolerance() const
+{
+    return this->light_time_tolerance;
+}
+
 void CPFInterpolator::getStationLocation(
         dpslr::geo::frames::GeodeticPoint<long double> &geodetic,
         dpslr::geo::frames::GeocentricPoint<long double> &geocentric) const
@@ -147,30 +216,110 @@ CPFInterpolator::InterpolationError CPFInterpolator::convertInterpError(math::La
     return cpf_error;
 }
 
+dpslr::math::LagrangeResult CPFInterpolator::lagrange(long double x, std::array<long double, 3> &y) const
+{
+    // Same algorithm as dpslr::math::lagrangeInterp with degree 9, with binary search and without memory allocation.
+    constexpr unsigned int degree = 9;
+    const std::vector<long double>& t = this->position_times;
+
+    if (t.size() < degree + 1)
+        return dpslr::math::LagrangeResult::DATA_SIZE_MISMATCH;
+    if (x < t.front() || x > t.back())
+        return dpslr::math::LagrangeResult::X_OUT_OF_BOUNDS;
+
+    // Look for given value immediately after interpolation argument.
+    long aux = std::max<long>(1, std::lower_bound(t.begin(), t.end(), x) - t.begin());
+
+    // Get first interpolator point. The first point should leave the interpolated point in the middle.
+    dpslr::math::LagrangeResult error = dpslr::math::LagrangeResult::NOT_ERROR;
+    std::size_t first_point;
+    aux -= (degree + 1)/2;
+    if (aux < 0)
+    {
+        first_point = 0;
+        error = dpslr::math::LagrangeResult::NOT_IN_THE_MIDDLE;
+    }
+    else if (static_cast<std::size_t>(aux) + degree >= t.size())
+    {
+        first_point = t.size() - degree - 1;
+        error = dpslr::math::LagrangeResult::NOT_IN_THE_MIDDLE;
+    }
+    else
+        first_point = static_cast<std::size_t>(aux);
+
+    y = {0.L, 0.L, 0.L};
+    for (std::size_t i = first_point; i <= first_point + degree; i++)
+    {
+        double pj = 1.0;
+        for (std::size_t j = first_point; j <= first_point + degree; j++)
+        {
+            if (j != i) pj *= (x - t[j]) / (t[i] - t[j]);
+        }
+        for (std::size_t k = 0; k < 3; k++)
+            y[k] += this->position_data[i][k] * pj;
+    }
+
+    return error;
+}
+
+CPFInterpolator::InterpolationError CPFInterpolator::objectPosition(long double x,
+                                                                    std::array<long double, 3> &y) const
+{
+    // Common epoch records are interpolated directly.
+    if (CPFData::DirectionFlagEnum::COMMON_EPOCH == this->direction)
+        return this->convertInterpError(this->lagrange(x, y));
+
+    // A transmit record at t is the position at t + r/c, and a receive record at t is the position at t - r/c, where
+    // r is the geocentric distance. Iterate the epoch of the records that gives the position at x.
+    const long double sign = CPFData::DirectionFlagEnum::TRANSMIT == this->direction ? -1.L : 1.L;
+    long double epoch = x;
+    for (unsigned i = 0; i < kMaxLightTimeIterations; i++)
+    {
+        auto error = this->lagrange(epoch, y);
+        if (dpslr::math::LagrangeResult::NOT_ERROR != error)
+            return this->convertInterpError(error);
+
+        const long double previous = epoch;
+        epoch = x + sign * norm(y) / dpslr::math::c;
+        if (std::fabs(epoch - previous) < this->light_time_tolerance)
+            break;
+    }
+
+    return this->convertInterpError(this->lagrange(epoch, y));
+}
+
+void CPFInterpolator::localDirection(const std::array<long double, 3> &topocentric, long double &azimuth,
+                                     long double &elevation) const
+{
+    // Topocentric vector in local system.
+    std::array<long double, 3> local;
+    for (std::size_t j = 0; j < 3; j++)
+        local[j] = 0.L + topocentric[0] * this->rotation_matrix[0][j] + topocentric[1] * this->rotation_matrix[1][j] +
+                topocentric[2] * this->rotation_matrix[2][j];
+
+    // Azimuth and elevation (degrees)
+    elevation = atanl(local[2]/sqrtl(local[0]*local[0] + local[1]*local[1]))*180/dpslr::math::pi;
+    azimuth = atan2l(-local[1], local[0])*180/dpslr::math::pi;
+    if(azimuth < 0.L)
+        azimuth += 360.L;
+}
+
 CPFInterpolator::InterpolationError CPFInterpolator::interpolate(int mjd, long double second,
                                                         InterpolationResult &interp_res,
                                                         InterpolationMode mode, InterpolationFunction function) const
 {
-    using namespace dpslr::math_operators;
-
     // Interpolation is not possible if there are no position records
     if (this->position_times.empty())
         return CPFInterpolator::NO_POS_RECORDS;
 
-
     // Variables and containers.
-    long double x_interp;
-    std::vector<long double> y_interp;
-    long double dist_to_object, elevation, azimuth, diff_azim, diff_elev;
-    long double azi_out, elev_out, time_out, dsidt, tb = 0.0L, distout = 0.0L;
-    std::vector<long double> topocentric_position, topocentric_outbound;
-    std::vector<long double> stat_xyz(this->stat_geocentric.store<std::vector<long double>>());
-    dpslr::math::Matrix<long double> station_rotated, station_rotation, topocentric_local_pos, topocentric_out_local;
-    dpslr::math::LagrangeResult interp_error = dpslr::math::LagrangeResult::NOT_ERROR;
+    Vec3 object, topocentric, outbound;
+    long double elevation, azimuth, elev_out, azi_out, diff_azim, diff_elev;
+    InterpolationError error;
 
     // Generate the relative time.
     int day_relative = mjd - this->mjd_orig;
-    x_interp = (day_relative*86400) + second - this->sod_orig;
+    long double x_interp = (day_relative*86400) + second - this->sod_orig;
 
     // Check if the relative time is negative.
     if(x_interp < 0 || x_interp > this->position_times.back())
@@ -184,47 +333,30 @@ CPFInterpolator::InterpolationError CPFInterpolator::interpolate(int mjd, long d
     interp_res.mjdt = mjd + second/86400.L;
     interp_res.sec_of_day = second;
 
-    if(function == CPFInterpolator::LAGRANGE_9)
-    {
-        interp_error = dpslr::math::lagrangeInterp(this->position_times, this->position_data, 9, x_interp, y_interp);
-    }
-    else
+    if(function != CPFInterpolator::LAGRANGE_9)
     {
         interp_res.error = CPFInterpolator::UNKNOWN_INTERPOLATOR;
         return CPFInterpolator::UNKNOWN_INTERPOLATOR;
     }
 
-    // Return if errors.
-    if (dpslr::math::LagrangeResult::NOT_ERROR != interp_error)
+    // Object position at transmit time. Return if errors.
+    error = this->objectPosition(x_interp, object);
+    if (CPFInterpolator::NOT_ERROR != error)
     {
-        interp_res.error = this->convertInterpError(interp_error);
-        return this->convertInterpError(interp_error);
+        interp_res.error = error;
+        return error;
     }
 
-    // Topocentric vector station/object both at transmit time
-    topocentric_position = y_interp - stat_xyz;
-
-    // Instant distance from station to object at transmit time
-    dist_to_object=sqrtl(topocentric_position[0]*topocentric_position[0] +
-                        topocentric_position[1]*topocentric_position[1] +
-                        topocentric_position[2]*topocentric_position[2]);
-
-    // Topocentric vector in local system
-    topocentric_local_pos.push_back_row(topocentric_position);
-    topocentric_local_pos *= rotation_matrix;
+    // Topocentric vector station/object both at transmit time, and instant distance.
+    topocentric = subtract(object, this->stat_xyz);
+    const long double dist_to_object = norm(topocentric);
+    this->localDirection(topocentric, azimuth, elevation);
 
-    // Azimuth and elevation (degrees)
-    elevation=atanl(topocentric_local_pos[0][2]/sqrtl(topocentric_local_pos[0][0]*topocentric_local_pos[0][0]+
-            topocentric_local_pos[0][1]*topocentric_local_pos[0][1]))*180/dpslr::math::pi;
     // TODO: Check 90 degrees elevation case (pag 263 fundamental of astrodinamic and applications (Vallado).
     // Fix, but never should be reached.
     if(dpslr::math::compareFloating(elevation, 90.0L) == 1)
         elevation+=0.01L;
 
-    azimuth=atan2l(-topocentric_local_pos[0][1],topocentric_local_pos[0][0])*180/dpslr::math::pi;
-    if(azimuth < 0.L)
-        azimuth+=360.L;
-
     // Instant vector only mode (not used in range gate generator)
     if (mode == InterpolationMode::INSTANT_VECTOR)
     {
@@ -232,8 +364,9 @@ CPFInterpolator::InterpolationError CPFInterpolator::interpolate(int mjd, long d
         interp_res.range = dist_to_object;
         if(this->com_offset)
             interp_res.range -= *this->com_offset;
-        // Round trip flight time (sec)
+        // Flight times (sec)
         interp_res.tof_2w = 2*interp_res.range/dpslr::math::c;
+        interp_res.tof_1w = interp_res.range/dpslr::math::c;
         // Direction
         interp_res.azimuth = azimuth;
         interp_res.elevation = elevation;
@@ -241,56 +374,44 @@ CPFInterpolator::InterpolationError CPFInterpolator::interpolate(int mjd, long d
         interp_res.diff_azimuth = 0;
         interp_res.diff_elevation = 0;
         // Store geocentric interpolated position
-        std::copy(y_interp.begin(), y_interp.end(), interp_res.geocentric.begin());
+        std::copy(object.begin(), object.end(), interp_res.geocentric.begin());
         // Return.
         interp_res.error = CPFInterpolator::NOT_ERROR;
         return CPFInterpolator::NOT_ERROR;
     }
 
-    // Store geocentric for calculate station rotated.
-    station_rotated.push_back_row(stat_xyz);
-    // Calculate the time out.
-    time_out = dist_to_object/dpslr::math::c;
-
-    // Iteration for laser pulse two-way trip (2 iteration).
-    for (unsigned int i=0; i<2; i++)
+    // Outbound light time: station at transmit time, object at bounce time. The station is rotated during the flight
+    // time of the previous iteration (not rotated in the first one).
+    Vec3 station_rotated = this->stat_xyz;
+    long double time_out = dist_to_object/dpslr::math::c;
+    long double distout = 0.0L;
+    for (unsigned int i = 0; i < kMaxLightTimeIterations; i++)
     {
-        //  Bounce time.
-        tb = x_interp + time_out;
-
-        // Interpolate geocentric position of the object for bounce time tb
-        interp_error =  dpslr::math::lagrangeInterp(position_times, position_data, 9, tb, y_interp);
-
-        if ( dpslr::math::LagrangeResult::NOT_ERROR != interp_error )
-            return this->convertInterpError(interp_error);
-
-        // Topocentric outbound vector
-        topocentric_outbound = y_interp - station_rotated[0];
+        // Interpolate geocentric position of the object for bounce time.
+        error = this->objectPosition(x_interp + time_out, object);
+        if (CPFInterpolator::NOT_ERROR != error)
+        {
+            interp_res.error = error;
+            return error;
+        }
 
-        //  Distance from station (tt) to object (tb)
-        distout=sqrtl(topocentric_outbound[0] * topocentric_outbound[0] +
-                     topocentric_outbound[1] * topocentric_outbound[1] +
-                     topocentric_outbound[2] * topocentric_outbound[2] );
+        // Topocentric outbound vector and distance from station (tt) to object (tb).
+        outbound = subtract(object, station_rotated);
+        distout = norm(outbound);
 
         // Outbound flight time (sec)
-        time_out= distout/dpslr::math::c;
+        const long double previous = time_out;
+        time_out = distout/dpslr::math::c;
 
-        // Rotate station during flight time (radians) */
-        dsidt= 6.300388L * (time_out/86400.0L);
-        dpslr::math::euclid3DRotMat(3,dsidt,station_rotation);
-        station_rotated *= station_rotation;
-    }
+        // Rotate station during flight time (radians)
+        station_rotated = rotateZ(this->stat_xyz, -kEarthRotationDay * (time_out/86400.0L));
 
-    // Topocentric outbound vector in local system
-    topocentric_out_local.push_back_row(topocentric_outbound);
-    topocentric_out_local *= this->rotation_matrix;
+        if (i > 0 && std::fabs(time_out - previous) < this->light_time_tolerance)
+            break;
+    }
 
     // Outbound azimuth and elevation (laser beam pointing direction)
-    elev_out=atanl(topocentric_out_local[0][2]/sqrtl(topocentric_out_local[0][0]*topocentric_out_local[0][0] +
-            topocentric_out_local[0][1]*topocentric_out_local[0][1]))*180/dpslr::math::pi;
-    azi_out=atan2l(-topocentric_out_local[0][1],topocentric_out_local[0][0])*180/dpslr::math::pi;
-    if(azi_out < 0.L)
-        azi_out+=360;
+    this->localDirection(outbound, azi_out, elev_out);
 
     //DIFFERENCE BETWEEN RECEIVE AND TRANSMIT DIRECTION AT TRANSMIT TIME
     diff_azim = 2*(azimuth-azi_out);
@@ -300,73 +421,226 @@ CPFInterpolator::InterpolationError CPFInterpolator::interpolate(int mjd, long d
         diff_azim -= 720;
     diff_elev= 2*(elevation-elev_out);
 
+    // Store geocentric interpolated position at bounce time.
+    std::copy(object.begin(), object.end(), interp_res.geocentric.begin());
+
+    // Direction
+    interp_res.azimuth = azi_out;
+    interp_res.elevation = elev_out;
+
+    // Differences.
+    interp_res.diff_azimuth = diff_azim;
+    interp_res.diff_elevation = diff_elev;
+
+    // Outbound leg only (one-way ranging to transponders).
+    long double range_1w = distout;
+
     // Average distance from station to object (both at bounce time).
     if(mode == InterpolationMode::AVERAGE_DISTANCE)
     {
-        // Store geocentric interpolated position
-        std::copy(y_interp.begin(), y_interp.end(), interp_res.geocentric.begin());
+        // One-way range
+        interp_res.range = norm(subtract(object, this->stat_xyz));
+        range_1w = interp_res.range;
+    }
+    // Outbound leg plus inbound leg, with the station rotated during the inbound flight time (other direction).
+    else if (mode == InterpolationMode::INBOUND_VECTOR)
+    {
+        long double time_in = time_out;
+        long double distin = 0.0L;
+        for (unsigned int i = 0; i < kMaxLightTimeIterations; i++)
+        {
+            distin = norm(subtract(object, rotateZ(this->stat_xyz, kEarthRotationDay * (time_in/86400.0L))));
+            const long double previous = time_in;
+            time_in = distin/dpslr::math::c;
+            if (std::fabs(time_in - previous) < this->light_time_tolerance)
+                break;
+        }
+        interp_res.range = (distout + distin)/2;
+    }
+    // Outbound leg only.
+    else if (mode == InterpolationMode::ONE_WAY)
+    {
+        interp_res.range = distout;
+    }
 
-        // Calculate topocentric
-        y_interp = y_interp - stat_xyz;
+    // Radial center of mass correction.
+    if(this->com_offset)
+    {
+        interp_res.range -= *this->com_offset;
+        range_1w -= *this->com_offset;
+    }
 
-        // One-way range
-        interp_res.range = sqrtl(y_interp[0] * y_interp[0] +
-                                 y_interp[1] * y_interp[1] +
-                                 y_interp[2] * y_interp[2]);
+    // Flight times (sec)
+    interp_res.tof_2w = 2 * interp_res.range/dpslr::math::c;
+    interp_res.tof_1w = range_1w/dpslr::math::c;
 
-        // Radial center of mass correction.
-        if(this->com_offset)
-            interp_res.range -= *this->com_offset;
+    interp_res.error = CPFInterpolator::NOT_ERROR;
+    return CPFInterpolator::NOT_ERROR;
+}
 
-        // Round trip flight time (sec)
-        interp_res.tof_2w = 2 * interp_res.range/dpslr::math::c;
+namespace
+{
 
-        // Direction
-        interp_res.azimuth = azi_out;
-        interp_res.elevation = elev_out;
+// Steps and tolerances of the adaptive pass search, in seconds.
+constexpr long double kMaxSearchStep = 60.L;
+constexpr long double kMinSearchStep = 1.L;
+constexpr long double kRateDelta = 0.05L;
+constexpr long double kTimeTolerance = 1e-4L;
 
-        // Differences.
-        interp_res.diff_azimuth = diff_azim;
-        interp_res.diff_elevation = diff_elev;
+// Limits of the range gate predictor tables. The segments are not halved below the minimum length (seconds).
+constexpr double kMinGateSegment = 1.;
+constexpr unsigned kMaxGateDegree = 32;
 
-        interp_res.error = CPFInterpolator::NOT_ERROR;
-        return CPFInterpolator::NOT_ERROR;
+struct ElevationSample
+{
+    long double t;           // Seconds from the search start.
+    long double f;           // Elevation over the minimum elevation, in degrees.
+    long double rate;        // Elevation rate in deg/s.
+    long double azim;        // Azimuth in degrees.
+    long double azim_rate;   // Azimuth rate in deg/s.
+};
+
+bool isValidInterpolation(CPFInterpolator::InterpolationError error)
+{
+    return CPFInterpolator::InterpolationError::NOT_ERROR == error ||
+           CPFInterpolator::InterpolationError::INTERPOLATION_NOT_IN_THE_MIDDLE == error;
+}
+
+void splitTime(int mjd_start, long double fract_day_start, long double t, int& mjd, long double& fract_day)
+{
+    const long double seconds = fract_day_start + t;
+    const long double days = std::floor(seconds / 86400.L);
+    mjd = mjd_start + static_cast<int>(days);
+    fract_day = seconds - days * 86400.L;
+}
+
+// Clenshaw evaluation of the Chebyshev series c[0] + c[1]*T1(x) + ... + c[degree]*Tdegree(x), with x in [-1, 1].
+inline double chebyshevValue(const double* c, unsigned degree, double x)
+{
+    const double x2 = 2. * x;
+    double b1 = 0., b2 = 0.;
+    for (unsigned k = degree; k > 0; k--)
+    {
+        const double b0 = c[k] + x2 * b1 - b2;
+        b2 = b1;
+        b1 = b0;
     }
+    return c[0] + x * b1 - b2;
+}
 
-    interp_res.error = CPFInterpolator::NOT_ERROR;
-    return CPFInterpolator::NOT_ERROR;
+// Brent's method for the root of f in [a, b]. f(a) and f(b) must have different signs.
+template <typename F>
+long double brentRoot(F&& f, long double a, long double b, long double fa, long double fb, long double tol)
+{
+    long double c = a, fc = fa;
+    long double d = b - a, e = d;
 
-    /* TODO: Mode Inbound vector
-    // Inbound vector: station at receiving time
-    if (mode == 2)
+    for (int i = 0; i < 100; i++)
     {
-        tinb= time_out;
-        //  Iteration
-        for (i=0; i<2; i++)
+        if ((fb > 0.L) == (fc > 0.L))
+        {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (std::fabs(fc) < std::fabs(fb))
+        {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+
+        const long double tol1 = 2.L * std::numeric_limits<long double>::epsilon() * std::fabs(b) + 0.5L * tol;
+        const long double xm = 0.5L * (c - b);
+        if (std::fabs(xm) <= tol1 || 0.L == fb)
+            return b;
+
+        if (std::fabs(e) >= tol1 && std::fabs(fa) > std::fabs(fb))
         {
-            //  Receive time
-            if (iunits == 0)
-                tr=tb+tinb;
+            // Inverse quadratic interpolation, or secant if there are only two points.
+            long double p, q, r;
+            const long double s = fb / fa;
+            if (a == c)
+            {
+                p = 2.L * xm * s;
+                q = 1.L - s;
+            }
+            else
+            {
+                q = fa / fc;
+                r = fb / fc;
+                p = s * (2.L * xm * q * (q - r) - (b - a) * (r - 1.L));
+                q = (q - 1.L) * (r - 1.L) * (s - 1.L);
+            }
+            if (p > 0.L)
+                q = -q;
+            p = std::fabs(p);
+            if (2.L * p < std::min(3.L * xm * q - std::fabs(tol1 * q), std::fabs(e * q)))
+            {
+                e = d;
+                d = p / q;
+            }
             else
-                tr=tb+tinb/86400.e0;
-            //  Rotate station during inbound flight time (other direction)
-            dsidt=6.300388e0*(tinb/86400.e0);
-            ddreh(3,-dsidt,r3);
-            dmlmav(stageo,r3,starot);
-            //  Topocentric inbound vector in geocentric system
-            topinb[0]=objbnc[0]-starot[0];
-            topinb[1]=objbnc[1]-starot[1];
-            topinb[2]=objbnc[2]-starot[2];
-            //  Distance from object to station
-            distinb=sqrt(topinb[0]*topinb[0]+topinb[1]*topinb[1]+topinb[2]*topinb[2]);
-            //  Inbound flight time (sec)
-            tinb= distinb/c;
+            {
+                d = xm;
+                e = d;
+            }
+        }
+        else
+        {
+            // Bisection.
+            d = xm;
+            e = d;
         }
-        // Total distance from station to object to station (correct computation)
-        distot=distout+distinb;
-        *fltime=(distot- 2.e0*cofm_corr)/c;
-        *range =distot/2.e0- cofm_corr;
-    } */
+
+        a = b;
+        fa = fb;
+        b += std::fabs(d) > tol1 ? d : (xm > 0.L ? tol1 : -tol1);
+        fb = f(b);
+    }
+
+    return b;
+}
+
+// Start, culmination and end of a pass from its steps.
+void setPassLimits(Pass& pass)
+{
+    if (pass.steps.empty())
+        return;
+    pass.start = pass.steps.front();
+    pass.end = pass.steps.back();
+    pass.culmination = *std::max_element(pass.steps.begin(), pass.steps.end(),
+                                         [](const Pass::Step& a, const Pass::Step& b){return a.elev < b.elev;});
+}
+
+// Degree of the interpolations of the stitcher (same as the CPF interpolator) and minimum records of a release.
+constexpr unsigned kStitchDegree = 9;
+constexpr std::size_t kMinStitchRecords = kStitchDegree + 1;
+// Tolerance for equal times in the stitcher, in seconds.
+constexpr long double kStitchTimeTolerance = 1e-6L;
+// Consecutive nodes separated by more than this number of steps are a gap in the merged CPF.
+constexpr long double kStitchMaxGapSteps = 2.L;
+
+// Interval of the merged CPF taken from a release. Times in seconds from the stitch origin.
+struct StitchInterval
+{
+    long double start;
+    long double end;
+    std::size_t release;
+};
+
+// Node of the merged CPF.
+struct StitchNode
+{
+    long double t;
+    std::size_t release;
+    std::size_t idx;
+};
+
+// Cubic step from 0 (x = 0) to 1 (x = 1) with zero slope at both ends.
+inline long double smoothStep(long double x)
+{
+    return x * x * (3.L - 2.L * x);
+}
 
 }
 
@@ -375,6 +649,8 @@ PassCalculator::PassCalculator(const CPF &cpf, const dpslr::geo::frames::Geodeti
                                unsigned int min_elev, long double interval) :
     min_elev_(min_elev),
     interval_(interval),
+    search_mode_(SearchMode::FIXED_STEP),
+    dense_steps_(true),
     interpolator_{cpf, stat_geodetic, stat_geocentric}
 {
 
@@ -386,6 +662,8 @@ PassCalculator::PassCalculator(const std::string &cpf_path,
                                unsigned int min_elev, long double interval) :
     min_elev_(min_elev),
     interval_(interval),
+    search_mode_(SearchMode::FIXED_STEP),
+    dense_steps_(true),
     interpolator_{CPF(cpf_path, CPF::OpenOptionEnum::ALL_DATA), stat_geodetic, stat_geocentric}
 {
 
@@ -411,6 +689,22 @@ long double PassCalculator::interval() const
     return this->interval_;
 }
 
+void PassCalculator::setSearchMode(SearchMode mode, bool dense_steps)
+{
+    this->search_mode_ = mode;
+    this->dense_steps_ = dense_steps;
+}
+
+PassCalculator::SearchMode PassCalculator::searchMode() const
+{
+    return this->search_mode_;
+}
+
+bool PassCalculator::denseSteps() const
+{
+    return this->dense_steps_;
+}
+
 PassCalculator::ResultCodes PassCalculator::getPasses(int mjd_start, long double fract_day_start,
                                                       int mjd_end, long double fract_day_end,
                                                       std::vector<Pass> &passes) const
@@ -430,6 +724,16 @@ PassCalculator::ResultCodes PassCalculator::getPasses(int mjd_start, long double
         (mjd_end_cpf == mjd_end && fract_day_end > fract_end_cpf) )
         return ResultCodes::INTERVAL_OUTSIDE_OF_CPF;
 
+    if (SearchMode::ADAPTIVE == this->search_mode_)
+        return this->getPassesAdaptive(mjd_start, fract_day_start, mjd_end, fract_day_end, passes);
+
+    return this->getPassesFixedStep(mjd_start, fract_day_start, mjd_end, fract_day_end, passes);
+}
+
+PassCalculator::ResultCodes PassCalculator::getPassesFixedStep(int mjd_start, long double fract_day_start,
+                                                               int mjd_end, long double fract_day_end,
+                                                               std::vector<Pass> &passes) const
+{
     int mjd = mjd_start;
     long double fract_day = fract_day_start;
     CPFInterpolator::InterpolationResult interp_result;
@@ -471,8 +775,11 @@ PassCalculator::ResultCodes PassCalculator::getPasses(int mjd_start, long double
         else if(pass_started)
         {
             pass_started = false;
+            setPassLimits(current_pass);
             passes.push_back(std::move(current_pass));
             current_pass = {};
+            current_pass.interval = this->interval_;
+            current_pass.min_elev = this->min_elev_;
         }
 
         fract_day += this->interval_;
@@ -487,12 +794,640 @@ PassCalculator::ResultCodes PassCalculator::getPasses(int mjd_start, long double
 
     if (pass_started)
     {
+        setPassLimits(current_pass);
         passes.push_back(current_pass);
     }
 
     return PassCalculator::ResultCodes::NOT_ERROR;
 }
 
+PassCalculator::ResultCodes PassCalculator::getPassesAdaptive(int mjd_start, long double fract_day_start,
+                                                              int mjd_end, long double fract_day_end,
+                                                              std::vector<Pass> &passes) const
+{
+    // Times are handled as seconds from the interval start.
+    const long double total_time = (mjd_end - mjd_start) * 86400.L + fract_day_end - fract_day_start;
+    const long double min_elev = this->min_elev_;
+    bool failed = false;
+
+    // Elevation and azimuth at a time, with their rates from a forward difference (backward at the interval end).
+    auto sample = [&](long double t)
+    {
+        ElevationSample result;
+        CPFInterpolator::InterpolationResult interp_result, interp_delta;
+        const long double delta = t + kRateDelta <= total_time ? kRateDelta : -kRateDelta;
+        int mjd;
+        long double fract_day;
+
+        splitTime(mjd_start, fract_day_start, t, mjd, fract_day);
+        failed |= !isValidInterpolation(this->interpolator_.interpolate(mjd, fract_day, interp_result));
+        splitTime(mjd_start, fract_day_start, t + delta, mjd, fract_day);
+        failed |= !isValidInterpolation(this->interpolator_.interpolate(mjd, fract_day, interp_delta));
+
+        long double diff_azim = interp_delta.azimuth - interp_result.azimuth;
+        if (diff_azim > 180.L)
+            diff_azim -= 360.L;
+        else if (diff_azim < -180.L)
+            diff_azim += 360.L;
+
+        result.t = t;
+        result.f = interp_result.elevation - min_elev;
+        result.rate = (interp_delta.elevation - interp_result.elevation) / delta;
+        result.azim = interp_result.azimuth;
+        result.azim_rate = diff_azim / delta;
+        return result;
+    };
+
+    auto elevation = [&](long double t){return sample(t).f;};
+
+    // The culminations are the roots of the central difference, since the forward one vanishes half a delta earlier.
+    auto elevation_rate = [&](long double t)
+    {
+        const long double t_before = std::min(std::max(t - 0.5L * kRateDelta, 0.L), total_time - kRateDelta);
+        return (sample(t_before + kRateDelta).f - sample(t_before).f) / kRateDelta;
+    };
+
+    auto make_step = [&](const ElevationSample& s)
+    {
+        Pass::Step step;
+        splitTime(mjd_start, fract_day_start, s.t, step.mjd, step.fract_day);
+        step.azim = static_cast<double>(s.azim);
+        step.elev = static_cast<double>(s.f + min_elev);
+        step.azim_rate = static_cast<double>(s.azim_rate);
+        step.elev_rate = static_cast<double>(s.rate);
+        return step;
+    };
+
+    // Pass being built.
+    bool in_pass = false;
+    ElevationSample rise, culmination;
+
+    auto close_pass = [&](const ElevationSample& set)
+    {
+        Pass pass;
+        pass.interval = this->interval_;
+        pass.min_elev = this->min_elev_;
+        pass.start = make_step(rise);
+        pass.culmination = make_step(culmination.f >= set.f ? culmination : set);
+        pass.end = make_step(set);
+        passes.push_back(std::move(pass));
+        in_pass = false;
+    };
+
+    // Processes a sub interval where the elevation is monotonic, looking for a horizon crossing.
+    auto process_monotonic = [&](const ElevationSample& a, const ElevationSample& b)
+    {
+        if ((a.f >= 0.L) == (b.f >= 0.L))
+            return;
+        ElevationSample cross = sample(brentRoot(elevation, a.t, b.t, a.f, b.f, kTimeTolerance));
+        if (!in_pass)
+        {
+            in_pass = true;
+            rise = cross;
+            culmination = cross;
+        }
+        else
+            close_pass(cross);
+    };
+
+    ElevationSample prev = sample(0.L);
+    if (prev.f >= 0.L)
+    {
+        in_pass = true;
+        rise = prev;
+        culmination = prev;
+    }
+
+    while (!failed && prev.t < total_time)
+    {
+        // The step is bounded by the time needed to reach the minimum elevation at the current rate.
+        long double step = kMaxSearchStep;
+        if ((prev.f < 0.L && prev.rate > 0.L) || (prev.f > 0.L && prev.rate < 0.L))
+            step = std::min(step, std::max(kMinSearchStep, 0.5L * std::fabs(prev.f / prev.rate)));
+
+        ElevationSample next = sample(std::min(prev.t + step, total_time));
+
+        // A maximum and a minimum inside the step (a grazing pass shorter than the step followed by a dip, or the
+        // opposite) leave the same rate sign at both ends, but not at the mean slope. The step is halved until the
+        // rates and the slope agree, so the maximum is found below.
+        while (!failed && next.t - prev.t > kMinSearchStep &&
+               ((prev.rate > 0.L && next.rate > 0.L && next.f < prev.f) ||
+                (prev.rate < 0.L && next.rate < 0.L && next.f > prev.f)))
+            next = sample(prev.t + 0.5L * (next.t - prev.t));
+
+        if (failed)
+            break;
+
+        // A maximum inside the step splits it in two monotonic sub intervals. It can be a whole pass between samples.
+        if (prev.rate > 0.L && next.rate < 0.L)
+        {
+            // The central differences keep the sign unless the maximum is within half a delta of a limit.
+            const long double rate_prev = elevation_rate(prev.t);
+            const long double rate_next = elevation_rate(next.t);
+            ElevationSample top;
+            if (rate_prev > 0.L && rate_next < 0.L)
+                top = sample(brentRoot(elevation_rate, prev.t, next.t, rate_prev, rate_next, kTimeTolerance));
+            else
+                top = rate_prev > 0.L ? next : prev;
+            process_monotonic(prev, top);
+            if (in_pass && top.f > culmination.f)
+                culmination = top;
+            process_monotonic(top, next);
+        }
+        else
+        {
+            process_monotonic(prev, next);
+            if (in_pass && next.f > culmination.f)
+                culmination = next;
+        }
+
+        prev = next;
+    }
+
+    if (failed)
+        return PassCalculator::ResultCodes::OTHER_ERROR;
+
+    if (in_pass)
+        close_pass(prev);
+
+    // Dense steps, at the same instants as the fixed step mode.
+    if (this->dense_steps_)
+    {
+        for (auto& pass : passes)
+        {
+            const long double t_start = (pass.start.mjd - mjd_start) * 86400.L + pass.start.fract_day - fract_day_start;
+            const long double t_end = (pass.end.mjd - mjd_start) * 86400.L + pass.end.fract_day - fract_day_start;
+            CPFInterpolator::InterpolationResult interp_result;
+
+            for (long double k = std::ceil(t_start / this->interval_); k * this->interval_ <= t_end; k++)
+            {
+                Pass::Step step;
+                splitTime(mjd_start, fract_day_start, k * this->interval_, step.mjd, step.fract_day);
+                if (!isValidInterpolation(this->interpolator_.interpolate(step.mjd, step.fract_day, interp_result)))
+                    return PassCalculator::ResultCodes::OTHER_ERROR;
+
+                step.azim = interp_result.azimuth;
+                step.elev = interp_result.elevation;
+                step.azim_rate = pass.steps.empty() ? 0. : (step.azim - pass.steps.back().azim) / this->interval_;
+                step.elev_rate = pass.steps.empty() ? 0. : (step.elev - pass.steps.back().elev) / this->interval_;
+                pass.steps.push_back(std::move(step));
+            }
+        }
+    }
+
+    return PassCalculator::ResultCodes::NOT_ERROR;
+}
+
+RangeGatePredictor::RangeGatePredictor(const CPF &cpf,
+                                       const dpslr::geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                                       const dpslr::geo::frames::GeocentricPoint<long double> &stat_geocentric) :
+    interpolator_{cpf, stat_geodetic, stat_geocentric},
+    mjd_start_(0),
+    sod_start_(0.L),
+    duration_(0.),
+    degree_(0),
+    segment_(0.),
+    inv_segment_(0.),
+    segments_(0),
+    max_error_(0.),
+    time_bias_(0.),
+    range_bias_tof_(0.)
+{
+
+}
+
+RangeGatePredictor::ResultCodes RangeGatePredictor::prepare(int mjd, long double sod_start, long double duration,
+                                                            double tolerance, unsigned degree, double max_segment)
+{
+    this->coefs_.clear();
+    this->segments_ = 0;
+    this->max_error_ = 0.;
+
+    if (this->interpolator_.empty())
+        return RangeGatePredictor::ResultCodes::CPF_NOT_VALID;
+
+    if (!(duration > 0.L) || !(tolerance > 0.) || !(max_segment > 0.) || 0 == degree || degree > kMaxGateDegree)
+        return RangeGatePredictor::ResultCodes::PARAMETERS_NOT_VALID;
+
+    const unsigned nodes = degree + 1;
+    const long double pi = dpslr::math::pi;
+
+    // Chebyshev nodes (first kind) and the cosines of the discrete transform.
+    std::vector<long double> node_x(nodes), cosines(nodes * nodes);
+    for (unsigned j = 0; j < nodes; j++)
+    {
+        node_x[j] = std::cos(pi * (j + 0.5L) / nodes);
+        for (unsigned k = 0; k < nodes; k++)
+            cosines[k * nodes + j] = std::cos(pi * k * (j + 0.5L) / nodes);
+    }
+
+    bool failed = false;
+    auto flight_time = [&](long double t)
+    {
+        CPFInterpolator::InterpolationResult interp_result;
+        int mjd_t;
+        long double sod_t;
+        splitTime(mjd, sod_start, t, mjd_t, sod_t);
+        failed |= !isValidInterpolation(this->interpolator_.interpolate(mjd_t, sod_t, interp_result,
+                                                                       CPFInterpolator::AVERAGE_DISTANCE));
+        return interp_result.tof_2w;
+    };
+
+    std::vector<double> coefs;
+    std::vector<long double> values(nodes);
+    const unsigned checks = 2 * nodes;
+    std::size_t segments = static_cast<std::size_t>(std::ceil(duration / std::min<long double>(max_segment, duration)));
+    long double segment = duration / segments;
+    long double max_error;
+
+    while (true)
+    {
+        coefs.assign(segments * nodes, 0.);
+        max_error = 0.L;
+
+        for (std::size_t s = 0; s < segments && !failed; s++)
+        {
+            const long double t_start = s * segment;
+            double* c = coefs.data() + s * nodes;
+
+            // Coefficients from the flight times at the nodes.
+            for (unsigned j = 0; j < nodes; j++)
+                values[j] = flight_time(t_start + 0.5L * (node_x[j] + 1.L) * segment);
+            for (unsigned k = 0; k < nodes; k++)
+            {
+                long double sum = 0.L;
+                for (unsigned j = 0; j < nodes; j++)
+                    sum += values[j] * cosines[k * nodes + j];
+                c[k] = static_cast<double>((k == 0 ? 1.L : 2.L) * sum / nodes);
+            }
+
+            // Check between the nodes, including the segment limits.
+            for (unsigned i = 0; i <= checks; i++)
+            {
+                const long double x = -1.L + 2.L * i / checks;
+                const long double error = chebyshevValue(c, degree, static_cast<double>(x)) -
+                        flight_time(t_start + 0.5L * (x + 1.L) * segment);
+                max_error = std::max(max_error, std::fabs(error));
+            }
+        }
+
+        if (failed)
+            return RangeGatePredictor::ResultCodes::INTERVAL_OUTSIDE_OF_CPF;
+
+        if (max_error <= tolerance || segment / 2.L < kMinGateSegment)
+            break;
+
+        segments *= 2;
+        segment = duration / segments;
+    }
+
+    this->mjd_start_ = mjd;
+    this->sod_start_ = sod_start;
+    this->duration_ = static_cast<double>(duration);
+    this->degree_ = degree;
+    this->segment_ = static_cast<double>(segment);
+    this->inv_segment_ = static_cast<double>(1.L / segment);
+    this->segments_ = segments;
+    this->max_error_ = static_cast<double>(max_error);
+    this->coefs_ = std::move(coefs);
+
+    return max_error <= tolerance ? RangeGatePredictor::ResultCodes::NOT_ERROR :
+                                    RangeGatePredictor::ResultCodes::TOLERANCE_NOT_REACHED;
+}
+
+bool RangeGatePredictor::tof(int mjd, long double sod, double &tof_2w) const
+{
+    const double t = static_cast<double>((mjd - this->mjd_start_) * 86400.L + (sod - this->sod_start_)) +
+            this->time_bias_.load(std::memory_order_relaxed);
+
+    if (this->coefs_.empty() || !(t >= 0. && t <= this->duration_))
+        return false;
+
+    // The end of the interval belongs to the last segment.
+    const double u = t * this->inv_segment_;
+    const std::size_t s = std::min(static_cast<std::size_t>(u), this->segments_ - 1);
+    const double x = 2. * (u - s) - 1.;
+
+    tof_2w = chebyshevValue(this->coefs_.data() + s * (this->degree_ + 1), this->degree_, x) +
+            this->range_bias_tof_.load(std::memory_order_relaxed);
+    return true;
+}
+
+void RangeGatePredictor::setTimeBias(double time_bias)
+{
+    this->time_bias_.store(time_bias, std::memory_order_relaxed);
+}
+
+double RangeGatePredictor::timeBias() const
+{
+    return this->time_bias_.load(std::memory_order_relaxed);
+}
+
+void RangeGatePredictor::setRangeBias(double range_bias)
+{
+    this->range_bias_tof_.store(2. * range_bias / dpslr::math::c, std::memory_order_relaxed);
+}
+
+double RangeGatePredictor::rangeBias() const
+{
+    return this->range_bias_tof_.load(std::memory_order_relaxed) * dpslr::math::c / 2.;
+}
+
+bool RangeGatePredictor::empty() const
+{
+    return this->coefs_.empty();
+}
+
+double RangeGatePredictor::segmentLength() const
+{
+    return this->segment_;
+}
+
+std::size_t RangeGatePredictor::segments() const
+{
+    return this->segments_;
+}
+
+double RangeGatePredictor::maxError() const
+{
+    return this->max_error_;
+}
+
+CPFStitcher::CPFStitcher(double blend_time) :
+    blend_time_(blend_time)
+{}
+
+CPFStitcher::ResultCodes CPFStitcher::addRelease(const CPF &cpf)
+{
+    if (cpf.empty() || !cpf.getHeader().basicInfo1Header() || !cpf.getHeader().basicInfo2Header() ||
+            cpf.getData().positionRecords().size() < kMinStitchRecords)
+        return CPF_NOT_VALID;
+
+    if (!this->releases_.empty() &&
+            this->releases_.front().header.basicInfo2Header()->norad != cpf.getHeader().basicInfo2Header()->norad)
+        return TARGET_MISMATCH;
+
+    this->releases_.push_back({cpf.getHeader(), cpf.getData().positionRecords()});
+    return NOT_ERROR;
+}
+
+void CPFStitcher::clear()
+{
+    this->releases_.clear();
+    this->seams_.clear();
+    this->gaps_.clear();
+}
+
+CPFStitcher::ResultCodes CPFStitcher::stitch(CPF &merged)
+{
+    std::vector<CPF> segments;
+    const ResultCodes result = this->stitch(segments);
+    if (NOT_ERROR != result)
+        return result;
+    if (segments.size() > 1)
+        return EPHEMERIS_GAP;
+
+    merged = std::move(segments.front());
+    return NOT_ERROR;
+}
+
+CPFStitcher::ResultCodes CPFStitcher::stitch(std::vector<CPF> &segments)
+{
+    this->seams_.clear();
+    this->gaps_.clear();
+    segments.clear();
+    if (this->releases_.empty())
+        return NO_RELEASES;
+
+    const std::size_t n_releases = this->releases_.size();
+
+    // Releases sorted from the lowest to the highest precedence, and the rank of each one.
+    std::vector<std::size_t> order(n_releases);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b)
+    {
+        return this->precedes(this->releases_[a], this->releases_[b]);
+    });
+    std::vector<std::size_t> rank(n_releases);
+    for (std::size_t i = 0; i < n_releases; i++)
+        rank[order[i]] = i;
+
+    // Times of the nodes of each release in seconds from a common origin, and their mean step.
+    int mjd_orig = this->releases_.front().positions.front().mjd;
+    for (const auto& release : this->releases_)
+        mjd_orig = std::min(mjd_orig, release.positions.front().mjd);
+
+    std::vector<std::vector<long double>> times(n_releases);
+    std::vector<dpslr::math::Matrix<long double>> positions(n_releases);
+    std::vector<long double> steps(n_releases);
+    for (std::size_t r = 0; r < n_releases; r++)
+    {
+        for (const auto& record : this->releases_[r].positions)
+        {
+            times[r].push_back((record.mjd - mjd_orig) * 86400.L + record.sod);
+            positions[r].push_back_row(record.geocentric_pos);
+        }
+        steps[r] = (times[r].back() - times[r].front()) / (times[r].size() - 1);
+    }
+
+    // Intervals taken from each release, from the highest precedence to the lowest. Each release takes the parts of
+    // its span not taken yet.
+    std::vector<StitchInterval> owned;
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        const std::size_t r = *it;
+        long double current = times[r].front();
+        const long double end = times[r].back();
+        std::vector<StitchInterval> pieces;
+        for (const auto& interval : owned)
+        {
+            if (interval.end <= current || interval.start >= end)
+                continue;
+            if (interval.start > current)
+                pieces.push_back({current, interval.start, r});
+            current = std::max(current, interval.end);
+        }
+        if (current < end)
+            pieces.push_back({current, end, r});
+
+        owned.insert(owned.end(), pieces.begin(), pieces.end());
+        std::sort(owned.begin(), owned.end(), [](const StitchInterval& a, const StitchInterval& b)
+        {
+            return a.start < b.start;
+        });
+    }
+
+    // Nodes of the intervals. The nodes closer than half the step are de-duplicated, keeping the newest release.
+    std::vector<StitchNode> nodes;
+    for (const auto& interval : owned)
+    {
+        const auto& t = times[interval.release];
+        auto first = std::lower_bound(t.begin(), t.end(), interval.start - kStitchTimeTolerance);
+        for (auto it = first; it != t.end() && *it <= interval.end + kStitchTimeTolerance; ++it)
+        {
+            const StitchNode node{*it, interval.release, static_cast<std::size_t>(it - t.begin())};
+            bool keep = true;
+            while (!nodes.empty() &&
+                   node.t - nodes.back().t < 0.5L * std::min(steps[node.release], steps[nodes.back().release]))
+            {
+                if (rank[nodes.back().release] >= rank[node.release])
+                {
+                    keep = false;
+                    break;
+                }
+                nodes.pop_back();
+            }
+            if (keep)
+                nodes.push_back(node);
+        }
+    }
+
+    // Gaps between consecutive nodes, where the merged CPF is split so it is never interpolated across them.
+    std::vector<bool> gap_before(nodes.size(), false);
+    for (std::size_t j = 1; j < nodes.size(); j++)
+    {
+        const long double max_step = kStitchMaxGapSteps * std::max(steps[nodes[j - 1].release],
+                                                                   steps[nodes[j].release]);
+        if (nodes[j].t - nodes[j - 1].t <= max_step)
+            continue;
+
+        gap_before[j] = true;
+        CPFGap gap;
+        gap.mjd_start = mjd_orig + static_cast<int>(std::floor(nodes[j - 1].t / 86400.L));
+        gap.sod_start = nodes[j - 1].t - (gap.mjd_start - mjd_orig) * 86400.L;
+        gap.mjd_end = mjd_orig + static_cast<int>(std::floor(nodes[j].t / 86400.L));
+        gap.sod_end = nodes[j].t - (gap.mjd_end - mjd_orig) * 86400.L;
+        this->gaps_.push_back(gap);
+    }
+
+    // Merged positions, blended with the older release near each seam.
+    std::vector<std::array<long double, 3>> merged_pos(nodes.size());
+    for (std::size_t j = 0; j < nodes.size(); j++)
+        merged_pos[j] = this->releases_[nodes[j].release].positions[nodes[j].idx].geocentric_pos;
+
+    std::vector<long double> y_interp;
+    for (std::size_t j = 1; j < nodes.size(); j++)
+    {
+        if (nodes[j - 1].release == nodes[j].release || gap_before[j])
+            continue;
+
+        // The seam is the first (or last) node of the newer release, and the blend goes towards it.
+        const bool newer_after = rank[nodes[j].release] > rank[nodes[j - 1].release];
+        const std::size_t seam_idx = newer_after ? j : j - 1;
+        const std::size_t newer = nodes[seam_idx].release;
+        const std::size_t older = newer_after ? nodes[j - 1].release : nodes[j].release;
+        const long double ts = nodes[seam_idx].t;
+
+        // The older release must cover the seam.
+        auto res = dpslr::math::lagrangeInterp(times[older], positions[older], kStitchDegree, ts, y_interp);
+        if (dpslr::math::LagrangeResult::X_OUT_OF_BOUNDS == res ||
+                dpslr::math::LagrangeResult::DATA_SIZE_MISMATCH == res)
+            continue;
+
+        CPFSeam seam;
+        seam.mjd = mjd_orig + static_cast<int>(std::floor(ts / 86400.L));
+        seam.sod = ts - (seam.mjd - mjd_orig) * 86400.L;
+        seam.older = older;
+        seam.newer = newer;
+        seam.jump = std::sqrt(std::pow(merged_pos[seam_idx][0] - y_interp[0], 2) +
+                              std::pow(merged_pos[seam_idx][1] - y_interp[1], 2) +
+                              std::pow(merged_pos[seam_idx][2] - y_interp[2], 2));
+        this->seams_.push_back(seam);
+
+        // Consecutive nodes of the newer release at its side of the seam. The blend takes at most half of them.
+        const long double dir = newer_after ? 1.L : -1.L;
+        std::size_t run_end = seam_idx;
+        while ((newer_after ? run_end + 1 < nodes.size() : run_end > 0) &&
+               nodes[newer_after ? run_end + 1 : run_end - 1].release == newer &&
+               !gap_before[newer_after ? run_end + 1 : run_end])
+            run_end = newer_after ? run_end + 1 : run_end - 1;
+        const long double window = std::min(static_cast<long double>(this->blend_time_),
+                                            0.5L * std::fabs(nodes[run_end].t - ts));
+        if (window <= 0.L)
+            continue;
+
+        for (std::size_t k = seam_idx; ; k = newer_after ? k + 1 : k - 1)
+        {
+            const long double dist = dir * (nodes[k].t - ts);
+            if (dist >= window)
+                break;
+
+            res = dpslr::math::lagrangeInterp(times[older], positions[older], kStitchDegree, nodes[k].t, y_interp);
+            if (dpslr::math::LagrangeResult::NOT_ERROR == res || dpslr::math::LagrangeResult::NOT_IN_THE_MIDDLE == res)
+            {
+                const long double w = smoothStep(dist / window);
+                for (std::size_t c = 0; c < 3; c++)
+                    merged_pos[k][c] = y_interp[c] + w * (merged_pos[k][c] - y_interp[c]);
+            }
+
+            if (k == run_end)
+                break;
+        }
+    }
+
+    // Merged records of each continuous segment, with the headers of the newest release and the segment span.
+    const Release& newest = this->releases_[order.back()];
+    const long double step = steps[order.back()];
+    std::size_t first = 0;
+    while (first < nodes.size())
+    {
+        std::vector<CPFData::PositionRecord> records;
+        bool uniform = true;
+        std::size_t j = first;
+        do
+        {
+            CPFData::PositionRecord record = this->releases_[nodes[j].release].positions[nodes[j].idx];
+            record.geocentric_pos = merged_pos[j];
+            records.push_back(std::move(record));
+            if (j > first && std::fabs(nodes[j].t - nodes[j - 1].t - step) > kStitchTimeTolerance)
+                uniform = false;
+            j++;
+        } while (j < nodes.size() && !gap_before[j]);
+        first = j;
+
+        CPFHeader::BasicInfo2Header h2 = *newest.header.basicInfo2Header();
+        h2.start_time = dpslr::utils::modifiedJulianDatetimeToTimePoint(records.front().mjd +
+                                                                        records.front().sod / 86400.L);
+        h2.end_time = dpslr::utils::modifiedJulianDatetimeToTimePoint(records.back().mjd +
+                                                                      records.back().sod / 86400.L);
+        h2.total_seconds = std::chrono::duration_cast<std::chrono::seconds>(h2.end_time - h2.start_time);
+        h2.time_between_entries = std::chrono::seconds(uniform ? static_cast<long long>(std::round(step)) : 0);
+
+        segments.emplace_back(newest.header.basicInfo1Header()->cpf_version);
+        segments.back().getHeader() = newest.header;
+        segments.back().getHeader().setBasicInfo2Header(h2);
+        segments.back().getData().setPositionRecords(records);
+    }
+
+    return NOT_ERROR;
+}
+
+std::size_t CPFStitcher::releases() const
+{
+    return this->releases_.size();
+}
+
+const std::vector<CPFSeam> &CPFStitcher::seams() const
+{
+    return this->seams_;
+}
+
+const std::vector<CPFGap> &CPFStitcher::gaps() const
+{
+    return this->gaps_;
+}
+
+bool CPFStitcher::precedes(const Release &a, const Release &b) const
+{
+    const auto& a1 = *a.header.basicInfo1Header();
+    const auto& b1 = *b.header.basicInfo1Header();
+    if (a1.cpf_production_date != b1.cpf_production_date)
+        return a1.cpf_production_date < b1.cpf_production_date;
+    if (a1.cpf_sequence_number != b1.cpf_sequence_number)
+        return a1.cpf_sequence_number < b1.cpf_sequence_number;
+    return a1.cpf_subsequence_number < b1.cpf_subsequence_number;
+}
+
 std::string CPFInterpolator::InterpolationResult::toJson() const
 {
     std::ostringstream oss;
@@ -502,6 +1437,7 @@ std::string CPFInterpolator::InterpolationResult::toJson() const
         << "\"mjdt\":" << std::setprecision(12) << std::fixed << mjdt << ","
         << "\"range\":" << std::setprecision(3) << std::fixed << range << ","
         << "\"tof_2w\":" << std::setprecision(12) << std::fixed << tof_2w << ","
+        << "\"tof_1w\":" << std::setprecision(12) << std::fixed << tof_1w << ","
         << "\"azimuth\":" << std::setprecision(4) << std::fixed << azimuth << ","
         << "\"elevation\":" << std::setprecision(4) << std::fixed << elevation << ","
         << "\"diff_azimuth\":" << std::setprecision(4) << std::fixed << diff_azimuth << ","
@@ -18,10 +18,119 @@
 #include "includes/utils.h"
 #include "includes/common.h"
 #include "includes/algorithms.h"
+#include "includes/dpslr_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 
 namespace dpslr{
 namespace crdutils{
 
+namespace
+{
+
+// Equatorial radius of the Earth (m), used only for classifying the orbits.
+constexpr long double kEarthRadius = 6378137.0L;
+
+// Maximum number of trend fits of a bin.
+constexpr unsigned kMaxTrendIterations = 10;
+
+// Forms the normal point of a bin. The indexes are the ones of the full rate records of the bin.
+bool formNormalPoint(const std::vector<std::size_t>& indexes, const common::ResidualsData<>& rdata,
+                     const std::vector<CRDData::FullRateRecord>& fr_records, double rf, double tlrnc,
+                     unsigned min_ranges, unsigned degree, CRDData::NormalPointRecord& np)
+{
+    if (indexes.empty() || indexes.size() < min_ranges)
+        return false;
+
+    // Times relative to the first one for the fit conditioning.
+    const long double t0 = rdata[indexes.front()].first;
+    std::vector<long double> times, bin_resids, resids;
+    for (const auto& idx : indexes)
+    {
+        times.push_back(rdata[idx].first - t0);
+        bin_resids.push_back(rdata[idx].second);
+    }
+
+    // Remove the residual signature of the bin and reject the points outside RF*RMS. The trend is fitted again with
+    // the accepted points until they do not change, so the rejected points do not bias it.
+    const unsigned fit_degree = static_cast<unsigned>(std::min<std::size_t>(degree, indexes.size() - 1));
+    std::vector<bool> accepted_mask(indexes.size(), true);
+    algorithms::BinStats stats;
+    for (unsigned iter = 0; iter < kMaxTrendIterations; iter++)
+    {
+        std::vector<long double> fit_times, fit_resids;
+        for (std::size_t i = 0; i < times.size(); i++)
+        {
+            if (accepted_mask[i])
+            {
+                fit_times.push_back(times[i]);
+                fit_resids.push_back(bin_resids[i]);
+            }
+        }
+
+        if (fit_times.size() <= fit_degree)
+            return false;
+
+        const auto coefs = math::polynomialFit(fit_times, fit_resids, fit_degree);
+        resids.clear();
+        for (std::size_t i = 0; i < times.size(); i++)
+            resids.push_back(bin_resids[i] - math::applyPolynomial(coefs, times[i]));
+
+        // Iterative RF*RMS rejection.
+        if (algorithms::BinStatsCalcErr::NOT_ERROR != algorithms::calcBinStats(resids, stats, rf, tlrnc))
+            return false;
+
+        if (stats.amask_rfrms == accepted_mask)
+            break;
+        accepted_mask = stats.amask_rfrms;
+    }
+
+    // Mean epoch of the accepted ranges.
+    long double time_sum = 0.L;
+    unsigned accepted = 0;
+    for (std::size_t i = 0; i < times.size(); i++)
+    {
+        if (stats.amask_rfrms[i])
+        {
+            time_sum += times[i];
+            accepted++;
+        }
+    }
+
+    if (accepted < min_ranges || accepted == 0)
+        return false;
+
+    // Accepted range nearest to the mean epoch.
+    const long double time_mean = time_sum / accepted;
+    std::size_t selected = times.size();
+    for (std::size_t i = 0; i < times.size(); i++)
+    {
+        if (stats.amask_rfrms[i] &&
+                (selected == times.size() || std::abs(times[i] - time_mean) < std::abs(times[selected] - time_mean)))
+            selected = i;
+    }
+
+    // The normal point range is the selected range moved from its residual to the mean residual (ps).
+    const CRDData::FullRateRecord& record = fr_records[indexes[selected]];
+    np.time_tag = record.time_tag;
+    np.time_flight = record.time_flight -
+            (resids[selected] - stats.stats_rfrms.mean) / static_cast<long double>(math::kSecondToPicosecond);
+    np.system_cfg_id = record.system_cfg_id;
+    np.epoch_event = record.epoch_event;
+    np.raw_ranges = accepted;
+    np.bin_rms = static_cast<double>(stats.stats_rfrms.rms);
+    np.bin_skew = static_cast<double>(stats.stats_rfrms.skew);
+    np.bin_kurtosis = static_cast<double>(stats.stats_rfrms.kurt);
+    np.bin_peak = static_cast<double>(stats.stats_rfrms.peak - stats.stats_rfrms.mean);
+    np.detector_channel = record.detector_channel;
+
+    return true;
+}
+
+}
+
 
 StatsGenErr generateStatsRecord(std::size_t bs, const geo::frames::GeodeticPoint<long double> &stat_geodetic,
                                 const geo::frames::GeocentricPoint<long double> &stat_geocentric,
@@ -69,6 +178,126 @@ StatsGenErr generateStatsRecord(std::size_t bs, const geo::frames::GeodeticPoint
 }
 
 
+NPGenErr generateNormalPoints(double bs, const geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                              const geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                              const CPF &cpf, CRD &crd, double rf, double tlrnc, unsigned min_ranges,
+                              unsigned degree)
+{
+    // Check the bin size.
+    if (bs <= 0)
+        return NPGenErr::BIN_SIZE_NOT_VALID;
+
+    // Calculate the full rate residuals. The trend of calculateFullRateResiduals uses the normal point bin size.
+    dpslr::common::ResidualsData<> rdata;
+    dpslr::algorithms::FullRateResCalcErr err_rescal = dpslr::algorithms::calculateFullRateResiduals(
+                cpf, crd, stat_geodetic, stat_geocentric, static_cast<std::size_t>(std::ceil(bs)), rdata);
+
+    // If there was an error while calculating residuals, return error
+    if(err_rescal != dpslr::algorithms::FullRateResCalcErr::NOT_ERROR)
+        return static_cast<NPGenErr>(err_rescal);
+
+    return generateNormalPoints(bs, rdata, crd, rf, tlrnc, min_ranges, degree);
+}
+
+
+NPGenErr generateNormalPoints(double bs, const common::ResidualsData<> &rdata, CRD &crd, double rf,
+                              double tlrnc, unsigned min_ranges, unsigned degree)
+{
+    // Check the bin size and the CRD data.
+    if (bs <= 0)
+        return NPGenErr::BIN_SIZE_NOT_VALID;
+
+    if (crd.empty() || crd.getData().fullRateRecords().empty())
+        return NPGenErr::CRD_DATA_EMPTY;
+
+    if (!crd.getConfiguration().systemConfiguration())
+        return NPGenErr::CRD_CFG_NOT_VALID;
+
+    const std::vector<CRDData::FullRateRecord>& fr_records = crd.getData().fullRateRecords();
+    if (rdata.size() != fr_records.size())
+        return NPGenErr::RESIDS_NOT_MATCHING;
+
+    // Divide the records not flagged as noise in bins, in a single pass.
+    std::vector<long double> times;
+    std::vector<std::size_t> data_indexes;
+    for (std::size_t i = 0; i < fr_records.size(); i++)
+    {
+        if (fr_records[i].filter_flag != CRDData::FilterFlagEnum::NOISE_EXCLUDED_RETURN)
+        {
+            times.push_back(rdata[i].first);
+            data_indexes.push_back(i);
+        }
+    }
+
+    std::vector<std::vector<std::size_t>> bins =
+            algorithms::extractBins(times, times, bs, algorithms::BinDivisionEnum::DAY_FIXED);
+    for (auto& bin : bins)
+        for (auto& idx : bin)
+            idx = data_indexes[idx];
+
+    // Form the normal points of each bin. The bins are independent.
+    std::vector<CRDData::NormalPointRecord> np_bins(bins.size());
+    std::vector<char> np_formed(bins.size(), false);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (long long i = 0; i < static_cast<long long>(bins.size()); i++)
+        np_formed[i] = formNormalPoint(bins[i], rdata, fr_records, rf, tlrnc, min_ranges, degree, np_bins[i]);
+
+    // Return rate using the fire rate, if available.
+    const auto& laser_cfg = crd.getConfiguration().laserConfiguration();
+    const double fire_rate = laser_cfg ? laser_cfg->fire_rate : 0.;
+
+    std::vector<CRDData::NormalPointRecord> np_records;
+    for (std::size_t i = 0; i < bins.size(); i++)
+    {
+        if (np_formed[i])
+        {
+            np_bins[i].window_length = bs;
+            np_bins[i].return_rate = fire_rate > 0. ? 100. * np_bins[i].raw_ranges / (bs * fire_rate) : 0.;
+            np_records.push_back(std::move(np_bins[i]));
+        }
+    }
+
+    // Set the normal point records.
+    const std::size_t np_count = np_records.size();
+    crd.getData().setNormalPointRecords(std::move(np_records));
+
+    if (np_count == 0)
+        return NPGenErr::NP_CALC_FAILED;
+    else if (np_count < bins.size())
+        return NPGenErr::SOME_BINS_CALC_FAILED;
+    else
+        return NPGenErr::NOT_ERROR;
+}
+
+
+double normalPointBinSize(const CPF &cpf)
+{
+    const auto& records = cpf.getData().positionRecords();
+    if (records.empty())
+        return 0.;
+
+    // Mean altitude of the object over the spherical Earth.
+    long double radius = 0.L;
+    for (const auto& record : records)
+        radius += std::sqrt(record.geocentric_pos[0] * record.geocentric_pos[0] +
+                            record.geocentric_pos[1] * record.geocentric_pos[1] +
+                            record.geocentric_pos[2] * record.geocentric_pos[2]);
+    const long double altitude = radius / records.size() - kEarthRadius;
+
+    if (altitude < 1000e3L)
+        return 15.;
+    else if (altitude < 2500e3L)
+        return 30.;
+    else if (altitude < 10000e3L)
+        return 120.;
+    else if (altitude < 100000e3L)
+        return 300.;
+    else
+        return 900.;
+}
+
+
 OverallCaliGencErr generateOverallCalibration(CRDData::ShiftTypeEnum shift_mode, CRD &crd)
 {
     // Aux variables.
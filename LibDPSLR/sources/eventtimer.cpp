@@ -0,0 +1,131 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file eventtimer.cpp
+ *
+ * @brief This file contains the implementation of the utilities for the event timer epochs.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "includes/eventtimer.h"
+#include "includes/math_definitions.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <algorithm>
+#include <cstdlib>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace eventtimer{
+// =====================================================================================================================
+
+MatchEpochsError matchEpochs(const std::vector<std::int64_t> &starts, const std::vector<std::int64_t> &predicted,
+                             const std::vector<std::int64_t> &stops, std::int64_t win_lower, std::int64_t win_upper,
+                             std::vector<EpochMatch> &matches)
+{
+    matches.clear();
+
+    // Check the input data.
+    if (starts.size() != predicted.size())
+        return MatchEpochsError::DATA_SIZE_MISMATCH;
+    if (win_lower > win_upper)
+        return MatchEpochsError::WINDOW_NOT_VALID;
+    if (!std::is_sorted(starts.begin(), starts.end()))
+        return MatchEpochsError::STARTS_NOT_SORTED;
+    if (!std::is_sorted(stops.begin(), stops.end()))
+        return MatchEpochsError::STOPS_NOT_SORTED;
+
+    // The merge needs the expected stops sorted. Otherwise, a candidate start could be skipped.
+    for (std::size_t i = 1; i < starts.size(); i++)
+        if (starts[i] + predicted[i] < starts[i - 1] + predicted[i - 1])
+            return MatchEpochsError::PREDICTIONS_NOT_VALID;
+
+    // Stops associated with each start, for the shared start flag.
+    std::vector<unsigned> start_stops(starts.size(), 0);
+    matches.reserve(std::min(starts.size(), stops.size()));
+
+    // Candidate starts of the current stop: [first, last). The expected stop of a start is start + predicted.
+    std::size_t first = 0, last = 0;
+    for (std::size_t s = 0; s < stops.size(); s++)
+    {
+        const std::int64_t stop = stops[s];
+        while (first < starts.size() && starts[first] + predicted[first] < stop - win_upper)
+            first++;
+        last = std::max(last, first);
+        while (last < starts.size() && starts[last] + predicted[last] <= stop - win_lower)
+            last++;
+
+        if (first == last)
+            continue;
+
+        // Nearest candidate to the prediction.
+        std::size_t best = first;
+        std::int64_t best_residual = std::llabs(stop - starts[first] - predicted[first]);
+        for (std::size_t i = first + 1; i < last; i++)
+        {
+            const std::int64_t residual = std::llabs(stop - starts[i] - predicted[i]);
+            if (residual < best_residual)
+            {
+                best = i;
+                best_residual = residual;
+            }
+        }
+
+        EpochMatch match;
+        match.start_idx = best;
+        match.stop_idx = s;
+        match.start = starts[best];
+        match.stop = stop;
+        match.tof_2w = stop - starts[best];
+        match.pred_2w = predicted[best];
+        match.candidates = static_cast<unsigned>(last - first);
+        match.ambiguous = match.candidates > 1;
+        match.shared_start = false;
+        matches.push_back(match);
+        start_stops[best]++;
+    }
+
+    for (auto& match : matches)
+        match.shared_start = start_stops[match.start_idx] > 1;
+
+    return MatchEpochsError::NOT_ERROR;
+}
+
+common::RangeData matchesToRangeData(const std::vector<EpochMatch> &matches, bool skip_ambiguous)
+{
+    common::RangeData ranges;
+    ranges.reserve(matches.size());
+    for (const auto& match : matches)
+    {
+        if (skip_ambiguous && match.ambiguous)
+            continue;
+        ranges.emplace_back(static_cast<long double>(match.start) / math::kSecondToPicosecond,
+                            static_cast<long double>(match.tof_2w), static_cast<long double>(match.pred_2w), 0.L);
+    }
+    return ranges;
+}
+
+}} // END NAMESPACES.
+// =====================================================================================================================
@@ -16,8 +16,81 @@
 
 #include "includes/geo.h"
 
+#include <algorithm>
 #include <cmath>
 
+// =====================================================================================================================
+namespace
+{
+// Dispersion constants of Mendes and Pavlis model (micrometres^-2) and correction for 375 ppm of CO2 content.
+constexpr double kMpK0 = 238.0185;
+constexpr double kMpK1 = 19990.975;
+constexpr double kMpK2 = 57.362;
+constexpr double kMpK3 = 579.55174;
+constexpr double kMpW0 = 295.235;
+constexpr double kMpW1 = 2.6422;
+constexpr double kMpW2 = -0.032380;
+constexpr double kMpW3 = 0.004028;
+constexpr double kMpCO2 = 1.0 + 0.534e-6 * (375.0 - 450.0);
+
+// Coefficients of the FCULa mapping function (IERS TN 36, table 9.3).
+constexpr double kA10 = 12100.8e-7, kA11 = 1729.5e-9, kA12 = 319.1e-7, kA13 = -1847.8e-11;
+constexpr double kA20 = 30496.5e-7, kA21 = 234.6e-8, kA22 = -103.5e-6, kA23 = -185.6e-10;
+constexpr double kA30 = 6877.7e-5, kA31 = 197.2e-7, kA32 = -345.8e-5, kA33 = 106.0e-9;
+
+// Dispersion formula of the hydrostatic component of Mendes and Pavlis model.
+double mpHydrostaticDispersion(double wl)
+{
+    const double s2 = 1.0 / (wl * wl);
+    return 0.01 * kMpCO2 * (kMpK1 * (kMpK0 + s2) / ((kMpK0 - s2) * (kMpK0 - s2)) +
+                            kMpK3 * (kMpK2 + s2) / ((kMpK2 - s2) * (kMpK2 - s2)));
+}
+
+// Dispersion formula of the non hydrostatic component of Mendes and Pavlis model.
+double mpNonHydrostaticDispersion(double wl)
+{
+    const double s2 = 1.0 / (wl * wl);
+    return 0.003101 * (kMpW0 + 3.0 * kMpW1 * s2 + 5.0 * kMpW2 * s2 * s2 + 7.0 * kMpW3 * s2 * s2 * s2);
+}
+
+// Site function of Mendes and Pavlis model.
+double mpSiteFunction(double phi, double ht)
+{
+    return 1.0 - 0.00266 * std::cos(2.0 * phi) - 0.00000028 * ht;
+}
+
+// Water vapor pressure of many values. Same formulas as dpslr::geo::meteo::waterVaporPressure.
+void waterVaporPressureBatch(const double* rh, const double* temp, const double* pres, std::size_t n,
+                             dpslr::geo::meteo::WtrVapPressModel mode, double* e0)
+{
+    if (mode == dpslr::geo::meteo::WtrVapPressModel::ORIGINAL_MM)
+    {
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const double tc = temp[i] - 273.15;
+            e0[i] = rh[i] * 6.11e-2 * std::pow(10.0, (7.5 * tc) / (237.3 + tc));
+        }
+    }
+    else if (mode == dpslr::geo::meteo::WtrVapPressModel::GIACOMO_DAVIS)
+    {
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const double t = temp[i];
+            const double tc = t - 273.15;
+            const double es = 0.01 * std::exp(1.2378847e-5 * t * t - 1.9121316e-2 * t + 33.93711047 - 6.3431645e3 / t);
+            const double fw = 1.00062 + 3.14e-6 * pres[i] + 5.6e-7 * tc * tc;
+            e0[i] = rh[i] * 0.01 * fw * es;
+        }
+    }
+    else
+    {
+        for (std::size_t i = 0; i < n; i++)
+            e0[i] = 0.;
+    }
+}
+}
+// =====================================================================================================================
+
 namespace dpslr{
 namespace geo{
 
@@ -48,6 +121,45 @@ double waterVaporPressure(double rh, double temp, double pres, WtrVapPressModel
     return e0;
 }
 
+bool interpolateMeteo(const MeteoSeries &records, const std::vector<long double> &times, MeteoSeries &result)
+{
+    const std::size_t n = records.times.size();
+    if (0 == n || records.pres.size() != n || records.temp.size() != n || records.rh.size() != n ||
+            !std::is_sorted(records.times.begin(), records.times.end()))
+        return false;
+
+    result.times = times;
+    result.pres.resize(times.size());
+    result.temp.resize(times.size());
+    result.rh.resize(times.size());
+
+    // Index of the first record after the current time tag.
+    std::size_t idx = 0;
+    for (std::size_t i = 0; i < times.size(); i++)
+    {
+        while (idx < n && records.times[idx] <= times[i])
+            idx++;
+
+        if (0 == idx || n == idx)
+        {
+            const std::size_t nearest = 0 == idx ? 0 : n - 1;
+            result.pres[i] = records.pres[nearest];
+            result.temp[i] = records.temp[nearest];
+            result.rh[i] = records.rh[nearest];
+        }
+        else
+        {
+            const double w = static_cast<double>((times[i] - records.times[idx - 1]) /
+                                                 (records.times[idx] - records.times[idx - 1]));
+            result.pres[i] = records.pres[idx - 1] + w * (records.pres[idx] - records.pres[idx - 1]);
+            result.temp[i] = records.temp[idx - 1] + w * (records.temp[idx] - records.temp[idx - 1]);
+            result.rh[i] = records.rh[idx - 1] + w * (records.rh[idx] - records.rh[idx - 1]);
+        }
+    }
+
+    return true;
+}
+
 } // END NAMESPACE METEO.
 
 namespace tropo{
@@ -72,6 +184,109 @@ double pathDelayMariniMurray(double pres, double temp, double rh, double el, dou
     return ar;
 }
 
+double zenithDelayMendesPavlis(double pres, double e0, double wl, double phi, double ht)
+{
+    // Calculate the dispersion and site functions.
+    double fh = mpHydrostaticDispersion(wl);
+    double fnh = mpNonHydrostaticDispersion(wl);
+    double fs = mpSiteFunction(phi, ht);
+    // Calculate the hydrostatic and non hydrostatic zenith delays.
+    double zhd = 2.416579e-3 * fh * pres / fs;
+    double zwd = 1e-4 * (5.316 * fnh - 3.759 * fh) * e0 / fs;
+    // Return one way the zenith tropospheric path delay (meters).
+    return zhd + zwd;
+}
+
+double mappingFunctionFCULa(double el, double temp, double phi, double ht)
+{
+    // Calculate the coefficients of the continued fraction.
+    double tc = temp - 273.15;
+    double cosphi = std::cos(phi);
+    double a1 = kA10 + kA11 * tc + kA12 * cosphi + kA13 * ht;
+    double a2 = kA20 + kA21 * tc + kA22 * cosphi + kA23 * ht;
+    double a3 = kA30 + kA31 * tc + kA32 * cosphi + kA33 * ht;
+    // Calculate the mapping function, normalized to one at the zenith.
+    double sine = std::sin(el);
+    double map_zen = 1.0 + a1 / (1.0 + a2 / (1.0 + a3));
+    return map_zen / (sine + a1 / (sine + a2 / (sine + a3)));
+}
+
+double pathDelayMendesPavlis(double pres, double temp, double rh, double el, double wl, double phi,
+                             double ht, meteo::WtrVapPressModel wvpm)
+{
+    double e0 = meteo::waterVaporPressure(rh, temp, pres, wvpm);
+    return zenithDelayMendesPavlis(pres, e0, wl, phi, ht) * mappingFunctionFCULa(el, temp, phi, ht);
+}
+
+bool pathDelayBatch(const meteo::MeteoSeries &meteo, const std::vector<double> &el, double wl, double phi,
+                    double ht, TropoModel model, meteo::WtrVapPressModel wvpm, std::vector<double> &delays)
+{
+    const std::size_t n = el.size();
+    if (meteo.pres.size() != n || meteo.temp.size() != n || meteo.rh.size() != n)
+        return false;
+
+    delays.resize(n);
+    std::vector<double> e0(n);
+    std::vector<double> sine(n);
+    const double* pres = meteo.pres.data();
+    const double* temp = meteo.temp.data();
+    const double* rh = meteo.rh.data();
+    double* delay = delays.data();
+
+    // Calculate the water vapor pressures and the elevation terms.
+    waterVaporPressureBatch(rh, temp, pres, n, wvpm, e0.data());
+    for (std::size_t i = 0; i < n; i++)
+        sine[i] = std::sin(el[i]);
+
+    if (TropoModel::MARINI_MURRAY == model)
+    {
+        // Terms that only depend on the station and the wavelength.
+        const double cos2phi = std::cos(2.0 * phi);
+        const double flam = 0.9650 + 0.0164 * std::pow(wl, -2) + 0.228e-3 * std::pow(wl, -4);
+        const double fphih = 1.0 - 0.26e-2 * cos2phi - 0.31e-6 * ht;
+        const double kphi = 1.163 - 0.968e-2 * cos2phi;
+
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const double p = pres[i];
+            const double t = temp[i];
+            const double a = 0.2357e-2 * p + 0.141e-3 * e0[i];
+            const double k = kphi - 0.104e-2 * t + 0.1435e-4 * p;
+            const double b = 1.084e-8 * p * t * k + 4.734e-8 * (2.0 * p * p) / (t * (3.0 - 1.0 / k));
+            const double ab = a + b;
+            delay[i] = (flam / fphih) * (ab / (sine[i] + (b / ab) / (sine[i] + 0.01)));
+        }
+    }
+    else if (TropoModel::MENDES_PAVLIS == model)
+    {
+        // Terms that only depend on the station and the wavelength.
+        const double fh = mpHydrostaticDispersion(wl);
+        const double fnh = mpNonHydrostaticDispersion(wl);
+        const double fs = mpSiteFunction(phi, ht);
+        const double ch = 2.416579e-3 * fh / fs;
+        const double cw = 1e-4 * (5.316 * fnh - 3.759 * fh) / fs;
+        const double cosphi = std::cos(phi);
+        const double a1s = kA10 + kA12 * cosphi + kA13 * ht;
+        const double a2s = kA20 + kA22 * cosphi + kA23 * ht;
+        const double a3s = kA30 + kA32 * cosphi + kA33 * ht;
+
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const double tc = temp[i] - 273.15;
+            const double a1 = a1s + kA11 * tc;
+            const double a2 = a2s + kA21 * tc;
+            const double a3 = a3s + kA31 * tc;
+            const double map_zen = 1.0 + a1 / (1.0 + a2 / (1.0 + a3));
+            const double map = map_zen / (sine[i] + a1 / (sine[i] + a2 / (sine[i] + a3)));
+            delay[i] = (ch * pres[i] + cw * e0[i]) * map;
+        }
+    }
+    else
+        return false;
+
+    return true;
+}
+
 } // END NAMESPACE TROPO.
 }} // END NAMESPACE GEO AND DPSLR.
 
@@ -0,0 +1,484 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file rtfilter.cpp
+ *
+ * @brief This file contains the implementation of the real time (streaming) residuals calculation and filter.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "includes/rtfilter.h"
+#include "includes/math_definitions.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <algorithm>
+#include <cmath>
+#include <limits>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace rtfilter{
+// =====================================================================================================================
+
+namespace
+{
+
+// Points of the Lagrange interpolation over the cached predictions, and extra predictions before and after the pass.
+constexpr int kStencilPoints = 6;
+constexpr int kStencilMargin = kStencilPoints / 2;
+
+// Denominators of the Lagrange weights for nodes at 0, 1, ..., 5.
+constexpr long double kLagrangeDenominators[kStencilPoints] = {-120.L, 24.L, -12.L, 12.L, -24.L, 120.L};
+
+// Minimum signal shots of the sliding window for using the line fit.
+constexpr long double kMinFitShots = 3.L;
+
+constexpr long double kSecondsPerDay = 86400.L;
+
+}
+
+StreamingFilter::StreamingFilter(const CPF &cpf, const geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                                 const geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                                 const StreamingFilterConfig &config) :
+    config(config),
+    interpolator(cpf, stat_geodetic, stat_geocentric),
+    pass_start(0.L),
+    day_offset(0.L),
+    last_time(0.L),
+    window_first(0),
+    window_count(0),
+    histogram_total(0),
+    band_bins(1),
+    best_band(0),
+    best_band_dirty(false),
+    fit_origin(0.L),
+    fit_n(0.L), fit_t(0.L), fit_r(0.L), fit_tt(0.L), fit_tr(0.L), fit_rr(0.L),
+    bias_estimator(config.bias_forgetting),
+    queue(config.queue_capacity),
+    dropped_shots(0),
+    overrun_shots(0)
+{}
+
+RTFilterError StreamingFilter::startPass(int mjd, long double sod_start, long double duration)
+{
+    // Without predictions, all the shots are noise until a pass is started without errors.
+    this->stencil.clear();
+
+    const StreamingFilterConfig& cfg = this->config;
+    if (cfg.bin_width <= 0. || cfg.win_upper <= cfg.win_lower || cfg.depth < cfg.bin_width || cfg.window <= 0. ||
+            cfg.stencil_step <= 0. || cfg.window_capacity == 0 || cfg.bias_forgetting <= 0. ||
+            cfg.bias_forgetting > 1. || duration < 0.L)
+        return RTFilterError::CONFIG_NOT_VALID;
+
+    if (this->interpolator.empty())
+        return RTFilterError::CPF_DATA_EMPTY;
+
+    // Cached predictions. The shots are not interpolated directly from the CPF, so the work for each shot is bounded.
+    const std::size_t points = static_cast<std::size_t>(std::ceil(duration / cfg.stencil_step)) + 1 +
+            2 * kStencilMargin;
+    std::vector<long double> predictions(points);
+    this->pass_start = sod_start;
+
+    cpfutils::CPFInterpolator::InterpolationResult interp_data;
+    for (std::size_t i = 0; i < points; i++)
+    {
+        const long double time = sod_start + (static_cast<long double>(i) - kStencilMargin) * cfg.stencil_step;
+        const long double days = std::floor(time / kSecondsPerDay);
+        auto error = this->interpolator.interpolate(mjd + static_cast<int>(days), time - days * kSecondsPerDay,
+                                                    interp_data, cpfutils::CPFInterpolator::INSTANT_VECTOR);
+        if (cpfutils::CPFInterpolator::NOT_ERROR != error &&
+                cpfutils::CPFInterpolator::INTERPOLATION_NOT_IN_THE_MIDDLE != error)
+            return RTFilterError::STENCIL_CALC_FAILED;
+        predictions[i] = interp_data.tof_2w * math::kSecondToPicosecond;
+    }
+
+    // Sliding window.
+    const std::size_t bins = static_cast<std::size_t>(std::ceil((cfg.win_upper - cfg.win_lower) / cfg.bin_width));
+    this->histogram.assign(bins, 0);
+    this->band_bins = std::min(bins, std::max<std::size_t>(1, static_cast<std::size_t>(
+                                                                std::lround(cfg.depth / cfg.bin_width))));
+    this->window_shots.assign(cfg.window_capacity, WindowShot());
+    this->window_first = 0;
+    this->window_count = 0;
+    this->histogram_total = 0;
+    this->band_sums.assign(bins - this->band_bins + 1, 0);
+    this->best_band = 0;
+    this->best_band_dirty = false;
+    this->fit_n = this->fit_t = this->fit_r = this->fit_tt = this->fit_tr = this->fit_rr = 0.L;
+    this->day_offset = 0.L;
+    this->last_time = sod_start;
+    this->overrun_shots.store(0, std::memory_order_relaxed);
+    this->dropped_shots.store(0, std::memory_order_relaxed);
+    this->bias_estimator.reset();
+    this->stencil = std::move(predictions);
+
+    // Discard the shots of the previous pass.
+    QueuedShot shot;
+    while (this->queue.pop(shot)) {}
+
+    return RTFilterError::NOT_ERROR;
+}
+
+bool StreamingFilter::push(long double start_time, double tof_2w)
+{
+    if (!this->queue.push({start_time, tof_2w, std::chrono::steady_clock::now()}))
+    {
+        this->dropped_shots.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+std::size_t StreamingFilter::process(ShotResult *results, std::size_t max)
+{
+    std::size_t processed = 0;
+    QueuedShot shot;
+    while (processed < max && this->queue.pop(shot))
+    {
+        ShotResult& result = results[processed++];
+        result = this->classify(shot.start_time, shot.tof_2w);
+        result.latency = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                        std::chrono::steady_clock::now() - shot.arrival).count());
+        if (result.latency > this->config.latency_budget)
+            this->overrun_shots.fetch_add(1, std::memory_order_relaxed);
+    }
+    return processed;
+}
+
+ShotResult StreamingFilter::classify(long double start_time, double tof_2w)
+{
+    const StreamingFilterConfig& cfg = this->config;
+    ShotResult result{start_time, std::numeric_limits<double>::quiet_NaN(), false, 0};
+
+    // Day change.
+    long double time = start_time + this->day_offset;
+    if (time < this->last_time - kSecondsPerDay / 2)
+    {
+        this->day_offset += kSecondsPerDay;
+        time += kSecondsPerDay;
+    }
+    this->last_time = time;
+
+    long double pred_2w;
+    if (this->stencil.empty() || !this->predict(time, pred_2w))
+        return result;
+
+    const double residual = static_cast<double>(tof_2w - pred_2w - cfg.calibration);
+    result.residual = residual;
+
+    this->expire(time);
+
+    // The shots outside the window are always noise, and they are not stored.
+    if (residual < cfg.win_lower || residual >= cfg.win_upper)
+        return result;
+
+    // Store the shot in the histogram. If the window is full, the oldest shot is discarded.
+    if (this->window_count == this->window_shots.size())
+        this->expire(std::numeric_limits<long double>::max());
+
+    const std::size_t bins = this->histogram.size();
+    const std::size_t bin = std::min(bins - 1, static_cast<std::size_t>((residual - cfg.win_lower) / cfg.bin_width));
+    this->updateHistogram(bin, true);
+
+    // Band with more shots. It is searched again only if a shot of the previous one has expired.
+    if (this->best_band_dirty)
+    {
+        this->best_band = static_cast<std::size_t>(std::max_element(this->band_sums.begin(), this->band_sums.end()) -
+                                                   this->band_sums.begin());
+        this->best_band_dirty = false;
+    }
+    const std::size_t best_first = this->best_band;
+    const std::size_t best_sum = this->band_sums[best_first];
+
+    // Signal detection over the noise floor.
+    const std::size_t noise_bins = bins - this->band_bins;
+    const double noise_floor = noise_bins > 0 ?
+                static_cast<double>(this->histogram_total - best_sum) / noise_bins : 0.;
+    const bool detected = best_sum - noise_floor * this->band_bins >= cfg.min_photons;
+    const bool in_band = bin >= best_first && bin < best_first + this->band_bins;
+
+    if (detected)
+    {
+        if (this->fit_n >= kMinFitShots)
+        {
+            // Line fitted to the signal of the window.
+            const long double dt = time - this->fit_origin;
+            const long double denom = this->fit_n * this->fit_tt - this->fit_t * this->fit_t;
+            long double slope = 0.L;
+            if (denom > std::numeric_limits<long double>::epsilon() * this->fit_n * this->fit_tt)
+                slope = (this->fit_n * this->fit_tr - this->fit_t * this->fit_r) / denom;
+            const long double intercept = (this->fit_r - slope * this->fit_t) / this->fit_n;
+            const long double variance = (this->fit_rr - intercept * this->fit_r - slope * this->fit_tr) / this->fit_n;
+            const long double sigma = std::max(std::sqrt(std::max(variance, 0.L)),
+                                               static_cast<long double>(cfg.min_sigma));
+            result.signal = std::abs(residual - (intercept + slope * dt)) <= cfg.rf * sigma;
+        }
+        else
+            result.signal = in_band;
+    }
+
+    // Store the shot in the window.
+    WindowShot& stored = this->window_shots[(this->window_first + this->window_count) % this->window_shots.size()];
+    stored = {time, residual, bin, result.signal};
+    this->window_count++;
+    if (result.signal)
+    {
+        if (this->fit_n == 0.L)
+            this->fit_origin = time;
+        this->addToFit(stored, 1.L);
+
+        long double rate;
+        if (this->predictRate(time, rate))
+            this->bias_estimator.update(static_cast<double>(rate), residual);
+    }
+
+    return result;
+}
+
+std::size_t StreamingFilter::pending() const
+{
+    return this->queue.size();
+}
+
+std::size_t StreamingFilter::dropped() const
+{
+    return this->dropped_shots.load(std::memory_order_relaxed);
+}
+
+std::size_t StreamingFilter::overruns() const
+{
+    return this->overrun_shots.load(std::memory_order_relaxed);
+}
+
+algorithms::BiasEstimErr StreamingFilter::biasEstimate(algorithms::BiasEstimate &estimate) const
+{
+    return this->bias_estimator.estimate(estimate);
+}
+
+bool StreamingFilter::predict(long double time, long double &tof_2w) const
+{
+    // Position in the stencil.
+    const long double x = (time - this->pass_start) / this->config.stencil_step + kStencilMargin;
+    const long double last = static_cast<long double>(this->stencil.size() - 1);
+    if (x < 0.L || x > last || this->stencil.size() < static_cast<std::size_t>(kStencilPoints))
+        return false;
+
+    // Nodes centered around the time, moved inside at the ends.
+    long long first = static_cast<long long>(std::floor(x)) - (kStencilPoints / 2 - 1);
+    first = std::max(0LL, std::min(first, static_cast<long long>(this->stencil.size()) - kStencilPoints));
+    const long double u = x - first;
+
+    // Lagrange interpolation.
+    tof_2w = 0.L;
+    for (int j = 0; j < kStencilPoints; j++)
+    {
+        long double weight = 1.L / kLagrangeDenominators[j];
+        for (int m = 0; m < kStencilPoints; m++)
+            if (m != j)
+                weight *= (u - m);
+        tof_2w += weight * this->stencil[static_cast<std::size_t>(first + j)];
+    }
+
+    return true;
+}
+
+bool StreamingFilter::predictRate(long double time, long double &rate) const
+{
+    // Same nodes as predict.
+    const long double x = (time - this->pass_start) / this->config.stencil_step + kStencilMargin;
+    const long double last = static_cast<long double>(this->stencil.size() - 1);
+    if (x < 0.L || x > last || this->stencil.size() < static_cast<std::size_t>(kStencilPoints))
+        return false;
+
+    long long first = static_cast<long long>(std::floor(x)) - (kStencilPoints / 2 - 1);
+    first = std::max(0LL, std::min(first, static_cast<long long>(this->stencil.size()) - kStencilPoints));
+    const long double u = x - first;
+
+    // Derivative of the Lagrange interpolation, converted from ps per stencil step to s/s.
+    long double derivative = 0.L;
+    for (int j = 0; j < kStencilPoints; j++)
+    {
+        long double weight = 0.L;
+        for (int k = 0; k < kStencilPoints; k++)
+        {
+            if (k == j)
+                continue;
+            long double product = 1.L;
+            for (int m = 0; m < kStencilPoints; m++)
+                if (m != j && m != k)
+                    product *= (u - m);
+            weight += product;
+        }
+        derivative += weight / kLagrangeDenominators[j] * this->stencil[static_cast<std::size_t>(first + j)];
+    }
+    rate = derivative / (this->config.stencil_step * math::kSecondToPicosecond);
+
+    return true;
+}
+
+void StreamingFilter::expire(long double time)
+{
+    // Removes the shots older than the window. With the maximum time, removes only the oldest one.
+    const bool only_oldest = time == std::numeric_limits<long double>::max();
+    while (this->window_count > 0)
+    {
+        const WindowShot& oldest = this->window_shots[this->window_first];
+        if (!only_oldest && oldest.time >= time - this->config.window)
+            break;
+
+        this->updateHistogram(oldest.bin, false);
+        if (oldest.signal)
+            this->addToFit(oldest, -1.L);
+
+        this->window_first = (this->window_first + 1) % this->window_shots.size();
+        this->window_count--;
+
+        if (only_oldest)
+            break;
+    }
+}
+
+void StreamingFilter::updateHistogram(std::size_t bin, bool add)
+{
+    // Bands that contain the bin.
+    const std::size_t first = bin + 1 >= this->band_bins ? bin + 1 - this->band_bins : 0;
+    const std::size_t last = std::min(bin, this->band_sums.size() - 1);
+
+    if (add)
+    {
+        this->histogram[bin]++;
+        this->histogram_total++;
+        for (std::size_t i = first; i <= last; i++)
+        {
+            this->band_sums[i]++;
+            if (this->band_sums[i] > this->band_sums[this->best_band])
+                this->best_band = i;
+        }
+    }
+    else
+    {
+        this->histogram[bin]--;
+        this->histogram_total--;
+        for (std::size_t i = first; i <= last; i++)
+            this->band_sums[i]--;
+        if (this->best_band >= first && this->best_band <= last)
+            this->best_band_dirty = true;
+    }
+}
+
+void StreamingFilter::addToFit(const WindowShot &shot, long double sign)
+{
+    const long double t = shot.time - this->fit_origin;
+    const long double r = shot.residual;
+    this->fit_n += sign;
+    this->fit_t += sign * t;
+    this->fit_r += sign * r;
+    this->fit_tt += sign * t * t;
+    this->fit_tr += sign * t * r;
+    this->fit_rr += sign * r * r;
+
+    // Reset the sums when the fit is empty, so the rounding errors do not accumulate.
+    if (this->fit_n < 0.5L)
+        this->fit_n = this->fit_t = this->fit_r = this->fit_tt = this->fit_tr = this->fit_rr = 0.L;
+}
+
+StreamingBiasEstimator::StreamingBiasEstimator(double forgetting) :
+    forgetting(forgetting)
+{
+    this->reset();
+}
+
+void StreamingBiasEstimator::reset()
+{
+    this->points = 0;
+    this->rate_origin = 0.L;
+    this->sum_w = this->sum_w2 = this->sum_x = this->sum_y = this->sum_xx = this->sum_xy = this->sum_yy = 0.L;
+}
+
+void StreamingBiasEstimator::update(double rate, double residual)
+{
+    // The rates are relative to the first one, so the sums do not lose precision.
+    const long double x = rate * math::kSecondToPicosecond;
+    if (this->points == 0)
+        this->rate_origin = x;
+    const long double dx = x - this->rate_origin;
+    const long double y = residual;
+    const long double f = this->forgetting;
+
+    this->sum_w = f * this->sum_w + 1.L;
+    this->sum_w2 = f * f * this->sum_w2 + 1.L;
+    this->sum_x = f * this->sum_x + dx;
+    this->sum_y = f * this->sum_y + y;
+    this->sum_xx = f * this->sum_xx + dx * dx;
+    this->sum_xy = f * this->sum_xy + dx * y;
+    this->sum_yy = f * this->sum_yy + y * y;
+    this->points++;
+}
+
+algorithms::BiasEstimErr StreamingBiasEstimator::estimate(algorithms::BiasEstimate &estimate) const
+{
+    estimate = algorithms::BiasEstimate();
+    estimate.ptn = this->points;
+
+    // Degrees of freedom of the weighted fit (n - 2 without forgetting).
+    const long double dof = this->sum_w - 2.L * this->sum_w2 / std::max(this->sum_w, 1.L);
+    if (this->points < 3 || dof <= 0.L)
+        return algorithms::BiasEstimErr::NOT_ENOUGH_POINTS;
+
+    const long double mean_x = this->sum_x / this->sum_w;
+    const long double mean_y = this->sum_y / this->sum_w;
+    const long double sxx = this->sum_xx - this->sum_x * mean_x;
+    const long double sxy = this->sum_xy - this->sum_x * mean_y;
+    const long double syy = this->sum_yy - this->sum_y * mean_y;
+
+    if (sxx <= std::numeric_limits<long double>::epsilon() * this->sum_xx || sxx <= 0.L)
+        return algorithms::BiasEstimErr::SINGULAR_GEOMETRY;
+
+    const long double time_bias = sxy / sxx;
+    const long double abs_mean_x = mean_x + this->rate_origin;
+    const long double bias_ps = mean_y - time_bias * abs_mean_x;
+    const long double ssr = std::max(syy - time_bias * sxy, 0.L);
+
+    // Covariance of the weighted fit, with the residual variance.
+    const long double factor = ssr / dof * this->sum_w2 / this->sum_w;
+    const long double ps_to_m = static_cast<long double>(math::c) / (2.L * math::kSecondToPicosecond);
+    estimate.time_bias = time_bias;
+    estimate.range_bias = bias_ps * ps_to_m;
+    estimate.var_time_bias = factor / sxx;
+    estimate.var_range_bias = factor * (1.L / this->sum_w + abs_mean_x * abs_mean_x / sxx) * ps_to_m * ps_to_m;
+    estimate.cov_time_range = -factor * abs_mean_x / sxx * ps_to_m;
+    estimate.rms_before = std::sqrt(this->sum_yy / this->sum_w);
+    estimate.rms_after = std::sqrt(ssr / this->sum_w);
+
+    return algorithms::BiasEstimErr::NOT_ERROR;
+}
+
+std::size_t StreamingBiasEstimator::count() const
+{
+    return this->points;
+}
+
+}} // END NAMESPACES.
+// =====================================================================================================================
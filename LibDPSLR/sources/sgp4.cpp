@@ -0,0 +1,1164 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file sgp4.cpp
+ *
+ * @brief This file contains the implementation of the SGP4/SDP4 propagator for TLEs.
+ *
+ * The model functions (initl, dscom, dsinit, dspace, dpper and sgp4) keep the structure and the variable names of the
+ * reference implementation, so they can be compared with it.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "includes/sgp4.h"
+#include "includes/utils.h"
+#include "includes/helpers.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace sgp4{
+// =====================================================================================================================
+
+namespace
+{
+
+// WGS-72 constants.
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kTwoPi = 2.0 * kPi;
+constexpr double kDeg2Rad = kPi / 180.0;
+constexpr double kMu = 398600.8;                        // km3/s2
+constexpr double kRadiusEarth = 6378.135;               // km
+constexpr double kJ2 = 0.001082616;
+constexpr double kJ3 = -0.00000253881;
+constexpr double kJ4 = -0.00000165597;
+constexpr double kJ3oJ2 = kJ3 / kJ2;
+constexpr double kX2o3 = 2.0 / 3.0;
+constexpr double kEarthRotation = 7.292115e-5;          // rad/s
+const double kXke = 60.0 / std::sqrt(kRadiusEarth * kRadiusEarth * kRadiusEarth / kMu);
+const double kVKmPerSec = kRadiusEarth * kXke / 60.0;
+
+// Temporary values of the deep space initialization.
+struct DeepSpaceCommon
+{
+    double snodm, cnodm, sinim, cosim, sinomm, cosomm, day, em, emsq, gam, rtemsq;
+    double s1, s2, s3, s4, s5, s6, s7, ss1, ss2, ss3, ss4, ss5, ss6, ss7;
+    double sz1, sz2, sz3, sz11, sz12, sz13, sz21, sz22, sz23, sz31, sz32, sz33;
+    double z1, z2, z3, z11, z12, z13, z21, z22, z23, z31, z32, z33;
+    double nm;
+};
+
+// Parses an implied decimal field of a TLE with exponent, like " 12345-3" (0.12345e-3).
+bool parseExponentField(const std::string& field, double& value)
+{
+    std::string mantissa = dpslr::helpers::trim(field.substr(0, field.size() - 2));
+    std::string exponent = field.substr(field.size() - 2);
+    if (mantissa.empty())
+    {
+        value = 0.0;
+        return true;
+    }
+    char sign = '+';
+    if ('-' == mantissa[0] || '+' == mantissa[0])
+    {
+        sign = mantissa[0];
+        mantissa.erase(0, 1);
+    }
+    char* end = nullptr;
+    double m = std::strtod(("0." + mantissa).c_str(), &end);
+    long e = std::strtol(exponent.c_str(), nullptr, 10);
+    value = ('-' == sign ? -m : m) * std::pow(10.0, static_cast<double>(e));
+    return true;
+}
+
+bool parseDouble(const std::string& field, double& value)
+{
+    std::string trimmed = dpslr::helpers::trim(field);
+    if (trimmed.empty())
+        return false;
+    char* end = nullptr;
+    value = std::strtod(trimmed.c_str(), &end);
+    return end && '\0' == *end;
+}
+
+void initl(double epoch, Elements& el, double& ainv, double& ao, double& con42, double& cosio, double& cosio2,
+           double& eccsq, double& omeosq, double& posq, double& rp, double& rteosq, double& sinio)
+{
+    eccsq = el.ecco * el.ecco;
+    omeosq = 1.0 - eccsq;
+    rteosq = std::sqrt(omeosq);
+    cosio = std::cos(el.inclo);
+    cosio2 = cosio * cosio;
+
+    // Un-kozai the mean motion.
+    double ak = std::pow(kXke / el.no_kozai, kX2o3);
+    double d1 = 0.75 * kJ2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+    double del = d1 / (ak * ak);
+    double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+    del = d1 / (adel * adel);
+    el.no_unkozai = el.no_kozai / (1.0 + del);
+
+    ao = std::pow(kXke / el.no_unkozai, kX2o3);
+    sinio = std::sin(el.inclo);
+    double po = ao * omeosq;
+    con42 = 1.0 - 5.0 * cosio2;
+    el.con41 = -con42 - cosio2 - cosio2;
+    ainv = 1.0 / ao;
+    posq = po * po;
+    rp = ao * (1.0 - el.ecco);
+
+    el.gsto = gstime(epoch + 2433281.5);
+}
+
+void dscom(double epoch, double ep, double argpp, double tc, double inclp, double nodep, double np, Elements& el,
+           DeepSpaceCommon& c)
+{
+    constexpr double zes = 0.01675;
+    constexpr double zel = 0.05490;
+    constexpr double c1ss = 2.9864797e-6;
+    constexpr double c1l = 4.7968065e-7;
+    constexpr double zsinis = 0.39785416;
+    constexpr double zcosis = 0.91744867;
+    constexpr double zcosgs = 0.1945905;
+    constexpr double zsings = -0.98088458;
+
+    c.nm = np;
+    c.em = ep;
+    c.snodm = std::sin(nodep);
+    c.cnodm = std::cos(nodep);
+    c.sinomm = std::sin(argpp);
+    c.cosomm = std::cos(argpp);
+    c.sinim = std::sin(inclp);
+    c.cosim = std::cos(inclp);
+    c.emsq = c.em * c.em;
+    double betasq = 1.0 - c.emsq;
+    c.rtemsq = std::sqrt(betasq);
+
+    el.peo = 0.0;
+    el.pinco = 0.0;
+    el.plo = 0.0;
+    el.pgho = 0.0;
+    el.pho = 0.0;
+    c.day = epoch + 18261.5 + tc / 1440.0;
+    double xnodce = std::fmod(4.5236020 - 9.2422029e-4 * c.day, kTwoPi);
+    double stem = std::sin(xnodce);
+    double ctem = std::cos(xnodce);
+    double zcosil = 0.91375164 - 0.03568096 * ctem;
+    double zsinil = std::sqrt(1.0 - zcosil * zcosil);
+    double zsinhl = 0.089683511 * stem / zsinil;
+    double zcoshl = std::sqrt(1.0 - zsinhl * zsinhl);
+    c.gam = 5.8351514 + 0.0019443680 * c.day;
+    double zx = 0.39785416 * stem / zsinil;
+    double zy = zcoshl * ctem + 0.91744867 * zsinhl * stem;
+    zx = std::atan2(zx, zy);
+    zx = c.gam + zx - xnodce;
+    double zcosgl = std::cos(zx);
+    double zsingl = std::sin(zx);
+
+    // Solar terms first, then lunar terms.
+    double zcosg = zcosgs;
+    double zsing = zsings;
+    double zcosi = zcosis;
+    double zsini = zsinis;
+    double zcosh = c.cnodm;
+    double zsinh = c.snodm;
+    double cc = c1ss;
+    double xnoi = 1.0 / c.nm;
+
+    for (int lsflg = 1; lsflg <= 2; lsflg++)
+    {
+        double a1 = zcosg * zcosh + zsing * zcosi * zsinh;
+        double a3 = -zsing * zcosh + zcosg * zcosi * zsinh;
+        double a7 = -zcosg * zsinh + zsing * zcosi * zcosh;
+        double a8 = zsing * zsini;
+        double a9 = zsing * zsinh + zcosg * zcosi * zcosh;
+        double a10 = zcosg * zsini;
+        double a2 = c.cosim * a7 + c.sinim * a8;
+        double a4 = c.cosim * a9 + c.sinim * a10;
+        double a5 = -c.sinim * a7 + c.cosim * a8;
+        double a6 = -c.sinim * a9 + c.cosim * a10;
+
+        double x1 = a1 * c.cosomm + a2 * c.sinomm;
+        double x2 = a3 * c.cosomm + a4 * c.sinomm;
+        double x3 = -a1 * c.sinomm + a2 * c.cosomm;
+        double x4 = -a3 * c.sinomm + a4 * c.cosomm;
+        double x5 = a5 * c.sinomm;
+        double x6 = a6 * c.sinomm;
+        double x7 = a5 * c.cosomm;
+        double x8 = a6 * c.cosomm;
+
+        c.z31 = 12.0 * x1 * x1 - 3.0 * x3 * x3;
+        c.z32 = 24.0 * x1 * x2 - 6.0 * x3 * x4;
+        c.z33 = 12.0 * x2 * x2 - 3.0 * x4 * x4;
+        c.z1 = 3.0 * (a1 * a1 + a2 * a2) + c.z31 * c.emsq;
+        c.z2 = 6.0 * (a1 * a3 + a2 * a4) + c.z32 * c.emsq;
+        c.z3 = 3.0 * (a3 * a3 + a4 * a4) + c.z33 * c.emsq;
+        c.z11 = -6.0 * a1 * a5 + c.emsq * (-24.0 * x1 * x7 - 6.0 * x3 * x5);
+        c.z12 = -6.0 * (a1 * a6 + a3 * a5) + c.emsq * (-24.0 * (x2 * x7 + x1 * x8) - 6.0 * (x3 * x6 + x4 * x5));
+        c.z13 = -6.0 * a3 * a6 + c.emsq * (-24.0 * x2 * x8 - 6.0 * x4 * x6);
+        c.z21 = 6.0 * a2 * a5 + c.emsq * (24.0 * x1 * x5 - 6.0 * x3 * x7);
+        c.z22 = 6.0 * (a4 * a5 + a2 * a6) + c.emsq * (24.0 * (x2 * x5 + x1 * x6) - 6.0 * (x4 * x7 + x3 * x8));
+        c.z23 = 6.0 * a4 * a6 + c.emsq * (24.0 * x2 * x6 - 6.0 * x4 * x8);
+        c.z1 = c.z1 + c.z1 + betasq * c.z31;
+        c.z2 = c.z2 + c.z2 + betasq * c.z32;
+        c.z3 = c.z3 + c.z3 + betasq * c.z33;
+        c.s3 = cc * xnoi;
+        c.s2 = -0.5 * c.s3 / c.rtemsq;
+        c.s4 = c.s3 * c.rtemsq;
+        c.s1 = -15.0 * c.em * c.s4;
+        c.s5 = x1 * x3 + x2 * x4;
+        c.s6 = x2 * x3 + x1 * x4;
+        c.s7 = x2 * x4 - x1 * x3;
+
+        if (1 == lsflg)
+        {
+            c.ss1 = c.s1;
+            c.ss2 = c.s2;
+            c.ss3 = c.s3;
+            c.ss4 = c.s4;
+            c.ss5 = c.s5;
+            c.ss6 = c.s6;
+            c.ss7 = c.s7;
+            c.sz1 = c.z1;
+            c.sz2 = c.z2;
+            c.sz3 = c.z3;
+            c.sz11 = c.z11;
+            c.sz12 = c.z12;
+            c.sz13 = c.z13;
+            c.sz21 = c.z21;
+            c.sz22 = c.z22;
+            c.sz23 = c.z23;
+            c.sz31 = c.z31;
+            c.sz32 = c.z32;
+            c.sz33 = c.z33;
+            zcosg = zcosgl;
+            zsing = zsingl;
+            zcosi = zcosil;
+            zsini = zsinil;
+            zcosh = zcoshl * c.cnodm + zsinhl * c.snodm;
+            zsinh = c.snodm * zcoshl - c.cnodm * zsinhl;
+            cc = c1l;
+        }
+    }
+
+    el.zmol = std::fmod(4.7199672 + 0.22997150 * c.day - c.gam, kTwoPi);
+    el.zmos = std::fmod(6.2565837 + 0.017201977 * c.day, kTwoPi);
+
+    // Solar terms.
+    el.se2 = 2.0 * c.ss1 * c.ss6;
+    el.se3 = 2.0 * c.ss1 * c.ss7;
+    el.si2 = 2.0 * c.ss2 * c.sz12;
+    el.si3 = 2.0 * c.ss2 * (c.sz13 - c.sz11);
+    el.sl2 = -2.0 * c.ss3 * c.sz2;
+    el.sl3 = -2.0 * c.ss3 * (c.sz3 - c.sz1);
+    el.sl4 = -2.0 * c.ss3 * (-21.0 - 9.0 * c.emsq) * zes;
+    el.sgh2 = 2.0 * c.ss4 * c.sz32;
+    el.sgh3 = 2.0 * c.ss4 * (c.sz33 - c.sz31);
+    el.sgh4 = -18.0 * c.ss4 * zes;
+    el.sh2 = -2.0 * c.ss2 * c.sz22;
+    el.sh3 = -2.0 * c.ss2 * (c.sz23 - c.sz21);
+
+    // Lunar terms.
+    el.ee2 = 2.0 * c.s1 * c.s6;
+    el.e3 = 2.0 * c.s1 * c.s7;
+    el.xi2 = 2.0 * c.s2 * c.z12;
+    el.xi3 = 2.0 * c.s2 * (c.z13 - c.z11);
+    el.xl2 = -2.0 * c.s3 * c.z2;
+    el.xl3 = -2.0 * c.s3 * (c.z3 - c.z1);
+    el.xl4 = -2.0 * c.s3 * (-21.0 - 9.0 * c.emsq) * zel;
+    el.xgh2 = 2.0 * c.s4 * c.z32;
+    el.xgh3 = 2.0 * c.s4 * (c.z33 - c.z31);
+    el.xgh4 = -18.0 * c.s4 * zel;
+    el.xh2 = -2.0 * c.s2 * c.z22;
+    el.xh3 = -2.0 * c.s2 * (c.z23 - c.z21);
+}
+
+void dsinit(const DeepSpaceCommon& c, double eccsq, double xpidot, Elements& el)
+{
+    constexpr double q22 = 1.7891679e-6;
+    constexpr double q31 = 2.1460748e-6;
+    constexpr double q33 = 2.2123015e-7;
+    constexpr double root22 = 1.7891679e-6;
+    constexpr double root44 = 7.3636953e-9;
+    constexpr double root54 = 2.1765803e-9;
+    constexpr double rptim = 4.37526908801129966e-3;
+    constexpr double root32 = 3.7393792e-7;
+    constexpr double root52 = 1.1428639e-7;
+    constexpr double znl = 1.5835218e-4;
+    constexpr double zns = 1.19459e-5;
+
+    const double nm = c.nm;
+    const double sinim = c.sinim;
+    const double cosim = c.cosim;
+    const double inclm = el.inclo;
+    double em = c.em;
+    double emsq = c.emsq;
+
+    // Resonance flags: 1 for synchronous orbits, 2 for 12 hour orbits.
+    el.irez = 0;
+    if (nm < 0.0052359877 && nm > 0.0034906585)
+        el.irez = 1;
+    if (nm >= 8.26e-3 && nm <= 9.24e-3 && em >= 0.5)
+        el.irez = 2;
+
+    // Solar terms.
+    double ses = c.ss1 * zns * c.ss5;
+    double sis = c.ss2 * zns * (c.sz11 + c.sz13);
+    double sls = -zns * c.ss3 * (c.sz1 + c.sz3 - 14.0 - 6.0 * emsq);
+    double sghs = c.ss4 * zns * (c.sz31 + c.sz33 - 6.0);
+    double shs = -zns * c.ss2 * (c.sz21 + c.sz23);
+    if (inclm < 5.2359877e-2 || inclm > kPi - 5.2359877e-2)
+        shs = 0.0;
+    if (sinim != 0.0)
+        shs = shs / sinim;
+    double sgs = sghs - cosim * shs;
+
+    // Lunar terms.
+    el.dedt = ses + c.s1 * znl * c.s5;
+    el.didt = sis + c.s2 * znl * (c.z11 + c.z13);
+    el.dmdt = sls - znl * c.s3 * (c.z1 + c.z3 - 14.0 - 6.0 * emsq);
+    double sghl = c.s4 * znl * (c.z31 + c.z33 - 6.0);
+    double shll = -znl * c.s2 * (c.z21 + c.z23);
+    if (inclm < 5.2359877e-2 || inclm > kPi - 5.2359877e-2)
+        shll = 0.0;
+    el.domdt = sgs + sghl;
+    el.dnodt = shs;
+    if (sinim != 0.0)
+    {
+        el.domdt = el.domdt - cosim / sinim * shll;
+        el.dnodt = el.dnodt + shll / sinim;
+    }
+
+    // Resonance terms.
+    const double theta = std::fmod(el.gsto, kTwoPi);
+    if (0 != el.irez)
+    {
+        double aonv = std::pow(nm / kXke, kX2o3);
+
+        // Geopotential resonance for 12 hour orbits.
+        if (2 == el.irez)
+        {
+            double cosisq = cosim * cosim;
+            double emo = em;
+            em = el.ecco;
+            double emsqo = emsq;
+            emsq = eccsq;
+            double eoc = em * emsq;
+            double g201 = -0.306 - (em - 0.64) * 0.440;
+            double g211, g310, g322, g410, g422, g520, g521, g532, g533;
+            if (em <= 0.65)
+            {
+                g211 = 3.616 - 13.2470 * em + 16.2900 * emsq;
+                g310 = -19.302 + 117.3900 * em - 228.4190 * emsq + 156.5910 * eoc;
+                g322 = -18.9068 + 109.7927 * em - 214.6334 * emsq + 146.5816 * eoc;
+                g410 = -41.122 + 242.6940 * em - 471.0940 * emsq + 313.9530 * eoc;
+                g422 = -146.407 + 841.8800 * em - 1629.014 * emsq + 1083.4350 * eoc;
+                g520 = -532.114 + 3017.977 * em - 5740.032 * emsq + 3708.2760 * eoc;
+            }
+            else
+            {
+                g211 = -72.099 + 331.819 * em - 508.738 * emsq + 266.724 * eoc;
+                g310 = -346.844 + 1582.851 * em - 2415.925 * emsq + 1246.113 * eoc;
+                g322 = -342.585 + 1554.908 * em - 2366.899 * emsq + 1215.972 * eoc;
+                g410 = -1052.797 + 4758.686 * em - 7193.992 * emsq + 3651.957 * eoc;
+                g422 = -3581.690 + 16178.110 * em - 24462.770 * emsq + 12422.520 * eoc;
+                if (em > 0.715)
+                    g520 = -5149.66 + 29936.92 * em - 54087.36 * emsq + 31324.56 * eoc;
+                else
+                    g520 = 1464.74 - 4664.75 * em + 3763.64 * emsq;
+            }
+            if (em < 0.7)
+            {
+                g533 = -919.22770 + 4988.6100 * em - 9064.7700 * emsq + 5542.21 * eoc;
+                g521 = -822.71072 + 4568.6173 * em - 8491.4146 * emsq + 5337.524 * eoc;
+                g532 = -853.66600 + 4690.2500 * em - 8624.7700 * emsq + 5341.4 * eoc;
+            }
+            else
+            {
+                g533 = -37995.780 + 161616.52 * em - 229838.20 * emsq + 109377.94 * eoc;
+                g521 = -51752.104 + 218913.95 * em - 309468.16 * emsq + 146349.42 * eoc;
+                g532 = -40023.880 + 170470.89 * em - 242699.48 * emsq + 115605.82 * eoc;
+            }
+
+            double sini2 = sinim * sinim;
+            double f220 = 0.75 * (1.0 + 2.0 * cosim + cosisq);
+            double f221 = 1.5 * sini2;
+            double f321 = 1.875 * sinim * (1.0 - 2.0 * cosim - 3.0 * cosisq);
+            double f322 = -1.875 * sinim * (1.0 + 2.0 * cosim - 3.0 * cosisq);
+            double f441 = 35.0 * sini2 * f220;
+            double f442 = 39.3750 * sini2 * sini2;
+            double f522 = 9.84375 * sinim * (sini2 * (1.0 - 2.0 * cosim - 5.0 * cosisq) +
+                                             0.33333333 * (-2.0 + 4.0 * cosim + 6.0 * cosisq));
+            double f523 = sinim * (4.92187512 * sini2 * (-2.0 - 4.0 * cosim + 10.0 * cosisq) +
+                                   6.56250012 * (1.0 + 2.0 * cosim - 3.0 * cosisq));
+            double f542 = 29.53125 * sinim * (2.0 - 8.0 * cosim + cosisq * (-12.0 + 8.0 * cosim + 10.0 * cosisq));
+            double f543 = 29.53125 * sinim * (-2.0 - 8.0 * cosim + cosisq * (12.0 + 8.0 * cosim - 10.0 * cosisq));
+            double xno2 = nm * nm;
+            double ainv2 = aonv * aonv;
+            double temp1 = 3.0 * xno2 * ainv2;
+            double temp = temp1 * root22;
+            el.d2201 = temp * f220 * g201;
+            el.d2211 = temp * f221 * g211;
+            temp1 = temp1 * aonv;
+            temp = temp1 * root32;
+            el.d3210 = temp * f321 * g310;
+            el.d3222 = temp * f322 * g322;
+            temp1 = temp1 * aonv;
+            temp = 2.0 * temp1 * root44;
+            el.d4410 = temp * f441 * g410;
+            el.d4422 = temp * f442 * g422;
+            temp1 = temp1 * aonv;
+            temp = temp1 * root52;
+            el.d5220 = temp * f522 * g520;
+            el.d5232 = temp * f523 * g532;
+            temp = 2.0 * temp1 * root54;
+            el.d5421 = temp * f542 * g521;
+            el.d5433 = temp * f543 * g533;
+            el.xlamo = std::fmod(el.mo + el.nodeo + el.nodeo - theta - theta, kTwoPi);
+            el.xfact = el.mdot + el.dmdt + 2.0 * (el.nodedot + el.dnodt - rptim) - el.no_unkozai;
+            em = emo;
+            emsq = emsqo;
+        }
+
+        // Synchronous resonance terms.
+        if (1 == el.irez)
+        {
+            double g200 = 1.0 + emsq * (-2.5 + 0.8125 * emsq);
+            double g310 = 1.0 + 2.0 * emsq;
+            double g300 = 1.0 + emsq * (-6.0 + 6.60937 * emsq);
+            double f220 = 0.75 * (1.0 + cosim) * (1.0 + cosim);
+            double f311 = 0.9375 * sinim * sinim * (1.0 + 3.0 * cosim) - 0.75 * (1.0 + cosim);
+            double f330 = 1.0 + cosim;
+            f330 = 1.875 * f330 * f330 * f330;
+            el.del1 = 3.0 * nm * nm * aonv * aonv;
+            el.del2 = 2.0 * el.del1 * f220 * g200 * q22;
+            el.del3 = 3.0 * el.del1 * f330 * g300 * q33 * aonv;
+            el.del1 = el.del1 * f311 * g310 * q31 * aonv;
+            el.xlamo = std::fmod(el.mo + el.nodeo + el.argpo - theta, kTwoPi);
+            el.xfact = el.mdot + xpidot - rptim + el.dmdt + el.domdt + el.dnodt - el.no_unkozai;
+        }
+    }
+}
+
+void dspace(const Elements& el, double t, ResonanceState& rs, double& em, double& argpm, double& inclm, double& mm,
+            double& nodem, double& nm)
+{
+    constexpr double fasx2 = 0.13130908;
+    constexpr double fasx4 = 2.8843198;
+    constexpr double fasx6 = 0.37448087;
+    constexpr double g22 = 5.7686396;
+    constexpr double g32 = 0.95240898;
+    constexpr double g44 = 1.8014998;
+    constexpr double g52 = 1.0508330;
+    constexpr double g54 = 4.4108898;
+    constexpr double rptim = 4.37526908801129966e-3;
+    constexpr double stepp = 720.0;
+    constexpr double stepn = -720.0;
+    constexpr double step2 = 259200.0;
+
+    double theta = std::fmod(el.gsto + t * rptim, kTwoPi);
+    em = em + el.dedt * t;
+    inclm = inclm + el.didt * t;
+    argpm = argpm + el.domdt * t;
+    nodem = nodem + el.dnodt * t;
+    mm = mm + el.dmdt * t;
+
+    if (0 == el.irez)
+        return;
+
+    // The integration restarts from the epoch if the time is before the last one or at the other side of the epoch.
+    if (0.0 == rs.atime || t * rs.atime <= 0.0 || std::fabs(t) < std::fabs(rs.atime))
+    {
+        rs.atime = 0.0;
+        rs.xni = el.no_unkozai;
+        rs.xli = el.xlamo;
+    }
+    const double delt = t > 0.0 ? stepp : stepn;
+
+    double ft = 0.0;
+    double xndt = 0.0;
+    double xldot = 0.0;
+    double xnddt = 0.0;
+    bool integrate = true;
+    while (integrate)
+    {
+        // Dot terms.
+        if (2 != el.irez)
+        {
+            xndt = el.del1 * std::sin(rs.xli - fasx2) + el.del2 * std::sin(2.0 * (rs.xli - fasx4)) +
+                    el.del3 * std::sin(3.0 * (rs.xli - fasx6));
+            xldot = rs.xni + el.xfact;
+            xnddt = el.del1 * std::cos(rs.xli - fasx2) + 2.0 * el.del2 * std::cos(2.0 * (rs.xli - fasx4)) +
+                    3.0 * el.del3 * std::cos(3.0 * (rs.xli - fasx6));
+            xnddt = xnddt * xldot;
+        }
+        else
+        {
+            double xomi = el.argpo + el.argpdot * rs.atime;
+            double x2omi = xomi + xomi;
+            double x2li = rs.xli + rs.xli;
+            xndt = el.d2201 * std::sin(x2omi + rs.xli - g22) + el.d2211 * std::sin(rs.xli - g22) +
+                    el.d3210 * std::sin(xomi + rs.xli - g32) + el.d3222 * std::sin(-xomi + rs.xli - g32) +
+                    el.d4410 * std::sin(x2omi + x2li - g44) + el.d4422 * std::sin(x2li - g44) +
+                    el.d5220 * std::sin(xomi + rs.xli - g52) + el.d5232 * std::sin(-xomi + rs.xli - g52) +
+                    el.d5421 * std::sin(xomi + x2li - g54) + el.d5433 * std::sin(-xomi + x2li - g54);
+            xldot = rs.xni + el.xfact;
+            xnddt = el.d2201 * std::cos(x2omi + rs.xli - g22) + el.d2211 * std::cos(rs.xli - g22) +
+                    el.d3210 * std::cos(xomi + rs.xli - g32) + el.d3222 * std::cos(-xomi + rs.xli - g32) +
+                    el.d5220 * std::cos(xomi + rs.xli - g52) + el.d5232 * std::cos(-xomi + rs.xli - g52) +
+                    2.0 * (el.d4410 * std::cos(x2omi + x2li - g44) + el.d4422 * std::cos(x2li - g44) +
+                           el.d5421 * std::cos(xomi + x2li - g54) + el.d5433 * std::cos(-xomi + x2li - g54));
+            xnddt = xnddt * xldot;
+        }
+
+        // Integrator steps of 720 minutes until the time is reached.
+        if (std::fabs(t - rs.atime) >= stepp)
+        {
+            rs.xli = rs.xli + xldot * delt + xndt * step2;
+            rs.xni = rs.xni + xndt * delt + xnddt * step2;
+            rs.atime = rs.atime + delt;
+        }
+        else
+        {
+            ft = t - rs.atime;
+            integrate = false;
+        }
+    }
+
+    nm = rs.xni + xndt * ft + xnddt * ft * ft * 0.5;
+    double xl = rs.xli + xldot * ft + xndt * ft * ft * 0.5;
+    if (1 != el.irez)
+        mm = xl - 2.0 * nodem + 2.0 * theta;
+    else
+        mm = xl - nodem - argpm + theta;
+    nm = el.no_unkozai + (nm - el.no_unkozai);
+}
+
+void dpper(const Elements& el, double t, double& ep, double& inclp, double& nodep, double& argpp, double& mp)
+{
+    constexpr double zns = 1.19459e-5;
+    constexpr double zes = 0.01675;
+    constexpr double znl = 1.5835218e-4;
+    constexpr double zel = 0.05490;
+
+    // Solar terms.
+    double zm = el.zmos + zns * t;
+    double zf = zm + 2.0 * zes * std::sin(zm);
+    double sinzf = std::sin(zf);
+    double f2 = 0.5 * sinzf * sinzf - 0.25;
+    double f3 = -0.5 * sinzf * std::cos(zf);
+    double ses = el.se2 * f2 + el.se3 * f3;
+    double sis = el.si2 * f2 + el.si3 * f3;
+    double sls = el.sl2 * f2 + el.sl3 * f3 + el.sl4 * sinzf;
+    double sghs = el.sgh2 * f2 + el.sgh3 * f3 + el.sgh4 * sinzf;
+    double shs = el.sh2 * f2 + el.sh3 * f3;
+
+    // Lunar terms.
+    zm = el.zmol + znl * t;
+    zf = zm + 2.0 * zel * std::sin(zm);
+    sinzf = std::sin(zf);
+    f2 = 0.5 * sinzf * sinzf - 0.25;
+    f3 = -0.5 * sinzf * std::cos(zf);
+    double sel = el.ee2 * f2 + el.e3 * f3;
+    double sil = el.xi2 * f2 + el.xi3 * f3;
+    double sll = el.xl2 * f2 + el.xl3 * f3 + el.xl4 * sinzf;
+    double sghl = el.xgh2 * f2 + el.xgh3 * f3 + el.xgh4 * sinzf;
+    double shll = el.xh2 * f2 + el.xh3 * f3;
+
+    double pe = ses + sel - el.peo;
+    double pinc = sis + sil - el.pinco;
+    double pl = sls + sll - el.plo;
+    double pgh = sghs + sghl - el.pgho;
+    double ph = shs + shll - el.pho;
+
+    inclp = inclp + pinc;
+    ep = ep + pe;
+    double sinip = std::sin(inclp);
+    double cosip = std::cos(inclp);
+
+    if (inclp >= 0.2)
+    {
+        // Apply the periodics directly.
+        ph = ph / sinip;
+        pgh = pgh - cosip * ph;
+        argpp = argpp + pgh;
+        nodep = nodep + ph;
+        mp = mp + pl;
+    }
+    else
+    {
+        // Apply the periodics with the Lyddane modification.
+        double sinop = std::sin(nodep);
+        double cosop = std::cos(nodep);
+        double alfdp = sinip * sinop;
+        double betdp = sinip * cosop;
+        double dalf = ph * cosop + pinc * cosip * sinop;
+        double dbet = -ph * sinop + pinc * cosip * cosop;
+        alfdp = alfdp + dalf;
+        betdp = betdp + dbet;
+        nodep = std::fmod(nodep, kTwoPi);
+        double xls = mp + argpp + cosip * nodep;
+        double dls = pl + pgh - pinc * nodep * sinip;
+        xls = xls + dls;
+        double xnoh = nodep;
+        nodep = std::atan2(alfdp, betdp);
+        if (std::fabs(xnoh - nodep) > kPi)
+        {
+            if (nodep < xnoh)
+                nodep = nodep + kTwoPi;
+            else
+                nodep = nodep - kTwoPi;
+        }
+        mp = mp + pl;
+        argpp = xls - mp - cosip * nodep;
+    }
+}
+
+SGP4Error sgp4init(double epoch, Elements& el)
+{
+    constexpr double temp4 = 1.5e-12;
+    const double ss = 78.0 / kRadiusEarth + 1.0;
+    const double qzms2t = std::pow((120.0 - 78.0) / kRadiusEarth, 4);
+
+    double ainv, ao, con42, cosio, cosio2, eccsq, omeosq, posq, rp, rteosq, sinio;
+    initl(epoch, el, ainv, ao, con42, cosio, cosio2, eccsq, omeosq, posq, rp, rteosq, sinio);
+
+    el.a = std::pow(el.no_unkozai / kXke, -kX2o3);
+    el.alta = el.a * (1.0 + el.ecco) - 1.0;
+    el.altp = el.a * (1.0 - el.ecco) - 1.0;
+    el.simplified = false;
+    el.deep_space = false;
+    el.irez = 0;
+
+    if (omeosq < 0.0 && el.no_unkozai < 0.0)
+        return SGP4Error::MEAN_MOTION_NEGATIVE;
+
+    // Perigees below 220 km use the simplified equations.
+    if (rp < 220.0 / kRadiusEarth + 1.0)
+        el.simplified = true;
+
+    // Atmospheric density parameter for low perigees.
+    double sfour = ss;
+    double qzms24 = qzms2t;
+    double perige = (rp - 1.0) * kRadiusEarth;
+    if (perige < 156.0)
+    {
+        sfour = perige - 78.0;
+        if (perige < 98.0)
+            sfour = 20.0;
+        qzms24 = std::pow((120.0 - sfour) / kRadiusEarth, 4);
+        sfour = sfour / kRadiusEarth + 1.0;
+    }
+
+    double pinvsq = 1.0 / posq;
+    double tsi = 1.0 / (ao - sfour);
+    el.eta = ao * el.ecco * tsi;
+    double etasq = el.eta * el.eta;
+    double eeta = el.ecco * el.eta;
+    double psisq = std::fabs(1.0 - etasq);
+    double coef = qzms24 * std::pow(tsi, 4);
+    double coef1 = coef / std::pow(psisq, 3.5);
+    double cc2 = coef1 * el.no_unkozai * (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+                                          0.375 * kJ2 * tsi / psisq * el.con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+    el.cc1 = el.bstar * cc2;
+    double cc3 = 0.0;
+    if (el.ecco > 1.0e-4)
+        cc3 = -2.0 * coef * tsi * kJ3oJ2 * el.no_unkozai * sinio / el.ecco;
+    el.x1mth2 = 1.0 - cosio2;
+    el.cc4 = 2.0 * el.no_unkozai * coef1 * ao * omeosq *
+            (el.eta * (2.0 + 0.5 * etasq) + el.ecco * (0.5 + 2.0 * etasq) -
+             kJ2 * tsi / (ao * psisq) * (-3.0 * el.con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+                                        0.75 * el.x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) *
+                                        std::cos(2.0 * el.argpo)));
+    el.cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+    double cosio4 = cosio2 * cosio2;
+    double temp1 = 1.5 * kJ2 * pinvsq * el.no_unkozai;
+    double temp2 = 0.5 * temp1 * kJ2 * pinvsq;
+    double temp3 = -0.46875 * kJ4 * pinvsq * pinvsq * el.no_unkozai;
+    el.mdot = el.no_unkozai + 0.5 * temp1 * rteosq * el.con41 +
+            0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+    el.argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+            temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+    double xhdot1 = -temp1 * cosio;
+    el.nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+    double xpidot = el.argpdot + el.nodedot;
+    el.omgcof = el.bstar * cc3 * std::cos(el.argpo);
+    el.xmcof = 0.0;
+    if (el.ecco > 1.0e-4)
+        el.xmcof = -kX2o3 * coef * el.bstar / eeta;
+    el.nodecf = 3.5 * omeosq * xhdot1 * el.cc1;
+    el.t2cof = 1.5 * el.cc1;
+    if (std::fabs(cosio + 1.0) > 1.5e-12)
+        el.xlcof = -0.25 * kJ3oJ2 * sinio * (3.0 + 5.0 * cosio) / (1.0 + cosio);
+    else
+        el.xlcof = -0.25 * kJ3oJ2 * sinio * (3.0 + 5.0 * cosio) / temp4;
+    el.aycof = -0.5 * kJ3oJ2 * sinio;
+    double delmotemp = 1.0 + el.eta * std::cos(el.mo);
+    el.delmo = delmotemp * delmotemp * delmotemp;
+    el.sinmao = std::sin(el.mo);
+    el.x7thm1 = 7.0 * cosio2 - 1.0;
+
+    // Deep space initialization for periods of 225 minutes or more.
+    if (kTwoPi / el.no_unkozai >= 225.0)
+    {
+        el.deep_space = true;
+        el.simplified = true;
+        DeepSpaceCommon c{};
+        dscom(epoch, el.ecco, el.argpo, 0.0, el.inclo, el.nodeo, el.no_unkozai, el, c);
+        dsinit(c, eccsq, xpidot, el);
+    }
+
+    // Coefficients of the non simplified equations.
+    if (!el.simplified)
+    {
+        double cc1sq = el.cc1 * el.cc1;
+        el.d2 = 4.0 * ao * tsi * cc1sq;
+        double temp = el.d2 * tsi * el.cc1 / 3.0;
+        el.d3 = (17.0 * ao + sfour) * temp;
+        el.d4 = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * el.cc1;
+        el.t3cof = el.d2 + 2.0 * cc1sq;
+        el.t4cof = 0.25 * (3.0 * el.d3 + el.cc1 * (12.0 * el.d2 + 10.0 * cc1sq));
+        el.t5cof = 0.2 * (3.0 * el.d4 + 12.0 * el.cc1 * el.d3 + 6.0 * el.d2 * el.d2 +
+                          15.0 * cc1sq * (2.0 * el.d2 + cc1sq));
+    }
+
+    // Propagation at the epoch to check the elements.
+    ResonanceState resonance;
+    std::array<double, 3> r, v;
+    return propagate(el, 0.0, resonance, r, v);
+}
+
+}
+
+SGP4Error parseTLE(const TLE& tle, Elements& elements)
+{
+    const std::string& line1 = tle.getFirstLine();
+    const std::string& line2 = tle.getSecondLine();
+    if (line1.size() < 64 || line2.size() < 63)
+        return SGP4Error::TLE_NOT_VALID;
+
+    elements = Elements();
+    elements.norad = dpslr::helpers::trim(line1.substr(2, 5));
+    elements.intl_designator = dpslr::helpers::trim(line1.substr(9, 8));
+
+    double epoch_year, epoch_days, no;
+    bool valid = parseDouble(line1.substr(18, 2), epoch_year) &&
+            parseDouble(line1.substr(20, 12), epoch_days) &&
+            parseDouble(line1.substr(33, 10), elements.ndot) &&
+            parseExponentField(line1.substr(44, 8), elements.nddot) &&
+            parseExponentField(line1.substr(53, 8), elements.bstar) &&
+            parseDouble(line2.substr(8, 8), elements.inclo) &&
+            parseDouble(line2.substr(17, 8), elements.nodeo) &&
+            parseDouble("0." + dpslr::helpers::trim(line2.substr(26, 7)), elements.ecco) &&
+            parseDouble(line2.substr(34, 8), elements.argpo) &&
+            parseDouble(line2.substr(43, 8), elements.mo) &&
+            parseDouble(line2.substr(52, 11), no);
+    if (!valid)
+        return SGP4Error::TLE_NOT_VALID;
+
+    // Units: radians and radians per minute.
+    const double xpdotp = 1440.0 / kTwoPi;
+    elements.no_kozai = no / xpdotp;
+    elements.ndot = elements.ndot / (xpdotp * 1440.0);
+    elements.nddot = elements.nddot / (xpdotp * 1440.0 * 1440.0);
+    elements.inclo *= kDeg2Rad;
+    elements.nodeo *= kDeg2Rad;
+    elements.argpo *= kDeg2Rad;
+    elements.mo *= kDeg2Rad;
+
+    // Epoch (the day 0 of the year plus the day of year). The years from 57 are in the 20th century.
+    int year = static_cast<int>(epoch_year) + (epoch_year < 57 ? 2000 : 1900);
+    double jd_year = 367.0 * year - std::floor(7.0 * (year + std::floor(10.0 / 12.0)) * 0.25) +
+            std::floor(275.0 / 9.0) + 1721013.5;
+    elements.jd_epoch = jd_year + std::floor(epoch_days);
+    elements.jd_epoch_fraction = epoch_days - std::floor(epoch_days);
+
+    return sgp4init(elements.jd_epoch + elements.jd_epoch_fraction - 2433281.5, elements);
+}
+
+std::vector<SGP4Error> parseTLEs(const std::vector<TLE>& tles, std::vector<Elements>& elements)
+{
+    std::vector<SGP4Error> errors(tles.size());
+    elements.resize(tles.size());
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (long long i = 0; i < static_cast<long long>(tles.size()); i++)
+        errors[i] = parseTLE(tles[i], elements[i]);
+
+    return errors;
+}
+
+SGP4Error propagate(const Elements& el, double tsince, ResonanceState& resonance,
+                    std::array<double, 3>& r, std::array<double, 3>& v)
+{
+    constexpr double temp4 = 1.5e-12;
+
+    r = {0.0, 0.0, 0.0};
+    v = {0.0, 0.0, 0.0};
+
+    // Secular gravity and atmospheric drag.
+    const double t = tsince;
+    double xmdf = el.mo + el.mdot * t;
+    double argpdf = el.argpo + el.argpdot * t;
+    double nodedf = el.nodeo + el.nodedot * t;
+    double argpm = argpdf;
+    double mm = xmdf;
+    double t2 = t * t;
+    double nodem = nodedf + el.nodecf * t2;
+    double tempa = 1.0 - el.cc1 * t;
+    double tempe = el.bstar * el.cc4 * t;
+    double templ = el.t2cof * t2;
+
+    if (!el.simplified)
+    {
+        double delomg = el.omgcof * t;
+        double delmtemp = 1.0 + el.eta * std::cos(xmdf);
+        double delm = el.xmcof * (delmtemp * delmtemp * delmtemp - el.delmo);
+        double temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2 * t;
+        double t4 = t3 * t;
+        tempa = tempa - el.d2 * t2 - el.d3 * t3 - el.d4 * t4;
+        tempe = tempe + el.bstar * el.cc5 * (std::sin(mm) - el.sinmao);
+        templ = templ + el.t3cof * t3 + t4 * (el.t4cof + t * el.t5cof);
+    }
+
+    double nm = el.no_unkozai;
+    double em = el.ecco;
+    double inclm = el.inclo;
+    if (el.deep_space)
+        dspace(el, t, resonance, em, argpm, inclm, mm, nodem, nm);
+
+    if (nm <= 0.0)
+        return SGP4Error::MEAN_MOTION_NEGATIVE;
+
+    double am = std::pow(kXke / nm, kX2o3) * tempa * tempa;
+    nm = kXke / std::pow(am, 1.5);
+    em = em - tempe;
+
+    if (em >= 1.0 || em < -0.001)
+        return SGP4Error::ECCENTRICITY_OUT_OF_RANGE;
+    if (em < 1.0e-6)
+        em = 1.0e-6;
+
+    mm = mm + el.no_unkozai * templ;
+    double xlm = mm + argpm + nodem;
+
+    nodem = std::fmod(nodem, kTwoPi);
+    argpm = std::fmod(argpm, kTwoPi);
+    xlm = std::fmod(xlm, kTwoPi);
+    mm = std::fmod(xlm - argpm - nodem, kTwoPi);
+
+    // Lunar-solar periodics.
+    double ep = em;
+    double xincp = inclm;
+    double argpp = argpm;
+    double nodep = nodem;
+    double mp = mm;
+    double sinip = std::sin(inclm);
+    double cosip = std::cos(inclm);
+    double aycof = el.aycof;
+    double xlcof = el.xlcof;
+    double con41 = el.con41;
+    double x1mth2 = el.x1mth2;
+    double x7thm1 = el.x7thm1;
+
+    if (el.deep_space)
+    {
+        dpper(el, t, ep, xincp, nodep, argpp, mp);
+        if (xincp < 0.0)
+        {
+            xincp = -xincp;
+            nodep = nodep + kPi;
+            argpp = argpp - kPi;
+        }
+        if (ep < 0.0 || ep > 1.0)
+            return SGP4Error::PERT_ECCENTRICITY_INVALID;
+
+        sinip = std::sin(xincp);
+        cosip = std::cos(xincp);
+        aycof = -0.5 * kJ3oJ2 * sinip;
+        if (std::fabs(cosip + 1.0) > 1.5e-12)
+            xlcof = -0.25 * kJ3oJ2 * sinip * (3.0 + 5.0 * cosip) / (1.0 + cosip);
+        else
+            xlcof = -0.25 * kJ3oJ2 * sinip * (3.0 + 5.0 * cosip) / temp4;
+    }
+
+    // Long period periodics.
+    double axnl = ep * std::cos(argpp);
+    double temp = 1.0 / (am * (1.0 - ep * ep));
+    double aynl = ep * std::sin(argpp) + temp * aycof;
+    double xl = mp + argpp + nodep + temp * xlcof * axnl;
+
+    // Kepler equation.
+    double u = std::fmod(xl - nodep, kTwoPi);
+    double eo1 = u;
+    double tem5 = 9999.9;
+    double sineo1 = 0.0;
+    double coseo1 = 0.0;
+    for (int ktr = 1; std::fabs(tem5) >= 1.0e-12 && ktr <= 10; ktr++)
+    {
+        sineo1 = std::sin(eo1);
+        coseo1 = std::cos(eo1);
+        tem5 = 1.0 - coseo1 * axnl - sineo1 * aynl;
+        tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+        if (std::fabs(tem5) >= 0.95)
+            tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+        eo1 = eo1 + tem5;
+    }
+
+    // Short period preliminary quantities.
+    double ecose = axnl * coseo1 + aynl * sineo1;
+    double esine = axnl * sineo1 - aynl * coseo1;
+    double el2 = axnl * axnl + aynl * aynl;
+    double pl = am * (1.0 - el2);
+    if (pl < 0.0)
+        return SGP4Error::SEMILATUS_RECTUM_NEGATIVE;
+
+    double rl = am * (1.0 - ecose);
+    double rdotl = std::sqrt(am) * esine / rl;
+    double rvdotl = std::sqrt(pl) / rl;
+    double betal = std::sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = std::atan2(sinu, cosu);
+    double sin2u = (cosu + cosu) * sinu;
+    double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    double temp1 = 0.5 * kJ2 * temp;
+    double temp2 = temp1 * temp;
+
+    // Short period periodics.
+    if (el.deep_space)
+    {
+        double cosisq = cosip * cosip;
+        con41 = 3.0 * cosisq - 1.0;
+        x1mth2 = 1.0 - cosisq;
+        x7thm1 = 7.0 * cosisq - 1.0;
+    }
+    double mrt = rl * (1.0 - 1.5 * temp2 * betal * con41) + 0.5 * temp1 * x1mth2 * cos2u;
+    su = su - 0.25 * temp2 * x7thm1 * sin2u;
+    double xnode = nodep + 1.5 * temp2 * cosip * sin2u;
+    double xinc = xincp + 1.5 * temp2 * cosip * sinip * cos2u;
+    double mvt = rdotl - nm * temp1 * x1mth2 * sin2u / kXke;
+    double rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + 1.5 * con41) / kXke;
+
+    // Orientation vectors.
+    double sinsu = std::sin(su);
+    double cossu = std::cos(su);
+    double snod = std::sin(xnode);
+    double cnod = std::cos(xnode);
+    double sini = std::sin(xinc);
+    double cosi = std::cos(xinc);
+    double xmx = -snod * cosi;
+    double xmy = cnod * cosi;
+    double ux = xmx * sinsu + cnod * cossu;
+    double uy = xmy * sinsu + snod * cossu;
+    double uz = sini * sinsu;
+    double vx = xmx * cossu - cnod * sinsu;
+    double vy = xmy * cossu - snod * sinsu;
+    double vz = sini * cossu;
+
+    r = {mrt * ux * kRadiusEarth, mrt * uy * kRadiusEarth, mrt * uz * kRadiusEarth};
+    v = {(mvt * ux + rvdot * vx) * kVKmPerSec, (mvt * uy + rvdot * vy) * kVKmPerSec,
+         (mvt * uz + rvdot * vz) * kVKmPerSec};
+
+    return mrt < 1.0 ? SGP4Error::SATELLITE_DECAYED : SGP4Error::NOT_ERROR;
+}
+
+SGP4Error propagateToJulian(const Elements& elements, long double jd,
+                            std::array<double, 3>& r, std::array<double, 3>& v)
+{
+    ResonanceState resonance;
+    double tsince = static_cast<double>(((jd - elements.jd_epoch) - elements.jd_epoch_fraction) * 1440.0L);
+    return propagate(elements, tsince, resonance, r, v);
+}
+
+void propagateBatch(const std::vector<Elements>& elements, const std::vector<long double>& jd_epochs,
+                    StateVectors& states)
+{
+    const std::size_t n_epochs = jd_epochs.size();
+    const std::size_t total = elements.size() * n_epochs;
+    states.objects = elements.size();
+    states.epochs = n_epochs;
+    states.x.resize(total);
+    states.y.resize(total);
+    states.z.resize(total);
+    states.vx.resize(total);
+    states.vy.resize(total);
+    states.vz.resize(total);
+    states.errors.resize(total);
+
+    // Each object is propagated by a single thread over all the epochs, so the resonance integrator continues from
+    // the previous epoch and the results of an object are contiguous in memory.
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (long long i = 0; i < static_cast<long long>(elements.size()); i++)
+    {
+        const Elements& el = elements[i];
+        ResonanceState resonance;
+        std::array<double, 3> r, v;
+        const std::size_t base = static_cast<std::size_t>(i) * n_epochs;
+
+        for (std::size_t j = 0; j < n_epochs; j++)
+        {
+            // Same time as propagateToJulian. The epoch is subtracted in two parts to keep the fraction precision.
+            double tsince = static_cast<double>(((jd_epochs[j] - el.jd_epoch) - el.jd_epoch_fraction) * 1440.0L);
+            SGP4Error error = propagate(el, tsince, resonance, r, v);
+            states.x[base + j] = r[0];
+            states.y[base + j] = r[1];
+            states.z[base + j] = r[2];
+            states.vx[base + j] = v[0];
+            states.vy[base + j] = v[1];
+            states.vz[base + j] = v[2];
+            states.errors[base + j] = error;
+        }
+    }
+}
+
+double gstime(double jd_ut1)
+{
+    double tut1 = (jd_ut1 - 2451545.0) / 36525.0;
+    double temp = -6.2e-6 * tut1 * tut1 * tut1 + 0.093104 * tut1 * tut1 +
+            (876600.0 * 3600.0 + 8640184.812866) * tut1 + 67310.54841;
+    temp = std::fmod(temp * kDeg2Rad / 240.0, kTwoPi);
+    if (temp < 0.0)
+        temp += kTwoPi;
+    return temp;
+}
+
+void temeToECEF(long double jd, const std::array<double, 3>& r_teme, const std::array<double, 3>& v_teme,
+                std::array<double, 3>& r_ecef, std::array<double, 3>& v_ecef)
+{
+    const double gmst = gstime(static_cast<double>(jd));
+    const double cg = std::cos(gmst);
+    const double sg = std::sin(gmst);
+
+    r_ecef = {cg * r_teme[0] + sg * r_teme[1], -sg * r_teme[0] + cg * r_teme[1], r_teme[2]};
+
+    // Velocity in the rotating frame: v - w x r.
+    std::array<double, 3> v_pef = {cg * v_teme[0] + sg * v_teme[1], -sg * v_teme[0] + cg * v_teme[1], v_teme[2]};
+    v_ecef = {v_pef[0] + kEarthRotation * r_ecef[1], v_pef[1] - kEarthRotation * r_ecef[0], v_pef[2]};
+}
+
+SGP4Error generateCPF(const TLE& tle, const Elements& elements, long double jd_start, long double jd_end,
+                      unsigned step, CPF& cpf)
+{
+    cpf = CPF(2.0);
+
+    const long double epoch = static_cast<long double>(elements.jd_epoch) + elements.jd_epoch_fraction;
+    const long double step_days = static_cast<long double>(step) / 86400.0L;
+    const std::size_t n_positions = step > 0 && jd_end >= jd_start ?
+                static_cast<std::size_t>((jd_end - jd_start) / step_days) + 1 : 0;
+
+    // Target name without spaces (the CPF v2 header is free format).
+    std::string target_name = dpslr::helpers::toLower(dpslr::helpers::trim(tle.getTitle()));
+    if (target_name.size() > 2 && '0' == target_name[0] && ' ' == target_name[1])
+        target_name.erase(0, 2);
+    for (auto& c : target_name)
+        if (' ' == c)
+            c = '_';
+
+    CPFHeader::BasicInfo1Header h1;
+    h1.cpf_version = 2.0;
+    h1.cpf_source = "tle";
+    h1.target_name = target_name;
+    h1.cpf_notes = "sgp4";
+    // The sequence number is the day of year of the first position. It is computed from the Julian date, because
+    // gmtime is not reentrant and the CPFs are generated in parallel.
+    const long long jd_start_day = static_cast<long long>(std::floor(jd_start));
+    int year;
+    unsigned month, day, hour, minute, second;
+    dpslr::utils::jdtogr(jd_start_day, static_cast<double>(jd_start - jd_start_day), year, month, day, hour, minute,
+                         second);
+    long long jd_date, jd_year_start;
+    double jd_fract;
+    dpslr::utils::grtojd(year, month, day, 0, 0, 0, jd_date, jd_fract);
+    dpslr::utils::grtojd(year, 1, 1, 0, 0, 0, jd_year_start, jd_fract);
+    h1.cpf_sequence_number = static_cast<int>(jd_date - jd_year_start) + 1;
+    h1.cpf_subsequence_number = 0;
+
+    CPFHeader::BasicInfo2Header h2;
+    h2.id = elements.intl_designator.empty() ? "0" : dpslr::utils::shortcosparToILRSID(elements.intl_designator);
+    h2.norad = elements.norad;
+    h2.start_time = dpslr::utils::julianToTimePoint(jd_start);
+    h2.end_time = dpslr::utils::julianToTimePoint(jd_start + step_days * (n_positions > 0 ? n_positions - 1 : 0));
+    h2.total_seconds = std::chrono::duration_cast<std::chrono::seconds>(h2.end_time - h2.start_time);
+    h2.time_between_entries = std::chrono::seconds(step);
+    h2.tiv_compatible = true;
+    h2.target_class = CPFHeader::TargetClassEnum::PASSIVE_LRR;
+    h2.reference_frame = CPFHeader::ReferenceFrameEnum::GEOCENTRIC_BODY_FIXED;
+    h2.rot_angle_type = CPFHeader::RotAngleTypeEnum::NOT_APPLICABLE;
+    h2.com_applied = false;
+    h2.target_dynamics = CPFHeader::TargetDynamicsEnum::EARTH_ORBIT;
+
+    std::vector<CPFData::PositionRecord> positions;
+    positions.reserve(n_positions);
+    ResonanceState resonance;
+    std::array<double, 3> r, v, r_ecef, v_ecef;
+    SGP4Error error = SGP4Error::NOT_ERROR;
+
+    for (std::size_t i = 0; i < n_positions && SGP4Error::NOT_ERROR == error; i++)
+    {
+        const long double jd = jd_start + step_days * static_cast<long double>(i);
+        error = propagate(elements, static_cast<double>((jd - epoch) * 1440.0L), resonance, r, v);
+        if (SGP4Error::NOT_ERROR != error)
+            break;
+
+        temeToECEF(jd, r, v, r_ecef, v_ecef);
+
+        // MJD and second of day, rounded to the microsecond of the CPF records.
+        const long double mjd_datetime = jd - 2400000.5L;
+        long double mjd = std::floor(mjd_datetime);
+        long double sod = std::round((mjd_datetime - mjd) * 86400.0L * 1.0e6L) / 1.0e6L;
+        if (sod >= 86400.0L)
+        {
+            mjd += 1.0L;
+            sod -= 86400.0L;
+        }
+
+        CPFData::PositionRecord record;
+        record.dir_flag = CPFData::DirectionFlagEnum::COMMON_EPOCH;
+        record.mjd = static_cast<int>(mjd);
+        record.sod = sod;
+        record.leap_second = 0;
+        record.geocentric_pos = {r_ecef[0] * 1000.0L, r_ecef[1] * 1000.0L, r_ecef[2] * 1000.0L};
+        positions.push_back(std::move(record));
+    }
+
+    cpf.getHeader().setBasicInfo1Header(h1);
+    cpf.getHeader().setBasicInfo2Header(h2);
+    cpf.getData().setPositionRecords(positions);
+
+    return error;
+}
+
+}} // END NAMESPACES.
+// =====================================================================================================================
@@ -0,0 +1,445 @@
+/***********************************************************************************************************************
+ * Copyright 2023 Degoras Project Team
+ *
+ * Licensed under the EUPL, Version 1.2 or – as soon they will be approved by the
+ * European Commission - subsequent versions of the EUPL (the "Licence");
+ *
+ * You may not use this work except in compliance with the Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * https://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed under the Licence is distributed on
+ * an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the Licence for the
+ * specific language governing permissions and limitations under the Licence.
+ **********************************************************************************************************************/
+
+/** ********************************************************************************************************************
+ * @file tracking.cpp
+ *
+ * @brief This file contains the implementation of the mount tracking tables generation.
+ *
+ * @author    Degoras Project Team.
+ * @version   2310.1
+ * @date      18-10-2023
+ * @copyright EUPL License.
+ *
+ **********************************************************************************************************************/
+
+// ========== DPSLR INCLUDES ===========================================================================================
+#include "includes/tracking.h"
+#include "includes/math_definitions.h"
+#include "includes/sun.h"
+// =====================================================================================================================
+
+// ========== C++ INCLUDES =============================================================================================
+#include <algorithm>
+#include <array>
+#include <cmath>
+// =====================================================================================================================
+
+// ========== DPSLR NAMESPACES =========================================================================================
+namespace dpslr{
+namespace tracking{
+// =====================================================================================================================
+
+namespace
+{
+
+// Unit vector in the local frame of the station (east, north, up).
+using Vector3 = std::array<double, 3>;
+
+constexpr long double kSecondsPerDay = 86400.L;
+constexpr double kMJDToJ2000 = 2400000.5 - 2451545.0;
+constexpr double kPi = static_cast<double>(dpslr::math::pi);
+constexpr double kDegToRad = kPi / 180.;
+constexpr double kRadToDeg = 180. / kPi;
+
+// Minimum knots of the interpolation (the cubic interpolation uses 4).
+constexpr std::size_t kMinKnots = 4;
+
+// If the object goes around the Sun by more than this angle (radians), it is considered a crossing of the Sun, and the
+// mount goes around by the highest side instead of the shortest one.
+constexpr double kSunCrossingAngle = 150. * kDegToRad;
+
+inline double dot(const Vector3& a, const Vector3& b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline Vector3 normalize(const Vector3& a)
+{
+    const double norm = std::sqrt(dot(a, a));
+    return {a[0] / norm, a[1] / norm, a[2] / norm};
+}
+
+inline Vector3 fromAzEl(double az, double el)
+{
+    return {std::cos(el) * std::sin(az), std::cos(el) * std::cos(az), std::sin(el)};
+}
+
+void splitTime(int mjd_start, long double sod_start, long double t, int& mjd, long double& sod)
+{
+    const long double seconds = sod_start + t;
+    const long double days = std::floor(seconds / kSecondsPerDay);
+    mjd = mjd_start + static_cast<int>(days);
+    sod = seconds - days * kSecondsPerDay;
+}
+
+// Frame orthogonal to the Sun direction, with e1 towards the zenith (or the north if the Sun is at the zenith).
+void sunFrame(const Vector3& sun, Vector3& e1, Vector3& e2)
+{
+    const Vector3 ref = std::fabs(sun[2]) < 0.999 ? Vector3{0., 0., 1.} : Vector3{0., 1., 0.};
+    const double proj = dot(ref, sun);
+    e1 = normalize({ref[0] - proj * sun[0], ref[1] - proj * sun[1], ref[2] - proj * sun[2]});
+    e2 = {sun[1] * e1[2] - sun[2] * e1[1], sun[2] * e1[0] - sun[0] * e1[2], sun[0] * e1[1] - sun[1] * e1[0]};
+}
+
+// Direction at the angle rho from the Sun and the position angle phi around it.
+Vector3 sunPolarPoint(const Vector3& sun, double rho, double phi)
+{
+    Vector3 e1, e2;
+    sunFrame(sun, e1, e2);
+    const double cos_rho = std::cos(rho), sin_rho = std::sin(rho);
+    const double c = sin_rho * std::cos(phi), s = sin_rho * std::sin(phi);
+    return {cos_rho * sun[0] + c * e1[0] + s * e2[0],
+            cos_rho * sun[1] + c * e1[1] + s * e2[1],
+            cos_rho * sun[2] + c * e1[2] + s * e2[2]};
+}
+
+double positionAngle(const Vector3& sun, const Vector3& p)
+{
+    Vector3 e1, e2;
+    sunFrame(sun, e1, e2);
+    return std::atan2(dot(p, e2), dot(p, e1));
+}
+
+inline double separation(const Vector3& sun, const Vector3& p)
+{
+    return std::acos(std::max(-1., std::min(1., dot(sun, p))));
+}
+
+// Cubic Hermite polynomial in [0, 1], and its derivative.
+inline double hermite(double p0, double m0, double p1, double m1, double s)
+{
+    const double s2 = s * s, s3 = s2 * s;
+    return (2. * s3 - 3. * s2 + 1.) * p0 + (s3 - 2. * s2 + s) * m0 + (-2. * s3 + 3. * s2) * p1 + (s3 - s2) * m1;
+}
+
+inline double hermiteRate(double p0, double m0, double p1, double m1, double s)
+{
+    const double s2 = s * s;
+    return (6. * s2 - 6. * s) * p0 + (3. * s2 - 4. * s + 1.) * m0 + (-6. * s2 + 6. * s) * p1 + (3. * s2 - 2. * s) * m1;
+}
+
+// Moves the positions inside the Sun exclusion cone to its border. The positions are handled in polar coordinates
+// around the Sun. Inside the cone enlarged by the margin, the angle to the Sun is clamped smoothly to the radius, and
+// the position angle goes from the entry to the exit with a cubic transition, so the velocity is continuous.
+void avoidSun(std::vector<Vector3>& pos, const std::vector<Vector3>& sun, double radius, double margin,
+              std::vector<char>& avoided)
+{
+    const std::size_t n = pos.size();
+    const double outer = radius + margin;
+    std::size_t i = 0;
+
+    auto phi_rate = [&](std::size_t k)
+    {
+        const std::size_t k0 = k > 0 ? k - 1 : k, k1 = k + 1 < n ? k + 1 : k;
+        if (k0 == k1)
+            return 0.;
+        return std::remainder(positionAngle(sun[k1], pos[k1]) - positionAngle(sun[k0], pos[k0]), 2. * kPi) /
+                (k1 - k0);
+    };
+
+    while (i < n)
+    {
+        if (separation(sun[i], pos[i]) >= outer)
+        {
+            i++;
+            continue;
+        }
+
+        const std::size_t first = i;
+        while (i < n && separation(sun[i], pos[i]) < outer)
+            i++;
+        const std::size_t last = i - 1;
+
+        // Anchors out of the enlarged cone (if the run is not at the table limits).
+        const std::size_t a = first > 0 ? first - 1 : first, b = last + 1 < n ? last + 1 : last;
+        const double length = static_cast<double>(std::max<std::size_t>(b - a, 1));
+        const double phi_a = positionAngle(sun[a], pos[a]);
+        const double m_a = phi_rate(a) * length, m_b = phi_rate(b) * length;
+        double dphi = std::remainder(positionAngle(sun[b], pos[b]) - phi_a, 2. * kPi);
+
+        // Crossing of the Sun. Both sides are similar, so the highest one is used.
+        if (std::fabs(dphi) > kSunCrossingAngle)
+        {
+            const std::size_t mid = (a + b) / 2;
+            const double dphi_other = dphi - std::copysign(2. * kPi, dphi);
+            if (sunPolarPoint(sun[mid], radius, hermite(phi_a, m_a, phi_a + dphi_other, m_b, 0.5))[2] >
+                    sunPolarPoint(sun[mid], radius, hermite(phi_a, m_a, phi_a + dphi, m_b, 0.5))[2])
+                dphi = dphi_other;
+        }
+
+        for (std::size_t k = first; k <= last; k++)
+        {
+            // Smooth clamp of the angle to the Sun, continuous with its derivative at the margin limits.
+            const double x = separation(sun[k], pos[k]) - radius;
+            const double rho = radius + (x <= -margin ? 0. : (x + margin) * (x + margin) / (4. * margin));
+            const double phi = hermite(phi_a, m_a, phi_a + dphi, m_b, (k - a) / length);
+            pos[k] = sunPolarPoint(sun[k], rho, phi);
+            avoided[k] = true;
+        }
+    }
+}
+
+// Replaces the azimuth (unwrapped, radians) of the keyholes by cubic transitions with the rate under the maximum.
+void smoothKeyholes(std::vector<double>& az, const std::vector<double>& el, double keyhole_elev, double max_rate,
+                    double dt, std::vector<char>& smoothed)
+{
+    const std::size_t n = az.size();
+    const std::vector<double> raw = az;
+    auto raw_rate = [&](std::size_t k)
+    {
+        const std::size_t k0 = k > 0 ? k - 1 : k, k1 = k + 1 < n ? k + 1 : k;
+        return (raw[k1] - raw[k0]) / ((k1 - k0) * dt);
+    };
+
+    std::size_t i = 0;
+    while (i < n)
+    {
+        if (el[i] <= keyhole_elev)
+        {
+            i++;
+            continue;
+        }
+
+        std::size_t first = i;
+        double peak_rate = 0.;
+        while (i < n && el[i] > keyhole_elev)
+            peak_rate = std::max(peak_rate, std::fabs(raw_rate(i++)));
+        std::size_t last = i - 1;
+
+        if (peak_rate <= max_rate || n < 3)
+            continue;
+
+        // The transition goes between the positions out of the keyhole, which is enlarged until the rate is valid.
+        std::size_t a = first > 0 ? first - 1 : 0, b = std::min(last + 1, n - 1);
+        std::vector<double> transition;
+        while (true)
+        {
+            const double length = (b - a) * dt;
+            const double p0 = raw[a], p1 = raw[b];
+            const double m0 = raw_rate(a) * length, m1 = raw_rate(b) * length;
+            double max_transition_rate = 0.;
+
+            transition.resize(b - a + 1);
+            for (std::size_t k = a; k <= b; k++)
+            {
+                const double s = static_cast<double>(k - a) / (b - a);
+                transition[k - a] = hermite(p0, m0, p1, m1, s);
+                max_transition_rate = std::max(max_transition_rate, std::fabs(hermiteRate(p0, m0, p1, m1, s)) /
+                                               length);
+            }
+
+            if (max_transition_rate <= max_rate || (a == 0 && b == n - 1))
+                break;
+
+            const std::size_t grow = std::max<std::size_t>(1, (b - a) / 4);
+            a = a > grow ? a - grow : 0;
+            b = std::min(b + grow, n - 1);
+        }
+
+        for (std::size_t k = a; k <= b; k++)
+        {
+            az[k] = transition[k - a];
+            smoothed[k] = true;
+        }
+        i = std::max(i, b + 1);
+    }
+}
+
+// Central differences (one side at the ends).
+void differentiate(const std::vector<double>& values, double dt, std::vector<double>& diff)
+{
+    const std::size_t n = values.size();
+    diff.resize(n);
+    if (n < 2)
+    {
+        std::fill(diff.begin(), diff.end(), 0.);
+        return;
+    }
+    for (std::size_t k = 1; k + 1 < n; k++)
+        diff[k] = (values[k + 1] - values[k - 1]) / (2. * dt);
+    diff[0] = (values[1] - values[0]) / dt;
+    diff[n - 1] = (values[n - 1] - values[n - 2]) / dt;
+}
+
+}
+
+TrackingError generateTrackingTable(const CPF &cpf, const geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                                    const geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                                    int mjd, long double sod_start, long double duration,
+                                    const TrackingConfig &config, TrackingTable &table)
+{
+    table.points.clear();
+    table.min_sun_separation = 180.;
+    table.max_az_rate = 0.;
+    table.max_el_rate = 0.;
+    table.sun_avoidance = false;
+    table.keyhole = false;
+
+    if (cpf.empty() || cpf.getData().positionRecords().empty())
+        return TrackingError::CPF_DATA_EMPTY;
+
+    if (!(duration > 0.L) || !(config.rate > 0.) || !(config.knot_step > 0.) || !(config.max_az_rate > 0.) ||
+            config.sun_avoid_angle < 0. || config.sun_avoid_angle >= 90. || !(config.sun_margin > 0.) ||
+            config.az_max <= config.az_min)
+        return TrackingError::CONFIG_NOT_VALID;
+
+    // Knots, at a uniform step that divides the interval.
+    const std::size_t knots = std::max<std::size_t>(kMinKnots,
+            static_cast<std::size_t>(std::ceil(duration / config.knot_step)) + 1);
+    const long double knot_step = duration / (knots - 1);
+
+    geo::frames::GeodeticPoint<long double> geodetic_deg = stat_geodetic;
+    geodetic_deg.convert(geo::meas::Angle<long double>::Unit::DEGREES, geo::meas::Distance<long double>::Unit::METRES);
+    const double lat = static_cast<double>(static_cast<long double>(geodetic_deg.lat));
+    const double lon = static_cast<double>(static_cast<long double>(geodetic_deg.lon));
+
+    const cpfutils::CPFInterpolator interpolator(cpf, stat_geodetic, stat_geocentric);
+    std::vector<Vector3> knot_pos(knots), knot_sun(knots);
+    bool failed = false;
+
+    for (std::size_t k = 0; k < knots && !failed; k++)
+    {
+        int mjd_k;
+        long double sod_k;
+        splitTime(mjd, sod_start, k * knot_step, mjd_k, sod_k);
+
+        cpfutils::CPFInterpolator::InterpolationResult result;
+        const auto error = interpolator.interpolate(mjd_k, sod_k, result);
+        failed = cpfutils::CPFInterpolator::NOT_ERROR != error &&
+                cpfutils::CPFInterpolator::INTERPOLATION_NOT_IN_THE_MIDDLE != error;
+        knot_pos[k] = fromAzEl(result.azimuth * kDegToRad, result.elevation * kDegToRad);
+
+        double sun_az, sun_el;
+        sun::simpleSunPosition(static_cast<double>(mjd_k + kMJDToJ2000 + sod_k / kSecondsPerDay), lat, lon, false,
+                               sun_az, sun_el);
+        knot_sun[k] = fromAzEl(sun_az * kDegToRad, sun_el * kDegToRad);
+    }
+
+    if (failed)
+        return TrackingError::INTERPOLATION_FAILED;
+
+    // Positions of the table. The object is interpolated with cubic Lagrange polynomials and the Sun linearly.
+    const std::size_t n = static_cast<std::size_t>(std::floor(duration * config.rate + 1e-6L)) + 1;
+    const double dt = 1. / config.rate;
+    const double inv_knot_step = static_cast<double>(1.L / knot_step);
+    std::vector<Vector3> pos(n), sun(n);
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const double u = i * dt * inv_knot_step;
+        const std::size_t k = std::min(static_cast<std::size_t>(u), knots - 2);
+        const std::size_t k0 = std::min(k > 0 ? k - 1 : 0, knots - kMinKnots);
+        const double s = u - k0;
+        const double w[4] = {-(s - 1.) * (s - 2.) * (s - 3.) / 6., s * (s - 2.) * (s - 3.) / 2.,
+                             -s * (s - 1.) * (s - 3.) / 2., s * (s - 1.) * (s - 2.) / 6.};
+        const double f = u - k;
+
+        Vector3 p{0., 0., 0.}, q;
+        for (std::size_t c = 0; c < 3; c++)
+        {
+            for (std::size_t j = 0; j < 4; j++)
+                p[c] += w[j] * knot_pos[k0 + j][c];
+            q[c] = (1. - f) * knot_sun[k][c] + f * knot_sun[k + 1][c];
+        }
+        pos[i] = normalize(p);
+        sun[i] = normalize(q);
+    }
+
+    table.points.resize(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        TrackingPoint& point = table.points[i];
+        splitTime(mjd, sod_start, i * dt, point.mjd, point.sod);
+        point.sun_separation = separation(sun[i], pos[i]) * kRadToDeg;
+        table.min_sun_separation = std::min(table.min_sun_separation, point.sun_separation);
+    }
+
+    std::vector<char> avoided(n, false), smoothed(n, false);
+    if (config.sun_avoid_angle > 0.)
+        avoidSun(pos, sun, config.sun_avoid_angle * kDegToRad, config.sun_margin * kDegToRad, avoided);
+
+    // Unwrapped azimuth and elevation.
+    std::vector<double> az(n), el(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        az[i] = std::atan2(pos[i][0], pos[i][1]);
+        el[i] = std::atan2(pos[i][2], std::hypot(pos[i][0], pos[i][1]));
+        if (i > 0)
+            az[i] = az[i - 1] + std::remainder(az[i] - az[i - 1], 2. * kPi);
+    }
+
+    smoothKeyholes(az, el, config.keyhole_elev * kDegToRad, config.max_az_rate * kDegToRad, dt, smoothed);
+
+    // Shift by turns to fit in the mount limits, with the middle of the pass as near as possible to the middle of the
+    // limits.
+    for (std::size_t i = 0; i < n; i++)
+    {
+        az[i] *= kRadToDeg;
+        el[i] *= kRadToDeg;
+    }
+    const auto az_range = std::minmax_element(az.begin(), az.end());
+    const double turn_min = std::ceil((config.az_min - *az_range.first) / 360.);
+    const double turn_max = std::floor((config.az_max - *az_range.second) / 360.);
+    if (turn_min > turn_max)
+    {
+        table.points.clear();
+        return TrackingError::AZIMUTH_LIMITS_EXCEEDED;
+    }
+    const double middle = 0.5 * (*az_range.first + *az_range.second);
+    const double turns = std::max(turn_min, std::min(turn_max, std::round((0.5 * (config.az_min + config.az_max) -
+                                                                         middle) / 360.)));
+    for (auto& value : az)
+        value += 360. * turns;
+
+    std::vector<double> az_rate, el_rate, az_accel, el_accel;
+    differentiate(az, dt, az_rate);
+    differentiate(el, dt, el_rate);
+    differentiate(az_rate, dt, az_accel);
+    differentiate(el_rate, dt, el_accel);
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        TrackingPoint& point = table.points[i];
+        point.az = az[i];
+        point.el = el[i];
+        point.az_rate = az_rate[i];
+        point.el_rate = el_rate[i];
+        point.az_accel = az_accel[i];
+        point.el_accel = el_accel[i];
+        point.sun_avoidance = avoided[i];
+        point.keyhole = smoothed[i];
+        table.max_az_rate = std::max(table.max_az_rate, std::fabs(az_rate[i]));
+        table.max_el_rate = std::max(table.max_el_rate, std::fabs(el_rate[i]));
+        table.sun_avoidance |= point.sun_avoidance;
+        table.keyhole |= point.keyhole;
+    }
+
+    return TrackingError::NOT_ERROR;
+}
+
+TrackingError generateTrackingTable(const CPF &cpf, const geo::frames::GeodeticPoint<long double> &stat_geodetic,
+                                    const geo::frames::GeocentricPoint<long double> &stat_geocentric,
+                                    const cpfutils::Pass &pass, const TrackingConfig &config, TrackingTable &table)
+{
+    const long double duration = (pass.end.mjd - pass.start.mjd) * kSecondsPerDay + pass.end.fract_day -
+            pass.start.fract_day;
+    return generateTrackingTable(cpf, stat_geodetic, stat_geocentric, pass.start.mjd, pass.start.fract_day, duration,
+                                 config, table);
+}
+
+}} // END NAMESPACES.
+// =====================================================================================================================
@@ -4,7 +4,9 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QSortFilterProxyModel>
+#include <QRegularExpression>
 #include <QSet>
+#include <QHash>
 
 #include "libjsontablemodel_global.h"
 
@@ -103,11 +105,50 @@ protected:
     virtual QJsonValue QvariantToJsonvalue(const QVariant& variant, const QString& type) const;
     virtual QVariant jsonvalueToQvariant(const QJsonValue &value, const QString &type, int role = DISPLAY_ROLE) const;
 
+    // Normalized representation of a value used for the uniqueness checks.
+    static QString uniqueKey(const QJsonValue& value);
+
+    // Must be called if the unique columns of jsonarray are modified directly by derived classes.
+    void invalidateUniqueIndex();
+
+    // Must be called if a row of jsonarray is modified directly by derived classes, to keep the cached cell values.
+    // If many rows are modified, the whole cache can be rebuilt instead.
+    void updateCachedRow(int row);
+    void rebuildCache();
+
     // Class members.
     HeaderList header;
     QJsonArray jsonarray;
     EditedObjectsMap edited_rows;
     QJsonObject json_emtpy_object;
+
+private:
+    // Number of rows using each normalized value, for each unique column. It is built when the data integrity is
+    // checked and updated with every change, so an edited row can be checked without comparing it with all the rows.
+    typedef QHash<QString, int> UniqueValuesCount;
+
+    ErrorIndexList indexRows() const;
+    void updateUniqueIndex(const QJsonObject& object, int delta);
+
+    mutable QHash<int, UniqueValuesCount> unique_index;
+    mutable bool unique_index_valid;
+
+    // Converted cell values of the stored data, one vector per column and role (DIRECT_ROLE, DISPLAY_ROLE and
+    // OBJECT_ROLE). The vectors are built when the data is set and updated with every change, so views, sorting and
+    // filtering do not convert the json objects in each call to data, and data never writes the cache (it can be
+    // read from several threads).
+    static constexpr int kCachedRoles = 3;
+
+    struct ColumnCache
+    {
+        QVector<QVariant> values[kCachedRoles];
+    };
+
+    static int cacheSlot(int role);
+    QVariant cellValue(const QJsonObject& object, int column, int role) const;
+    QVariant cachedValue(int row, int column, int role) const;
+
+    QVector<ColumnCache> column_cache;
 };
 
 class LIBJSONTABLEMODEL_EXPORT JsonTableSortFilterProxyModel : public QSortFilterProxyModel
@@ -117,6 +158,23 @@ class LIBJSONTABLEMODEL_EXPORT JsonTableSortFilterProxyModel : public QSortFilte
 public:
     typedef QHash<int, QString> AppliedFilters;
 
+    // Filter that accepts the rows whose value is one of a set, checked with a hash lookup instead of a regex.
+    struct SetFilter
+    {
+        QSet<QString> values;
+        bool ignore_leading_zeros;
+    };
+    typedef QHash<int, SetFilter> AppliedSetFilters;
+
+    // Filter that accepts the rows whose value (OBJECT_ROLE) is between the limits. The limits can be numbers or
+    // dates. A null limit means no limit.
+    struct RangeFilter
+    {
+        QVariant min;
+        QVariant max;
+    };
+    typedef QHash<int, RangeFilter> AppliedRangeFilters;
+
     explicit JsonTableSortFilterProxyModel(QObject *parent = nullptr);
     explicit JsonTableSortFilterProxyModel(const AppliedFilters& applied_filters, QObject *parent = nullptr);
     virtual bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override;
@@ -125,13 +183,41 @@ public:
 public slots:
     void setFilter(int filter_id, const QString& filter_string = "");
     void unsetFilter(int filter_id);
+    void setSetFilter(int filter_id, const QStringList& values, bool ignore_leading_zeros = false);
+    void unsetSetFilter(int filter_id);
+    void setRangeFilter(int filter_id, const QVariant& min, const QVariant& max);
+    void unsetRangeFilter(int filter_id);
+    void clearFilters();
+
+    // Filter changes between these calls only refilter the model once, at the end.
+    void beginFiltersUpdate();
+    void endFiltersUpdate();
+
     void setMandatoryHide(const QSet<int>& rows);
     void setMandatoryHide(int row);
     void unsetMandatoryHide(int row);
     void clearMandatoryHide();
 
 private:
+    // Regular expression filter compiled once, when the filters or the source columns change.
+    struct CompiledFilter
+    {
+        int column;
+        QRegularExpression regex;
+    };
+
+    static QString normalizeSetValue(const QString& value, bool ignore_leading_zeros);
+    static bool valueInRange(const QVariant& value, const RangeFilter& range);
+
+    void compileFilters();
+    void filtersChanged();
+
     AppliedFilters m_applied_filters;
+    AppliedSetFilters m_applied_set_filters;
+    AppliedRangeFilters m_applied_range_filters;
+    QVector<CompiledFilter> m_compiled_filters;
     QSet<int> m_mandatory_hide_rows;
+    int m_filters_update_depth;
+    bool m_filters_update_pending;
 };
 
@@ -19,63 +19,201 @@ const QMap<JsonTableModel::ErrorEnum, QString> JsonTableModel::ErrorEnumStringMa
     {JsonTableModel::ErrorEnum::MANDATORY_VALUE_EMPTY, "Mandatory value is not valid"}
 };
 
-JsonTableModel::JsonTableModel(QObject *parent) : QAbstractTableModel (parent)
+JsonTableModel::JsonTableModel(QObject *parent) : QAbstractTableModel (parent),
+    unique_index_valid(false)
 {
 }
 
 JsonTableModel::ErrorIndexList JsonTableModel::checkDataIntegrity() const
+{
+    return this->indexRows();
+}
+
+JsonTableModel::ErrorIndexList JsonTableModel::indexRows() const
 {
     JsonTableModel::ErrorIndexList error_list;
 
-    int i = 0;
-    for (auto it = jsonarray.constBegin(); it != jsonarray.constEnd(); it++)
+    // Columns that must be checked. The header properties are read only once.
+    struct ColumnCheck
     {
-        QJsonObject object = it->toObject();
+        int section;
+        QString index;
+        QString type;
+        bool mandatory;
+        bool unique;
+    };
 
-        int j = 0;
-        // Check mandatory format and uniqueness for each column in the row
-        for (const auto& column : header)
+    QVector<ColumnCheck> checks;
+    for (int j = 0; j < header.size(); j++)
+    {
+        const HeadingMap& column = header[j];
+        if (column.contains("Mandatory") || column.contains("Unique"))
+            checks.push_back({j, column["Index"], column["Type"], column.contains("Mandatory"),
+                              column.contains("Unique")});
+    }
+
+    this->unique_index.clear();
+
+    // Check mandatory format and uniqueness for each column in the row. The uniqueness is checked against the values
+    // of the previous rows stored in the index, so only the repeated values are marked.
+    for (int i = 0; i < jsonarray.size(); i++)
+    {
+        const QJsonObject object = jsonarray[i].toObject();
+
+        for (const auto& check : checks)
         {
-            QString column_index = column["Index"];
+            const QJsonValue value = object[check.index];
 
-            if (column.contains("Mandatory"))
+            if (check.mandatory && !checkMandatoryData(value, check.type))
             {
-                auto type = column.find("Type");
-                if (!checkMandatoryData(object[column_index], type.value()))
-                {
-                    error_list.push_back(qMakePair(
-                                             JsonTableModel::ErrorEnum::MANDATORY_VALUE_EMPTY, this->index(i, j)));
-                }
+                error_list.push_back(qMakePair(
+                                         JsonTableModel::ErrorEnum::MANDATORY_VALUE_EMPTY, this->index(i, check.section)));
             }
 
-            if (column.contains("Unique"))
+            // If value is not an empty string, check if it is unique
+            if (check.unique && !(value.isString() && value.toString().isEmpty()))
             {
-                bool unique = true;
-
-                // If value is not an empty string, check if it is unique
-                if (!(object[column_index].isString() && object[column_index].toString().isEmpty()))
+                int& count = this->unique_index[check.section][uniqueKey(value)];
+                if (count > 0)
                 {
-                    // Check uniqueness of the cell with the previous rows
-                    for (auto other = jsonarray.constBegin(); other != it && unique; other++)
-                    {
-                        QJsonObject other_object = other->toObject();
-                        if (other_object[column_index] == object[column_index])
-                        {
-                            unique = false;
-                            error_list.push_back(qMakePair(
-                                                     JsonTableModel::ErrorEnum::VALUE_NOT_UNIQUE, this->index(i,j)));
-                        }
-                    }
+                    error_list.push_back(qMakePair(
+                                             JsonTableModel::ErrorEnum::VALUE_NOT_UNIQUE, this->index(i, check.section)));
                 }
+                count++;
             }
-            j++;
         }
-        i++;
     }
 
+    this->unique_index_valid = true;
+
     return error_list;
 }
 
+QString JsonTableModel::uniqueKey(const QJsonValue &value)
+{
+    // The type is included, so values of different types are always different, as in QJsonValue comparisons.
+    switch (value.type())
+    {
+    case QJsonValue::String:
+        return QLatin1Char('s') + value.toString();
+    case QJsonValue::Double:
+        return QLatin1Char('d') + QString::number(0.0 == value.toDouble() ? 0.0 : value.toDouble(), 'g', 17);
+    case QJsonValue::Bool:
+        return value.toBool() ? QStringLiteral("b1") : QStringLiteral("b0");
+    case QJsonValue::Array:
+        return QLatin1Char('a') + QString::fromUtf8(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+    case QJsonValue::Object:
+        return QLatin1Char('o') + QString::fromUtf8(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+    case QJsonValue::Null:
+        return QStringLiteral("n");
+    default:
+        return QStringLiteral("u");
+    }
+}
+
+void JsonTableModel::invalidateUniqueIndex()
+{
+    this->unique_index_valid = false;
+    this->unique_index.clear();
+}
+
+void JsonTableModel::updateUniqueIndex(const QJsonObject &object, int delta)
+{
+    if (!this->unique_index_valid)
+        return;
+
+    for (int j = 0; j < header.size(); j++)
+    {
+        if (!header[j].contains("Unique"))
+            continue;
+
+        const QJsonValue value = object[header[j]["Index"]];
+        if (value.isString() && value.toString().isEmpty())
+            continue;
+
+        UniqueValuesCount& counts = this->unique_index[j];
+        const QString key = uniqueKey(value);
+        int& count = counts[key];
+        count += delta;
+        if (count <= 0)
+            counts.remove(key);
+    }
+}
+
+int JsonTableModel::cacheSlot(int role)
+{
+    switch (role)
+    {
+    case JsonTableModel::DIRECT_ROLE:
+        return 0;
+    case JsonTableModel::DISPLAY_ROLE:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+QVariant JsonTableModel::cellValue(const QJsonObject &object, int column, int role) const
+{
+    const QString& key = header[column]["Index"];
+    auto it = object.constFind(key);
+    if (it == object.constEnd())
+        return QVariant();
+
+    if (JsonTableModel::DIRECT_ROLE == role)
+        return QVariant(it.value());
+
+    return jsonvalueToQvariant(it.value(), header[column]["Type"], role);
+}
+
+QVariant JsonTableModel::cachedValue(int row, int column, int role) const
+{
+    // Rows added to jsonarray by derived classes without updating the cache are converted in each call.
+    if (column < this->column_cache.size() && row < this->column_cache[column].values[cacheSlot(role)].size())
+        return this->column_cache[column].values[cacheSlot(role)][row];
+
+    return this->cellValue(jsonarray[row].toObject(), column, role);
+}
+
+void JsonTableModel::updateCachedRow(int row)
+{
+    if (row < 0 || row >= rowCount())
+        return;
+
+    const QJsonObject object = jsonarray[row].toObject();
+    const int roles[kCachedRoles] = {JsonTableModel::DIRECT_ROLE, JsonTableModel::DISPLAY_ROLE,
+                                     JsonTableModel::OBJECT_ROLE};
+
+    for (int j = 0; j < this->column_cache.size(); j++)
+    {
+        for (int role : roles)
+        {
+            QVector<QVariant>& values = this->column_cache[j].values[cacheSlot(role)];
+            if (row < values.size())
+                values[row] = this->cellValue(object, j, role);
+        }
+    }
+}
+
+void JsonTableModel::rebuildCache()
+{
+    const int roles[kCachedRoles] = {JsonTableModel::DIRECT_ROLE, JsonTableModel::DISPLAY_ROLE,
+                                     JsonTableModel::OBJECT_ROLE};
+
+    this->column_cache.clear();
+    this->column_cache.resize(header.size());
+    for (int j = 0; j < header.size(); j++)
+    {
+        for (int role : roles)
+        {
+            QVector<QVariant>& values = this->column_cache[j].values[cacheSlot(role)];
+            values.reserve(jsonarray.size());
+            for (const auto& value : jsonarray)
+                values.push_back(this->cellValue(value.toObject(), j, role));
+        }
+    }
+}
+
 bool JsonTableModel::checkMandatoryData(const QJsonValue &value, const QString &type) const
 {
     if ((type == "Date" || type == "Time" || type == "WeekDay" || type == "DateTime"))
@@ -216,10 +354,16 @@ JsonTableModel::ErrorList JsonTableModel::checkEditedRowIntegrity(int row) const
     if (it != edited_rows.end())
     {
         const QJsonObject& object = it.value();
+        const QJsonObject stored_object = (row >= 0 && row < rowCount()) ? jsonarray[row].toObject() : QJsonObject();
+
+        // The unique values index is needed for checking the uniqueness.
+        if (!this->unique_index_valid)
+            this->indexRows();
 
         // Check mandatory format and uniqueness for each column in the row
-        for (const auto& column : header)
+        for (int j = 0; j < header.size(); j++)
         {
+            const HeadingMap& column = header[j];
             QString column_index = column["Index"];
 
             if (column.contains("Mandatory"))
@@ -232,28 +376,21 @@ JsonTableModel::ErrorList JsonTableModel::checkEditedRowIntegrity(int row) const
                 }
             }
 
-            if (column.contains("Unique"))
+            // If value is not an empty string, check if it is unique. The stored value of this row does not count.
+            if (column.contains("Unique") &&
+                    !(object[column_index].isString() && object[column_index].toString().isEmpty()))
             {
-                bool unique = true;
-                int other_row = 0;
-
-                // If value is not an empty string, check if it is unique
-                if (!(object[column_index].isString() && object[column_index].toString().isEmpty()))
+                const QString key = uniqueKey(object[column_index]);
+                int count = this->unique_index.value(j).value(key);
+                const QJsonValue stored_value = stored_object[column_index];
+                if (count > 0 && !(stored_value.isString() && stored_value.toString().isEmpty()) &&
+                        uniqueKey(stored_value) == key)
+                    count--;
+
+                if (count > 0)
                 {
-                    while ( unique && other_row < rowCount())
-                    {
-                        if (row != other_row &&
-                                jsonarray[other_row].toObject()[column_index] == object[column_index])
-                        {
-                            unique = false;
-                            error_list.push_back(qMakePair(
-                                                     JsonTableModel::ErrorEnum::VALUE_NOT_UNIQUE, column["Index"]));
-                        }
-                        else
-                        {
-                            other_row++;
-                        }
-                    }
+                    error_list.push_back(qMakePair(
+                                             JsonTableModel::ErrorEnum::VALUE_NOT_UNIQUE, column["Index"]));
                 }
             }
         }
@@ -276,7 +413,10 @@ JsonTableModel::ErrorList JsonTableModel::submitEditedRow(int row)
 
         if (errors.isEmpty())
         {
+            this->updateUniqueIndex(jsonarray[row].toObject(), -1);
+            this->updateUniqueIndex(edited_rows[row], 1);
             jsonarray.replace(row, edited_rows[row]);
+            this->updateCachedRow(row);
             edited_rows.remove(row);
             emit dataChanged(index(row, 0), index(row, columnCount() - 1));
         }
@@ -371,6 +511,8 @@ JsonTableModel::ErrorIndexList JsonTableModel::setJsonData(const QJsonArray& jso
     ErrorIndexList error_list = checkDataIntegrity();
     if(!error_list.isEmpty())
         this->clearContents();
+    else
+        this->rebuildCache();
     this->endResetModel();
     return error_list;
 }
@@ -379,6 +521,9 @@ void JsonTableModel::clearContents()
 {
     this->beginResetModel();
     this->jsonarray = QJsonArray();
+    this->rebuildCache();
+    this->unique_index.clear();
+    this->unique_index_valid = true;
     this->endResetModel();
 }
 
@@ -386,6 +531,7 @@ JsonTableModel::ErrorEnum JsonTableModel::setJsonScheme(const QJsonArray &scheme
 {
     // Clean
     this->header.clear();
+    this->invalidateUniqueIndex();
     // Set the header using the scheme.
     for(const auto& value : scheme)
     {
@@ -465,40 +611,11 @@ QVariant JsonTableModel::data(const QModelIndex &index, int role) const
     switch(role)
     {
     case JsonTableModel::DIRECT_ROLE:
-    {
-        if (index.column() >= 0 && index.column() < columnCount() && index.row() >= 0 && index.row() < rowCount())
-        {
-            QJsonObject obj = jsonarray[index.row()].toObject();
-            const QString& key = header[index.column()]["Index"];
-            if(obj.contains(key))
-                return QVariant(obj[key]);
-
-        }
-        break;
-    }
     case JsonTableModel::DISPLAY_ROLE:
-    {
-        if (index.column() >= 0 && index.column() < columnCount() && index.row() >= 0 && index.row() < rowCount())
-        {
-            QJsonObject obj = jsonarray[index.row()].toObject();
-            const QString& key = header[index.column()]["Index"];
-            if( obj.contains( key ))
-                return jsonvalueToQvariant(obj[key], header[index.column()]["Type"], JsonTableModel::DISPLAY_ROLE);
-        }
-        break;
-    }
     case JsonTableModel::OBJECT_ROLE:
     {
         if (index.column() >= 0 && index.column() < columnCount() && index.row() >= 0 && index.row() < rowCount())
-        {
-            QJsonObject obj = jsonarray[index.row()].toObject();
-            const QString& key = header[index.column()]["Index"];
-            if( obj.contains( key ))
-            {
-                QJsonValue v = obj[ key ];
-                return jsonvalueToQvariant(v, header[index.column()]["Type"], JsonTableModel::OBJECT_ROLE);
-            }
-        }
+            return this->cachedValue(index.row(), index.column(), role);
         break;
     }
     case JsonTableModel::EDIT_ROLE:
@@ -564,8 +681,11 @@ bool JsonTableModel::setData(const QModelIndex &index, const QVariant &value, in
                 const QString& key = header[index.column()]["Index"];
                 if(obj.contains(key))
                 {
+                    this->updateUniqueIndex(obj, -1);
                     obj[key] = QvariantToJsonvalue(value, header[index.column()]["Type"]);
+                    this->updateUniqueIndex(obj, 1);
                     jsonarray.replace(index.row(), obj);
+                    this->updateCachedRow(index.row());
 
                     emit dataChanged(index, index);
 
@@ -587,6 +707,11 @@ bool JsonTableModel::insertRows(int row, int count, const QModelIndex &parent)
     for (int i = row; i < row + count; i++)
     {
         this->jsonarray.insert(i, json_emtpy_object);
+        this->updateUniqueIndex(json_emtpy_object, 1);
+        for (int j = 0; j < this->column_cache.size(); j++)
+            for (int slot = 0; slot < kCachedRoles; slot++)
+                this->column_cache[j].values[slot].insert(i, QVariant());
+        this->updateCachedRow(i);
     }
     this->endInsertRows();
     return true;
@@ -597,23 +722,31 @@ bool JsonTableModel::removeRows(int row, int count, const QModelIndex &parent)
     this->beginRemoveRows(parent, row, row + count - 1);
     for (int i = row; i < row + count; i++)
     {
-        this->jsonarray.takeAt(i);  // Qt Bug. We cant use remove. Ask Angel Vera or Jesus Relinque.
+        // Qt Bug. We cant use remove. Ask Angel Vera or Jesus Relinque.
+        this->updateUniqueIndex(this->jsonarray.takeAt(i).toObject(), -1);
+        for (int j = 0; j < this->column_cache.size(); j++)
+            for (int slot = 0; slot < kCachedRoles; slot++)
+                this->column_cache[j].values[slot].removeAt(i);
     }
     this->endRemoveRows();
     return true;
 }
 
 JsonTableSortFilterProxyModel::JsonTableSortFilterProxyModel(QObject *parent) :
-    QSortFilterProxyModel (parent)
+    QSortFilterProxyModel (parent),
+    m_filters_update_depth(0),
+    m_filters_update_pending(false)
 {
 
 }
 
 JsonTableSortFilterProxyModel::JsonTableSortFilterProxyModel(
         const JsonTableSortFilterProxyModel::AppliedFilters &applied_filters, QObject *parent) :
-    QSortFilterProxyModel(parent),m_applied_filters(applied_filters)
+    QSortFilterProxyModel(parent),m_applied_filters(applied_filters),
+    m_filters_update_depth(0),
+    m_filters_update_pending(false)
 {
-
+    this->compileFilters();
 }
 
 bool JsonTableSortFilterProxyModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
@@ -622,18 +755,28 @@ bool JsonTableSortFilterProxyModel::filterAcceptsRow(int source_row, const QMode
         return false;
 
     bool accept = true;
+    const QAbstractItemModel* source = sourceModel();
 
-    AppliedFilters::const_iterator it = m_applied_filters.cbegin();
+    // Set filters first, since they are cheaper than the regular expressions.
+    for (auto set_it = m_applied_set_filters.cbegin(); set_it != m_applied_set_filters.cend() && accept; set_it++)
+    {
+        QModelIndex column_index = source->index(source_row, set_it.key(), source_parent);
+        QString value = source->data(column_index).toString();
+        accept = set_it->values.contains(normalizeSetValue(value, set_it->ignore_leading_zeros));
+    }
 
-    while (it != m_applied_filters.end() && accept)
+    for (auto range_it = m_applied_range_filters.cbegin(); range_it != m_applied_range_filters.cend() && accept;
+         range_it++)
     {
-        QModelIndex column_index = sourceModel()->index(source_row, it.key(), source_parent);
-        QVariant value = sourceModel()->data(column_index);
+        QModelIndex column_index = source->index(source_row, range_it.key(), source_parent);
+        accept = valueInRange(source->data(column_index, JsonTableModel::OBJECT_ROLE), range_it.value());
+    }
+
+    for (auto filter_it = m_compiled_filters.cbegin(); filter_it != m_compiled_filters.cend() && accept; filter_it++)
+    {
+        QVariant value = source->data(source->index(source_row, filter_it->column, source_parent));
         if (value.canConvert<QString>())
-        {
-            accept = accept && value.toString().contains(QRegularExpression(it.value()));
-        }
-        it++;
+            accept = filter_it->regex.match(value.toString()).hasMatch();
     }
 
     return accept && QSortFilterProxyModel::filterAcceptsRow(source_row, source_parent);
@@ -652,18 +795,154 @@ void JsonTableSortFilterProxyModel::setSourceModel(QAbstractItemModel *sourceMod
     QObject::connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset,
                      this, &JsonTableSortFilterProxyModel::clearMandatoryHide);
 
+    // The compiled filters depend on the source columns.
+    QObject::connect(sourceModel, &QAbstractItemModel::headerDataChanged,
+                     this, &JsonTableSortFilterProxyModel::compileFilters);
+    QObject::connect(sourceModel, &QAbstractItemModel::columnsInserted,
+                     this, &JsonTableSortFilterProxyModel::compileFilters);
+    QObject::connect(sourceModel, &QAbstractItemModel::columnsRemoved,
+                     this, &JsonTableSortFilterProxyModel::compileFilters);
+    QObject::connect(sourceModel, &QAbstractItemModel::modelReset,
+                     this, &JsonTableSortFilterProxyModel::compileFilters);
+
     QSortFilterProxyModel::setSourceModel(sourceModel);
+    this->compileFilters();
 }
 
 void JsonTableSortFilterProxyModel::setFilter(int filter_id, const QString &filter_string)
 {
     this->m_applied_filters[filter_id] = filter_string;
-    this->invalidateFilter();
+    this->filtersChanged();
 }
 
 void JsonTableSortFilterProxyModel::unsetFilter(int filter_id)
 {
     this->m_applied_filters.remove(filter_id);
+    this->filtersChanged();
+}
+
+void JsonTableSortFilterProxyModel::setSetFilter(int filter_id, const QStringList &values, bool ignore_leading_zeros)
+{
+    // The values are normalized once here, so each row only needs a lookup.
+    SetFilter filter{QSet<QString>(), ignore_leading_zeros};
+    filter.values.reserve(values.size());
+    for (const auto& value : values)
+        filter.values.insert(normalizeSetValue(value, ignore_leading_zeros));
+
+    this->m_applied_set_filters[filter_id] = filter;
+    this->filtersChanged();
+}
+
+void JsonTableSortFilterProxyModel::unsetSetFilter(int filter_id)
+{
+    this->m_applied_set_filters.remove(filter_id);
+    this->filtersChanged();
+}
+
+void JsonTableSortFilterProxyModel::setRangeFilter(int filter_id, const QVariant &min, const QVariant &max)
+{
+    this->m_applied_range_filters[filter_id] = {min, max};
+    this->filtersChanged();
+}
+
+void JsonTableSortFilterProxyModel::unsetRangeFilter(int filter_id)
+{
+    this->m_applied_range_filters.remove(filter_id);
+    this->filtersChanged();
+}
+
+void JsonTableSortFilterProxyModel::clearFilters()
+{
+    this->m_applied_filters.clear();
+    this->m_applied_set_filters.clear();
+    this->m_applied_range_filters.clear();
+    this->filtersChanged();
+}
+
+void JsonTableSortFilterProxyModel::beginFiltersUpdate()
+{
+    this->m_filters_update_depth++;
+}
+
+void JsonTableSortFilterProxyModel::endFiltersUpdate()
+{
+    if (this->m_filters_update_depth > 0)
+        this->m_filters_update_depth--;
+
+    if (0 == this->m_filters_update_depth && this->m_filters_update_pending)
+    {
+        this->m_filters_update_pending = false;
+        this->compileFilters();
+        this->invalidateFilter();
+    }
+}
+
+QString JsonTableSortFilterProxyModel::normalizeSetValue(const QString &value, bool ignore_leading_zeros)
+{
+    QString normalized = value.trimmed();
+    if (ignore_leading_zeros)
+    {
+        int first = 0;
+        while (first < normalized.size() - 1 && '0' == normalized[first])
+            first++;
+        normalized.remove(0, first);
+    }
+    return normalized;
+}
+
+bool JsonTableSortFilterProxyModel::valueInRange(const QVariant &value, const RangeFilter &range)
+{
+    if (!value.isValid())
+        return false;
+
+    // Dates are compared as dates, everything else as numbers.
+    auto isDate = [](const QVariant& limit)
+    {
+        return QMetaType::QDateTime == limit.userType() || QMetaType::QDate == limit.userType();
+    };
+
+    if (isDate(range.min) || isDate(range.max))
+    {
+        const QDateTime datetime = value.toDateTime();
+        if (!datetime.isValid())
+            return false;
+        return (range.min.isNull() || datetime >= range.min.toDateTime()) &&
+               (range.max.isNull() || datetime <= range.max.toDateTime());
+    }
+
+    bool ok = false;
+    const double number = value.toDouble(&ok);
+    return ok && (range.min.isNull() || number >= range.min.toDouble()) &&
+           (range.max.isNull() || number <= range.max.toDouble());
+}
+
+void JsonTableSortFilterProxyModel::compileFilters()
+{
+    this->m_compiled_filters.clear();
+    this->m_compiled_filters.reserve(this->m_applied_filters.size());
+
+    const int column_count = sourceModel() ? sourceModel()->columnCount() : 0;
+    for (auto it = this->m_applied_filters.cbegin(); it != this->m_applied_filters.cend(); it++)
+    {
+        // Filters for columns that do not exist in the source can not reject rows.
+        if (sourceModel() && (it.key() < 0 || it.key() >= column_count))
+            continue;
+
+        QRegularExpression regex(it.value());
+        regex.optimize();
+        this->m_compiled_filters.push_back({it.key(), regex});
+    }
+}
+
+void JsonTableSortFilterProxyModel::filtersChanged()
+{
+    if (this->m_filters_update_depth > 0)
+    {
+        this->m_filters_update_pending = true;
+        return;
+    }
+
+    this->compileFilters();
     this->invalidateFilter();
 }
 